@@ -57,6 +57,7 @@
 #include <86box/pci.h>
 #include <86box/timer.h>
 #include <86box/device.h>
+#include <86box/device_prof.h>
 #include <86box/pit.h>
 #include <86box/random.h>
 #include <86box/nvr.h>
@@ -192,6 +193,8 @@ int      confirm_reset                          = 1;              /* (G) enable
 int      confirm_exit                           = 1;              /* (G) enable exit confirmation */
 int      confirm_save                           = 1;              /* (G) enable save confirmation */
 int      chd_precache_level                     = 0;              /* (G) CHD precache level */
+int      chd_cache_size                         = CHD_CACHE_SIZE_DEFAULT; /* (G) CHD hunk cache size in MB */
+int      chd_read_ahead                         = CHD_READ_AHEAD_DEFAULT; /* (G) CHD hunks to decompress ahead */
 int      enable_discord                         = 0;              /* (C) enable Discord integration */
 int      pit_mode                               = -1;             /* (C) force setting PIT mode */
 int      fm_driver                              = 0;              /* (C) select FM sound driver */
@@ -1526,6 +1529,10 @@ pc_init_modules(void)
 
     random_init();
 
+    /* Periodic dumps of the per-device host time imply counting from the start. */
+    if (device_prof_interval > 0)
+        device_prof_enable(1);
+
     mem_init();
 
 #ifdef USE_DYNAREC
@@ -1933,6 +1940,9 @@ pc_close(UNUSED(thread_t *ptr))
 
     nvr_save();
 
+    if (device_prof_on && (device_prof_interval > 0))
+        device_prof_dump();
+
     plat_mouse_capture(0);
 
     /* Close all the memory mappings. */
@@ -1968,6 +1978,8 @@ pc_close(UNUSED(thread_t *ptr))
 
     sound_cd_thread_end();
 
+    sound_mix_thread_end();
+
     cdrom_close();
 
     rdisk_close();
@@ -2027,6 +2039,8 @@ pc_run(void)
     joystick_process(0); // Gameport 0
     endblit();
 
+    device_prof_frame();
+
     /* Done with this frame, update statistics. */
     framecount++;
     if (++framecountx >= (force_10ms ? 100 : 1000)) {
@@ -16,6 +16,7 @@
 #ifdef ENABLE_CDROM_LOG
 #include <stdarg.h>
 #endif
+#include <stdatomic.h>
 #include <stdint.h>
 #include <stdbool.h>
 #include <stdio.h>
@@ -41,6 +42,7 @@
 #include <86box/scsi_device.h>
 #include <86box/scsi_cdrom.h>
 #include <86box/sound.h>
+#include <86box/thread.h>
 #include <86box/ui.h>
 
 #define RAW_SECTOR_SIZE    2352
@@ -48,8 +50,55 @@
 #define MIN_SEEK           2000
 #define MAX_SEEK           333333
 
+/* Raw sector plus the 96 bytes of interleaved subchannel data. */
+#define STREAM_RAW_SIZE    (RAW_SECTOR_SIZE + 96)
+
+typedef struct cdrom_stream_slot_t {
+    uint32_t lba;
+    uint32_t gen;
+    int      ret;
+    uint8_t  raw[STREAM_RAW_SIZE];
+    int16_t  pcm[RAW_SECTOR_SIZE / 2];
+} cdrom_stream_slot_t;
+
+/*
+   Audio read-ahead: a worker thread reads and decodes the sectors after
+   the play position into a ring of slots, the CD audio thread consumes
+   them in order. The worker only writes head, the consumer only writes
+   tail; a seek bumps gen so that slots still being produced for the old
+   position are skipped.
+ */
+typedef struct cdrom_stream_t {
+    cdrom_t             *dev;
+    cdrom_stream_slot_t *slots;
+    uint32_t             depth;
+
+    atomic_uint          head;
+    atomic_uint          tail;
+    atomic_uint          gen;
+    atomic_uint          start;
+    atomic_uint          end;
+    atomic_uint          epoch;
+    atomic_int           quit;
+
+    /* Consumer side. */
+    uint32_t             next;
+    uint32_t             seen_epoch;
+    uint32_t             underruns;
+
+    thread_t            *thread;
+    event_t             *wake_event;
+    event_t             *ready_event;
+    mutex_t             *read_mutex;
+
+    /* read_sector() may overrun the raw sector, see raw_buffer. */
+    uint8_t              buffer[4096];
+} cdrom_stream_t;
+
 cdrom_t cdrom[CDROM_NUM] = { 0 };
 
+int cdrom_read_ahead = CD_READ_AHEAD_DEFAULT;
+
 uint16_t subq_crc16_table[256] = { 0 };
 
 uint8_t  __attribute__((aligned(16))) cdrom_scramble_table[2352] = {
@@ -438,9 +487,15 @@ read_data(cdrom_t *dev, const uint32_t lba, int check)
 
         dev->formed_mode2  = 0;
 
+        if (dev->stream != NULL)
+            thread_wait_mutex(dev->stream->read_mutex);
+
         ret = dev->ops->read_sector(dev->local,
                                     dev->raw_buffer[dev->cur_buf ^ 1], lba);
 
+        if (dev->stream != NULL)
+            thread_release_mutex(dev->stream->read_mutex);
+
         cdrom_check_for_formed_mode2(dev, dev->raw_buffer[dev->cur_buf ^ 1]);
 
         if ((ret > 0) && check) {
@@ -1123,12 +1178,21 @@ cdrom_unload(cdrom_t *dev)
     dev->cached_sector = -1;
     dev->subc_sector = -1;
 
+    /* Keep the read-ahead worker out while the image goes away. */
+    if (dev->stream != NULL) {
+        thread_wait_mutex(dev->stream->read_mutex);
+        atomic_fetch_add(&dev->stream->epoch, 1);
+    }
+
     if (dev->local != NULL) {
         dev->ops->close(dev->local);
         dev->local = NULL;
     }
 
     dev->ops = NULL;
+
+    if (dev->stream != NULL)
+        thread_release_mutex(dev->stream->read_mutex);
 }
 
 #ifdef ENABLE_CDROM_LOG
@@ -1556,6 +1620,211 @@ cdrom_audio_deemphasize(int16_t *buffer)
             buffer[(i * 2) + j] = deemph_iir(j, buffer[(i * 2) + j]);
 }
 
+/* Turn a raw sector into the PCM that goes to the mixer. */
+static void
+cdrom_audio_process(const uint8_t *raw, int16_t *pcm)
+{
+    /* Q subchannel data in bit 6: 4-5-6-7-0-1-2-3. */
+    if ((raw[2353] >> 6) & 0x01)
+        /* Data sector, copy silence into buffer. */
+        memset(pcm, 0x00, RAW_SECTOR_SIZE);
+    else {
+        memcpy(pcm, raw, RAW_SECTOR_SIZE);
+        if ((raw[2355] >> 6) & 0x01)
+            /* De-emphasize pre-emphasized audio. */
+            cdrom_audio_deemphasize(pcm);
+    }
+}
+
+static void
+cdrom_stream_thread(void *priv)
+{
+    cdrom_stream_t *s      = (cdrom_stream_t *) priv;
+    cdrom_t        *dev    = s->dev;
+    uint32_t        gen    = 0;
+    uint32_t        lba    = 0;
+    uint32_t        end    = 0;
+    int             active = 0;
+
+    while (!atomic_load(&s->quit)) {
+        /* Reset before looking at the state so that no wake-up is lost. */
+        thread_reset_event(s->wake_event);
+
+        const uint32_t g = atomic_load_explicit(&s->gen, memory_order_acquire);
+
+        if (g != gen) {
+            gen    = g;
+            lba    = atomic_load(&s->start);
+            end    = atomic_load(&s->end);
+            active = 1;
+        }
+
+        const uint32_t head = atomic_load_explicit(&s->head, memory_order_relaxed);
+        const uint32_t tail = atomic_load_explicit(&s->tail, memory_order_acquire);
+
+        if (!active || (lba >= end) || ((head - tail) >= s->depth)) {
+            thread_wait_event(s->wake_event, -1);
+            continue;
+        }
+
+        cdrom_stream_slot_t *slot = &s->slots[head % s->depth];
+        int                  ret  = 0;
+
+        thread_wait_mutex(s->read_mutex);
+        if ((dev->ops != NULL) && (dev->local != NULL))
+            ret = dev->ops->read_sector(dev->local, s->buffer, lba);
+        thread_release_mutex(s->read_mutex);
+
+        slot->lba = lba;
+        slot->gen = gen;
+        slot->ret = ret;
+
+        if (ret) {
+            memcpy(slot->raw, s->buffer, STREAM_RAW_SIZE);
+            cdrom_audio_process(slot->raw, slot->pcm);
+        } else {
+            /* Playback stops on a failed read, so should the worker. */
+            cdrom_log(dev->log, "Read-ahead of LBA %08X failed\n", lba);
+            active = 0;
+        }
+
+        lba++;
+
+        atomic_store_explicit(&s->head, head + 1, memory_order_release);
+        thread_set_event(s->ready_event);
+    }
+}
+
+static void
+cdrom_stream_restart(cdrom_stream_t *s, const uint32_t lba, const uint32_t end)
+{
+    /* Everything already produced belongs to the old position. */
+    atomic_store_explicit(&s->tail, atomic_load_explicit(&s->head, memory_order_acquire),
+                          memory_order_release);
+
+    atomic_store(&s->start, lba);
+    atomic_store(&s->end, end);
+    atomic_fetch_add_explicit(&s->gen, 1, memory_order_release);
+
+    s->next = lba;
+
+    thread_set_event(s->wake_event);
+}
+
+/*
+   Fetch a sector from the read-ahead ring, only waits for the worker
+   if it has fallen behind or the position has just changed.
+ */
+static int
+cdrom_stream_read(cdrom_t *dev, uint8_t *raw, int16_t *pcm, const uint32_t lba)
+{
+    cdrom_stream_t *s     = dev->stream;
+    const uint32_t  epoch = atomic_load(&s->epoch);
+    int             waits = 0;
+
+    if ((lba != s->next) || (epoch != s->seen_epoch) || (dev->cd_end != atomic_load(&s->end))) {
+        s->seen_epoch = epoch;
+        cdrom_stream_restart(s, lba, dev->cd_end);
+    }
+
+    const uint32_t gen = atomic_load_explicit(&s->gen, memory_order_relaxed);
+
+    while (!atomic_load(&s->quit)) {
+        thread_reset_event(s->ready_event);
+
+        uint32_t       tail = atomic_load_explicit(&s->tail, memory_order_relaxed);
+        const uint32_t head = atomic_load_explicit(&s->head, memory_order_acquire);
+
+        while (tail != head) {
+            const cdrom_stream_slot_t *slot = &s->slots[tail % s->depth];
+            const int                  hit  = (slot->gen == gen) && (slot->lba == lba);
+            const int                  ret  = slot->ret;
+
+            if (hit) {
+                memcpy(raw, slot->raw, STREAM_RAW_SIZE);
+                if (ret)
+                    memcpy(pcm, slot->pcm, RAW_SECTOR_SIZE);
+            }
+
+            atomic_store_explicit(&s->tail, ++tail, memory_order_release);
+            thread_set_event(s->wake_event);
+
+            if (hit) {
+                /* The worker has stopped after a failure, restart on the next read. */
+                s->next = ret ? (lba + 1) : 0xffffffff;
+                return ret;
+            }
+        }
+
+        if (waits++ == 0) {
+            s->underruns++;
+            cdrom_log(dev->log, "Read-ahead underrun at LBA %08X (%i total)\n",
+                      lba, s->underruns);
+        } else if (waits > 500) {
+            cdrom_log(dev->log, "Read-ahead of LBA %08X timed out\n", lba);
+            break;
+        }
+
+        thread_wait_event(s->ready_event, 10);
+    }
+
+    s->next = 0xffffffff;
+    return 0;
+}
+
+static void
+cdrom_stream_init(cdrom_t *dev)
+{
+    cdrom_stream_t *s;
+
+    if ((dev->stream != NULL) || (cdrom_read_ahead <= 0))
+        return;
+
+    s        = (cdrom_stream_t *) calloc(1, sizeof(cdrom_stream_t));
+    s->dev   = dev;
+    s->depth = (cdrom_read_ahead > CD_READ_AHEAD_MAX) ? CD_READ_AHEAD_MAX : cdrom_read_ahead;
+    s->slots = (cdrom_stream_slot_t *) calloc(s->depth, sizeof(cdrom_stream_slot_t));
+    s->next  = 0xffffffff;
+
+    atomic_init(&s->head, 0);
+    atomic_init(&s->tail, 0);
+    atomic_init(&s->gen, 0);
+    atomic_init(&s->start, 0);
+    atomic_init(&s->end, 0);
+    atomic_init(&s->epoch, 0);
+    atomic_init(&s->quit, 0);
+
+    s->wake_event  = thread_create_event();
+    s->ready_event = thread_create_event();
+    s->read_mutex  = thread_create_mutex();
+
+    dev->stream = s;
+
+    s->thread = thread_create(cdrom_stream_thread, s);
+}
+
+static void
+cdrom_stream_close(cdrom_t *dev)
+{
+    cdrom_stream_t *s = dev->stream;
+
+    if (s == NULL)
+        return;
+
+    atomic_store(&s->quit, 1);
+    thread_set_event(s->wake_event);
+    thread_wait(s->thread);
+
+    dev->stream = NULL;
+
+    thread_destroy_event(s->wake_event);
+    thread_destroy_event(s->ready_event);
+    thread_close_mutex(s->read_mutex);
+
+    free(s->slots);
+    free(s);
+}
+
 int
 cdrom_audio_callback(cdrom_t *dev, int16_t *output, const int len)
 {
@@ -1564,27 +1833,24 @@ cdrom_audio_callback(cdrom_t *dev, int16_t *output, const int len)
     while (dev->cd_buflen < len) {
         if (dev->seek_pos < dev->cd_end) {
             dev->audio_read = 1;
-            ret = dev->ops->read_sector(dev->local,
-                                        dev->raw_buffer[dev->cur_buf ^ 1],
+            if (dev->stream != NULL)
+                ret = cdrom_stream_read(dev, dev->raw_buffer[dev->cur_buf ^ 1],
+                                        &(dev->cd_buffer[dev->cd_buflen]),
                                         dev->seek_pos);
+            else
+                ret = dev->ops->read_sector(dev->local,
+                                            dev->raw_buffer[dev->cur_buf ^ 1],
+                                            dev->seek_pos);
             if (!dev->sound_on)
                 memset(dev->raw_buffer[dev->cur_buf ^ 1], 0x00, 2352);
             dev->cur_buf ^= 1;
             if (ret) {
                 cdrom_log(dev->log, "Read LBA %08X successful\n", dev->seek_pos);
                 dev->cached_sector = dev->seek_pos;
-                /* Q subchannel data in bit 6: 4-5-6-7-0-1-2-3. */
-                if ((dev->raw_buffer[dev->cur_buf][2353] >> 6) & 0x01)
-                    /* Data sector, copy silence into buffer. */
-                    memset((uint8_t *) &(dev->cd_buffer[dev->cd_buflen]),
-                           0x00, RAW_SECTOR_SIZE);
-                else {
-                    memcpy((uint8_t *) &(dev->cd_buffer[dev->cd_buflen]),
-                           dev->raw_buffer[dev->cur_buf], RAW_SECTOR_SIZE);
-                    if ((dev->raw_buffer[dev->cur_buf][2355] >> 6) & 0x01)
-                        /* De-emphasize pre-emphasized audio. */
-                        cdrom_audio_deemphasize(&(dev->cd_buffer[dev->cd_buflen]));
-                }
+                /* The read-ahead worker has already done this. */
+                if (dev->stream == NULL)
+                    cdrom_audio_process(dev->raw_buffer[dev->cur_buf],
+                                        &(dev->cd_buffer[dev->cd_buflen]));
                 dev->seek_pos++;
                 dev->cd_buflen += (RAW_SECTOR_SIZE / 2);
 
@@ -3342,6 +3608,10 @@ cdrom_update_status(cdrom_t *dev)
     if (dev->ops->load != NULL)
         dev->ops->load(dev->local);
 
+    /* The medium may have changed under the read-ahead. */
+    if (dev->stream != NULL)
+        atomic_fetch_add(&dev->stream->epoch, 1);
+
     /* All good, reset state. */
     dev->seek_pos       = 0;
     dev->cd_buflen      = 0;
@@ -3499,6 +3769,8 @@ cdrom_hard_reset(void)
 
             cdrom_drive_reset(dev);
 
+            cdrom_stream_init(dev);
+
             char n[1024] = { 0 };
 
             sprintf(n, "CD-ROM %i      ", i + 1);
@@ -3559,6 +3831,8 @@ cdrom_close(void)
 
         cdrom_unload(dev);
 
+        cdrom_stream_close(dev);
+
         dev->ops  = NULL;
         dev->priv = NULL;
 
@@ -25,9 +25,7 @@
 #define __STDC_FORMAT_MACROS
 #include <ctype.h>
 #include <inttypes.h>
-#ifdef ENABLE_IMAGE_LOG
-#    include <stdarg.h>
-#endif
+#include <stdarg.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -56,6 +54,7 @@
 #include <86box/cdrom_image.h>
 #include <86box/cdrom_image_viso.h>
 #include <86box/plat_dynld.h>
+#include <86box/thread.h>
 
 #undef CD_TRACK_AUDIO
 #undef CD_TRACK_MODE2
@@ -73,6 +72,28 @@
 // Whether it actually exists in the file or not is very unclear.
 // Note 4: The padding of the frames in the CHD, depends on the FRAMES field itself, nothing else.
 
+#define CHD_HUNK_EMPTY  0
+#define CHD_HUNK_QUEUED 1 /* Waiting for a worker. */
+#define CHD_HUNK_BUSY   2 /* Being decompressed. */
+#define CHD_HUNK_READY  3
+#define CHD_HUNK_FAILED 4
+
+#define CHD_WORKERS_MAX 2
+
+typedef struct chd_hunk_t {
+    int64_t  hunk;
+    uint8_t *data;
+    uint64_t last_use;
+    int      state;
+    int      next; /* Hash chain. */
+} chd_hunk_t;
+
+typedef struct chd_worker_t {
+    struct chd_image_t *img;
+    chd_file           *file;
+    thread_t           *thread;
+} chd_worker_t;
+
 typedef struct TrackEntry_CHD
 {
     union {
@@ -108,7 +129,32 @@ typedef struct chd_image_t {
     uint8_t* hunk_bytes;
     uint64_t hunk_size;
 
-    int64_t cur_hunk;
+    /*
+       Decompressed hunks, least recently used ones are reused first.
+       Sequential reads queue the next hunks for the workers, each of
+       which decompresses with its own chd_file since libchdr keeps the
+       codec state per file. Slot states are guarded by cache_mutex;
+       only the reading thread assigns slots, and the slot in cur_slot
+       is never reused while hunk_bytes points into it.
+     */
+    chd_hunk_t  *cache;
+    int          cache_slots;
+    int         *cache_hash;
+    uint32_t     cache_hash_mask;
+    chd_hunk_t  *cur_slot;
+    uint64_t     use_tick;
+    int64_t      last_hunk;
+    int          read_ahead;
+    int          quit;
+    int          num_workers;
+    chd_worker_t workers[CHD_WORKERS_MAX];
+    mutex_t     *cache_mutex;
+    event_t     *work_event;
+    event_t     *done_event;
+
+    uint32_t     hits;
+    uint32_t     misses;
+    uint32_t     waits;
 
     uint64_t sectors_per_hunk;
 
@@ -125,6 +171,319 @@ typedef struct chd_image_t {
 
 typedef struct chd_image_t chd_image_t;
 
+#ifdef ENABLE_CHD_IMAGE_LOG
+int chd_image_do_log = ENABLE_CHD_IMAGE_LOG;
+
+static void
+chd_image_log(const char *fmt, ...)
+{
+    va_list ap;
+
+    if (chd_image_do_log) {
+        va_start(ap, fmt);
+        pclog_ex(fmt, ap);
+        va_end(ap);
+    }
+}
+#else
+#    define chd_image_log(fmt, ...)
+#endif
+
+static chd_hunk_t *
+chd_cache_find(chd_image_t *img, const int64_t hunk)
+{
+    for (int i = img->cache_hash[hunk & img->cache_hash_mask]; i != -1; i = img->cache[i].next)
+        if (img->cache[i].hunk == hunk)
+            return &img->cache[i];
+
+    return NULL;
+}
+
+static void
+chd_cache_unlink(chd_image_t *img, chd_hunk_t *slot)
+{
+    const int idx = (int) (slot - img->cache);
+    int      *p   = &img->cache_hash[slot->hunk & img->cache_hash_mask];
+
+    while (*p != -1) {
+        if (*p == idx) {
+            *p = slot->next;
+            break;
+        }
+        p = &img->cache[*p].next;
+    }
+
+    slot->hunk  = -1;
+    slot->state = CHD_HUNK_EMPTY;
+}
+
+/* Take the least recently used slot that nobody is filling, NULL if none. */
+static chd_hunk_t *
+chd_cache_assign(chd_image_t *img, const int64_t hunk, const int state)
+{
+    chd_hunk_t *victim = NULL;
+
+    for (int i = 0; i < img->cache_slots; i++) {
+        chd_hunk_t *slot = &img->cache[i];
+
+        if ((slot == img->cur_slot) || (slot->state == CHD_HUNK_QUEUED) || (slot->state == CHD_HUNK_BUSY))
+            continue;
+        if ((victim == NULL) || (slot->last_use < victim->last_use))
+            victim = slot;
+        if (slot->state == CHD_HUNK_EMPTY)
+            break;
+    }
+
+    if (victim == NULL)
+        return NULL;
+
+    if (victim->data == NULL) {
+        victim->data = malloc(img->hunk_size);
+        if (victim->data == NULL)
+            return NULL;
+    }
+
+    if (victim->hunk != -1)
+        chd_cache_unlink(img, victim);
+
+    const int idx = (int) (victim - img->cache);
+    int      *head = &img->cache_hash[hunk & img->cache_hash_mask];
+
+    victim->hunk     = hunk;
+    victim->state    = state;
+    victim->last_use = ++img->use_tick;
+    victim->next     = *head;
+    *head            = idx;
+
+    return victim;
+}
+
+static void
+chd_cache_worker(void *priv)
+{
+    chd_worker_t *w   = (chd_worker_t *) priv;
+    chd_image_t  *img = w->img;
+
+    thread_wait_mutex(img->cache_mutex);
+
+    while (!img->quit) {
+        chd_hunk_t *job = NULL;
+
+        /* Nearest hunk first, that is the one the guest will want next. */
+        for (int i = 0; i < img->cache_slots; i++)
+            if ((img->cache[i].state == CHD_HUNK_QUEUED) && ((job == NULL) || (img->cache[i].hunk < job->hunk)))
+                job = &img->cache[i];
+
+        if (job == NULL) {
+            /* Reset under the mutex so that a job queued after this wakes us. */
+            thread_reset_event(img->work_event);
+            thread_release_mutex(img->cache_mutex);
+            thread_wait_event(img->work_event, -1);
+            thread_wait_mutex(img->cache_mutex);
+            continue;
+        }
+
+        job->state         = CHD_HUNK_BUSY;
+        const int64_t hunk = job->hunk;
+        thread_release_mutex(img->cache_mutex);
+
+        const chd_error res = chd_read(w->file, (uint32_t) hunk, job->data);
+
+        thread_wait_mutex(img->cache_mutex);
+        job->state = (res == CHDERR_NONE) ? CHD_HUNK_READY : CHD_HUNK_FAILED;
+        thread_set_event(img->done_event);
+    }
+
+    thread_release_mutex(img->cache_mutex);
+}
+
+/* Queue the hunks after a sequential read, drop the queue on a seek. */
+static int
+chd_cache_read_ahead(chd_image_t *img, const int64_t hunk)
+{
+    int queued = 0;
+
+    if (hunk != (img->last_hunk + 1)) {
+        for (int i = 0; i < img->cache_slots; i++)
+            if (img->cache[i].state == CHD_HUNK_QUEUED)
+                chd_cache_unlink(img, &img->cache[i]);
+        return 0;
+    }
+
+    for (int64_t h = hunk + 1; (h <= (hunk + img->read_ahead)) && (h < img->header->totalhunks); h++) {
+        chd_hunk_t *slot = chd_cache_find(img, h);
+
+        if (slot != NULL) {
+            slot->last_use = ++img->use_tick;
+            continue;
+        }
+
+        if (chd_cache_assign(img, h, CHD_HUNK_QUEUED) == NULL)
+            break;
+        queued++;
+    }
+
+    return queued;
+}
+
+/* Returns the decompressed hunk, NULL on a read error. */
+static uint8_t *
+chd_image_get_hunk(chd_image_t *img, const int64_t hunk)
+{
+    chd_hunk_t *slot = img->cur_slot;
+
+    /* Only the reading thread changes cur_slot and workers never touch a ready slot. */
+    if ((slot != NULL) && (slot->hunk == hunk) && (slot->state == CHD_HUNK_READY))
+        return slot->data;
+
+    thread_wait_mutex(img->cache_mutex);
+
+    slot = chd_cache_find(img, hunk);
+    if (slot == NULL) {
+        slot = chd_cache_assign(img, hunk, CHD_HUNK_QUEUED);
+        if (slot == NULL) {
+            thread_release_mutex(img->cache_mutex);
+            pclog("CHD: No free hunk slot for hunk %" PRId64 "\n", hunk);
+            return NULL;
+        }
+    }
+
+    if (slot->state == CHD_HUNK_READY)
+        img->hits++;
+    else if (slot->state == CHD_HUNK_BUSY) {
+        img->waits++;
+        while (slot->state == CHD_HUNK_BUSY) {
+            thread_reset_event(img->done_event);
+            thread_release_mutex(img->cache_mutex);
+            thread_wait_event(img->done_event, 100);
+            thread_wait_mutex(img->cache_mutex);
+        }
+    }
+
+    if ((slot->state == CHD_HUNK_QUEUED) || (slot->state == CHD_HUNK_FAILED)) {
+        /* Nobody has started on it, quicker to do it here than to wait. */
+        img->misses++;
+        slot->state = CHD_HUNK_BUSY;
+        thread_release_mutex(img->cache_mutex);
+
+        const chd_error res = chd_read(img->img_file, (uint32_t) hunk, slot->data);
+
+        thread_wait_mutex(img->cache_mutex);
+        slot->state = (res == CHDERR_NONE) ? CHD_HUNK_READY : CHD_HUNK_FAILED;
+    }
+
+    if (slot->state != CHD_HUNK_READY) {
+        thread_release_mutex(img->cache_mutex);
+        pclog("Failed to read hunk %" PRId64 "\n", hunk);
+        return NULL;
+    }
+
+    slot->last_use = ++img->use_tick;
+    img->cur_slot  = slot;
+
+    const int queued = img->num_workers ? chd_cache_read_ahead(img, hunk) : 0;
+    img->last_hunk   = hunk;
+
+    thread_release_mutex(img->cache_mutex);
+
+    if (queued)
+        thread_set_event(img->work_event);
+
+    return slot->data;
+}
+
+static int
+chd_cache_init(chd_image_t *img, const char *path)
+{
+    const uint64_t hunks   = img->header->totalhunks;
+    uint64_t       slots   = ((uint64_t) chd_cache_size << 20) / img->hunk_size;
+    uint32_t       buckets = 1;
+
+    img->read_ahead = chd_read_ahead;
+    if ((uint64_t) img->read_ahead >= hunks)
+        img->read_ahead = (int) (hunks ? (hunks - 1) : 0);
+
+    /* Room for the current hunk, the read-ahead window and one to read into. */
+    if (slots > hunks)
+        slots = hunks;
+    if (slots < (uint64_t) (img->read_ahead + 2))
+        slots = img->read_ahead + 2;
+
+    while (buckets < slots)
+        buckets <<= 1;
+
+    img->cache_slots     = (int) slots;
+    img->cache_hash_mask = buckets - 1;
+    img->cache           = calloc(slots, sizeof(chd_hunk_t));
+    img->cache_hash      = malloc(buckets * sizeof(int));
+    if ((img->cache == NULL) || (img->cache_hash == NULL))
+        return 0;
+
+    memset(img->cache_hash, 0xff, buckets * sizeof(int));
+    for (int i = 0; i < img->cache_slots; i++) {
+        img->cache[i].hunk = -1;
+        img->cache[i].next = -1;
+    }
+
+    /* Sector reads may look at hunk_bytes before the first hunk is read. */
+    img->cache[0].data = calloc(1, img->hunk_size);
+    if (img->cache[0].data == NULL)
+        return 0;
+    img->hunk_bytes = img->cache[0].data;
+    img->last_hunk  = -2;
+
+    img->cache_mutex = thread_create_mutex();
+    img->work_event  = thread_create_event();
+    img->done_event  = thread_create_event();
+
+    if (img->read_ahead > 0)
+        for (int i = 0; i < CHD_WORKERS_MAX; i++) {
+            chd_worker_t *w = &img->workers[img->num_workers];
+
+            if (chd_open(path, CHD_OPEN_READ, NULL, &w->file) != CHDERR_NONE)
+                break;
+
+            w->img    = img;
+            w->thread = thread_create(chd_cache_worker, w);
+            img->num_workers++;
+        }
+
+    chd_image_log("CHD: %i hunk slots of %" PRIu64 " bytes, %i hunks ahead on %i workers\n",
+                  img->cache_slots, img->hunk_size, img->read_ahead, img->num_workers);
+
+    return 1;
+}
+
+static void
+chd_cache_close(chd_image_t *img)
+{
+    if (img->cache_mutex != NULL) {
+        thread_wait_mutex(img->cache_mutex);
+        img->quit = 1;
+        thread_release_mutex(img->cache_mutex);
+        thread_set_event(img->work_event);
+
+        for (int i = 0; i < img->num_workers; i++) {
+            thread_wait(img->workers[i].thread);
+            chd_close(img->workers[i].file);
+        }
+
+        chd_image_log("CHD: %u hits, %u misses, %u waits on a worker\n",
+                      img->hits, img->misses, img->waits);
+
+        thread_destroy_event(img->done_event);
+        thread_destroy_event(img->work_event);
+        thread_close_mutex(img->cache_mutex);
+    }
+
+    if (img->cache != NULL) {
+        for (int i = 0; i < img->cache_slots; i++)
+            free(img->cache[i].data);
+        free(img->cache);
+    }
+    free(img->cache_hash);
+}
+
 static void
 chd_image_get_raw_track_info(UNUSED(const void *local), int *num, uint8_t *rti)
 {
@@ -321,8 +680,9 @@ static void
 chd_image_close(void *local)
 {
     chd_image_t *img = local;
-    if (img->hunk_bytes)
-        free(img->hunk_bytes);
+    chd_cache_close(img);
+    if (img->uncompressed_chd_sectors)
+        free(img->uncompressed_chd_sectors);
     if (img->track_entries)
         free(img->track_entries);
     if (img->rti_infos)
@@ -382,14 +742,9 @@ chd_image_read_sector_dvd(const void *local, UNUSED(uint8_t *buffer), UNUSED(uin
         hunk_to_use      = 0;
         offset_from_hunk = chd_offset;
     } else {
-        if (hunk_to_use != ioctl->cur_hunk) {
-            chd_error res = chd_read(ioctl->img_file, (uint32_t) hunk_to_use, ioctl->hunk_bytes);
-            if (res != CHDERR_NONE) {
-                pclog("Failed to read hunk %" PRId64 "\n", hunk_to_use);
-                return 0;
-            }
-            ioctl->cur_hunk = hunk_to_use;
-        }
+        ioctl->hunk_bytes = chd_image_get_hunk(ioctl, hunk_to_use);
+        if (ioctl->hunk_bytes == NULL)
+            return 0;
     }
 
     memcpy(&buffer[16], &ioctl->hunk_bytes[offset_from_hunk], 2048);
@@ -489,14 +844,10 @@ chd_image_read_sector(const void *local, UNUSED(uint8_t *buffer), UNUSED(uint32_
             hunk_to_use = 0;
             offset_from_hunk = chd_offset;
         } else {
-            if (hunk_to_use != ioctl->cur_hunk) {
-                chd_error res = chd_read(ioctl->img_file, (uint32_t)hunk_to_use, ioctl->hunk_bytes);
-                if (res != CHDERR_NONE) {
-                pclog("Failed to read hunk %" PRId64 "\n", hunk_to_use);
-                    return 0;
-                }
-                ioctl->cur_hunk = hunk_to_use;
-            }
+            uint8_t *hunk_bytes = chd_image_get_hunk(ioctl, hunk_to_use);
+            if (hunk_bytes == NULL)
+                return 0;
+            ioctl->hunk_bytes = hunk_bytes;
         }
     }
 
@@ -820,9 +1171,13 @@ precache_start:
                     break;
                 }
         }
-        if (!img->uncompressed)
-            img->hunk_bytes = calloc(1, img->header->hunkbytes);
-        else
+        if (!img->uncompressed) {
+            if (!chd_cache_init(img, path)) {
+                warning("Failed to allocate the hunk cache for \"%s\"!\n", path);
+                chd_image_close(img);
+                return NULL;
+            }
+        } else
             img->hunk_bytes = img->uncompressed_chd_sectors;
 
         if (img->is_dvd) {
@@ -906,9 +1261,7 @@ precache_start:
 
         if (img->track_size == 0) {
             warning("CHD image '%s' contains no tracks!", path);
-            free(img->hunk_bytes);
-            chd_close(file);
-            free(img);
+            chd_image_close(img);
             return NULL;
         }
 generate_raw_track_info:
@@ -988,7 +1341,6 @@ generate_raw_track_info:
 
         img->dev = dev;
         img->dev->ops = img->is_dvd ? &chd_image_dvd_ops : &chd_image_ops;
-        img->cur_hunk = -1;
 
         return img;
     }
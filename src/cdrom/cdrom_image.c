@@ -43,6 +43,7 @@
 #include <86box/cdrom.h>
 #include <86box/cdrom_image.h>
 #include <86box/cdrom_image_viso.h>
+#include <86box/thread.h>
 
 #include <sndfile.h>
 
@@ -305,8 +306,10 @@ static char   *cit[4]   = { "SPECIAL", "NONE", "ZERO", "NORMAL" };
 #endif
 
 typedef struct audio_file_t {
-    SNDFILE *file;
-    SF_INFO  info;
+    SNDFILE   *file;
+    SF_INFO    info;
+    /* Current decoder position in frames, -1 if unknown. */
+    sf_count_t pos;
 } audio_file_t;
 
 /* Audio file functions */
@@ -314,7 +317,7 @@ static int
 audio_read(void *priv, uint8_t *buffer, const uint64_t seek, const size_t count)
 {
     const track_file_t *tf            = (track_file_t *) priv;
-    const audio_file_t *audio         = (audio_file_t *) tf->priv;
+    audio_file_t       *audio         = (audio_file_t *) tf->priv;
     const uint64_t      samples_seek  = seek / 4;
     const uint64_t      samples_count = count / 4;
 
@@ -322,12 +325,24 @@ audio_read(void *priv, uint8_t *buffer, const uint64_t seek, const size_t count)
         image_log(tf->log, "CD Audio file: Reading on non-4-aligned boundaries.\n");
     }
 
-    const sf_count_t res = sf_seek(audio->file, samples_seek, SEEK_SET);
+    /*
+       Playback reads sequentially, and seeking in a compressed stream
+       (FLAC, Vorbis) means restarting the decoder at a seek point.
+     */
+    if (audio->pos != (sf_count_t) samples_seek) {
+        const sf_count_t res = sf_seek(audio->file, samples_seek, SEEK_SET);
 
-    if (res == -1)
-        return 0;
+        if (res == -1) {
+            audio->pos = -1;
+            return 0;
+        }
+    }
+
+    const sf_count_t res = sf_readf_short(audio->file, (short *) buffer, samples_count);
 
-    return !!sf_readf_short(audio->file, (short *) buffer, samples_count);
+    audio->pos = (res > 0) ? (sf_count_t) (samples_seek + res) : -1;
+
+    return !!res;
 }
 
 static uint64_t
@@ -393,6 +408,8 @@ audio_init(const uint8_t id, const char *filename, UNUSED(int bom), int *error)
 
     *error         = 0;
 
+    audio->pos     = 0;
+
     tf->priv       = audio;
     tf->fp         = NULL;
     tf->close      = audio_close;
@@ -407,11 +424,93 @@ cleanup_error:
     return NULL;
 }
 
+/*
+   Binary files are read through a few windows of file data instead of
+   one fread() per sector. A read that continues where a window ends
+   refills that window with the next, larger stretch of the file, so
+   each sequential stream (the guest reading data, CD audio playing from
+   another track of the same file) keeps its own window and grows its
+   read-ahead, while random reads only cost one small aligned block.
+ */
+#define BIN_CACHE_WINDOWS 4
+#define BIN_CACHE_BLOCK   (32 * 1024)
+#define BIN_CACHE_RAMP    4 /* Up to BIN_CACHE_BLOCK << 4, 512 kB. */
+
+typedef struct bin_window_t {
+    uint64_t start;
+    uint32_t len;
+    uint32_t size;
+    uint32_t last_use;
+    int      seq;
+    uint8_t *data;
+} bin_window_t;
+
+typedef struct bin_cache_t {
+    mutex_t     *mutex;
+    uint32_t     tick;
+    uint32_t     hits;
+    uint32_t     reads;
+    bin_window_t windows[BIN_CACHE_WINDOWS];
+} bin_cache_t;
+
+static bin_window_t *
+bin_cache_fill(const track_file_t *tf, bin_cache_t *cache, const uint64_t seek)
+{
+    bin_window_t *win = NULL;
+    int           seq = 0;
+
+    for (int i = 0; i < BIN_CACHE_WINDOWS; i++) {
+        bin_window_t *w = &cache->windows[i];
+
+        if (w->len && (seek == (w->start + w->len))) {
+            win = w;
+            seq = (w->seq < BIN_CACHE_RAMP) ? (w->seq + 1) : w->seq;
+            break;
+        }
+        if ((win == NULL) || (w->last_use < win->last_use))
+            win = w;
+    }
+
+    const uint64_t start = seek & ~((uint64_t) BIN_CACHE_BLOCK - 1);
+    const uint32_t size  = BIN_CACHE_BLOCK << seq;
+
+    if (win->size < size) {
+        uint8_t *data = (uint8_t *) realloc(win->data, size);
+
+        if (data == NULL)
+            return NULL;
+        win->data = data;
+        win->size = size;
+    }
+
+    win->len = 0;
+    win->seq = seq;
+
+    if (fseeko64(tf->fp, start, SEEK_SET) == -1) {
+        image_log(tf->log, "binary_read failed during seek!\n");
+        return NULL;
+    }
+
+    win->start = start;
+    win->len   = (uint32_t) fread(win->data, 1, size, tf->fp);
+    cache->reads++;
+
+    if ((start + win->len) <= seek) {
+        image_log(tf->log, "binary_read failed during read!\n");
+        return NULL;
+    }
+
+    return win;
+}
+
 /* Binary file functions. */
 static int
 bin_read(void *priv, uint8_t *buffer, const uint64_t seek, const size_t count)
 {
-    const track_file_t *tf = (track_file_t *) priv;
+    const track_file_t *tf    = (track_file_t *) priv;
+    bin_cache_t        *cache = (bin_cache_t *) tf->priv;
+    uint64_t            pos   = seek;
+    size_t              left  = count;
 
     if (tf->fp == NULL)
         return 0;
@@ -419,18 +518,41 @@ bin_read(void *priv, uint8_t *buffer, const uint64_t seek, const size_t count)
     image_log(tf->log, "binary_read(%08lx, pos=%" PRIu64 " count=%lu)\n",
                     tf->fp, seek, count);
 
-    if (fseeko64(tf->fp, seek, SEEK_SET) == -1) {
-        image_log(tf->log, "binary_read failed during seek!\n");
+    /* The data path and the CD audio read-ahead may both be in here. */
+    thread_wait_mutex(cache->mutex);
 
-        return -1;
-    }
+    while (left > 0) {
+        bin_window_t *win = NULL;
 
-    if (fread(buffer, count, 1, tf->fp) != 1) {
-        image_log(tf->log, "binary_read failed during read!\n");
+        for (int i = 0; i < BIN_CACHE_WINDOWS; i++) {
+            bin_window_t *w = &cache->windows[i];
 
-        return -1;
+            if ((pos >= w->start) && (pos < (w->start + w->len))) {
+                win = w;
+                cache->hits++;
+                break;
+            }
+        }
+
+        if ((win == NULL) && ((win = bin_cache_fill(tf, cache, pos)) == NULL)) {
+            thread_release_mutex(cache->mutex);
+            return -1;
+        }
+
+        const uint64_t off = pos - win->start;
+        size_t         len = win->len - off;
+
+        if (len > left)
+            len = left;
+
+        memcpy(buffer + (pos - seek), win->data + off, len);
+        win->last_use = ++cache->tick;
+        pos += len;
+        left -= len;
     }
 
+    thread_release_mutex(cache->mutex);
+
     if (UNLIKELY(tf->motorola)) {
         for (uint64_t i = 0; i < count; i += 2) {
             const uint8_t buffer0 = buffer[i];
@@ -471,6 +593,16 @@ bin_close(void *priv)
         tf->fp = NULL;
     }
 
+    bin_cache_t *cache = (bin_cache_t *) tf->priv;
+    if (cache != NULL) {
+        image_log(tf->log, "binary_close: %u window hits, %u reads\n", cache->hits, cache->reads);
+        for (int i = 0; i < BIN_CACHE_WINDOWS; i++)
+            free(cache->windows[i].data);
+        thread_close_mutex(cache->mutex);
+        free(cache);
+        tf->priv = NULL;
+    }
+
     memset(tf->fn, 0x00, sizeof(tf->fn));
 
     log_close(tf->log);
@@ -506,6 +638,17 @@ bin_init(const uint8_t id, const char *filename, int *error)
     }
     *error = ((tf->fp == NULL) || ((stats.st_mode & S_IFMT) == S_IFDIR));
 
+    if (!*error) {
+        tf->priv = calloc(1, sizeof(bin_cache_t));
+        if (tf->priv == NULL)
+            *error = 1;
+        else {
+            ((bin_cache_t *) tf->priv)->mutex = thread_create_mutex();
+            /* Reads go through the windows, a stdio buffer would only add a copy. */
+            setvbuf(tf->fp, NULL, _IONBF, 0);
+        }
+    }
+
     /* Set the function pointers. */
     if (!*error) {
         tf->read       = bin_read;
@@ -515,7 +658,7 @@ bin_init(const uint8_t id, const char *filename, int *error)
         /* From the check above, error may still be non-zero if opening a directory.
          * The error is set for viso to try and open the directory following this function.
          * However, we need to make sure the descriptor is closed. */
-        if ((tf->fp != NULL) && ((stats.st_mode & S_IFMT) == S_IFDIR)) {
+        if (tf->fp != NULL) {
             /* tf is freed by bin_close */
             bin_close(tf);
         } else {
@@ -66,6 +66,7 @@
 
 #define VISO_SECTOR_SIZE COOKED_SECTOR_SIZE
 #define VISO_OPEN_FILES  32
+#define VISO_FILE_BUFFER (64 * 1024)
 
 enum {
     VISO_CHARSET_D = 0,
@@ -121,13 +122,24 @@ typedef struct {
     uint64_t pt_meta_offsets[2];
     int      format;
     uint8_t  use_version_suffix : 1;
-    size_t   metadata_sectors, all_sectors, entry_map_size, sector_size, file_fifo_pos;
+    size_t   metadata_sectors, all_sectors, sector_size;
     uint8_t *metadata;
+    uint64_t metadata_len, metadata_alloc;
+    int      metadata_error;
 
     track_file_t   tf;
     viso_entry_t  *root_dir;
-    viso_entry_t **entry_map;
-    viso_entry_t  *file_fifo[VISO_OPEN_FILES];
+
+    /* Files in data order, so that a sector is found by binary search
+       instead of through a pointer per sector. */
+    viso_entry_t **extents;
+    size_t         extents_num, extents_alloc;
+
+    /* Least recently used open files are closed first. */
+    viso_entry_t  *open_files[VISO_OPEN_FILES];
+    uint64_t       open_pos[VISO_OPEN_FILES];
+    uint32_t       open_use[VISO_OPEN_FILES];
+    uint32_t       open_tick;
 } viso_t;
 
 static const char rr_eid[]   = "RRIP_1991A"; /* identifiers used in ER field for Rock Ridge */
@@ -153,28 +165,47 @@ image_viso_log(void *priv, const char *fmt, ...)
 #    define image_viso_log(priv, fmt, ...)
 #endif
 
+/* Metadata is built in memory, these stand in for the old temporary file. */
+static void
+viso_write(viso_t *viso, const void *ptr, const size_t size)
+{
+    if ((viso->metadata_len + size) > viso->metadata_alloc) {
+        uint64_t alloc = viso->metadata_alloc ? viso->metadata_alloc : (64 * VISO_SECTOR_SIZE);
+
+        while ((viso->metadata_len + size) > alloc)
+            alloc <<= 1;
+
+        uint8_t *metadata = (uint8_t *) realloc(viso->metadata, alloc);
+        if (metadata == NULL) {
+            viso->metadata_error = 1;
+            return;
+        }
+        viso->metadata       = metadata;
+        viso->metadata_alloc = alloc;
+    }
+
+    memcpy(viso->metadata + viso->metadata_len, ptr, size);
+    viso->metadata_len += size;
+}
+
 static size_t
 viso_pread(void *ptr, const uint64_t offset, const size_t size,
-           const size_t count, FILE *fp)
+           const size_t count, const viso_t *viso)
 {
-    const uint64_t cur_pos = ftello64(fp);
-    size_t         ret     = 0;
-    if (fseeko64(fp, offset, SEEK_SET) != -1)
-        ret = fread(ptr, size, count, fp);
-    fseeko64(fp, cur_pos, SEEK_SET);
-    return ret;
+    if ((offset + (size * count)) > viso->metadata_len)
+        return 0;
+    memcpy(ptr, viso->metadata + offset, size * count);
+    return count;
 }
 
 static size_t
 viso_pwrite(const void *ptr, const uint64_t offset, const size_t size,
-            const size_t count, FILE *fp)
+            const size_t count, viso_t *viso)
 {
-    const uint64_t cur_pos = ftello64(fp);
-    size_t         ret     = 0;
-    if (fseeko64(fp, offset, SEEK_SET) != -1)
-        ret = fwrite(ptr, size, count, fp);
-    fseeko64(fp, cur_pos, SEEK_SET);
-    return ret;
+    if ((offset + (size * count)) > viso->metadata_len)
+        return 0;
+    memcpy(viso->metadata + offset, ptr, size * count);
+    return count;
 }
 
 static size_t
@@ -674,73 +705,134 @@ viso_compare_entries(const void *a, const void *b)
     return strcmp((*((viso_entry_t **) a))->name_short, (*((viso_entry_t **) b))->name_short);
 }
 
+/* Returns the slot of an open file, opening it in place of the least recently used one. */
+static int
+viso_open_file(viso_t *viso, viso_entry_t *entry)
+{
+    int slot = 0;
+
+    for (int i = 0; i < VISO_OPEN_FILES; i++) {
+        if (viso->open_files[i] == entry) {
+            slot = i;
+            goto found;
+        }
+        if (viso->open_use[i] < viso->open_use[slot])
+            slot = i;
+    }
+
+    /* Close the least recently used file. */
+    viso_entry_t *other_entry = viso->open_files[slot];
+    if (other_entry && other_entry->file) {
+        image_viso_log(viso->tf.log, "Closing [%s]...\n", other_entry->path);
+        fclose(other_entry->file);
+        other_entry->file = NULL;
+        image_viso_log(viso->tf.log, "Done\n");
+    }
+    viso->open_files[slot] = NULL;
+    viso->open_use[slot]   = 0;
+
+    /* Open file. */
+    image_viso_log(viso->tf.log, "Opening [%s]...\n", entry->path);
+    if (!(entry->file = fopen(entry->path, "rb"))) {
+        image_viso_log(viso->tf.log, "Failed\n");
+        return -1;
+    }
+    image_viso_log(viso->tf.log, "Done\n");
+
+    setvbuf(entry->file, NULL, _IOFBF, VISO_FILE_BUFFER);
+    viso->open_files[slot] = entry;
+    viso->open_pos[slot]   = 0;
+
+found:
+    viso->open_use[slot] = ++viso->open_tick;
+    return slot;
+}
+
+/* Index of the last file starting at or before this offset, -1 if none. */
+static ssize_t
+viso_find_extent(const viso_t *viso, const uint64_t seek)
+{
+    size_t lo = 0;
+    size_t hi = viso->extents_num;
+
+    while (lo < hi) {
+        const size_t mid = lo + ((hi - lo) >> 1);
+
+        if (viso->extents[mid]->data_offset <= seek)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return ((ssize_t) lo) - 1;
+}
+
 int
 viso_read(void *priv, uint8_t *buffer, uint64_t seek, size_t count)
 {
-    track_file_t *tf   = (track_file_t *) priv;
-    viso_t       *viso = (viso_t *) tf->priv;
+    track_file_t  *tf            = (track_file_t *) priv;
+    viso_t        *viso          = (viso_t *) tf->priv;
+    const uint64_t metadata_size = ((uint64_t) viso->metadata_sectors) * viso->sector_size;
 
-    /* Handle reads in a sector by sector basis. */
+    /* Handle reads in spans of metadata, file data or padding. */
     while (count > 0) {
-        /* Determine the current sector, offset and remainder. */
-        size_t sector        = seek / viso->sector_size;
-        size_t sector_offset = seek % viso->sector_size;
-        size_t sector_remain = MIN(count, viso->sector_size - sector_offset);
+        size_t span;
+        size_t read = 0;
 
-        /* Handle sector. */
-        if (sector < viso->metadata_sectors) {
+        if (seek < metadata_size) {
             /* Copy metadata. */
-            memcpy(buffer, viso->metadata + seek, sector_remain);
+            span = MIN(count, metadata_size - seek);
+            memcpy(buffer, viso->metadata + seek, span);
+            read = span;
         } else {
-            size_t read = 0;
+            const ssize_t       idx    = viso_find_extent(viso, seek);
+            viso_entry_t *const entry  = (idx >= 0) ? viso->extents[idx] : NULL;
+            uint64_t            offset = 0;
+            uint64_t            end    = 0;
 
-            /* Get the file entry corresponding to this sector. */
-            viso_entry_t *entry = viso->entry_map[sector - viso->metadata_sectors];
             if (entry) {
-                /* Open file if it's not already open. */
-                if (!entry->file) {
-                    /* Close any existing FIFO entry's file. */
-                    viso_entry_t *other_entry = viso->file_fifo[viso->file_fifo_pos];
-                    if (other_entry && other_entry->file) {
-                        image_viso_log(viso->tf.log, "Closing [%s]...\n", other_entry->path);
-                        fclose(other_entry->file);
-                        other_entry->file = NULL;
-                        image_viso_log(viso->tf.log, "Done\n");
-                    }
+                offset = seek - entry->data_offset;
+                end    = entry->stats.size + viso->sector_size - 1;
+                end   -= end % viso->sector_size;
+            }
 
-                    /* Open file. */
-                    image_viso_log(viso->tf.log, "Opening [%s]...\n", entry->path);
-                    if ((entry->file = fopen(entry->path, "rb"))) {
-                        image_viso_log(viso->tf.log, "Done\n");
+            if (entry && (offset < end)) {
+                /* Read file data, up to the end of its last sector. */
+                span = MIN(count, end - offset);
 
-                        /* Add this entry to the FIFO. */
-                        viso->file_fifo[viso->file_fifo_pos++] = entry;
-                        viso->file_fifo_pos &= (sizeof(viso->file_fifo) / sizeof(viso->file_fifo[0])) - 1;
-                    } else {
-                        image_viso_log(viso->tf.log, "Failed\n");
+                if (offset < entry->stats.size) {
+                    const size_t want = MIN(span, entry->stats.size - offset);
+                    const int    slot = viso_open_file(viso, entry);
 
-                        /* Clear any existing FIFO entry. */
-                        viso->file_fifo[viso->file_fifo_pos] = NULL;
-                    }
+                    if (slot < 0)
+                        return -1;
+                    if ((viso->open_pos[slot] != offset) &&
+                        (fseeko64(entry->file, offset, SEEK_SET) == -1))
+                        return -1;
+
+                    read = fread(buffer, 1, want, entry->file);
+                    viso->open_pos[slot] = offset + read;
+                    if (!read)
+                        return -1;
                 }
+            } else {
+                /* Nothing allocated here, up to the next file. */
+                const size_t next = idx + 1;
 
-                /* Read data. */
-                if (!entry->file || (fseeko64(entry->file, seek - entry->data_offset, SEEK_SET) == -1))
-                    return -1;
-                read = fread(buffer, 1, sector_remain, entry->file);
-                if (sector_remain && !read)
-                    return -1;
+                span = count;
+                if ((next < viso->extents_num) && ((viso->extents[next]->data_offset - seek) < span))
+                    span = viso->extents[next]->data_offset - seek;
             }
-
-            /* Fill remainder with 00 bytes if required. */
-            if (read < sector_remain)
-                memset(buffer + read, 0x00, sector_remain - read);
         }
 
-        /* Move on to the next sector. */
-        buffer += sector_remain;
-        seek += sector_remain;
-        count -= sector_remain;
+        /* Fill remainder with 00 bytes if required. */
+        if (read < span)
+            memset(buffer + read, 0x00, span - read);
+
+        /* Move on to the next span. */
+        buffer += span;
+        seek += span;
+        count -= span;
     }
 
     return 1;
@@ -767,13 +859,6 @@ viso_close(void *priv)
     image_viso_log(viso->tf.log, "close()\n");
 
     /* De-allocate everything. */
-    if (tf->fp)
-        fclose(tf->fp);
-#ifdef IMAGE_VISO_LOG
-    if (stricmp(path_get_extension(viso->tf.fn), "iso"))
-#endif
-        remove(nvr_path(viso->tf.fn));
-
     viso_entry_t *entry = viso->root_dir;
     viso_entry_t *next_entry;
     while (entry) {
@@ -786,8 +871,8 @@ viso_close(void *priv)
 
     if (viso->metadata)
         free(viso->metadata);
-    if (viso->entry_map)
-        free(viso->entry_map);
+    if (viso->extents)
+        free(viso->extents);
 
     if (tf->log != NULL)
         log_close(tf->log);
@@ -823,16 +908,7 @@ viso_init(const uint8_t id, const char *dirname, int *error)
     if (!data)
         goto end;
 
-        /* Open temporary file. */
-#ifdef IMAGE_VISO_LOG
-    if (image_viso_do_log)
-        memcpy(viso->tf.fn, "viso-debug.iso", sizeof("viso-debug.iso"));
-    else
-#endif
-        plat_tempfile(viso->tf.fn, "viso", ".tmp");
-    viso->tf.fp = plat_fopen64(nvr_path(viso->tf.fn), "w+b");
-    if (!viso->tf.fp)
-        goto end;
+    strncpy(viso->tf.fn, dirname, sizeof(viso->tf.fn) - 1);
 
     /* Set up directory traversal. */
     image_viso_log(viso->tf.log, "Traversing directories:\n");
@@ -863,7 +939,7 @@ viso_init(const uint8_t id, const char *dirname, int *error)
     while (LIKELY(dir)) {
         /* Open directory for listing. */
         int    have_dir       = plat_dir_open(&context, dir->path);
-        size_t children_count = 2; /* include . and .. (terminator is the +1 when allocating) */
+        size_t children_count; /* includes . and .. (terminator is the +1 when allocating) */
         if (UNLIKELY(dir == viso->root_dir)) {
             /* Handle root directory. */
             if (have_dir && plat_dir_is_dir(&context)) {
@@ -873,22 +949,13 @@ viso_init(const uint8_t id, const char *dirname, int *error)
                 goto end; /* not a directory */
             }
         }
-        if (LIKELY(have_dir)) {
-            /* Determine the entry array size. */
-            children_count += plat_dir_count_children(&context);
-        }
-
-        /* Grow array if required. */
-        if (children_count > dir_entries_len) {
-            viso_entry_t **new_dir_entries = (viso_entry_t **) malloc((children_count + 1) * sizeof(viso_entry_t *));
-            if (LIKELY(new_dir_entries)) {
-                if (LIKELY(dir_entries))
-                    free(dir_entries);
-                dir_entries     = new_dir_entries;
-                dir_entries_len = children_count;
-            } else {
+        /* Allocate the entry array. It grows as children are read, so
+           that each directory is only listed once. */
+        if (UNLIKELY(!dir_entries)) {
+            dir_entries = (viso_entry_t **) malloc((64 + 1) * sizeof(viso_entry_t *));
+            if (UNLIKELY(!dir_entries))
                 goto next_dir;
-            }
+            dir_entries_len = 64;
         }
 
         /* Add . and .. pseudo-directories. */
@@ -915,9 +982,9 @@ viso_init(const uint8_t id, const char *dirname, int *error)
         /* Iterate through this directory's children again, making the entries. */
         if (LIKELY(have_dir)) {
             while (plat_dir_read(&context)) {
-                /* Grow array if the original size is inaccurate. */
+                /* Grow array if required. */
                 if (UNLIKELY(children_count >= dir_entries_len)) {
-                    size_t         new_entries_len = children_count + 1;
+                    size_t         new_entries_len = dir_entries_len * 2;
                     viso_entry_t **new_dir_entries = (viso_entry_t **) realloc(dir_entries, (new_entries_len + 1) * sizeof(viso_entry_t *));
                     if (LIKELY(new_dir_entries)) {
                         dir_entries     = new_dir_entries;
@@ -943,10 +1010,8 @@ viso_init(const uint8_t id, const char *dirname, int *error)
 
                 /* Handle file size and El Torito boot code. */
                 if (!entry->stats.is_dir) {
-                    /* Increase entry map size. */
-                    viso->entry_map_size += entry->stats.size / viso->sector_size;
-                    if (entry->stats.size % viso->sector_size)
-                        viso->entry_map_size++; /* round up to the next sector */
+                    /* Count this file for the extent map. */
+                    viso->extents_alloc++;
 
                     /* Detect El Torito boot code file and set it accordingly. */
                     if (dir == eltorito_dir) {
@@ -1028,7 +1093,7 @@ next_dir:
 
     /* Write 16 blank sectors. */
     for (int i = 0; i < 16; i++)
-        fwrite(data, viso->sector_size, 1, viso->tf.fp);
+        viso_write(viso, data, viso->sector_size);
 
     /* Get current time for the volume descriptors, and calculate
        the timezone offset for descriptors and file times to use. */
@@ -1065,7 +1130,7 @@ next_dir:
         /* Fill volume descriptor. */
         p = data;
         if (!(viso->format & VISO_FORMAT_ISO))
-            VISO_LBE_32(p, ftello64(viso->tf.fp) / viso->sector_size);      /* sector offset (HSF only) */
+            VISO_LBE_32(p, viso->metadata_len / viso->sector_size);      /* sector offset (HSF only) */
         *p++ = 1 + i;                                                       /* type */
         memcpy(p, (viso->format & VISO_FORMAT_ISO) ? "CD001" : "CDROM", 5); /* standard ID */
         p += 5;
@@ -1089,7 +1154,7 @@ next_dir:
 
         VISO_SKIP(p, 8); /* unused */
 
-        viso->vol_size_offsets[i] = ftello64(viso->tf.fp) + (p - data);
+        viso->vol_size_offsets[i] = viso->metadata_len + (p - data);
         VISO_LBE_32(p, 0); /* volume space size (filled in later) */
 
         if (i) {
@@ -1106,10 +1171,10 @@ next_dir:
         VISO_LBE_16(p, viso->sector_size); /* logical block size */
 
         /* Path table metadata is filled in later. */
-        viso->pt_meta_offsets[i] = ftello64(viso->tf.fp) + (p - data);
+        viso->pt_meta_offsets[i] = viso->metadata_len + (p - data);
         VISO_SKIP(p, 24 + (16 * !(viso->format & VISO_FORMAT_ISO))); /* PT size, LE PT offset, optional LE PT offset (three on HSF), BE PT offset, optional BE PT offset (three on HSF) */
 
-        viso->root_dir->dr_offsets[i] = ftello64(viso->tf.fp) + (p - data);
+        viso->root_dir->dr_offsets[i] = viso->metadata_len + (p - data);
         p += viso_fill_dir_record(p, viso->root_dir, viso, VISO_DIR_CURRENT); /* root directory */
 
         int copyright_abstract_len = (viso->format & VISO_FORMAT_ISO) ? 37 : 32;
@@ -1165,7 +1230,7 @@ next_dir:
         memset(p, 0x00, viso->sector_size - (p - data));
 
         /* Write volume descriptor. */
-        fwrite(data, viso->sector_size, 1, viso->tf.fp);
+        viso_write(viso, data, viso->sector_size);
 
         /* Write El Torito boot descriptor. This is an awkward spot for
            that, but the spec requires it to be the second descriptor. */
@@ -1176,7 +1241,7 @@ next_dir:
             p = data;
             if (!(viso->format & VISO_FORMAT_ISO))
                 /* Sector offset (HSF only). */
-                VISO_LBE_32(p, ftello64(viso->tf.fp) / viso->sector_size);
+                VISO_LBE_32(p, viso->metadata_len / viso->sector_size);
             /* Type. */
             *p++ = 0;
             /* Standard ID. */
@@ -1189,13 +1254,13 @@ next_dir:
             VISO_SKIP(p, 40);
 
             /* Save the boot catalog pointer's offset for later. */
-            eltorito_offset = ftello64(viso->tf.fp) + (p - data);
+            eltorito_offset = viso->metadata_len + (p - data);
 
             /* Blank the rest of the working sector. */
             memset(p, 0x00, viso->sector_size - (p - data));
 
             /* Write boot descriptor. */
-            fwrite(data, viso->sector_size, 1, viso->tf.fp);
+            viso_write(viso, data, viso->sector_size);
         }
     }
     volume_path[path_len] = saved_trailer;
@@ -1203,7 +1268,7 @@ next_dir:
     /* Fill terminator. */
     p = data;
     if (!(viso->format & VISO_FORMAT_ISO))
-        VISO_LBE_32(p, ftello64(viso->tf.fp) / viso->sector_size);      /* sector offset (HSF only) */
+        VISO_LBE_32(p, viso->metadata_len / viso->sector_size);      /* sector offset (HSF only) */
     *p++ = 0xff;                                                        /* type */
     memcpy(p, (viso->format & VISO_FORMAT_ISO) ? "CD001" : "CDROM", 5); /* standard ID */
     p += 5;
@@ -1213,22 +1278,22 @@ next_dir:
     memset(p, 0x00, viso->sector_size - (p - data));
 
     /* Write terminator. */
-    fwrite(data, viso->sector_size, 1, viso->tf.fp);
+    viso_write(viso, data, viso->sector_size);
 
     /* We start seeing a pattern of padding to even sectors here.
        mkisofs does this, presumably for a very good reason... */
-    int write = ftello64(viso->tf.fp) % (viso->sector_size * 2);
+    int write = viso->metadata_len % (viso->sector_size * 2);
     if (write) {
         write = (viso->sector_size * 2) - write;
         memset(data, 0x00, write);
-        fwrite(data, write, 1, viso->tf.fp);
+        viso_write(viso, data, write);
     }
 
     /* Handle El Torito boot catalog. */
     if (eltorito_entry) {
         /* Write a pointer to this boot catalog to the boot descriptor. */
-        AS_U32(data[0]) = cpu_to_le32(ftello64(viso->tf.fp) / viso->sector_size);
-        viso_pwrite(data, eltorito_offset, 4, 1, viso->tf.fp);
+        AS_U32(data[0]) = cpu_to_le32(viso->metadata_len / viso->sector_size);
+        viso_pwrite(data, eltorito_offset, 4, 1, viso);
 
         /* Fill boot catalog validation entry. */
         p    = data;
@@ -1258,21 +1323,21 @@ next_dir:
         *p++ = 0x00; /* reserved */
 
         /* Save offsets to the boot catalog entry's offset and size fields for later. */
-        eltorito_offset = ftello64(viso->tf.fp) + (p - data);
+        eltorito_offset = viso->metadata_len + (p - data);
 
         /* Blank the rest of the working sector. This includes the sector count,
            ISO sector offset and 20-byte selection criteria fields at the end. */
         memset(p, 0x00, viso->sector_size - (p - data));
 
         /* Write boot catalog. */
-        fwrite(data, viso->sector_size, 1, viso->tf.fp);
+        viso_write(viso, data, viso->sector_size);
 
         /* Pad to the next even sector. */
-        write = ftello64(viso->tf.fp) % (viso->sector_size * 2);
+        write = viso->metadata_len % (viso->sector_size * 2);
         if (write) {
             write = (viso->sector_size * 2) - write;
             memset(data, 0x00, write);
-            fwrite(data, write, 1, viso->tf.fp);
+            viso_write(viso, data, write);
         }
 
         /* Flag that we shouldn't hide the boot code directory if it contains other files. */
@@ -1285,12 +1350,12 @@ next_dir:
         image_viso_log(viso->tf.log, "Generating path table #%d:\n", i);
 
         /* Save this path table's start offset. */
-        uint64_t pt_start = ftello64(viso->tf.fp);
+        uint64_t pt_start = viso->metadata_len;
 
         /* Write this table's sector offset to the corresponding volume descriptor. */
         uint32_t pt_temp = pt_start / viso->sector_size;
         AS_U32(data[0])  = (i & 1) ? cpu_to_be32(pt_temp) : cpu_to_le32(pt_temp);
-        viso_pwrite(data, viso->pt_meta_offsets[i >> 1] + 8 + (8 * (i & 1)), 4, 1, viso->tf.fp);
+        viso_pwrite(data, viso->pt_meta_offsets[i >> 1] + 8 + (8 * (i & 1)), 4, 1, viso);
 
         /* Go through directories. */
         dir             = viso->root_dir;
@@ -1309,7 +1374,7 @@ next_dir:
 
             /* Save this directory's path table index and offset. */
             dir->pt_idx        = pt_idx;
-            dir->pt_offsets[i] = ftello64(viso->tf.fp);
+            dir->pt_offsets[i] = viso->metadata_len;
 
             /* Fill path table entry. */
             p = data;
@@ -1345,7 +1410,7 @@ next_dir:
                 *p++ = 0x00;
 
             /* Write path table entry. */
-            fwrite(data, p - data, 1, viso->tf.fp);
+            viso_write(viso, data, p - data);
 
             /* Increment path table index and stop if it overflows. */
             if (++pt_idx == 0)
@@ -1356,17 +1421,17 @@ next_dir:
         }
 
         /* Write this table's size to the corresponding volume descriptor. */
-        pt_temp = ftello64(viso->tf.fp) - pt_start;
+        pt_temp = viso->metadata_len - pt_start;
         p       = data;
         VISO_LBE_32(p, pt_temp);
-        viso_pwrite(data, viso->pt_meta_offsets[i >> 1], 8, 1, viso->tf.fp);
+        viso_pwrite(data, viso->pt_meta_offsets[i >> 1], 8, 1, viso);
 
         /* Pad to the next even sector. */
-        write = ftello64(viso->tf.fp) % (viso->sector_size * 2);
+        write = viso->metadata_len % (viso->sector_size * 2);
         if (write) {
             write = (viso->sector_size * 2) - write;
             memset(data, 0x00, write);
-            fwrite(data, write, 1, viso->tf.fp);
+            viso_write(viso, data, write);
         }
     }
 
@@ -1385,25 +1450,25 @@ next_dir:
             }
 
             /* Pad to the next sector if required. */
-            write = ftello64(viso->tf.fp) % viso->sector_size;
+            write = viso->metadata_len % viso->sector_size;
             if (write) {
                 write = viso->sector_size - write;
                 memset(data, 0x00, write);
-                fwrite(data, write, 1, viso->tf.fp);
+                viso_write(viso, data, write);
             }
 
             /* Save this directory's child record array's start offset. */
-            uint64_t dir_start = ftello64(viso->tf.fp);
+            uint64_t dir_start = viso->metadata_len;
 
             /* Write this directory's child record array's sector offset to its record... */
             uint32_t dir_temp = dir_start / viso->sector_size;
             p                 = data;
             VISO_LBE_32(p, dir_temp);
-            viso_pwrite(data, dir->dr_offsets[i] + 2, 8, 1, viso->tf.fp);
+            viso_pwrite(data, dir->dr_offsets[i] + 2, 8, 1, viso);
 
             /* ...and to its path table entries. */
-            viso_pwrite(data, dir->pt_offsets[i << 1], 4, 1, viso->tf.fp);           /* little endian */
-            viso_pwrite(data + 4, dir->pt_offsets[(i << 1) | 1], 4, 1, viso->tf.fp); /* big endian */
+            viso_pwrite(data, dir->pt_offsets[i << 1], 4, 1, viso);           /* little endian */
+            viso_pwrite(data + 4, dir->pt_offsets[(i << 1) | 1], 4, 1, viso); /* big endian */
 
             if (i == max_vd) /* overwrite pt_offsets in the union if we no longer need them */
                 dir->file = NULL;
@@ -1425,15 +1490,15 @@ next_dir:
                 viso_fill_dir_record(data, entry, viso, dir_type);
 
                 /* Entries cannot cross sector boundaries, so pad to the next sector if required. */
-                write = viso->sector_size - (ftello64(viso->tf.fp) % viso->sector_size);
+                write = viso->sector_size - (viso->metadata_len % viso->sector_size);
                 if (write < data[0]) {
                     p = data + (viso->sector_size * 2) - write;
                     memset(p, 0x00, write);
-                    fwrite(p, write, 1, viso->tf.fp);
+                    viso_write(viso, p, write);
                 }
 
                 /* Save this entry's record's offset. This overwrites name_short in the union. */
-                entry->dr_offsets[i] = ftello64(viso->tf.fp);
+                entry->dr_offsets[i] = viso->metadata_len;
 
                 /* Write data related to the . and .. pseudo-subdirectories,
                    while advancing the current directory type. */
@@ -1446,13 +1511,13 @@ next_dir:
                 } else if (dir_type == VISO_DIR_PARENT) {
                     /* Copy the parent directory's offset and size. The root directory's
                        parent size is a special, self-referential case handled later. */
-                    viso_pread(data + 2, dir->parent->dr_offsets[i] + 2, 16, 1, viso->tf.fp);
+                    viso_pread(data + 2, dir->parent->dr_offsets[i] + 2, 16, 1, viso);
 
                     dir_type = i ? VISO_DIR_JOLIET : VISO_DIR_REGULAR;
                 }
 
                 /* Write entry. */
-                fwrite(data, data[0], 1, viso->tf.fp);
+                viso_write(viso, data, data[0]);
 next_entry:
                 /* Move on to the next entry, and stop if the end of this directory was reached. */
                 entry = entry->next;
@@ -1461,13 +1526,13 @@ next_entry:
             }
 
             /* Write this directory's child record array's size to its parent and . records. */
-            dir_temp = ftello64(viso->tf.fp) - dir_start;
+            dir_temp = viso->metadata_len - dir_start;
             p        = data;
             VISO_LBE_32(p, dir_temp);
-            viso_pwrite(data, dir->dr_offsets[i] + 10, 8, 1, viso->tf.fp);
-            viso_pwrite(data, dir->first_child->dr_offsets[i] + 10, 8, 1, viso->tf.fp);
+            viso_pwrite(data, dir->dr_offsets[i] + 10, 8, 1, viso);
+            viso_pwrite(data, dir->first_child->dr_offsets[i] + 10, 8, 1, viso);
             if (dir->parent == dir) /* write size to .. on root directory as well */
-                viso_pwrite(data, dir->first_child->next->dr_offsets[i] + 10, 8, 1, viso->tf.fp);
+                viso_pwrite(data, dir->first_child->next->dr_offsets[i] + 10, 8, 1, viso);
 
             /* Move on to the next directory. */
             dir_type = VISO_DIR_CURRENT;
@@ -1475,64 +1540,28 @@ next_entry:
         }
 
         /* Pad to the next even sector. */
-        write = ftello64(viso->tf.fp) % (viso->sector_size * 2);
+        write = viso->metadata_len % (viso->sector_size * 2);
         if (write) {
             write = (viso->sector_size * 2) - write;
             memset(data, 0x00, write);
-            fwrite(data, write, 1, viso->tf.fp);
+            viso_write(viso, data, write);
         }
     }
 
-    /* Allocate entry map for sector->file lookups. */
-    size_t orig_sector_size = viso->sector_size;
-    while (1) {
-        image_viso_log(viso->tf.log, "Allocating entry map for %zu %zu-byte sectors\n",
-                       viso->entry_map_size, viso->sector_size);
-        viso->entry_map = (viso_entry_t **) calloc(viso->entry_map_size, sizeof(viso_entry_t *));
-        if (viso->entry_map) {
-            /* Successfully allocated. */
-            break;
-        } else {
-            /* Blank data buffer for padding if this is the first run. */
-            if (orig_sector_size == viso->sector_size)
-                memset(data, 0x00, orig_sector_size);
-
-            /* If we don't have enough memory, double the sector size. */
-            viso->sector_size *= 2;
-            if ((viso->sector_size < VISO_SECTOR_SIZE) || (viso->sector_size > (1 << 30))) /* give up if sectors become too large */
-                goto end;
-
-            /* Go through files, recalculating the entry map size. */
-            size_t orig_entry_map_size = viso->entry_map_size;
-            viso->entry_map_size       = 0;
-            entry                      = viso->root_dir;
-            while (LIKELY(entry)) {
-                if (!entry->stats.is_dir) {
-                    viso->entry_map_size += entry->stats.size / viso->sector_size;
-                    if (entry->stats.size % viso->sector_size)
-                        viso->entry_map_size++; /* round up to the next sector */
-                }
-                entry = entry->next;
-            }
-            if (viso->entry_map_size == orig_entry_map_size) /* give up if there was no change in map size */
-                goto end;
-
-            /* Pad metadata to the new size's next sector. */
-            while (ftello64(viso->tf.fp) % viso->sector_size)
-                fwrite(data, orig_sector_size, 1, viso->tf.fp);
-        }
-    }
+    /* Allocate extent map for sector->file lookups. */
+    image_viso_log(viso->tf.log, "Allocating extent map for %zu files\n", viso->extents_alloc);
+    viso->extents = (viso_entry_t **) calloc(viso->extents_alloc + 1, sizeof(viso_entry_t *));
+    if ((viso->extents == NULL) || viso->metadata_error)
+        goto end;
 
     /* Start sector counts. */
-    viso->metadata_sectors = ftello64(viso->tf.fp) / viso->sector_size;
+    viso->metadata_sectors = viso->metadata_len / viso->sector_size;
     viso->all_sectors      = viso->metadata_sectors;
 
     /* Go through files, assigning sectors to them. */
     image_viso_log(viso->tf.log, "Assigning sectors to files:\n");
-    size_t        base_factor  = viso->sector_size / orig_sector_size;
-    viso_entry_t *prev_entry   = viso->root_dir;
-    viso_entry_t **entry_map_p = viso->entry_map;
-    entry                      = prev_entry->next;
+    viso_entry_t *prev_entry = viso->root_dir;
+    entry                    = prev_entry->next;
     while (LIKELY(entry)) {
         /* Skip this entry if it corresponds to a directory. */
         if (entry->stats.is_dir) {
@@ -1557,13 +1586,13 @@ next_entry:
             } else { /* emulation */
                 AS_U16(data[0]) = cpu_to_le16(1);
             }
-            AS_U32(data[2]) = cpu_to_le32(viso->all_sectors * base_factor);
-            viso_pwrite(data, eltorito_offset, 6, 1, viso->tf.fp);
+            AS_U32(data[2]) = cpu_to_le32(viso->all_sectors);
+            viso_pwrite(data, eltorito_offset, 6, 1, viso);
         } else {
             p = data;
-            VISO_LBE_32(p, viso->all_sectors * base_factor);
+            VISO_LBE_32(p, viso->all_sectors);
             for (int i = 0; i <= max_vd; i++)
-                viso_pwrite(data, entry->dr_offsets[i] + 2, 8, 1, viso->tf.fp);
+                viso_pwrite(data, entry->dr_offsets[i] + 2, 8, 1, viso);
         }
 
         /* Save this file's base offset. This overwrites dr_offsets in the union. */
@@ -1578,8 +1607,8 @@ next_entry:
 
         /* Allocate sectors to this file. */
         viso->all_sectors += size;
-        while (size-- > 0)
-            *entry_map_p++ = entry;
+        if (size && (viso->extents_num < viso->extents_alloc))
+            viso->extents[viso->extents_num++] = entry;
 
         /* Move on to the next entry. */
         prev_entry = entry;
@@ -1590,27 +1619,22 @@ next_entry:
     p = data;
     VISO_LBE_32(p, viso->all_sectors);
     for (int i = 0; i < (sizeof(viso->vol_size_offsets) / sizeof(viso->vol_size_offsets[0])); i++)
-        viso_pwrite(data, viso->vol_size_offsets[i], 8, 1, viso->tf.fp);
+        viso_pwrite(data, viso->vol_size_offsets[i], 8, 1, viso);
 
-    /* Metadata processing is finished, read it back to memory. */
-    image_viso_log(viso->tf.log, "Reading back %zu %zu-byte sectors of metadata\n",
-                   viso->metadata_sectors, viso->sector_size);
-    viso->metadata = (uint8_t *) calloc(viso->metadata_sectors, viso->sector_size);
-    if (viso->metadata == NULL)
+    /* Metadata processing is finished. */
+    if (viso->metadata_error)
         goto end;
-    fseeko64(viso->tf.fp, 0, SEEK_SET);
-    size_t metadata_size = viso->metadata_sectors * viso->sector_size;
-    size_t metadata_remain = metadata_size;
-    while (metadata_remain > 0)
-        metadata_remain -= fread(viso->metadata + (metadata_size - metadata_remain), 1, MIN(metadata_remain, viso->sector_size), viso->tf.fp);
-
-    /* We no longer need the temporary file; close and delete it. */
-    fclose(viso->tf.fp);
-    viso->tf.fp = NULL;
+    image_viso_log(viso->tf.log, "Built %zu %zu-byte sectors of metadata\n",
+                   viso->metadata_sectors, viso->sector_size);
 #ifdef IMAGE_VISO_LOG
-    if (stricmp(path_get_extension(viso->tf.fn), "iso"))
+    if (image_viso_do_log) {
+        FILE *fp = plat_fopen64(nvr_path("viso-debug.iso"), "wb");
+        if (fp) {
+            fwrite(viso->metadata, 1, viso->metadata_len, fp);
+            fclose(fp);
+        }
+    }
 #endif
-        remove(nvr_path(viso->tf.fn));
 
     /* All good. */
     *error = 0;
@@ -6,6 +6,10 @@ ropJMP_r8(UNUSED(uint8_t opcode), uint32_t fetchdat, UNUSED(uint32_t op_32), uin
     if (offset & 0x80)
         offset |= 0xffffff00;
 
+    /* Leave JMP $ to the interpreter, which skips ahead to the next timer. */
+    if (cpu_idle_skip && (offset == 0xfffffffe))
+        return 0;
+
     STORE_IMM_ADDR_L((uintptr_t) &cpu_state.pc, op_pc + 1 + offset);
 
     return -1;
@@ -23,6 +23,10 @@ ropJMP_r8(codeblock_t *block, ir_data_t *ir, UNUSED(uint8_t opcode), UNUSED(uint
     if (!(op_32 & 0x100))
         dest_addr &= 0xffff;
 
+    /* Leave JMP $ to the interpreter, which skips ahead to the next timer. */
+    if (cpu_idle_skip && (offset == 0xfffffffe))
+        return 0;
+
     if (offset < 0)
         codegen_can_unroll(block, ir, op_pc + 1, dest_addr);
     codegen_mark_code_present(block, cs + op_pc, 1);
@@ -48,6 +48,7 @@
 #include <86box/86box.h>
 #include "cpu.h"
 #include <86box/device.h>
+#include <86box/device_prof.h>
 #include <86box/timer.h>
 #include <86box/cassette.h>
 #include <86box/cartridge.h>
@@ -157,6 +158,18 @@ load_global_emulator(void)
 
     chd_precache_level = ini_section_get_int(cat, "chd_precache_level", 0);
 
+    chd_cache_size = ini_section_get_int(cat, "chd_cache_size", CHD_CACHE_SIZE_DEFAULT);
+    if (chd_cache_size < 0)
+        chd_cache_size = 0;
+    else if (chd_cache_size > CHD_CACHE_SIZE_MAX)
+        chd_cache_size = CHD_CACHE_SIZE_MAX;
+
+    chd_read_ahead = ini_section_get_int(cat, "chd_read_ahead", CHD_READ_AHEAD_DEFAULT);
+    if (chd_read_ahead < 0)
+        chd_read_ahead = 0;
+    else if (chd_read_ahead > CHD_READ_AHEAD_MAX)
+        chd_read_ahead = CHD_READ_AHEAD_MAX;
+
     p = ini_section_get_string(cat, "vmm_path", NULL);
     if (p != NULL) {
         /* Convert relative paths to absolute in portable mode */
@@ -330,6 +343,10 @@ load_general(void)
 
     force_10ms = !!ini_section_get_int(cat, "force_10ms", 0);
 
+    device_prof_interval = ini_section_get_int(cat, "device_prof_interval", 0);
+    if (device_prof_interval < 0)
+        device_prof_interval = 0;
+
     rctrl_is_lalt = ini_section_get_int(cat, "rctrl_is_lalt", 0);
     update_icons  = ini_section_get_int(cat, "update_icons", 1);
 
@@ -530,6 +547,9 @@ load_machine(void)
 
     cpu_override             = ini_section_get_int(cat, "cpu_override", 0);
     cpu_override_interpreter = ini_section_get_int(cat, "cpu_override_interpreter", 0);
+    cpu_fetch_cache          = !!ini_section_get_int(cat, "cpu_fetch_cache", 1);
+    cpu_idle_skip            = !!ini_section_get_int(cat, "cpu_idle_skip", 1);
+    cpu_fuse_ops             = !!ini_section_get_int(cat, "cpu_fuse_ops", 1);
     cpu_f                    = NULL;
     p                        = ini_section_get_string(cat, "cpu_family", NULL);
     if (p) {
@@ -981,6 +1001,24 @@ load_sound(void)
     sound_sample_rate = ini_section_get_int(cat, "sound_sample_rate", FREQ_48000);
     if (sound_sample_rate != FREQ_44100 && sound_sample_rate != FREQ_48000)
         sound_sample_rate = FREQ_48000;
+
+    sound_mix_threads = ini_section_get_int(cat, "sound_mix_threads", 0);
+    if (sound_mix_threads < 0)
+        sound_mix_threads = 0;
+    else if (sound_mix_threads > SOUND_MIX_MAX_THREADS)
+        sound_mix_threads = SOUND_MIX_MAX_THREADS;
+
+    midi_render_ahead = ini_section_get_int(cat, "midi_render_ahead", MIDI_RENDER_AHEAD_DEFAULT);
+    if (midi_render_ahead < 0)
+        midi_render_ahead = 0;
+    else if (midi_render_ahead > MIDI_RENDER_AHEAD_MAX)
+        midi_render_ahead = MIDI_RENDER_AHEAD_MAX;
+
+    cdrom_read_ahead = ini_section_get_int(cat, "cd_audio_read_ahead", CD_READ_AHEAD_DEFAULT);
+    if (cdrom_read_ahead < 0)
+        cdrom_read_ahead = 0;
+    else if (cdrom_read_ahead > CD_READ_AHEAD_MAX)
+        cdrom_read_ahead = CD_READ_AHEAD_MAX;
 }
 
 /* Load "Network" section. */
@@ -1071,6 +1109,8 @@ load_network(void)
                 nc->net_type = NET_TYPE_NLSWITCH;
             else if (!strcmp(p, "nrswitch") || !strcmp(p, "6"))
                 nc->net_type = NET_TYPE_NRSWITCH;
+            else if (!strcmp(p, "shmswitch") || !strcmp(p, "7"))
+                nc->net_type = NET_TYPE_SHMSWITCH;
             else
                 nc->net_type = NET_TYPE_NONE;
         } else
@@ -1123,6 +1163,29 @@ load_network(void)
         p = ini_section_get_string(cat, temp, NULL);
         strncpy(nc->nrs_hostname, p ? p : "", sizeof(nc->nrs_hostname) - 1);
 
+        sprintf(temp, "net_%02i_queue_len", c + 1);
+        nc->queue_len = ini_section_get_int(cat, temp, NET_QUEUE_LEN_DEFAULT);
+        if (nc->queue_len < NET_QUEUE_LEN)
+            nc->queue_len = NET_QUEUE_LEN;
+        else if (nc->queue_len > NET_QUEUE_LEN_MAX)
+            nc->queue_len = NET_QUEUE_LEN_MAX;
+
+        sprintf(temp, "net_%02i_host_speed", c + 1);
+        nc->host_speed = !!ini_section_get_int(cat, temp, 0);
+
+        sprintf(temp, "net_%02i_busy_poll", c + 1);
+        nc->busy_poll = ini_section_get_int(cat, temp, 0);
+        if (nc->busy_poll > NET_BUSY_POLL_MAX)
+            nc->busy_poll = NET_BUSY_POLL_MAX;
+
+        sprintf(temp, "net_%02i_capture_snaplen", c + 1);
+        nc->capture_snaplen = ini_section_get_int(cat, temp, 0);
+
+        sprintf(temp, "net_%02i_capture_filter", c + 1);
+        p = ini_section_get_string(cat, temp, NULL);
+        strncpy(nc->capture_filter, p ? p : "", sizeof(nc->capture_filter) - 1);
+        nc->capture_filter[sizeof(nc->capture_filter) - 1] = '\0';
+
         sprintf(temp, "net_%02i_link", c + 1);
         nc->link_state = ini_section_get_int(cat, temp,
                                              (NET_LINK_10_HD | NET_LINK_10_FD |
@@ -1458,6 +1521,8 @@ load_storage_controllers(void)
     if (p != NULL)
         cdrom_interface_current = cdrom_interface_get_from_internal_name(p);
 
+    ide_fast_completion = !!ini_section_get_int(cat, "ide_fast_completion", 0);
+
     fdd_tape_enabled = !!ini_section_get_int(cat, "floppy_tape_enabled", 0);
 
     fdd_tape_unit = ini_section_get_int(cat, "floppy_tape_unit", 1);
@@ -2881,6 +2946,16 @@ save_global_emulator(void)
     else
         ini_section_delete_var(cat, "chd_precache_level");
 
+    if (chd_cache_size != CHD_CACHE_SIZE_DEFAULT)
+        ini_section_set_int(cat, "chd_cache_size", chd_cache_size);
+    else
+        ini_section_delete_var(cat, "chd_cache_size");
+
+    if (chd_read_ahead != CHD_READ_AHEAD_DEFAULT)
+        ini_section_set_int(cat, "chd_read_ahead", chd_read_ahead);
+    else
+        ini_section_delete_var(cat, "chd_read_ahead");
+
     if (vmm_disabled != 0)
         ini_section_set_int(cat, "vmm_disabled", vmm_disabled);
     else
@@ -2980,6 +3055,10 @@ save_general(void)
     if (force_10ms == 0)
         ini_section_delete_var(cat, "force_10ms");
 
+    ini_section_set_int(cat, "device_prof_interval", device_prof_interval);
+    if (device_prof_interval == 0)
+        ini_section_delete_var(cat, "device_prof_interval");
+
     ini_section_set_int(cat, "sound_muted", sound_muted);
     if (sound_muted == 0)
         ini_section_delete_var(cat, "sound_muted");
@@ -3198,6 +3277,18 @@ save_machine(void)
         ini_section_set_int(cat, "cpu_override_interpreter", cpu_override_interpreter);
     else
         ini_section_delete_var(cat, "cpu_override_interpreter");
+    if (cpu_fetch_cache)
+        ini_section_delete_var(cat, "cpu_fetch_cache");
+    else
+        ini_section_set_int(cat, "cpu_fetch_cache", cpu_fetch_cache);
+    if (cpu_idle_skip)
+        ini_section_delete_var(cat, "cpu_idle_skip");
+    else
+        ini_section_set_int(cat, "cpu_idle_skip", cpu_idle_skip);
+    if (cpu_fuse_ops)
+        ini_section_delete_var(cat, "cpu_fuse_ops");
+    else
+        ini_section_set_int(cat, "cpu_fuse_ops", cpu_fuse_ops);
 
     /* Downgrade compatibility with the previous CPU model system. */
     ini_section_delete_var(cat, "cpu_manufacturer");
@@ -3493,6 +3584,21 @@ save_sound(void)
     else
         ini_section_set_int(cat, "sound_sample_rate", sound_sample_rate);
 
+    if (sound_mix_threads == 0)
+        ini_section_delete_var(cat, "sound_mix_threads");
+    else
+        ini_section_set_int(cat, "sound_mix_threads", sound_mix_threads);
+
+    if (midi_render_ahead == MIDI_RENDER_AHEAD_DEFAULT)
+        ini_section_delete_var(cat, "midi_render_ahead");
+    else
+        ini_section_set_int(cat, "midi_render_ahead", midi_render_ahead);
+
+    if (cdrom_read_ahead == CD_READ_AHEAD_DEFAULT)
+        ini_section_delete_var(cat, "cd_audio_read_ahead");
+    else
+        ini_section_set_int(cat, "cd_audio_read_ahead", cdrom_read_ahead);
+
     ini_delete_section_if_empty(config, cat);
 }
 
@@ -3540,6 +3646,9 @@ save_network(void)
             case NET_TYPE_NRSWITCH:
                 ini_section_set_string(cat, temp, "nrswitch");
                 break;
+            case NET_TYPE_SHMSWITCH:
+                ini_section_set_string(cat, temp, "shmswitch");
+                break;
             default:
                 break;
         }
@@ -3553,6 +3662,36 @@ save_network(void)
         } else
             ini_section_delete_var(cat, temp);
 
+        sprintf(temp, "net_%02i_queue_len", c + 1);
+        if (nc->queue_len == NET_QUEUE_LEN_DEFAULT)
+            ini_section_delete_var(cat, temp);
+        else
+            ini_section_set_int(cat, temp, nc->queue_len);
+
+        sprintf(temp, "net_%02i_host_speed", c + 1);
+        if (nc->host_speed == 0)
+            ini_section_delete_var(cat, temp);
+        else
+            ini_section_set_int(cat, temp, nc->host_speed);
+
+        sprintf(temp, "net_%02i_busy_poll", c + 1);
+        if (nc->busy_poll == 0)
+            ini_section_delete_var(cat, temp);
+        else
+            ini_section_set_int(cat, temp, nc->busy_poll);
+
+        sprintf(temp, "net_%02i_capture_snaplen", c + 1);
+        if (nc->capture_snaplen == 0)
+            ini_section_delete_var(cat, temp);
+        else
+            ini_section_set_int(cat, temp, nc->capture_snaplen);
+
+        sprintf(temp, "net_%02i_capture_filter", c + 1);
+        if (nc->capture_filter[0] == '\0')
+            ini_section_delete_var(cat, temp);
+        else
+            ini_section_set_string(cat, temp, nc->capture_filter);
+
         sprintf(temp, "net_%02i_link", c + 1);
         if (nc->link_state == (NET_LINK_10_HD | NET_LINK_10_FD |
                                NET_LINK_100_HD | NET_LINK_100_FD |
@@ -3802,6 +3941,11 @@ save_storage_controllers(void)
         ini_section_set_string(cat, "cdrom_interface",
                                cdrom_interface_get_internal_name(cdrom_interface_current));
 
+    if (ide_fast_completion == 0)
+        ini_section_delete_var(cat, "ide_fast_completion");
+    else
+        ini_section_set_int(cat, "ide_fast_completion", ide_fast_completion);
+
     if (fdd_tape_enabled == 0) {
         ini_section_delete_var(cat, "floppy_tape_enabled");
         ini_section_delete_var(cat, "floppy_tape_unit");
@@ -220,6 +220,7 @@ fetch_ea_16_long(uint32_t rmdat)
         x86gpf("Limit check (READ CS)", 0);
 
 #include "386_ops.h"
+#include "386_fuse.h"
 
 void
 exec386_2386(int32_t cycs)
@@ -294,6 +295,9 @@ exec386_2386(int32_t cycs)
                 in_lock = 0;
                 if (x86_was_reset)
                     break;
+
+                if (fuse_jcc_candidate(opcode, fetchdat) && fuse_jcc_allowed(ins_cycles - cycles))
+                    fuse_jcc_run(x86_2386_opcodes);
             }
 #ifdef ENABLE_386_LOG
             else if (in_smm)
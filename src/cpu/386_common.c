@@ -18,6 +18,7 @@
 #include "x87.h"
 #include <86box/nmi.h>
 #include <86box/mem.h>
+#include <86box/io.h>
 #include <86box/smram.h>
 #include <86box/pic.h>
 #include <86box/pit.h>
@@ -2061,7 +2062,7 @@ sysexit(UNUSED(uint32_t fetchdat))
 
     cpu_cur_status &= ~(CPU_STATUS_NOTFLATSS /* | CPU_STATUS_V86*/);
     cpu_cur_status |= (CPU_STATUS_USE32 | CPU_STATUS_STACK32 | CPU_STATUS_PMODE);
-    flushmmucache_nopc();
+    flushmmucache_user();
     set_use32(1);
     set_stack32(1);
 
@@ -2178,7 +2179,7 @@ sysret(UNUSED(uint32_t fetchdat))
 
     cpu_cur_status &= ~(CPU_STATUS_NOTFLATSS /* | CPU_STATUS_V86*/);
     cpu_cur_status |= (CPU_STATUS_USE32 | CPU_STATUS_STACK32 | CPU_STATUS_PMODE);
-    flushmmucache_nopc();
+    flushmmucache_user();
     set_use32(1);
     set_stack32(1);
 
@@ -2251,6 +2252,242 @@ nmi_raise(void)
     nmi = 1;
 }
 
+/* Number of elements from addr onwards (or downwards) that stay in its page. */
+static uint32_t
+rep_bulk_page_span(uint32_t addr, uint32_t n, int size, int down)
+{
+    uint32_t span;
+
+    if (((addr & 0xfff) + size) > 0x1000)
+        return 0;
+
+    if (down)
+        span = ((addr & 0xfff) / size) + 1;
+    else
+        span = ((0x1000 - (addr & 0xfff)) / size);
+
+    return (span < n) ? span : n;
+}
+
+static const uint8_t *
+rep_bulk_read_ptr(uint32_t addr)
+{
+    if (readlookup2[addr >> 12] == (uintptr_t) LOOKUP_INV)
+        return NULL;
+
+    return (const uint8_t *) (readlookup2[addr >> 12] + (uintptr_t) addr);
+}
+
+/* Pages holding recompiled code are never in writelookup2[], those are
+   written through page_lookup[] so that *page can be marked dirty. */
+static uint8_t *
+rep_bulk_write_ptr(uint32_t addr, page_t **page)
+{
+    *page = NULL;
+
+    if (writelookup2[addr >> 12] != (uintptr_t) LOOKUP_INV)
+        return (uint8_t *) (writelookup2[addr >> 12] + (uintptr_t) addr);
+
+#ifndef USE_GDBSTUB
+    if (page_lookup[addr >> 12] != NULL) {
+        uint8_t *p = mem_ram_page_ptr(addr, page_lookup[addr >> 12]);
+
+        if (p != NULL)
+            *page = page_lookup[addr >> 12];
+        return p;
+    }
+#endif
+
+    return NULL;
+}
+
+/*
+   Bulk steps of the REP string instructions. Each one handles up to n
+   elements that lie in a single page of plain RAM, directly on the host
+   memory, and returns how many it did; 0 tells the caller to keep going
+   one element at a time (MMIO, unmapped or not yet looked up pages, page
+   crossings). The caller has already made sure that the n elements pass
+   the segment checks and fit in the cycles left in the slice.
+ */
+uint32_t
+rep_movs_bulk(uint32_t src, uint32_t dst, uint32_t n, int size, int down)
+{
+    const uint8_t *s;
+    uint8_t       *d;
+    page_t        *page;
+    uint32_t       len;
+
+    if (dr[7] & 0xff)
+        return 0;
+
+    n = rep_bulk_page_span(src, n, size, down);
+    n = rep_bulk_page_span(dst, n, size, down);
+    if (n < 2)
+        return 0;
+
+    if (((s = rep_bulk_read_ptr(src)) == NULL) || ((d = rep_bulk_write_ptr(dst, &page)) == NULL))
+        return 0;
+
+    /* Going one element at a time, a destination just ahead of the source
+       keeps reading back what was just written; stop short of that. */
+    if (!down && (d > s) && ((uintptr_t) (d - s) < ((uintptr_t) n * size)))
+        n = (uint32_t) (d - s) / size;
+    else if (down && (d < s) && ((uintptr_t) (s - d) < ((uintptr_t) n * size)))
+        n = (uint32_t) (s - d) / size;
+    if (n < 2)
+        return 0;
+
+    len = n * size;
+    if (down) {
+        s -= len - size;
+        d -= len - size;
+        dst -= len - size;
+    }
+
+    if (page == NULL)
+        memmove(d, s, len);
+#ifdef USE_DYNAREC
+    else if (codegen_in_recompile || memcmp(d, s, len)) {
+#else
+    else if (memcmp(d, s, len)) {
+#endif
+        memmove(d, s, len);
+        mem_dirty_ram_range_page(dst, len, page);
+    }
+
+    return n;
+}
+
+uint32_t
+rep_stos_bulk(uint32_t dst, uint32_t n, int size, int down, uint32_t val)
+{
+    uint8_t *d;
+    page_t  *page;
+    uint32_t len;
+
+    if (dr[7] & 0xff)
+        return 0;
+
+    n = rep_bulk_page_span(dst, n, size, down);
+    if ((n < 2) || ((d = rep_bulk_write_ptr(dst, &page)) == NULL))
+        return 0;
+
+    len = n * size;
+    if (down) {
+        d -= len - size;
+        dst -= len - size;
+    }
+
+    if (size == 1)
+        memset(d, val, len);
+    else {
+        for (uint32_t i = 0; i < len; i += size)
+            memcpy(d + i, &val, size);
+    }
+
+    if (page != NULL)
+        mem_dirty_ram_range_page(dst, len, page);
+
+    return n;
+}
+
+uint32_t
+rep_lods_bulk(uint32_t src, uint32_t n, int size, int down, uint32_t *last)
+{
+    const uint8_t *s;
+
+    if (dr[7] & 0xff)
+        return 0;
+
+    n = rep_bulk_page_span(src, n, size, down);
+    if ((n < 2) || ((s = rep_bulk_read_ptr(src)) == NULL))
+        return 0;
+
+    *last = 0;
+    memcpy(last, down ? (s - ((n - 1) * size)) : (s + ((n - 1) * size)), size);
+
+    return n;
+}
+
+/* Stops after the first element that ends the REPE/REPNE, whose value is
+   left in *last so that the caller can set the flags from it. */
+uint32_t
+rep_scas_bulk(uint32_t dst, uint32_t n, int size, int down, uint32_t val, int while_equal, uint32_t *last)
+{
+    const uint8_t *d;
+    uint32_t       i;
+    uint32_t       elem = 0;
+
+    if (dr[7] & 0xff)
+        return 0;
+
+    n = rep_bulk_page_span(dst, n, size, down);
+    if ((n < 2) || ((d = rep_bulk_read_ptr(dst)) == NULL))
+        return 0;
+
+    if ((size == 1) && !down && !while_equal) {
+        const uint8_t *p = memchr(d, val & 0xff, n);
+
+        i     = p ? ((uint32_t) (p - d) + 1) : n;
+        *last = d[i - 1];
+        return i;
+    }
+
+    for (i = 0; i < n; ) {
+        memcpy(&elem, down ? (d - (i * size)) : (d + (i * size)), size);
+        i++;
+        if ((elem == val) != while_equal)
+            break;
+    }
+
+    *last = elem;
+    return i;
+}
+
+/* REP INSW/INSD and OUTSW/OUTSD, upwards only, through the block handler
+   of the port if it has one. */
+uint32_t
+rep_ins_bulk(uint16_t port, uint32_t dst, uint32_t n, int size)
+{
+    uint8_t *d;
+    page_t  *page;
+
+    if ((dr[7] & 0xff) || (dst & (size - 1)))
+        return 0;
+
+    n = rep_bulk_page_span(dst, n, size, 0);
+    if ((n == 0) || ((d = rep_bulk_write_ptr(dst, &page)) == NULL))
+        return 0;
+
+    if (size == 2)
+        n = inw_block(port, (uint16_t *) d, n);
+    else
+        n = inl_block(port, (uint32_t *) d, n);
+
+    if ((n != 0) && (page != NULL))
+        mem_dirty_ram_range_page(dst, n * size, page);
+
+    return n;
+}
+
+uint32_t
+rep_outs_bulk(uint16_t port, uint32_t src, uint32_t n, int size)
+{
+    const uint8_t *s;
+
+    if ((dr[7] & 0xff) || (src & (size - 1)))
+        return 0;
+
+    n = rep_bulk_page_span(src, n, size, 0);
+    if ((n == 0) || ((s = rep_bulk_read_ptr(src)) == NULL))
+        return 0;
+
+    if (size == 2)
+        return outw_block(port, (const uint16_t *) s, n);
+
+    return outl_block(port, (const uint32_t *) s, n);
+}
+
 #ifndef USE_DYNAREC
 /* This is for compatibility with new x87 code. */
 void
@@ -2259,3 +2496,33 @@ codegen_set_rounding_mode(int mode)
     /* cpu_state.new_npxc = (cpu_state.old_npxc & ~0xc00) | (mode << 10); */
 }
 #endif
+
+/*
+   Cycles to charge a CPU that only an interrupt can get going again, such
+   as one in HLT. Nothing else can happen before the next timer event, so
+   it skips straight there, but no further than what is left of the cycles
+   this call to cpu_exec was given.
+ */
+int
+cpu_idle_cycles(int min_cycles)
+{
+    int64_t skip;
+
+    if (!cpu_idle_skip || smi_line || (nmi && nmi_enable && nmi_mask) || (cpu_state.flags & T_FLAG))
+        return min_cycles;
+
+#ifdef USE_DYNAREC
+    /* The dynarec only brings the TSC up to date at the end of a block. */
+    if (cpu_exec == exec386_dynarec)
+        update_tsc();
+#endif
+
+    if ((cpu_state.flags & I_FLAG) && pic.int_pending)
+        return min_cycles;
+
+    skip = (int64_t) (timer_target - tsc);
+    if (skip > cycles)
+        skip = cycles;
+
+    return (skip > min_cycles) ? (int) skip : min_cycles;
+}
@@ -303,6 +303,140 @@ int checkio(uint32_t port, int mask);
         break;                                                                   \
     }
 
+extern uint32_t rep_movs_bulk(uint32_t src, uint32_t dst, uint32_t n, int size, int down);
+extern uint32_t rep_stos_bulk(uint32_t dst, uint32_t n, int size, int down, uint32_t val);
+extern uint32_t rep_lods_bulk(uint32_t src, uint32_t n, int size, int down, uint32_t *last);
+extern uint32_t rep_scas_bulk(uint32_t dst, uint32_t n, int size, int down, uint32_t val, int while_equal, uint32_t *last);
+extern uint32_t rep_ins_bulk(uint16_t port, uint32_t dst, uint32_t n, int size);
+extern uint32_t rep_outs_bulk(uint16_t port, uint32_t src, uint32_t n, int size);
+
+extern int cpu_idle_cycles(int min_cycles);
+
+/* How many of the next cnt elements at reg the REP loop would get through
+   without a segment limit fault, an address register wrap or running out
+   of the cycles it has left. */
+static __inline uint32_t
+rep_bulk_limit(uint32_t cnt, int budget, int cost, uint32_t reg, uint32_t reg_max, int size, int down, const x86seg *seg)
+{
+    uint32_t n = cnt;
+    uint32_t m;
+
+    if ((budget < 0) || (reg < seg->limit_low) || (reg > (reg_max - (size - 1))) || ((reg + (size - 1)) > seg->limit_high))
+        return 0;
+
+    m = ((uint32_t) budget / cost) + 1;
+    if (m < n)
+        n = m;
+
+    if (down)
+        m = ((reg - seg->limit_low) / size) + 1;
+    else {
+        m = ((reg_max - reg - (size - 1)) / size) + 1;
+        if (m < n)
+            n = m;
+        m = ((seg->limit_high - reg - (size - 1)) / size) + 1;
+    }
+
+    return (m < n) ? m : n;
+}
+
+#define REP_BULK_REG_MAX(reg) ((sizeof(reg) == 2) ? 0xffffUL : 0xffffffffUL)
+
+/* Run after an element has been done and the slice is not over yet; the
+   number of further elements done is left in n. */
+#define REP_BULK_MOVS(n, size, CNT_REG, SRC_REG, DEST_REG, cost)                                                                       \
+    n = 0;                                                                                                                             \
+    if (CNT_REG > 0) {                                                                                                                 \
+        const int down_ = !!(cpu_state.flags & D_FLAG);                                                                                \
+        n = rep_bulk_limit(CNT_REG, cycles - cycles_end, cost, SRC_REG, REP_BULK_REG_MAX(SRC_REG), size, down_, cpu_state.ea_seg);    \
+        n = rep_bulk_limit(n, cycles - cycles_end, cost, DEST_REG, REP_BULK_REG_MAX(DEST_REG), size, down_, &cpu_state.seg_es);      \
+        if (n)                                                                                                                         \
+            n = rep_movs_bulk(cpu_state.ea_seg->base + SRC_REG, es + DEST_REG, n, size, down_);                                        \
+        if (n) {                                                                                                                       \
+            SRC_REG  = down_ ? (SRC_REG - (n * size)) : (SRC_REG + (n * size));                                                        \
+            DEST_REG = down_ ? (DEST_REG - (n * size)) : (DEST_REG + (n * size));                                                      \
+            CNT_REG -= n;                                                                                                              \
+            cycles -= n * (cost);                                                                                                      \
+        }                                                                                                                              \
+    }
+
+#define REP_BULK_STOS(n, size, CNT_REG, DEST_REG, val, cost)                                                                           \
+    n = 0;                                                                                                                             \
+    if (CNT_REG > 0) {                                                                                                                 \
+        const int down_ = !!(cpu_state.flags & D_FLAG);                                                                                \
+        n = rep_bulk_limit(CNT_REG, cycles - cycles_end, cost, DEST_REG, REP_BULK_REG_MAX(DEST_REG), size, down_, &cpu_state.seg_es); \
+        if (n)                                                                                                                         \
+            n = rep_stos_bulk(es + DEST_REG, n, size, down_, val);                                                                     \
+        if (n) {                                                                                                                       \
+            DEST_REG = down_ ? (DEST_REG - (n * size)) : (DEST_REG + (n * size));                                                      \
+            CNT_REG -= n;                                                                                                              \
+            cycles -= n * (cost);                                                                                                      \
+        }                                                                                                                              \
+    }
+
+#define REP_BULK_LODS(n, size, CNT_REG, SRC_REG, reg, cost)                                                                            \
+    n = 0;                                                                                                                             \
+    if (CNT_REG > 0) {                                                                                                                 \
+        const int down_ = !!(cpu_state.flags & D_FLAG);                                                                                \
+        uint32_t  last_;                                                                                                               \
+        n = rep_bulk_limit(CNT_REG, cycles - cycles_end, cost, SRC_REG, REP_BULK_REG_MAX(SRC_REG), size, down_, cpu_state.ea_seg);    \
+        if (n)                                                                                                                         \
+            n = rep_lods_bulk(cpu_state.ea_seg->base + SRC_REG, n, size, down_, &last_);                                               \
+        if (n) {                                                                                                                       \
+            reg     = last_;                                                                                                           \
+            SRC_REG = down_ ? (SRC_REG - (n * size)) : (SRC_REG + (n * size));                                                         \
+            CNT_REG -= n;                                                                                                              \
+            cycles -= n * (cost);                                                                                                      \
+        }                                                                                                                              \
+    }
+
+#define REP_BULK_SCAS(n, size, CNT_REG, DEST_REG, reg, setsub, tempz, FV, cost)                                                        \
+    n = 0;                                                                                                                             \
+    if ((CNT_REG > 0) && (FV == tempz)) {                                                                                              \
+        const int down_ = !!(cpu_state.flags & D_FLAG);                                                                                \
+        uint32_t  last_;                                                                                                               \
+        n = rep_bulk_limit(CNT_REG, cycles - cycles_end, cost, DEST_REG, REP_BULK_REG_MAX(DEST_REG), size, down_, &cpu_state.seg_es); \
+        if (n)                                                                                                                         \
+            n = rep_scas_bulk(es + DEST_REG, n, size, down_, reg, FV, &last_);                                                         \
+        if (n) {                                                                                                                       \
+            setsub(reg, last_);                                                                                                        \
+            tempz    = (ZF_SET()) ? 1 : 0;                                                                                             \
+            DEST_REG = down_ ? (DEST_REG - (n * size)) : (DEST_REG + (n * size));                                                      \
+            CNT_REG -= n;                                                                                                              \
+            cycles -= n * (cost);                                                                                                      \
+        }                                                                                                                              \
+    }
+
+/* REP INS/OUTS do one element per pass; once it is done, the block
+   handlers get as many more as the other REP string ops do in a slice. */
+#define REP_BULK_IO_CYCLES ((is386 && cpu_use_dynarec) ? 1000 : 100)
+
+#define REP_BULK_INS(n, size, CNT_REG, DEST_REG, cost)                                                                                 \
+    n = 0;                                                                                                                             \
+    if ((CNT_REG > 0) && !trap && !(cpu_state.flags & D_FLAG)) {                                                                       \
+        n = rep_bulk_limit(CNT_REG, REP_BULK_IO_CYCLES, cost, DEST_REG, REP_BULK_REG_MAX(DEST_REG), size, 0, &cpu_state.seg_es);      \
+        if (n)                                                                                                                         \
+            n = rep_ins_bulk(DX, es + DEST_REG, n, size);                                                                              \
+        if (n) {                                                                                                                       \
+            DEST_REG += n * size;                                                                                                      \
+            CNT_REG -= n;                                                                                                              \
+            cycles -= n * (cost);                                                                                                      \
+        }                                                                                                                              \
+    }
+
+#define REP_BULK_OUTS(n, size, CNT_REG, SRC_REG, cost)                                                                                 \
+    n = 0;                                                                                                                             \
+    if ((CNT_REG > 0) && !trap && !(cpu_state.flags & D_FLAG)) {                                                                       \
+        n = rep_bulk_limit(CNT_REG, REP_BULK_IO_CYCLES, cost, SRC_REG, REP_BULK_REG_MAX(SRC_REG), size, 0, cpu_state.ea_seg);         \
+        if (n)                                                                                                                         \
+            n = rep_outs_bulk(DX, cpu_state.ea_seg->base + SRC_REG, n, size);                                                          \
+        if (n) {                                                                                                                       \
+            SRC_REG += n * size;                                                                                                       \
+            CNT_REG -= n;                                                                                                              \
+            cycles -= n * (cost);                                                                                                      \
+        }                                                                                                                              \
+    }
+
 #define NOTRM                                         \
     if (!(msw & 1) || (cpu_state.eflags & VM_FLAG)) { \
         x86_int(6);                                   \
@@ -310,11 +444,27 @@ int checkio(uint32_t port, int mask);
     }
 
 #ifdef OPS_286_386
-/* TODO: Introduce functions to read exec. */
+/* Host pointer for len code bytes at a if they lie in the cached fetch page. */
+static __inline uint8_t *
+fetch_ptr_2386(uint32_t a, int len)
+{
+    if (((a >> 12) != fetch_page_2386) || (((a & 0xfff) + len) > 0x1000) || cpu_old_paging || cpu_state.abrt ||
+        (fetch_user_2386 != (CPL == 3)) || (dr[7] & 0x000000ff))
+        return NULL;
+
+    mem_logical_addr = a;
+    return &fetch_mem_2386[a & 0xfff];
+}
+
 static __inline uint8_t
 fastreadb(uint32_t a)
 {
-    uint8_t ret;
+    const uint8_t *p = fetch_ptr_2386(a, 1);
+    uint8_t        ret;
+
+    if (p != NULL)
+        return *p;
+
     read_type = 1;
     ret = readmembl_2386(a);
     read_type = 4;
@@ -326,7 +476,15 @@ fastreadb(uint32_t a)
 static __inline uint16_t
 fastreadw(uint32_t a)
 {
-    uint16_t ret;
+    const uint8_t *p = fetch_ptr_2386(a, 2);
+    uint16_t       ret;
+
+    if (p != NULL) {
+        if ((a & 1) && (!cpu_cyrix_alignment || (a & 7) == 7))
+            cycles -= timing_misaligned;
+        return *(const uint16_t *) p;
+    }
+
     read_type = 1;
     ret = readmemwl_2386(a);
     read_type = 4;
@@ -338,7 +496,15 @@ fastreadw(uint32_t a)
 static __inline uint32_t
 fastreadl(uint32_t a)
 {
-    uint32_t ret;
+    const uint8_t *p = fetch_ptr_2386(a, 4);
+    uint32_t       ret;
+
+    if (p != NULL) {
+        if ((a & 3) && (!cpu_cyrix_alignment || (a & 7) > 4))
+            cycles -= timing_misaligned;
+        return *(const uint32_t *) p;
+    }
+
     read_type = 1;
     ret = readmemll_2386(a);
     read_type = 4;
@@ -469,7 +635,8 @@ fastreadw_fetch(uint32_t a)
 static __inline uint32_t
 fastreadl_fetch(uint32_t a)
 {
-    uint32_t ret;
+    const uint8_t *p;
+    uint32_t       ret;
 
     if (cpu_16bitbus || ((a & 0xFFF) > 0xFFC)) {
         ret = fastreadw_fetch(a);
@@ -478,11 +645,18 @@ fastreadl_fetch(uint32_t a)
     } else if (cpu_state.abrt)
         ret = 0;
     else {
-        read_type = 1;
         cpu_old_paging = (cpu_flush_pending == 2);
-        ret = readmemll_2386(a);
+        if ((p = fetch_ptr_2386(a, 4)) != NULL) {
+            if ((a & 3) && (!cpu_cyrix_alignment || (a & 7) > 4))
+                cycles -= timing_misaligned;
+            ret = *(const uint32_t *) p;
+        } else {
+            read_type = 1;
+            ret = readmemll_2386(a);
+            read_type = 4;
+            fetch_fill_2386(a);
+        }
         cpu_old_paging = 0;
-        read_type = 4;
     }
 
     return ret;
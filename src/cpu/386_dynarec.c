@@ -244,6 +244,7 @@ fetch_ea_16_long(uint32_t rmdat)
 #define CLOCK_CYCLES_ALWAYS(c) cycles -= (c)
 
 #include "386_ops.h"
+#include "386_fuse.h"
 
 #ifdef USE_DEBUG_REGS_486
 #    define CACHE_ON() (!(cr0 & (1 << 30)) && !(cpu_state.flags & T_FLAG) && !(dr[7] & 0xFF))
@@ -1029,6 +1030,9 @@ exec386(int32_t cycs)
                 x86_opcodes[(opcode | cpu_state.op32) & 0x3ff](fetchdat);
                 if (x86_was_reset)
                     break;
+
+                if (fuse_jcc_candidate(opcode, fetchdat) && fuse_jcc_allowed(ins_cycles - cycles))
+                    fuse_jcc_run(x86_opcodes);
             }
 #ifdef ENABLE_386_LOG
             else if (in_smm)
@@ -0,0 +1,92 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Compare and branch fusion for the interpreter loops.
+ *
+ *          A short Jcc right behind a CMP, TEST, INC or DEC is run in
+ *          the same step of the loop, skipping the bookkeeping between
+ *          the two. Only done when that bookkeeping would have had
+ *          nothing to do.
+ *
+ * Authors: 86Box contributors.
+ *
+ *          Copyright 2026 86Box contributors.
+ */
+#ifndef _386_FUSE_H_
+#define _386_FUSE_H_
+
+/* fetchdat holds the bytes following the opcode. */
+static __inline int
+fuse_jcc_candidate(uint8_t opcode, uint32_t fetchdat)
+{
+    switch (opcode) {
+        case 0x38 ... 0x3d: /* CMP */
+        case 0x40 ... 0x4f: /* INC/DEC reg */
+        case 0x84:
+        case 0x85:
+        case 0xa8:
+        case 0xa9:          /* TEST */
+            return 1;
+
+        case 0x80:
+        case 0x81:
+        case 0x83:          /* CMP r/m, imm */
+            return (fetchdat & 0x38) == 0x38;
+
+        default:
+            return 0;
+    }
+}
+
+/*
+   ins_cycles is how many cycles the first instruction took. The loop adds
+   them to the TSC only after the Jcc, so a timer that is due by then has
+   to be run first.
+ */
+static __inline int
+fuse_jcc_allowed(int32_t ins_cycles)
+{
+#ifdef USE_GDBSTUB
+    return 0;
+#else
+    return cpu_fuse_ops && !TIMER_VAL_LESS_THAN_VAL(timer_target, (uint64_t) tsc + ins_cycles) &&
+           !cpu_state.abrt && !x86_was_reset && !trap && !(cpu_state.flags & T_FLAG) &&
+           !cpu_end_block_after_ins && !cpu_flush_pending && !new_ne && !smi_line &&
+           !(nmi && nmi_enable && nmi_mask) && !((cpu_state.flags & I_FLAG) && pic.int_pending) &&
+           !(dr[7] & 0xff) && (cpu_state.pc >= cpu_state.seg_cs.limit_low) &&
+           ((cpu_state.pc + 1) <= cpu_state.seg_cs.limit_high);
+#endif
+}
+
+/*
+   Runs the next instruction if it is a short Jcc. The fetch is the one the
+   loop would do next anyway, so a fault from it is taken with oldpc already
+   pointing at the Jcc.
+ */
+static __inline void
+fuse_jcc_run(const OpFn *opcodes)
+{
+    uint32_t fetchdat;
+
+#ifndef USE_NEW_DYNAREC
+    if (!use32)
+        cpu_state.pc &= 0xffff;
+#endif
+
+    cpu_state.oldpc = cpu_state.pc;
+    cpu_state.op32  = use32;
+
+    fetchdat = fastreadl_fetch(cs + cpu_state.pc);
+    if (cpu_state.abrt || ((fetchdat & 0xf0) != 0x70))
+        return;
+
+    cpu_state.pc++;
+    opcodes[((fetchdat & 0xff) | cpu_state.op32) & 0x3ff](fetchdat >> 8);
+}
+
+#endif /*_386_FUSE_H_*/
@@ -211,6 +211,9 @@ int cpu_cyrix_alignment;
 int cpu_cpurst_on_sr;
 int cpu_use_exec = 0;
 int cpu_override_interpreter;
+int cpu_fetch_cache = 1;
+int cpu_idle_skip   = 1;
+int cpu_fuse_ops    = 1;
 int CPUID;
 
 int is186;
@@ -851,6 +851,9 @@ extern int new_ne;
 
 extern int in_lock;
 extern int cpu_override_interpreter;
+extern int cpu_fetch_cache;
+extern int cpu_idle_skip;
+extern int cpu_fuse_ops;
 
 extern int is_lock_legal(uint32_t fetchdat);
 
@@ -493,6 +493,81 @@ CF_SET(void)
 #endif
 }
 
+/*
+   Conditions made of more than one flag. After a CMP/SUB they come straight
+   from the operands, after a logical op (V and C clear) from the result,
+   instead of working out every flag they need on its own.
+ */
+static __inline int32_t
+flags_sub_sext(uint32_t val)
+{
+    switch (cpu_state.flags_op) {
+        case FLAGS_SUB8:
+            return (int8_t) val;
+        case FLAGS_SUB16:
+            return (int16_t) val;
+        default:
+            return (int32_t) val;
+    }
+}
+
+static __inline int
+cond_be_set(void)
+{
+    switch (cpu_state.flags_op) {
+        case FLAGS_SUB8:
+        case FLAGS_SUB16:
+        case FLAGS_SUB32:
+            return cpu_state.flags_op1 <= cpu_state.flags_op2;
+
+        case FLAGS_ZN8:
+        case FLAGS_ZN16:
+        case FLAGS_ZN32:
+            return !cpu_state.flags_res;
+
+        default:
+            return CF_SET() || ZF_SET();
+    }
+}
+
+static __inline int
+cond_l_set(void)
+{
+    switch (cpu_state.flags_op) {
+        case FLAGS_SUB8:
+        case FLAGS_SUB16:
+        case FLAGS_SUB32:
+            return flags_sub_sext(cpu_state.flags_op1) < flags_sub_sext(cpu_state.flags_op2);
+
+        case FLAGS_ZN8:
+        case FLAGS_ZN16:
+        case FLAGS_ZN32:
+            return !!NF_SET();
+
+        default:
+            return ((NF_SET()) ? 1 : 0) != ((VF_SET()) ? 1 : 0);
+    }
+}
+
+static __inline int
+cond_le_set(void)
+{
+    switch (cpu_state.flags_op) {
+        case FLAGS_SUB8:
+        case FLAGS_SUB16:
+        case FLAGS_SUB32:
+            return flags_sub_sext(cpu_state.flags_op1) <= flags_sub_sext(cpu_state.flags_op2);
+
+        case FLAGS_ZN8:
+        case FLAGS_ZN16:
+        case FLAGS_ZN32:
+            return !cpu_state.flags_res || NF_SET();
+
+        default:
+            return (((NF_SET()) ? 1 : 0) != ((VF_SET()) ? 1 : 0)) || ZF_SET();
+    }
+}
+
 static __inline void
 flags_rebuild(void)
 {
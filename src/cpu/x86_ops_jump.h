@@ -4,16 +4,16 @@
 #define cond_NB  (!CF_SET())
 #define cond_E   (ZF_SET())
 #define cond_NE  (!ZF_SET())
-#define cond_BE  (CF_SET() || ZF_SET())
-#define cond_NBE (!CF_SET() && !ZF_SET())
+#define cond_BE  (cond_be_set())
+#define cond_NBE (!cond_be_set())
 #define cond_S   (NF_SET())
 #define cond_NS  (!NF_SET())
 #define cond_P   (PF_SET())
 #define cond_NP  (!PF_SET())
-#define cond_L   (((NF_SET()) ? 1 : 0) != ((VF_SET()) ? 1 : 0))
-#define cond_NL  (((NF_SET()) ? 1 : 0) == ((VF_SET()) ? 1 : 0))
-#define cond_LE  (((NF_SET()) ? 1 : 0) != ((VF_SET()) ? 1 : 0) || (ZF_SET()))
-#define cond_NLE (((NF_SET()) ? 1 : 0) == ((VF_SET()) ? 1 : 0) && (!ZF_SET()))
+#define cond_L   (cond_l_set())
+#define cond_NL  (!cond_l_set())
+#define cond_LE  (cond_le_set())
+#define cond_NLE (!cond_le_set())
 
 #define opJ(condition)                                                  \
     static int opJ##condition(uint32_t fetchdat)                        \
@@ -239,6 +239,9 @@ opJMP_r8(uint32_t fetchdat)
         cpu_state.pc &= 0xffff;
     CPU_BLOCK_END();
     CLOCK_CYCLES((is486) ? 3 : 7);
+    /* JMP $ only ever ends through an interrupt, same as HLT. */
+    if (offset == -2)
+        CLOCK_CYCLES_ALWAYS(cpu_idle_cycles(0));
     PREFETCH_RUN(7, 2, -1, 0, 0, 0, 0, 0);
     PREFETCH_FLUSH();
     return 0;
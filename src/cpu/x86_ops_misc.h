@@ -710,7 +710,7 @@ opHLT(UNUSED(uint32_t fetchdat))
     if (smi_line)
         enter_smm_check(1);
     else if (!((cpu_state.flags & I_FLAG) && pic.int_pending)) {
-        CLOCK_CYCLES_ALWAYS(100);
+        CLOCK_CYCLES_ALWAYS(cpu_idle_cycles(100));
         if (!((cpu_state.flags & I_FLAG) && pic.int_pending))
             cpu_state.pc--;
     } else {
@@ -1042,7 +1042,7 @@ opLOADALL386(UNUSED(uint32_t fetchdat))
     loadall386_load_segment(la_addr + 0xc0, &cpu_state.seg_es);
 
     if (CPL == 3 && oldcpl != 3)
-        flushmmucache_nopc();
+        flushmmucache_user();
     oldcpl = CPL;
 
     CLOCK_CYCLES(350);
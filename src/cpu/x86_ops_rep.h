@@ -68,6 +68,12 @@
             reads++;                                                                                              \
             writes++;                                                                                             \
             total_cycles += 15;                                                                                   \
+                                                                                                                  \
+            uint32_t bulk;                                                                                        \
+            REP_BULK_INS(bulk, 2, CNT_REG, DEST_REG, 15);                                                         \
+            reads += bulk;                                                                                        \
+            writes += bulk;                                                                                       \
+            total_cycles += bulk * 15;                                                                            \
         }                                                                                                         \
         PREFETCH_RUN(total_cycles, 1, -1, reads, 0, writes, 0, 0);                                                \
         if (CNT_REG > 0) {                                                                                        \
@@ -107,6 +113,12 @@
             reads++;                                                                                              \
             writes++;                                                                                             \
             total_cycles += 15;                                                                                   \
+                                                                                                                  \
+            uint32_t bulk;                                                                                        \
+            REP_BULK_INS(bulk, 4, CNT_REG, DEST_REG, 15);                                                         \
+            reads += bulk;                                                                                        \
+            writes += bulk;                                                                                       \
+            total_cycles += bulk * 15;                                                                            \
         }                                                                                                         \
         PREFETCH_RUN(total_cycles, 1, -1, 0, reads, 0, writes, 0);                                                \
         if (CNT_REG > 0) {                                                                                        \
@@ -170,6 +182,12 @@
             reads++;                                                                                              \
             writes++;                                                                                             \
             total_cycles += 14;                                                                                   \
+                                                                                                                  \
+            uint32_t bulk;                                                                                        \
+            REP_BULK_OUTS(bulk, 2, CNT_REG, SRC_REG, 14);                                                         \
+            reads += bulk;                                                                                        \
+            writes += bulk;                                                                                       \
+            total_cycles += bulk * 14;                                                                            \
         }                                                                                                         \
         PREFETCH_RUN(total_cycles, 1, -1, reads, 0, writes, 0, 0);                                                \
         if (CNT_REG > 0) {                                                                                        \
@@ -201,6 +219,12 @@
             reads++;                                                                                              \
             writes++;                                                                                             \
             total_cycles += 14;                                                                                   \
+                                                                                                                  \
+            uint32_t bulk;                                                                                        \
+            REP_BULK_OUTS(bulk, 4, CNT_REG, SRC_REG, 14);                                                         \
+            reads += bulk;                                                                                        \
+            writes += bulk;                                                                                       \
+            total_cycles += bulk * 14;                                                                            \
         }                                                                                                         \
         PREFETCH_RUN(total_cycles, 1, -1, 0, reads, 0, writes, 0);                                                \
         if (CNT_REG > 0) {                                                                                        \
@@ -253,6 +277,14 @@
             reads++;                                                                                              \
             writes++;                                                                                             \
             total_cycles += is486 ? 3 : 4;                                                                        \
+            if (cycles < cycles_end)                                                                              \
+                break;                                                                                            \
+                                                                                                                  \
+            uint32_t bulk;                                                                                        \
+            REP_BULK_MOVS(bulk, 1, CNT_REG, SRC_REG, DEST_REG, (is486 ? 3 : 4));                                  \
+            reads += bulk;                                                                                        \
+            writes += bulk;                                                                                       \
+            total_cycles += bulk * (is486 ? 3 : 4);                                                               \
             if (cycles < cycles_end)                                                                              \
                 break;                                                                                            \
         }                                                                                                         \
@@ -307,6 +339,14 @@
             reads++;                                                                                              \
             writes++;                                                                                             \
             total_cycles += is486 ? 3 : 4;                                                                        \
+            if (cycles < cycles_end)                                                                              \
+                break;                                                                                            \
+                                                                                                                  \
+            uint32_t bulk;                                                                                        \
+            REP_BULK_MOVS(bulk, 2, CNT_REG, SRC_REG, DEST_REG, (is486 ? 3 : 4));                                  \
+            reads += bulk;                                                                                        \
+            writes += bulk;                                                                                       \
+            total_cycles += bulk * (is486 ? 3 : 4);                                                               \
             if (cycles < cycles_end)                                                                              \
                 break;                                                                                            \
         }                                                                                                         \
@@ -361,6 +401,14 @@
             reads++;                                                                                              \
             writes++;                                                                                             \
             total_cycles += is486 ? 3 : 4;                                                                        \
+            if (cycles < cycles_end)                                                                              \
+                break;                                                                                            \
+                                                                                                                  \
+            uint32_t bulk;                                                                                        \
+            REP_BULK_MOVS(bulk, 4, CNT_REG, SRC_REG, DEST_REG, (is486 ? 3 : 4));                                  \
+            reads += bulk;                                                                                        \
+            writes += bulk;                                                                                       \
+            total_cycles += bulk * (is486 ? 3 : 4);                                                               \
             if (cycles < cycles_end)                                                                              \
                 break;                                                                                            \
         }                                                                                                         \
@@ -394,6 +442,13 @@
             cycles -= is486 ? 4 : 5;                                                                              \
             writes++;                                                                                             \
             total_cycles += is486 ? 4 : 5;                                                                        \
+            if (cycles < cycles_end)                                                                              \
+                break;                                                                                            \
+                                                                                                                  \
+            uint32_t bulk;                                                                                        \
+            REP_BULK_STOS(bulk, 1, CNT_REG, DEST_REG, AL, (is486 ? 4 : 5));                                       \
+            writes += bulk;                                                                                       \
+            total_cycles += bulk * (is486 ? 4 : 5);                                                               \
             if (cycles < cycles_end)                                                                              \
                 break;                                                                                            \
         }                                                                                                         \
@@ -426,6 +481,13 @@
             cycles -= is486 ? 4 : 5;                                                                              \
             writes++;                                                                                             \
             total_cycles += is486 ? 4 : 5;                                                                        \
+            if (cycles < cycles_end)                                                                              \
+                break;                                                                                            \
+                                                                                                                  \
+            uint32_t bulk;                                                                                        \
+            REP_BULK_STOS(bulk, 2, CNT_REG, DEST_REG, AX, (is486 ? 4 : 5));                                       \
+            writes += bulk;                                                                                       \
+            total_cycles += bulk * (is486 ? 4 : 5);                                                               \
             if (cycles < cycles_end)                                                                              \
                 break;                                                                                            \
         }                                                                                                         \
@@ -458,6 +520,13 @@
             cycles -= is486 ? 4 : 5;                                                                              \
             writes++;                                                                                             \
             total_cycles += is486 ? 4 : 5;                                                                        \
+            if (cycles < cycles_end)                                                                              \
+                break;                                                                                            \
+                                                                                                                  \
+            uint32_t bulk;                                                                                        \
+            REP_BULK_STOS(bulk, 4, CNT_REG, DEST_REG, EAX, (is486 ? 4 : 5));                                      \
+            writes += bulk;                                                                                       \
+            total_cycles += bulk * (is486 ? 4 : 5);                                                               \
             if (cycles < cycles_end)                                                                              \
                 break;                                                                                            \
         }                                                                                                         \
@@ -491,6 +560,13 @@
             cycles -= is486 ? 4 : 5;                                                                              \
             reads++;                                                                                              \
             total_cycles += is486 ? 4 : 5;                                                                        \
+            if (cycles < cycles_end)                                                                              \
+                break;                                                                                            \
+                                                                                                                  \
+            uint32_t bulk;                                                                                        \
+            REP_BULK_LODS(bulk, 1, CNT_REG, SRC_REG, AL, (is486 ? 4 : 5));                                        \
+            reads += bulk;                                                                                        \
+            total_cycles += bulk * (is486 ? 4 : 5);                                                               \
             if (cycles < cycles_end)                                                                              \
                 break;                                                                                            \
         }                                                                                                         \
@@ -523,6 +599,13 @@
             cycles -= is486 ? 4 : 5;                                                                              \
             reads++;                                                                                              \
             total_cycles += is486 ? 4 : 5;                                                                        \
+            if (cycles < cycles_end)                                                                              \
+                break;                                                                                            \
+                                                                                                                  \
+            uint32_t bulk;                                                                                        \
+            REP_BULK_LODS(bulk, 2, CNT_REG, SRC_REG, AX, (is486 ? 4 : 5));                                        \
+            reads += bulk;                                                                                        \
+            total_cycles += bulk * (is486 ? 4 : 5);                                                               \
             if (cycles < cycles_end)                                                                              \
                 break;                                                                                            \
         }                                                                                                         \
@@ -555,6 +638,13 @@
             cycles -= is486 ? 4 : 5;                                                                              \
             reads++;                                                                                              \
             total_cycles += is486 ? 4 : 5;                                                                        \
+            if (cycles < cycles_end)                                                                              \
+                break;                                                                                            \
+                                                                                                                  \
+            uint32_t bulk;                                                                                        \
+            REP_BULK_LODS(bulk, 4, CNT_REG, SRC_REG, EAX, (is486 ? 4 : 5));                                       \
+            reads += bulk;                                                                                        \
+            total_cycles += bulk * (is486 ? 4 : 5);                                                               \
             if (cycles < cycles_end)                                                                              \
                 break;                                                                                            \
         }                                                                                                         \
@@ -756,6 +846,13 @@
             cycles -= is486 ? 5 : 8;                                                                              \
             reads++;                                                                                              \
             total_cycles += is486 ? 5 : 8;                                                                        \
+            if (cycles < cycles_end)                                                                              \
+                break;                                                                                            \
+                                                                                                                  \
+            uint32_t bulk;                                                                                        \
+            REP_BULK_SCAS(bulk, 1, CNT_REG, DEST_REG, AL, setsub8, tempz, FV, (is486 ? 5 : 8));                   \
+            reads += bulk;                                                                                        \
+            total_cycles += bulk * (is486 ? 5 : 8);                                                               \
             if (cycles < cycles_end)                                                                              \
                 break;                                                                                            \
         }                                                                                                         \
@@ -791,6 +888,13 @@
             cycles -= is486 ? 5 : 8;                                                                              \
             reads++;                                                                                              \
             total_cycles += is486 ? 5 : 8;                                                                        \
+            if (cycles < cycles_end)                                                                              \
+                break;                                                                                            \
+                                                                                                                  \
+            uint32_t bulk;                                                                                        \
+            REP_BULK_SCAS(bulk, 2, CNT_REG, DEST_REG, AX, setsub16, tempz, FV, (is486 ? 5 : 8));                  \
+            reads += bulk;                                                                                        \
+            total_cycles += bulk * (is486 ? 5 : 8);                                                               \
             if (cycles < cycles_end)                                                                              \
                 break;                                                                                            \
         }                                                                                                         \
@@ -826,6 +930,13 @@
             cycles -= is486 ? 5 : 8;                                                                              \
             reads++;                                                                                              \
             total_cycles += is486 ? 5 : 8;                                                                        \
+            if (cycles < cycles_end)                                                                              \
+                break;                                                                                            \
+                                                                                                                  \
+            uint32_t bulk;                                                                                        \
+            REP_BULK_SCAS(bulk, 4, CNT_REG, DEST_REG, EAX, setsub32, tempz, FV, (is486 ? 5 : 8));                 \
+            reads += bulk;                                                                                        \
+            total_cycles += bulk * (is486 ? 5 : 8);                                                               \
             if (cycles < cycles_end)                                                                              \
                 break;                                                                                            \
         }                                                                                                         \
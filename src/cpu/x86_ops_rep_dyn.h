@@ -57,6 +57,9 @@
                 DEST_REG += 2;                                                                                    \
             CNT_REG--;                                                                                            \
             cycles -= 15;                                                                                         \
+                                                                                                                  \
+            uint32_t bulk;                                                                                        \
+            REP_BULK_INS(bulk, 2, CNT_REG, DEST_REG, 15);                                                         \
         }                                                                                                         \
         if (CNT_REG > 0) {                                                                                        \
             CPU_BLOCK_END();                                                                                      \
@@ -90,6 +93,9 @@
                 DEST_REG += 4;                                                                                    \
             CNT_REG--;                                                                                            \
             cycles -= 15;                                                                                         \
+                                                                                                                  \
+            uint32_t bulk;                                                                                        \
+            REP_BULK_INS(bulk, 4, CNT_REG, DEST_REG, 15);                                                         \
         }                                                                                                         \
         if (CNT_REG > 0) {                                                                                        \
             CPU_BLOCK_END();                                                                                      \
@@ -141,6 +147,9 @@
                 SRC_REG += 2;                                                                                     \
             CNT_REG--;                                                                                            \
             cycles -= 14;                                                                                         \
+                                                                                                                  \
+            uint32_t bulk;                                                                                        \
+            REP_BULK_OUTS(bulk, 2, CNT_REG, SRC_REG, 14);                                                         \
         }                                                                                                         \
         if (CNT_REG > 0) {                                                                                        \
             CPU_BLOCK_END();                                                                                      \
@@ -166,6 +175,9 @@
                 SRC_REG += 4;                                                                                     \
             CNT_REG--;                                                                                            \
             cycles -= 14;                                                                                         \
+                                                                                                                  \
+            uint32_t bulk;                                                                                        \
+            REP_BULK_OUTS(bulk, 4, CNT_REG, SRC_REG, 14);                                                         \
         }                                                                                                         \
         if (CNT_REG > 0) {                                                                                        \
             CPU_BLOCK_END();                                                                                      \
@@ -213,6 +225,11 @@
             }                                                                                                     \
             CNT_REG--;                                                                                            \
             cycles -= is486 ? 3 : 4;                                                                              \
+            if (cycles < cycles_end)                                                                              \
+                break;                                                                                            \
+                                                                                                                  \
+            uint32_t bulk;                                                                                        \
+            REP_BULK_MOVS(bulk, 1, CNT_REG, SRC_REG, DEST_REG, (is486 ? 3 : 4));                                  \
             if (cycles < cycles_end)                                                                              \
                 break;                                                                                            \
         }                                                                                                         \
@@ -262,6 +279,11 @@
             }                                                                                                     \
             CNT_REG--;                                                                                            \
             cycles -= is486 ? 3 : 4;                                                                              \
+            if (cycles < cycles_end)                                                                              \
+                break;                                                                                            \
+                                                                                                                  \
+            uint32_t bulk;                                                                                        \
+            REP_BULK_MOVS(bulk, 2, CNT_REG, SRC_REG, DEST_REG, (is486 ? 3 : 4));                                  \
             if (cycles < cycles_end)                                                                              \
                 break;                                                                                            \
         }                                                                                                         \
@@ -311,6 +333,11 @@
             }                                                                                                     \
             CNT_REG--;                                                                                            \
             cycles -= is486 ? 3 : 4;                                                                              \
+            if (cycles < cycles_end)                                                                              \
+                break;                                                                                            \
+                                                                                                                  \
+            uint32_t bulk;                                                                                        \
+            REP_BULK_MOVS(bulk, 4, CNT_REG, SRC_REG, DEST_REG, (is486 ? 3 : 4));                                  \
             if (cycles < cycles_end)                                                                              \
                 break;                                                                                            \
         }                                                                                                         \
@@ -340,6 +367,11 @@
                 DEST_REG++;                                                                                       \
             CNT_REG--;                                                                                            \
             cycles -= is486 ? 4 : 5;                                                                              \
+            if (cycles < cycles_end)                                                                              \
+                break;                                                                                            \
+                                                                                                                  \
+            uint32_t bulk;                                                                                        \
+            REP_BULK_STOS(bulk, 1, CNT_REG, DEST_REG, AL, (is486 ? 4 : 5));                                       \
             if (cycles < cycles_end)                                                                              \
                 break;                                                                                            \
         }                                                                                                         \
@@ -368,6 +400,11 @@
                 DEST_REG += 2;                                                                                    \
             CNT_REG--;                                                                                            \
             cycles -= is486 ? 4 : 5;                                                                              \
+            if (cycles < cycles_end)                                                                              \
+                break;                                                                                            \
+                                                                                                                  \
+            uint32_t bulk;                                                                                        \
+            REP_BULK_STOS(bulk, 2, CNT_REG, DEST_REG, AX, (is486 ? 4 : 5));                                       \
             if (cycles < cycles_end)                                                                              \
                 break;                                                                                            \
         }                                                                                                         \
@@ -396,6 +433,11 @@
                 DEST_REG += 4;                                                                                    \
             CNT_REG--;                                                                                            \
             cycles -= is486 ? 4 : 5;                                                                              \
+            if (cycles < cycles_end)                                                                              \
+                break;                                                                                            \
+                                                                                                                  \
+            uint32_t bulk;                                                                                        \
+            REP_BULK_STOS(bulk, 4, CNT_REG, DEST_REG, EAX, (is486 ? 4 : 5));                                      \
             if (cycles < cycles_end)                                                                              \
                 break;                                                                                            \
         }                                                                                                         \
@@ -425,6 +467,11 @@
                 SRC_REG++;                                                                                        \
             CNT_REG--;                                                                                            \
             cycles -= is486 ? 4 : 5;                                                                              \
+            if (cycles < cycles_end)                                                                              \
+                break;                                                                                            \
+                                                                                                                  \
+            uint32_t bulk;                                                                                        \
+            REP_BULK_LODS(bulk, 1, CNT_REG, SRC_REG, AL, (is486 ? 4 : 5));                                        \
             if (cycles < cycles_end)                                                                              \
                 break;                                                                                            \
         }                                                                                                         \
@@ -453,6 +500,11 @@
                 SRC_REG += 2;                                                                                     \
             CNT_REG--;                                                                                            \
             cycles -= is486 ? 4 : 5;                                                                              \
+            if (cycles < cycles_end)                                                                              \
+                break;                                                                                            \
+                                                                                                                  \
+            uint32_t bulk;                                                                                        \
+            REP_BULK_LODS(bulk, 2, CNT_REG, SRC_REG, AX, (is486 ? 4 : 5));                                        \
             if (cycles < cycles_end)                                                                              \
                 break;                                                                                            \
         }                                                                                                         \
@@ -481,6 +533,11 @@
                 SRC_REG += 4;                                                                                     \
             CNT_REG--;                                                                                            \
             cycles -= is486 ? 4 : 5;                                                                              \
+            if (cycles < cycles_end)                                                                              \
+                break;                                                                                            \
+                                                                                                                  \
+            uint32_t bulk;                                                                                        \
+            REP_BULK_LODS(bulk, 4, CNT_REG, SRC_REG, EAX, (is486 ? 4 : 5));                                       \
             if (cycles < cycles_end)                                                                              \
                 break;                                                                                            \
         }                                                                                                         \
@@ -670,6 +727,11 @@
                 DEST_REG++;                                                                                       \
             CNT_REG--;                                                                                            \
             cycles -= is486 ? 5 : 8;                                                                              \
+            if (cycles < cycles_end)                                                                              \
+                break;                                                                                            \
+                                                                                                                  \
+            uint32_t bulk;                                                                                        \
+            REP_BULK_SCAS(bulk, 1, CNT_REG, DEST_REG, AL, setsub8, tempz, FV, (is486 ? 5 : 8));                   \
             if (cycles < cycles_end)                                                                              \
                 break;                                                                                            \
         }                                                                                                         \
@@ -702,6 +764,11 @@
                 DEST_REG += 2;                                                                                    \
             CNT_REG--;                                                                                            \
             cycles -= is486 ? 5 : 8;                                                                              \
+            if (cycles < cycles_end)                                                                              \
+                break;                                                                                            \
+                                                                                                                  \
+            uint32_t bulk;                                                                                        \
+            REP_BULK_SCAS(bulk, 2, CNT_REG, DEST_REG, AX, setsub16, tempz, FV, (is486 ? 5 : 8));                  \
             if (cycles < cycles_end)                                                                              \
                 break;                                                                                            \
         }                                                                                                         \
@@ -734,6 +801,11 @@
                 DEST_REG += 4;                                                                                    \
             CNT_REG--;                                                                                            \
             cycles -= is486 ? 5 : 8;                                                                              \
+            if (cycles < cycles_end)                                                                              \
+                break;                                                                                            \
+                                                                                                                  \
+            uint32_t bulk;                                                                                        \
+            REP_BULK_SCAS(bulk, 4, CNT_REG, DEST_REG, EAX, setsub32, tempz, FV, (is486 ? 5 : 8));                 \
             if (cycles < cycles_end)                                                                              \
                 break;                                                                                            \
         }                                                                                                         \
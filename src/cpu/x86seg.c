@@ -533,7 +533,7 @@ loadcs(uint16_t seg)
             do_seg_load(&cpu_state.seg_cs, segdat);
             use32 = (segdat[3] & 0x40) ? 0x300 : 0;
             if ((CPL == 3) && (oldcpl != 3))
-                flushmmucache_nopc();
+                flushmmucache_user();
 #ifdef USE_NEW_DYNAREC
             oldcpl = CPL;
 #endif
@@ -562,7 +562,7 @@ loadcs(uint16_t seg)
         cpu_state.seg_cs.access     = (cpu_state.eflags & VM_FLAG) ? 0xe2 : 0x82;
         cpu_state.seg_cs.ar_high    = 0x10;
         if ((CPL == 3) && (oldcpl != 3))
-            flushmmucache_nopc();
+            flushmmucache_user();
 #ifdef USE_NEW_DYNAREC
         oldcpl = CPL;
 #endif
@@ -632,7 +632,7 @@ loadcsjmp(uint16_t seg, uint32_t old_pc)
 
             do_seg_load(&cpu_state.seg_cs, segdat);
             if ((CPL == 3) && (oldcpl != 3))
-                flushmmucache_nopc();
+                flushmmucache_user();
 #ifdef USE_NEW_DYNAREC
             oldcpl = CPL;
 #endif
@@ -708,7 +708,7 @@ loadcsjmp(uint16_t seg, uint32_t old_pc)
                             CS = seg2;
                             do_seg_load(&cpu_state.seg_cs, segdat);
                             if ((CPL == 3) && (oldcpl != 3))
-                                flushmmucache_nopc();
+                                flushmmucache_user();
 #ifdef USE_NEW_DYNAREC
                             oldcpl = CPL;
 #endif
@@ -751,7 +751,7 @@ loadcsjmp(uint16_t seg, uint32_t old_pc)
         cpu_state.seg_cs.access     = (cpu_state.eflags & VM_FLAG) ? 0xe2 : 0x82;
         cpu_state.seg_cs.ar_high    = 0x10;
         if ((CPL == 3) && (oldcpl != 3))
-            flushmmucache_nopc();
+            flushmmucache_user();
 #ifdef USE_NEW_DYNAREC
         oldcpl = CPL;
 #endif
@@ -953,7 +953,7 @@ loadcscall(uint16_t seg)
             CS = seg;
             do_seg_load(&cpu_state.seg_cs, segdat);
             if ((CPL == 3) && (oldcpl != 3))
-                flushmmucache_nopc();
+                flushmmucache_user();
 #ifdef USE_NEW_DYNAREC
             oldcpl = CPL;
 #endif
@@ -1094,7 +1094,7 @@ loadcscall(uint16_t seg)
                                 CS = (seg2 & ~3) | DPL;
                                 do_seg_load(&cpu_state.seg_cs, segdat);
                                 if ((CPL == 3) && (oldcpl != 3))
-                                    flushmmucache_nopc();
+                                    flushmmucache_user();
 #ifdef USE_NEW_DYNAREC
                                 oldcpl = CPL;
 #endif
@@ -1211,7 +1211,7 @@ loadcscall(uint16_t seg)
                             CS = (seg2 & ~3) | CPL;
                             do_seg_load(&cpu_state.seg_cs, segdat);
                             if ((CPL == 3) && (oldcpl != 3))
-                                flushmmucache_nopc();
+                                flushmmucache_user();
 #ifdef USE_NEW_DYNAREC
                             oldcpl = CPL;
 #endif
@@ -1256,7 +1256,7 @@ loadcscall(uint16_t seg)
         cpu_state.seg_cs.access     = (cpu_state.eflags & VM_FLAG) ? 0xe2 : 0x82;
         cpu_state.seg_cs.ar_high    = 0x10;
         if ((CPL == 3) && (oldcpl != 3))
-            flushmmucache_nopc();
+            flushmmucache_user();
 #ifdef USE_NEW_DYNAREC
         oldcpl = CPL;
 #endif
@@ -1377,7 +1377,7 @@ pmoderetf(int is32, uint16_t off)
         do_seg_load(&cpu_state.seg_cs, segdat);
         cpu_state.seg_cs.access = (cpu_state.seg_cs.access & ~(3 << 5)) | ((CS & 3) << 5);
         if ((CPL == 3) && (oldcpl != 3))
-            flushmmucache_nopc();
+            flushmmucache_user();
 #ifdef USE_NEW_DYNAREC
         oldcpl = CPL;
 #endif
@@ -1496,7 +1496,7 @@ pmoderetf(int is32, uint16_t off)
         CS           = seg;
         do_seg_load(&cpu_state.seg_cs, segdat);
         if ((CPL == 3) && (oldcpl != 3))
-            flushmmucache_nopc();
+            flushmmucache_user();
 #ifdef USE_NEW_DYNAREC
         oldcpl = CPL;
 #endif
@@ -1770,7 +1770,7 @@ pmodeint(int num, int soft)
             CS                      = (seg & 0xfffc) | new_cpl;
             cpu_state.seg_cs.access = (cpu_state.seg_cs.access & ~0x60) | (new_cpl << 5);
             if ((CPL == 3) && (oldcpl != 3))
-                flushmmucache_nopc();
+                flushmmucache_user();
 #ifdef USE_NEW_DYNAREC
             oldcpl = CPL;
 #endif
@@ -1947,7 +1947,7 @@ pmodeiret(int is32)
             cpu_state.seg_cs.access     = 0xe2;
             cpu_state.seg_cs.ar_high    = 0x10;
             if ((CPL == 3) && (oldcpl != 3))
-                flushmmucache_nopc();
+                flushmmucache_user();
 #ifdef USE_NEW_DYNAREC
             oldcpl = CPL;
 #endif
@@ -2038,7 +2038,7 @@ pmodeiret(int is32)
         do_seg_load(&cpu_state.seg_cs, segdat);
         cpu_state.seg_cs.access = (cpu_state.seg_cs.access & ~0x60) | ((CS & 0x0003) << 5);
         if ((CPL == 3) && (oldcpl != 3))
-            flushmmucache_nopc();
+            flushmmucache_user();
 #ifdef USE_NEW_DYNAREC
         oldcpl = CPL;
 #endif
@@ -2127,7 +2127,7 @@ pmodeiret(int is32)
         do_seg_load(&cpu_state.seg_cs, segdat);
         cpu_state.seg_cs.access = (cpu_state.seg_cs.access & ~0x60) | ((CS & 3) << 5);
         if ((CPL == 3) && (oldcpl != 3))
-            flushmmucache_nopc();
+            flushmmucache_user();
 #ifdef USE_NEW_DYNAREC
         oldcpl = CPL;
 #endif
@@ -2282,7 +2282,7 @@ taskswitch286(uint16_t seg, uint16_t *segdat, int is32)
         cr0 |= 8;
 
         cr3 = new_cr3;
-        flushmmucache();
+        flushmmucache_cr3();
 
         cpu_state.pc     = new_pc;
         cpu_state.flags  = new_flags;
@@ -2346,7 +2346,7 @@ taskswitch286(uint16_t seg, uint16_t *segdat, int is32)
             CS = new_cs;
             do_seg_load(&cpu_state.seg_cs, segdat2);
             if ((CPL == 3) && (oldcpl != 3))
-                flushmmucache_nopc();
+                flushmmucache_user();
 #ifdef USE_NEW_DYNAREC
             oldcpl = CPL;
 #endif
@@ -2535,7 +2535,7 @@ taskswitch286(uint16_t seg, uint16_t *segdat, int is32)
         CS = new_cs;
         do_seg_load(&cpu_state.seg_cs, segdat2);
         if ((CPL == 3) && (oldcpl != 3))
-            flushmmucache_nopc();
+            flushmmucache_user();
 #ifdef USE_NEW_DYNAREC
         oldcpl = CPL;
 #endif
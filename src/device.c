@@ -68,6 +68,7 @@ static device_state_t   device_state[DEVICE_MAX];
 static void            *device_priv[DEVICE_MAX];
 static device_context_t device_current;
 static device_context_t device_prev;
+static int              device_init_depth;
 static void            *device_common_priv;
 
 #ifdef ENABLE_DEVICE_LOG
@@ -395,7 +396,9 @@ device_add_common(const device_t *dev, void *p, void *params, int inst)
 
         if (dev->init != NULL) {
             /* Give it our temporary device in case we have dynamically changed info->local. */
+            device_init_depth++;
             priv = dev->init(init_dev);
+            device_init_depth--;
 
             if (priv == NULL) {
 #ifdef ENABLE_DEVICE_LOG
@@ -1223,6 +1226,16 @@ device_context_get_device(void)
     return device_current.dev;
 }
 
+/* Name of the device whose init is running, NULL outside of one. */
+const char *
+device_init_get_name(void)
+{
+    if ((device_init_depth == 0) || (device_current.dev == NULL))
+        return NULL;
+
+    return device_current.name;
+}
+
 const device_t device_none = {
     .name          = "None",
     .internal_name = "none",
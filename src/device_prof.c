@@ -0,0 +1,288 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Per-device accounting of the host time spent in timer
+ *          callbacks, I/O port handlers and memory mapping handlers.
+ *
+ *          Handlers remember the slot of the device that registered
+ *          them during its init, calls are only timed while counting
+ *          is turned on.
+ *
+ * Authors: 86Box contributors.
+ *
+ *          Copyright 2026 86Box contributors.
+ */
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <wchar.h>
+#define HAVE_STDARG_H
+#include <86box/86box.h>
+#include <86box/device.h>
+#include <86box/device_prof.h>
+#include <86box/path.h>
+#include <86box/plat.h>
+
+#define DEVICE_PROF_CSV  "device_prof.csv"
+#define DEVICE_PROF_JSON "device_prof.json"
+
+typedef struct device_prof_t {
+    char     name[128];
+    uint64_t calls[DEVICE_PROF_KINDS];
+    uint64_t ticks[DEVICE_PROF_KINDS];
+} device_prof_t;
+
+int device_prof_on       = 0;
+int device_prof_interval = 0; /* (C) seconds between dumps, 0 = only on request */
+
+static device_prof_t device_prof[DEVICE_PROF_SLOTS];
+static int           device_prof_num = 1;
+static uint64_t      device_prof_start;
+static uint32_t      device_prof_last_dump;
+
+static const char *device_prof_kinds[DEVICE_PROF_KINDS] = { "timer", "io", "mem" };
+
+#ifdef ENABLE_DEVICE_PROF_LOG
+int device_prof_do_log = ENABLE_DEVICE_PROF_LOG;
+
+static void
+device_prof_log(const char *fmt, ...)
+{
+    va_list ap;
+
+    if (device_prof_do_log) {
+        va_start(ap, fmt);
+        pclog_ex(fmt, ap);
+        va_end(ap);
+    }
+}
+#else
+#    define device_prof_log(fmt, ...)
+#endif
+
+/*
+   Slots live as long as the emulator does, so a device that is closed and
+   added again on a hard reset keeps counting into the same one.
+ */
+int
+device_prof_slot(void)
+{
+    const char *name = device_init_get_name();
+    int         i;
+
+    if (name == NULL)
+        return 0;
+
+    for (i = 1; i < device_prof_num; i++) {
+        if (!strncmp(device_prof[i].name, name, sizeof(device_prof[i].name) - 1))
+            return i;
+    }
+
+    if (device_prof_num == DEVICE_PROF_SLOTS)
+        return 0;
+
+    snprintf(device_prof[i].name, sizeof(device_prof[i].name), "%s", name);
+    device_prof_log("DEVICE_PROF: Slot %i is %s\n", i, name);
+
+    return device_prof_num++;
+}
+
+void
+device_prof_add(int slot, int kind, uint64_t ticks)
+{
+    device_prof[slot].calls[kind]++;
+    device_prof[slot].ticks[kind] += ticks;
+}
+
+void
+device_prof_reset(void)
+{
+    for (int i = 0; i < device_prof_num; i++) {
+        memset(device_prof[i].calls, 0x00, sizeof(device_prof[i].calls));
+        memset(device_prof[i].ticks, 0x00, sizeof(device_prof[i].ticks));
+    }
+
+    device_prof_start     = device_prof_ticks();
+    device_prof_last_dump = plat_get_ticks();
+}
+
+void
+device_prof_enable(int enable)
+{
+    enable = !!enable;
+
+    if (enable && !device_prof_on)
+        device_prof_reset();
+
+    device_prof_on = enable;
+}
+
+uint64_t
+device_prof_elapsed(void)
+{
+    return device_prof_start ? (device_prof_ticks() - device_prof_start) : 0;
+}
+
+static uint64_t
+device_prof_key(const device_prof_stats_t *s, int sort)
+{
+    if (sort < DEVICE_PROF_KINDS)
+        return s->ticks[sort];
+    if (sort == DEVICE_PROF_SORT_CALLS)
+        return s->calls[DEVICE_PROF_TIMER] + s->calls[DEVICE_PROF_IO] + s->calls[DEVICE_PROF_MEM];
+
+    return s->total;
+}
+
+static int
+device_prof_before(const device_prof_stats_t *a, const device_prof_stats_t *b, int sort)
+{
+    if (sort == DEVICE_PROF_SORT_NAME)
+        return strcmp(a->name, b->name) < 0;
+
+    return device_prof_key(a, sort) > device_prof_key(b, sort);
+}
+
+int
+device_prof_get_top(device_prof_stats_t *stats, int max, int sort)
+{
+    device_prof_stats_t s;
+    int                 n = 0;
+    int                 i;
+
+    if (max <= 0)
+        return 0;
+
+    for (int c = 0; c < device_prof_num; c++) {
+        const device_prof_t *p = &device_prof[c];
+
+        if (!p->calls[DEVICE_PROF_TIMER] && !p->calls[DEVICE_PROF_IO] && !p->calls[DEVICE_PROF_MEM])
+            continue;
+
+        snprintf(s.name, sizeof(s.name), "%s", c ? p->name : "(other)");
+        memcpy(s.calls, p->calls, sizeof(s.calls));
+        memcpy(s.ticks, p->ticks, sizeof(s.ticks));
+        s.total = p->ticks[DEVICE_PROF_TIMER] + p->ticks[DEVICE_PROF_IO] + p->ticks[DEVICE_PROF_MEM];
+
+        if ((n == max) && !device_prof_before(&s, &stats[n - 1], sort))
+            continue;
+
+        if (n < max)
+            n++;
+        for (i = n - 1; (i > 0) && device_prof_before(&s, &stats[i - 1], sort); i--)
+            stats[i] = stats[i - 1];
+
+        stats[i] = s;
+    }
+
+    return n;
+}
+
+static void
+device_prof_json_string(FILE *fp, const char *s)
+{
+    fputc('"', fp);
+    for (; *s; s++) {
+        if ((*s == '"') || (*s == '\\'))
+            fprintf(fp, "\\%c", *s);
+        else if ((uint8_t) *s < 0x20)
+            fprintf(fp, "\\u%04x", (uint8_t) *s);
+        else
+            fputc(*s, fp);
+    }
+    fputc('"', fp);
+}
+
+/*
+   Appends one row per device and kind to the CSV so the dumps of a session
+   can be graphed, and rewrites the JSON with the latest totals.
+ */
+int
+device_prof_dump(void)
+{
+    device_prof_stats_t *stats;
+    char                 path[1024];
+    FILE                *fp;
+    const uint64_t       elapsed = device_prof_elapsed();
+    const long long      now     = (long long) time(NULL);
+    long                 pos;
+    int                  n;
+
+    stats = (device_prof_stats_t *) calloc(DEVICE_PROF_SLOTS, sizeof(device_prof_stats_t));
+    if (stats == NULL)
+        return 0;
+    n = device_prof_get_top(stats, DEVICE_PROF_SLOTS, DEVICE_PROF_SORT_TOTAL);
+
+    path_append_filename(path, usr_path, DEVICE_PROF_CSV);
+    fp = plat_fopen(path, "a");
+    if (fp == NULL) {
+        free(stats);
+        return 0;
+    }
+    fseek(fp, 0, SEEK_END);
+    pos = ftell(fp);
+    if (pos == 0)
+        fprintf(fp, "time,elapsed,device,kind,calls,ticks\n");
+    for (int i = 0; i < n; i++) {
+        for (int k = 0; k < DEVICE_PROF_KINDS; k++) {
+            if (!stats[i].calls[k])
+                continue;
+            fprintf(fp, "%lld,%" PRIu64 ",\"", now, elapsed);
+            for (const char *s = stats[i].name; *s; s++) {
+                if (*s == '"')
+                    fputc('"', fp);
+                fputc(*s, fp);
+            }
+            fprintf(fp, "\",%s,%" PRIu64 ",%" PRIu64 "\n",
+                    device_prof_kinds[k], stats[i].calls[k], stats[i].ticks[k]);
+        }
+    }
+    fclose(fp);
+
+    path_append_filename(path, usr_path, DEVICE_PROF_JSON);
+    fp = plat_fopen(path, "w");
+    if (fp == NULL) {
+        free(stats);
+        return 0;
+    }
+    fprintf(fp, "{\n  \"time\": %lld,\n  \"elapsed\": %" PRIu64 ",\n  \"devices\": [", now, elapsed);
+    for (int i = 0; i < n; i++) {
+        fprintf(fp, "%s\n    { \"name\": ", i ? "," : "");
+        device_prof_json_string(fp, stats[i].name);
+        for (int k = 0; k < DEVICE_PROF_KINDS; k++)
+            fprintf(fp, ", \"%s\": { \"calls\": %" PRIu64 ", \"ticks\": %" PRIu64 " }",
+                    device_prof_kinds[k], stats[i].calls[k], stats[i].ticks[k]);
+        fprintf(fp, " }");
+    }
+    fprintf(fp, "\n  ]\n}\n");
+    fclose(fp);
+
+    device_prof_log("DEVICE_PROF: Dumped %i devices\n", n);
+
+    free(stats);
+    return 1;
+}
+
+void
+device_prof_frame(void)
+{
+    uint32_t now;
+
+    if (!device_prof_on || (device_prof_interval <= 0))
+        return;
+
+    now = plat_get_ticks();
+    if ((now - device_prof_last_dump) >= ((uint32_t) device_prof_interval * 1000)) {
+        device_prof_last_dump = now;
+        device_prof_dump();
+    }
+}
@@ -109,7 +109,10 @@
 #define FEATURE_DISABLE_IRQ_OVERLAPPED 0xdd
 #define FEATURE_DISABLE_IRQ_SERVICE    0xde
 
-#define IDE_TIME                       10.0
+/* Command overhead, cut down in fast completion mode. */
+#define IDE_TIME                       (ide_fast_completion ? 1.0 : 10.0)
+/* Bytes per microsecond the interface moves in fast completion mode. */
+#define IDE_FAST_XFER_RATE             1000.0
 
 #define IDE_ATAPI_IS_EARLY             ide->sc->pad0
 
@@ -235,6 +238,8 @@ static uint8_t ide_qua_pnp_rom[] = {
 
 ide_t *ide_drives[IDE_NUM] = { 0 };
 
+int ide_fast_completion = 0; /* (C) skip transfer, seek and rotation timing */
+
 static void ide_atapi_callback(ide_t *ide);
 static void ide_callback(void *priv);
 
@@ -276,6 +281,9 @@ ide_get_xfer_time(ide_t *ide, int size)
 {
     double period = (10.0 / 3.0);
 
+    if (ide_fast_completion)
+        return ((double) size) / IDE_FAST_XFER_RATE;
+
     /* We assume that 1 MB = 1000000 B in this case, so we have as
        many B/us as there are MB/s because 1 s = 1000000 us. */
     switch (ide->mdma_mode & 0x300) {
@@ -382,6 +390,32 @@ ide_atapi_get_period(uint8_t channel)
     return ide_get_xfer_time(ide, 1);
 }
 
+/* Whether the drive completes commands without modelling the mechanics,
+   either because it has no speed preset or because of fast completion. */
+static int
+ide_hdd_is_instant(const ide_t *ide)
+{
+    return ide_fast_completion || (hdd[ide->hdd_num].speed_preset == 0);
+}
+
+static double
+ide_hdd_timing_read(const ide_t *ide, uint32_t addr, uint32_t len)
+{
+    if (ide_fast_completion)
+        return 0.0;
+
+    return hdd_timing_read(&hdd[ide->hdd_num], addr, len);
+}
+
+static double
+ide_hdd_timing_write(const ide_t *ide, uint32_t addr, uint32_t len)
+{
+    if (ide_fast_completion)
+        return 0.0;
+
+    return hdd_timing_write(&hdd[ide->hdd_num], addr, len);
+}
+
 static void
 ide_irq_update(ide_board_t *dev, UNUSED(int log))
 {
@@ -1409,11 +1443,11 @@ ide_write_data(ide_t *ide, const uint16_t val)
             if (ide->tf->pos >= 512) {
                 ide->tf->pos     = 0;
                 ide->tf->atastat = BSY_STAT;
-                const double seek_time = hdd_timing_write(&hdd[ide->hdd_num], ide_get_sector(ide), 1);
+                const double seek_time = ide_hdd_timing_write(ide, ide_get_sector(ide), 1);
                 const double xfer_time = ide_get_xfer_time(ide, 512);
                 const double wait_time = seek_time + xfer_time;
                 if (ide->command == WIN_WRITE_MULTIPLE) {
-                    if (hdd[ide->hdd_num].speed_preset == 0) {
+                    if (ide_hdd_is_instant(ide)) {
                         ide->pending_delay = 0;
                         ide_callback(ide);
                     } else if ((ide->blockcount + 1) >= ide->blocksize || ide->tf->secount == 1) {
@@ -1468,6 +1502,48 @@ ide_complete_pio_buffer_write(void *priv)
     ide_write_data(ide, value);
 }
 
+/* Device in a data phase that the block transfers below can serve, or NULL. */
+static ide_t *
+ide_get_block_device(void *priv)
+{
+    ide_t *ide = ide_get_current_device(priv);
+
+    if ((ide == NULL) || (ide->type == IDE_NONE) || (ide->type & IDE_SHADOW) ||
+        (ide->buffer == NULL) || (ide->command == WIN_INVALID) ||
+        (ide->command == WIN_PACKETCMD) || !(ide->tf->atastat & DRQ_STAT) ||
+        (ide->tf->pos >= 512))
+        return NULL;
+
+    return ide;
+}
+
+/*
+   Bulk PIO data transfers for string I/O: copy up to the rest of the current
+   sector straight to or from the drive buffer, and let the last word go through
+   ide_write_data()/ide_read_data() so that sector completion runs as usual.
+   Returns the number of words moved, 0 if the transfer has to be done one
+   word at a time (no data phase or an ATAPI packet command).
+ */
+int
+ide_write_data_block(void *priv, const uint16_t *buf, int count)
+{
+    ide_t *ide = ide_get_block_device(priv);
+    int    words;
+
+    if ((ide == NULL) || (count <= 0))
+        return 0;
+
+    words = (512 - ide->tf->pos) >> 1;
+    if (words > count)
+        words = count;
+
+    memcpy(((uint8_t *) ide->buffer) + ide->tf->pos, buf, (words - 1) << 1);
+    ide->tf->pos += (words - 1) << 1;
+    ide_write_data(ide, buf[words - 1]);
+
+    return words;
+}
+
 void
 ide_writew(uint16_t addr, uint16_t val, void *priv)
 {
@@ -1798,7 +1874,7 @@ ide_writeb(uint16_t addr, uint8_t val, void *priv)
                         ide->sc->callback = 100.0 * IDE_TIME;
                         ide_set_callback(ide, 100.0 * IDE_TIME);
                     } else {
-                        if (hdd[ide->hdd_num].speed_preset == 0)
+                        if (ide_hdd_is_instant(ide))
                             ide_set_callback(ide, 100.0 * IDE_TIME);
                         else {
                             double seek_time = hdd_seek_get_time(&hdd[ide->hdd_num], (val & 0x60) ?
@@ -1842,18 +1918,17 @@ ide_writeb(uint16_t addr, uint8_t val, void *priv)
                         double   wait_time;
                         if ((val == WIN_READ) && (prev == WIN_SETIDLE1)) {
                             /* Do the callback instantly - this happens on the Intel Monsoon. */
-                            (void) hdd_timing_read(&hdd[ide->hdd_num], ide_get_sector(ide), 1);
+                            (void) ide_hdd_timing_read(ide, ide_get_sector(ide), 1);
                             ide->do_initial_read = 1;
                             ide_callback(ide);
                             break;
                         } else if ((val == WIN_READ_DMA) || (val == WIN_READ_DMA_ALT)) {
                             /* TODO: Make DMA timing more accurate. */
                             sec_count        = ide->tf->secount ? ide->tf->secount : 256;
-                            double seek_time = hdd_timing_read(&hdd[ide->hdd_num],
-                                                               ide_get_sector(ide), sec_count);
+                            double seek_time = ide_hdd_timing_read(ide, ide_get_sector(ide), sec_count);
                             double xfer_time = ide_get_xfer_time(ide, 512 * sec_count);
                             wait_time        = seek_time > xfer_time ? seek_time : xfer_time;
-                        } else if ((val == WIN_READ_MULTIPLE) && (hdd[ide->hdd_num].speed_preset == 0)) {
+                        } else if ((val == WIN_READ_MULTIPLE) && ide_hdd_is_instant(ide)) {
                            ide_set_callback(ide, 200.0 * IDE_TIME);
                            ide->do_initial_read = 1;
                            break;
@@ -1861,16 +1936,14 @@ ide_writeb(uint16_t addr, uint8_t val, void *priv)
                             sec_count = ide->tf->secount ? ide->tf->secount : 256;
                             if (sec_count > ide->blocksize)
                                 sec_count = ide->blocksize;
-                            double seek_time = hdd_timing_read(&hdd[ide->hdd_num],
-                                                               ide_get_sector(ide), sec_count);
+                            double seek_time = ide_hdd_timing_read(ide, ide_get_sector(ide), sec_count);
                             double xfer_time = ide_get_xfer_time(ide, 512 * sec_count);
                             wait_time        = seek_time + xfer_time;
                         } else if ((val == WIN_READ_MULTIPLE) && (ide->blocksize == 0))
                             wait_time = 200.0;
                         else {
                             sec_count        = 1;
-                            double seek_time = hdd_timing_read(&hdd[ide->hdd_num],
-                                                               ide_get_sector(ide), sec_count);
+                            double seek_time = ide_hdd_timing_read(ide, ide_get_sector(ide), sec_count);
                             double xfer_time = ide_get_xfer_time(ide, 512 * sec_count);
                             wait_time        = seek_time + xfer_time;
                         }
@@ -1908,16 +1981,14 @@ ide_writeb(uint16_t addr, uint8_t val, void *priv)
 
                     if ((ide->type == IDE_HDD) && ((val == WIN_WRITE_DMA) || (val == WIN_WRITE_DMA_ALT))) {
                         uint32_t sec_count = ide->tf->secount ? ide->tf->secount : 256;
-                        double   seek_time = hdd_timing_read(&hdd[ide->hdd_num],
-                                                             ide_get_sector(ide), sec_count);
+                        double   seek_time = ide_hdd_timing_read(ide, ide_get_sector(ide), sec_count);
                         double   xfer_time = ide_get_xfer_time(ide, 512 * sec_count);
                         double   wait_time = seek_time > xfer_time ? seek_time : xfer_time;
                         ide_set_callback(ide, wait_time);
                     } else if ((ide->type == IDE_HDD) && ((val == WIN_VERIFY) ||
                                (val == WIN_VERIFY_ONCE))) {
                         uint32_t sec_count = ide->tf->secount ? ide->tf->secount : 256;
-                        double   seek_time = hdd_timing_read(&hdd[ide->hdd_num],
-                                                             ide_get_sector(ide), sec_count);
+                        double   seek_time = ide_hdd_timing_read(ide, ide_get_sector(ide), sec_count);
                         ide_set_callback(ide, seek_time + ide_get_xfer_time(ide, 2));
                     } else if ((val == WIN_IDENTIFY) || (val == WIN_SET_FEATURES))
                         ide_callback(ide);
@@ -2055,22 +2126,20 @@ ide_read_data(ide_t *ide)
                     ide_next_sector(ide);
                     ide->tf->atastat = BSY_STAT | READY_STAT | DSC_STAT;
                     if (ide->command == WIN_READ_MULTIPLE) {
-                        if (hdd[ide->hdd_num].speed_preset == 0)
+                        if (ide_hdd_is_instant(ide))
                             ide_callback(ide);
                         else if (!ide->blockcount) {
                             uint32_t cnt = ide->tf->secount ?
                                            ide->tf->secount : 256;
                             if (cnt > ide->blocksize)
                                 cnt = ide->blocksize;
-                            const double seek_us = hdd_timing_read(&hdd[ide->hdd_num],
-                                                   ide_get_sector(ide), cnt);
+                            const double seek_us = ide_hdd_timing_read(ide, ide_get_sector(ide), cnt);
                             const double xfer_us = ide_get_xfer_time(ide, 512 * cnt);
                             ide_set_callback(ide, seek_us + xfer_us);
                         } else
                             ide_callback(ide);
                     } else {
-                        const double seek_us = hdd_timing_read(&hdd[ide->hdd_num],
-                                                               ide_get_sector(ide), 1);
+                        const double seek_us = ide_hdd_timing_read(ide, ide_get_sector(ide), 1);
                         const double xfer_us = ide_get_xfer_time(ide, 512);
                         ide_set_callback(ide, seek_us + xfer_us);
                     }
@@ -2086,6 +2155,27 @@ ide_read_data(ide_t *ide)
     return ret;
 }
 
+/* Read counterpart of ide_write_data_block(). */
+int
+ide_read_data_block(void *priv, uint16_t *buf, int count)
+{
+    ide_t *ide = ide_get_block_device(priv);
+    int    words;
+
+    if ((ide == NULL) || (count <= 0))
+        return 0;
+
+    words = (512 - ide->tf->pos) >> 1;
+    if (words > count)
+        words = count;
+
+    memcpy(buf, ((uint8_t *) ide->buffer) + ide->tf->pos, (words - 1) << 1);
+    ide->tf->pos += (words - 1) << 1;
+    buf[words - 1] = ide_read_data(ide);
+
+    return words;
+}
+
 void
 ide_complete_pio_buffer_read(void *priv)
 {
@@ -2852,6 +2942,50 @@ ide_read_ali_76(void)
     return ret;
 }
 
+/* Block handlers for REP INSW/INSD/OUTSW/OUTSD on the data port. */
+static int
+ide_readw_block(uint16_t addr, uint16_t *buf, int count, void *priv)
+{
+    if (addr & 0x7)
+        return 0;
+
+    return ide_read_data_block(priv, buf, count);
+}
+
+static int
+ide_readl_block(uint16_t addr, uint32_t *buf, int count, void *priv)
+{
+    const ide_board_t *dev = (ide_board_t *) priv;
+    const ide_t       *ide = ide_get_block_device(priv);
+
+    /* Make sure the last dword does not straddle the end of the sector. */
+    if ((addr & 0x7) || !dev->bit32 || (ide == NULL) || (ide->tf->pos & 2))
+        return 0;
+
+    return ide_read_data_block(priv, (uint16_t *) buf, count << 1) >> 1;
+}
+
+static int
+ide_writew_block(uint16_t addr, const uint16_t *buf, int count, void *priv)
+{
+    if (addr & 0x7)
+        return 0;
+
+    return ide_write_data_block(priv, buf, count);
+}
+
+static int
+ide_writel_block(uint16_t addr, const uint32_t *buf, int count, void *priv)
+{
+    const ide_board_t *dev = (ide_board_t *) priv;
+    const ide_t       *ide = ide_get_block_device(priv);
+
+    if ((addr & 0x7) || !dev->bit32 || (ide == NULL) || (ide->tf->pos & 2))
+        return 0;
+
+    return ide_write_data_block(priv, (const uint16_t *) buf, count << 1) >> 1;
+}
+
 void
 ide_handlers(uint8_t board, int set)
 {
@@ -2861,6 +2995,11 @@ ide_handlers(uint8_t board, int set)
                        ide_readb, ide_readw, ide_readl,
                        ide_writeb, ide_writew, ide_writel,
                        ide_boards[board]);
+            if (set)
+                io_set_block_handler(ide_boards[board]->base[0], 1,
+                                     ide_readw_block, ide_readl_block,
+                                     ide_writew_block, ide_writel_block,
+                                     ide_boards[board]);
         }
 
         if (ide_boards[board]->base[1]) {
@@ -1452,6 +1452,9 @@ unknown:
                         l++;
                     }
                 }
+
+                /* Make the 2386 interpreter see the new map on its next fetch. */
+                fetch_page_2386 = 0xffffffff;
             }
 
             /* Respond positively. */
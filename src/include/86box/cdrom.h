@@ -67,6 +67,14 @@
 
 #define CD_BUF_SIZE              (16 * RAW_SECTOR_SIZE)
 
+#define CD_READ_AHEAD_DEFAULT    75  /* sectors, one second at 1x */
+#define CD_READ_AHEAD_MAX        750
+
+#define CHD_CACHE_SIZE_DEFAULT   32  /* MB of decompressed hunks per image */
+#define CHD_CACHE_SIZE_MAX       1024
+#define CHD_READ_AHEAD_DEFAULT   4   /* hunks */
+#define CHD_READ_AHEAD_MAX       64
+
 #define DATA_TRACK               0x14
 #define AUDIO_TRACK              0x10
 
@@ -515,9 +523,13 @@ typedef struct cdrom {
 
     int               audio_read;
     int               formed_mode2;
+
+    /* CD audio read-ahead, NULL if disabled. */
+    struct cdrom_stream_t *stream;
 } cdrom_t;
 
 extern cdrom_t cdrom[CDROM_NUM];
+extern int     cdrom_read_ahead;
 
 #define MSFtoLBA(m, s, f)  (((((m) * 60) + (s)) * 75) + (f))
 
@@ -234,6 +234,7 @@ extern const char *device_get_bios_file(const device_t *dev, const char *interna
 extern int device_is_valid(const device_t *, int mch);
 
 extern const device_t* device_context_get_device(void);
+extern const char     *device_init_get_name(void);
 
 extern int         device_get_config_int(const char *name);
 extern int         device_get_config_int_ex(const char *str, int def);
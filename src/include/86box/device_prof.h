@@ -0,0 +1,102 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Definitions for the per-device host time accounting.
+ *
+ * Authors: 86Box contributors.
+ *
+ *          Copyright 2026 86Box contributors.
+ */
+#ifndef EMU_DEVICE_PROF_H
+#define EMU_DEVICE_PROF_H
+
+#include <stdint.h>
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#    include <intrin.h>
+#endif
+
+#define DEVICE_PROF_TIMER 0 /* timer_process() callbacks */
+#define DEVICE_PROF_IO    1 /* I/O port handlers */
+#define DEVICE_PROF_MEM   2 /* Memory mapping handlers */
+#define DEVICE_PROF_KINDS 3
+
+/* Devices tracked, slot 0 collects everything registered outside a device init. */
+#define DEVICE_PROF_SLOTS 256
+#define DEVICE_PROF_TOP   32
+
+/* Sort orders, the kinds above sort by their own time. */
+#define DEVICE_PROF_SORT_TOTAL 3
+#define DEVICE_PROF_SORT_CALLS 4
+#define DEVICE_PROF_SORT_NAME  5
+
+typedef struct device_prof_stats_t {
+    char     name[128];
+    uint64_t calls[DEVICE_PROF_KINDS];
+    uint64_t ticks[DEVICE_PROF_KINDS];
+    uint64_t total; /* Sum of ticks[]. */
+} device_prof_stats_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern int device_prof_on;
+extern int device_prof_interval; /* (C) seconds between dumps, 0 = only on request */
+
+extern uint64_t plat_timer_read(void);
+
+/* Host cycle counter, the TSC where there is one. */
+static __inline uint64_t
+device_prof_ticks(void)
+{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    return __rdtsc();
+#elif defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#elif defined(__aarch64__)
+    uint64_t ret;
+
+    __asm__ __volatile__("mrs %0, cntvct_el0" : "=r"(ret));
+    return ret;
+#else
+    return plat_timer_read();
+#endif
+}
+
+/* Slot for handlers registered now, by the device being initialized. */
+extern int  device_prof_slot(void);
+extern void device_prof_add(int slot, int kind, uint64_t ticks);
+
+extern void device_prof_enable(int enable);
+extern void device_prof_reset(void);
+/* Fills in the busiest devices first and returns how many. */
+extern int  device_prof_get_top(device_prof_stats_t *stats, int max, int sort);
+/* Host ticks since counting was turned on or reset. */
+extern uint64_t device_prof_elapsed(void);
+extern int  device_prof_dump(void);
+/* Emulation thread, once per pc_run() block. */
+extern void device_prof_frame(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+/* Wraps a handler call, call is a statement that may free the handler. */
+#define DEVICE_PROF_CALL(slot, kind, call)                                        \
+    do {                                                                          \
+        if (device_prof_on) {                                                     \
+            const int      dp_slot_  = (slot);                                    \
+            const uint64_t dp_start_ = device_prof_ticks();                       \
+            call;                                                                 \
+            device_prof_add(dp_slot_, (kind), device_prof_ticks() - dp_start_);   \
+        } else {                                                                  \
+            call;                                                                 \
+        }                                                                         \
+    } while (0)
+
+#endif /* EMU_DEVICE_PROF_H */
@@ -149,6 +149,8 @@ typedef struct ide_s {
 extern ide_t *ide_drives[IDE_NUM];
 #endif
 
+extern int ide_fast_completion;
+
 /* Type:
         0 = PIO,
         1 = SDMA,
@@ -190,6 +192,8 @@ extern void  ide_xtide_set_is_jride(int is_jride);
 extern uint8_t *ide_get_pio_buffer(void *priv);
 extern void  ide_complete_pio_buffer_read(void *priv);
 extern void  ide_complete_pio_buffer_write(void *priv);
+extern int   ide_read_data_block(void *priv, uint16_t *buf, int count);
+extern int   ide_write_data_block(void *priv, const uint16_t *buf, int count);
 
 extern void  ide_drives_set_shadow(void);
 
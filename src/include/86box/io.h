@@ -18,6 +18,16 @@
 #ifndef EMU_IO_H
 #define EMU_IO_H
 
+/* Ports listed by io_stats_dump(). */
+#define IO_STATS_TOP 32
+
+typedef struct io_port_stats_t {
+    uint16_t port;
+    uint16_t handlers;
+    uint32_t reads;
+    uint32_t writes;
+} io_port_stats_t;
+
 extern void io_init(void);
 
 extern void io_sethandler_common(uint16_t base, uint16_t size,
@@ -101,6 +111,13 @@ extern void io_handler_interleaved(uint8_t set, uint16_t base, uint16_t size,
                                    void (*outl)(uint16_t port, uint32_t val, void *priv),
                                    void *priv);
 
+extern void io_set_block_handler(uint16_t base, uint16_t size,
+                                 int (*inw_block)(uint16_t port, uint16_t *buf, int count, void *priv),
+                                 int (*inl_block)(uint16_t port, uint32_t *buf, int count, void *priv),
+                                 int (*outw_block)(uint16_t port, const uint16_t *buf, int count, void *priv),
+                                 int (*outl_block)(uint16_t port, const uint32_t *buf, int count, void *priv),
+                                 void *priv);
+
 extern uint8_t  inb(uint16_t port);
 extern void     outb(uint16_t port, uint8_t val);
 extern uint16_t inw(uint16_t port);
@@ -108,6 +125,19 @@ extern void     outw(uint16_t port, uint16_t val);
 extern uint32_t inl(uint16_t port);
 extern void     outl(uint16_t port, uint32_t val);
 
+/* Return how many elements were transferred, 0 if the port has no block handler. */
+extern int inw_block(uint16_t port, uint16_t *buf, int count);
+extern int inl_block(uint16_t port, uint32_t *buf, int count);
+extern int outw_block(uint16_t port, const uint16_t *buf, int count);
+extern int outl_block(uint16_t port, const uint32_t *buf, int count);
+
+/* Per-port access counters, for finding drivers that hammer a port. */
+extern void io_stats_enable(int enable);
+extern int  io_stats_enabled(void);
+extern void io_stats_reset(void);
+extern int  io_stats_get_top(io_port_stats_t *stats, int max);
+extern void io_stats_dump(void);
+
 extern void *io_trap_add(void (*func)(uint16_t size, uint16_t port, uint8_t write, uint8_t val, void *priv),
                          void *priv);
 extern void  io_trap_remap(void *handle, uint8_t enable, uint16_t port, uint16_t size);
@@ -19,6 +19,8 @@
 #ifndef EMU_MEM_H
 #define EMU_MEM_H
 
+#include <86box/device_prof.h>
+
 #define MEM_MAP_TO_SHADOW_RAM_MASK 1
 #define MEM_MAP_TO_RAM_ADDR_MASK   2
 
@@ -193,8 +195,65 @@ typedef struct _mem_mapping_ {
     /* There is never a needed to pass a pointer to the mapping itself, it is much preferable to
        prepare a structure with the requires data (usually, the base address and mask) instead. */
     void *priv; /* backpointer to device */
+
+    int prof; /* Device slot for the host time accounting. */
 } mem_mapping_t;
 
+/* Handler calls, timed per device while the host time accounting is on. */
+static __inline uint8_t
+mem_mapping_read_b(mem_mapping_t *map, uint32_t addr)
+{
+    uint8_t ret;
+
+    DEVICE_PROF_CALL(map->prof, DEVICE_PROF_MEM, ret = map->read_b(addr, map->priv));
+    return ret;
+}
+
+static __inline uint16_t
+mem_mapping_read_w(mem_mapping_t *map, uint32_t addr)
+{
+    uint16_t ret;
+
+    DEVICE_PROF_CALL(map->prof, DEVICE_PROF_MEM, ret = map->read_w(addr, map->priv));
+    return ret;
+}
+
+static __inline uint32_t
+mem_mapping_read_l(mem_mapping_t *map, uint32_t addr)
+{
+    uint32_t ret;
+
+    DEVICE_PROF_CALL(map->prof, DEVICE_PROF_MEM, ret = map->read_l(addr, map->priv));
+    return ret;
+}
+
+static __inline void
+mem_mapping_write_b(mem_mapping_t *map, uint32_t addr, uint8_t val)
+{
+    DEVICE_PROF_CALL(map->prof, DEVICE_PROF_MEM, map->write_b(addr, val, map->priv));
+}
+
+static __inline void
+mem_mapping_write_w(mem_mapping_t *map, uint32_t addr, uint16_t val)
+{
+    DEVICE_PROF_CALL(map->prof, DEVICE_PROF_MEM, map->write_w(addr, val, map->priv));
+}
+
+static __inline void
+mem_mapping_write_l(mem_mapping_t *map, uint32_t addr, uint32_t val)
+{
+    DEVICE_PROF_CALL(map->prof, DEVICE_PROF_MEM, map->write_l(addr, val, map->priv));
+}
+
+typedef struct mmu_stats_t {
+    uint64_t walks;        /* Page walks done to fill the lookups. */
+    uint64_t flushes;      /* Lookups dropped entirely. */
+    uint64_t cr3_flushes;  /* CR3 loads that kept the global pages. */
+    uint64_t user_flushes; /* Switches to ring 3 that kept the user pages. */
+    uint64_t page_flushes; /* INVLPG. */
+    uint64_t kept;         /* Lookup slots that survived the above two. */
+} mmu_stats_t;
+
 #ifdef USE_NEW_DYNAREC
 extern uint64_t *byte_dirty_mask;
 extern uint64_t *byte_code_present_mask;
@@ -331,6 +390,12 @@ extern void     writememll_no_mmut(uint32_t addr, uint32_t *a64, uint32_t val);
 
 extern void do_mmutranslate(uint32_t addr, uint32_t *a64, int num, int write);
 
+extern uint32_t fetch_page_2386;
+extern int      fetch_user_2386;
+extern uint8_t *fetch_mem_2386;
+
+extern void     fetch_fill_2386(uint32_t addr);
+
 extern uint8_t  readmembl_2386(uint32_t addr);
 extern void     writemembl_2386(uint32_t addr, uint8_t val);
 extern uint16_t readmemwl_2386(uint32_t addr);
@@ -433,6 +498,8 @@ extern void mem_write_ramb_page(uint32_t addr, uint8_t val, page_t *page);
 extern void mem_write_ramw_page(uint32_t addr, uint16_t val, page_t *page);
 extern void mem_write_raml_page(uint32_t addr, uint32_t val, page_t *page);
 extern void mem_flush_write_page(uint32_t addr, uint32_t virt);
+extern void mem_dirty_ram_range_page(uint32_t addr, uint32_t len, page_t *page);
+extern uint8_t *mem_ram_page_ptr(uint32_t addr, page_t *page);
 
 extern void mem_reset_page_blocks(void);
 
@@ -440,6 +507,12 @@ extern void flushmmucache(void);
 extern void flushmmucache_write(void);
 extern void flushmmucache_pc(void);
 extern void flushmmucache_nopc(void);
+extern void flushmmucache_cr3(void);
+extern void flushmmucache_user(void);
+extern void flushmmucache_page(uint32_t addr);
+
+extern mmu_stats_t mmu_stats;
+extern void        mem_get_mmu_stats(mmu_stats_t *stats);
 
 extern void mem_debug_check_addr(uint32_t addr, int write);
 
@@ -5,6 +5,9 @@
 
 #define RENDER_RATE                100
 
+#define MIDI_RENDER_AHEAD_DEFAULT  20  /* ms */
+#define MIDI_RENDER_AHEAD_MAX      200 /* ms */
+
 extern uint8_t MIDI_InSysexBuf[SYSEX_SIZE];
 extern uint8_t MIDI_evt_len[256];
 
@@ -83,6 +86,25 @@ extern void midi_clear_buffer(void);
 extern void midi_poll(void);
 extern void midi_reset(void);
 
+/* Shared render host for software synthesizers (midi_synth.c). */
+typedef struct midi_synth_t midi_synth_t;
+
+typedef struct midi_synth_ops_t {
+    void (*play_msg)(void *priv, uint8_t *msg);
+    void (*play_sysex)(void *priv, uint8_t *sysex, unsigned int len);
+    /* Render interleaved stereo; render_int16 is optional. */
+    void (*render)(void *priv, float *buf, int frames);
+    void (*render_int16)(void *priv, int16_t *buf, int frames);
+} midi_synth_ops_t;
+
+extern int midi_render_ahead;
+
+extern midi_synth_t *midi_synth_init(const midi_synth_ops_t *ops, void *priv, int freq);
+extern void          midi_synth_close(midi_synth_t *synth);
+extern void          midi_synth_poll(midi_synth_t *synth);
+extern void          midi_synth_msg(midi_synth_t *synth, uint8_t *msg);
+extern void          midi_synth_sysex(midi_synth_t *synth, uint8_t *sysex, unsigned int len);
+
 extern void midi_in_handler(int set, void (*msg)(void *priv, uint8_t *msg, uint32_t len), int (*sysex)(void *priv, uint8_t *buffer, uint32_t len, int abort), void *priv);
 extern void midi_in_handlers_clear(void);
 extern void midi_in_msg(uint8_t *msg, uint32_t len);
@@ -0,0 +1,69 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Definitions for the network capture tap.
+ *
+ * Authors: 86Box contributors.
+ *
+ *          Copyright 2026 86Box contributors.
+ */
+#ifndef EMU_NET_CAPTURE_H
+#define EMU_NET_CAPTURE_H
+
+#include <stdint.h>
+
+#define NET_CAPTURE_IN      0 /* host to guest */
+#define NET_CAPTURE_OUT     1 /* guest to host */
+
+#define NET_CAPTURE_PATH    "captures"
+/* Bytes of frames buffered for the writer thread, shared by all cards. */
+#define NET_CAPTURE_RING    (4 << 20)
+/* Flows tracked per card while its tap is on. */
+#define NET_CAPTURE_FLOWS   128
+
+typedef struct net_capture_stats_t {
+    int      active;
+    uint64_t packets;   /* Frames that passed the filter. */
+    uint64_t bytes;
+    uint64_t filtered;  /* Frames the filter rejected. */
+    uint64_t written;   /* Frames written out by the writer thread. */
+    uint32_t ring_full; /* Frames lost because the writer fell behind. */
+    char     path[1024];
+} net_capture_stats_t;
+
+typedef struct net_flow_stats_t {
+    char     desc[112];
+    uint64_t packets[2]; /* Indexed by NET_CAPTURE_IN/OUT. */
+    uint64_t bytes[2];
+    uint32_t drops;      /* Guest frames lost to a full transmit queue. */
+} net_flow_stats_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern void network_capture_init(void);
+extern void network_capture_close(void);
+
+extern int  network_capture_start(int card_num);
+extern void network_capture_stop(int card_num);
+extern int  network_capture_active(int card_num);
+
+/* Emulation thread only. */
+extern void network_capture_frame(int card_num, int dir, const uint8_t *data, int len);
+extern void network_capture_drop(int card_num, int dir, const uint8_t *data, int len);
+
+extern int network_capture_get_stats(int card_num, net_capture_stats_t *stats);
+/* Busiest flows first, returns how many were filled in. */
+extern int network_capture_get_flows(int card_num, net_flow_stats_t *flows, int max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* EMU_NET_CAPTURE_H */
@@ -1,12 +1,20 @@
 #ifndef EMU_NET_EVENT_H
 #define EMU_NET_EVENT_H
 
+#include <stdatomic.h>
+#include <stdint.h>
+#ifndef _WIN32
+#    include <poll.h>
+#endif
+
 typedef struct net_evt_t {
 #ifdef _WIN32
     HANDLE handle;
 #else
     int fds[2];
 #endif /* _WIN32 */
+    /* Set until the waiter clears the event, further sets are no-ops. */
+    atomic_int pending;
 } net_evt_t;
 
 extern void net_event_init(net_evt_t *event);
@@ -17,6 +25,15 @@ extern void net_event_close(net_evt_t *event);
 extern HANDLE net_event_get_handle(net_evt_t *event);
 #else
 extern int net_event_get_fd(net_evt_t *event);
+
+/* Adaptive spinning before a host driver thread goes to sleep. */
+typedef struct net_busy_poll_t {
+    uint32_t max_us; /* 0 never spins */
+    uint32_t window_us;
+} net_busy_poll_t;
+
+extern void net_busy_poll_init(net_busy_poll_t *bp, uint32_t max_us);
+extern int  net_event_poll(struct pollfd *pfd, int nfds, int timeout, net_busy_poll_t *bp);
 #endif /* _WIN32 */
 
 #endif /* EMU_NET_EVENT_H */
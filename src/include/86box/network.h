@@ -45,25 +45,37 @@
 #include <stdint.h>
 
 /* Network provider types. */
-#define NET_TYPE_NONE     0 /* use the null network driver */
-#define NET_TYPE_SLIRP    1 /* use the SLiRP port forwarder */
-#define NET_TYPE_PCAP     2 /* use the (Win)Pcap API */
-#define NET_TYPE_VDE      3 /* use the VDE plug API */
-#define NET_TYPE_TAP      4 /* use a linux TAP device */
-#define NET_TYPE_NLSWITCH 5 /* use the local switch provider */
-#define NET_TYPE_NRSWITCH 6 /* use the remote switch provider */
+#define NET_TYPE_NONE      0 /* use the null network driver */
+#define NET_TYPE_SLIRP     1 /* use the SLiRP port forwarder */
+#define NET_TYPE_PCAP      2 /* use the (Win)Pcap API */
+#define NET_TYPE_VDE       3 /* use the VDE plug API */
+#define NET_TYPE_TAP       4 /* use a linux TAP device */
+#define NET_TYPE_NLSWITCH  5 /* use the local switch provider */
+#define NET_TYPE_NRSWITCH  6 /* use the remote switch provider */
+#define NET_TYPE_SHMSWITCH 7 /* use the shared memory switch */
 
 #define NET_MAX_FRAME  1518
-/* Queue size must be a power of 2 */
+/* Packets moved per batch; also the smallest queue depth. */
 #define NET_QUEUE_LEN      16
-#define NET_QUEUE_LEN_MASK (NET_QUEUE_LEN - 1)
-#define NET_QUEUE_COUNT    4
+/* Queue depths are rounded up to a power of 2. */
+#define NET_QUEUE_LEN_DEFAULT 256
+#define NET_QUEUE_LEN_MAX     4096
+#define NET_QUEUE_COUNT    5
 #define NET_CARD_MAX       4
 #define NET_HOST_INTF_MAX  64
 
 #define NET_PERIOD_10M     0.8
 #define NET_PERIOD_100M    0.08
 
+/* Bounds of the adaptive queue polling interval, in microseconds. */
+#define NET_POLL_MIN       25
+#define NET_POLL_MAX       200
+
+/* Most frames a host driver moves per system call. */
+#define NET_HOST_BATCH_MAX 64
+/* Longest host driver busy-poll window, in microseconds. */
+#define NET_BUSY_POLL_MAX  1000
+
 /* Error buffers for network driver init */
 #define NET_DRV_ERRBUF_SIZE 384
 
@@ -87,7 +99,8 @@ enum {
     NET_QUEUE_RX       = 0,
     NET_QUEUE_TX_VM    = 1,
     NET_QUEUE_TX_HOST  = 2,
-    NET_QUEUE_RX_ON_TX = 3
+    NET_QUEUE_RX_ON_TX = 3,
+    NET_QUEUE_RX_LOOP  = 4
 };
 
 typedef struct netcard_conf_t {
@@ -99,6 +112,11 @@ typedef struct netcard_conf_t {
     uint8_t  promisc_mode;
     char     slirp_net[16];
     char     nrs_hostname[128];
+    uint32_t queue_len;
+    uint8_t  host_speed;  /* Deliver frames as fast as the guest takes them. */
+    uint16_t busy_poll;   /* Spin this many microseconds before sleeping, 0 = never. */
+    uint16_t capture_snaplen;   /* 0 captures whole frames. */
+    char     capture_filter[64]; /* See net_capture.c. */
 } netcard_conf_t;
 
 extern netcard_conf_t net_cards_conf[NET_CARD_MAX];
@@ -113,11 +131,21 @@ typedef struct netpkt {
     int      len;
 } netpkt_t;
 
-typedef struct netqueue_t {
-    netpkt_t packets[NET_QUEUE_LEN];
-    int      head;
-    int      tail;
-} netqueue_t;
+/* Single producer, single consumer packet ring, see network.c. */
+typedef struct netqueue_t netqueue_t;
+
+typedef struct netcard_stats_t {
+    uint64_t rx_packets;
+    uint64_t rx_bytes;
+    uint64_t tx_packets;
+    uint64_t tx_bytes;
+    uint32_t rx_drops;        /* Host frames lost to a full receive queue. */
+    uint32_t tx_drops;        /* Guest frames lost to a full transmit queue. */
+    uint32_t rx_backpressure; /* Times the card had no room for a frame. */
+    uint32_t rx_queued;
+    uint32_t queue_len;
+    uint32_t poll_period;
+} netcard_stats_t;
 
 typedef struct _netcard_t netcard_t;
 
@@ -134,6 +162,7 @@ extern const netdrv_t net_vde_drv;
 extern const netdrv_t net_tap_drv;
 extern const netdrv_t net_null_drv;
 extern const netdrv_t net_switch_drv;
+extern const netdrv_t net_shmswitch_drv;
 
 struct _netcard_t {
     const device_t *device;
@@ -141,16 +170,20 @@ struct _netcard_t {
     struct netdrv_t host_drv;
     NETRXCB         rx;
     NETSETLINKSTATE set_link_state;
-    netqueue_t      queues[NET_QUEUE_COUNT];
+    netqueue_t     *queues[NET_QUEUE_COUNT];
     netpkt_t        queued_pkt;
-    mutex_t        *tx_mutex;
-    mutex_t        *rx_mutex;
     pc_timer_t      timer;
     uint16_t        card_num;
     double          byte_period;
+    double          poll_period;
     uint32_t        led_timer;
     uint32_t        led_state;
     uint32_t        link_state;
+    uint64_t        rx_packets;
+    uint64_t        rx_bytes;
+    uint64_t        tx_packets;
+    uint64_t        tx_bytes;
+    uint32_t        rx_backpressure;
 };
 
 typedef struct {
@@ -214,6 +247,8 @@ extern int network_rx_on_tx_popv(netcard_t *card, netpkt_t *pkt_vec, int vec_siz
 extern int network_rx_on_tx_put(netcard_t *card, uint8_t *bufp, int len);
 extern int network_rx_put_pkt(netcard_t *card, netpkt_t *pkt);
 extern int network_rx_on_tx_put_pkt(netcard_t *card, netpkt_t *pkt);
+extern int network_card_get_stats(int card_num, netcard_stats_t *stats);
+extern int network_host_batch(const netcard_t *card);
 
 #ifdef EMU_DEVICE_H
 /* 3Com Etherlink */
@@ -22,6 +22,12 @@
 
 #define SCSI_LUN_USE_CDB 0xff
 
+/* Queue tag types, numbered after their SCSI-2 messages. */
+#define SCSI_TAG_NONE    0x00
+#define SCSI_TAG_SIMPLE  0x20
+#define SCSI_TAG_HEAD    0x21
+#define SCSI_TAG_ORDERED 0x22
+
 #ifdef WALTJE
 #    define SCSI_TIME 50.0
 #else
@@ -449,6 +455,13 @@ typedef struct scsi_device_t {
 
     uint16_t           type;
 
+    /* Tag of the command being issued, cleared once it has been started. */
+    uint8_t            tag_type;
+    uint8_t            tag;
+    /* Commands the controller has let go of but not yet completed. */
+    uint8_t            queued;
+    uint8_t            pad;
+
     scsi_common_t *    sc;
 
     void               (*command)(scsi_common_t *sc, const uint8_t *cdb);
@@ -522,6 +535,10 @@ extern void     scsi_device_command_phase0(scsi_device_t *dev, uint8_t *cdb);
 extern void     scsi_device_command_stop(scsi_device_t *dev);
 extern void     scsi_device_command_phase1(scsi_device_t *dev);
 extern void     scsi_device_identify(scsi_device_t *dev, uint8_t lun);
+extern void     scsi_device_set_tag(scsi_device_t *dev, uint8_t tag_type, uint8_t tag);
+extern void     scsi_device_queue_begin(scsi_device_t *dev);
+extern void     scsi_device_queue_end(scsi_device_t *dev);
+extern int      scsi_device_queue_busy(scsi_device_t *dev);
 extern void     scsi_device_close_all(void);
 extern void     scsi_device_init(void);
 
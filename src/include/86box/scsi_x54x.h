@@ -324,6 +324,19 @@ typedef struct {
     uint8_t  MailboxCompletionCode;
 } Req_t;
 
+/* A started command waiting out its target's media time. */
+typedef struct x54x_slot_t {
+    Req_t      req;
+    uint8_t    busy;
+    uint8_t    ready;
+    uint8_t    scsi_cmd_phase;
+    uint8_t    pad;
+    uint8_t    temp_cdb[12];
+    int        target_data_len;
+    uint32_t   Outgoing;
+    pc_timer_t timer;
+} x54x_slot_t;
+
 typedef struct BIOSCMD_t {
     uint8_t command;
     uint8_t lun      : 3;
@@ -517,6 +530,10 @@ typedef struct x54x_t {
 
     Req_t Req;
 
+    /* Commands overlapping on other targets, one per target ID. */
+    x54x_slot_t slots[16];
+    int         pending_cmds;
+
     fdc_t *fdc;
 } x54x_t;
 
@@ -21,6 +21,19 @@
 
 #define SOUND_CARD_MAX 4 /* currently we support up to 4 sound cards and a standalone MPU401 */
 
+#define SOUND_MIX_MAX_THREADS 4 /* maximum number of parallel mixer worker threads */
+
+/* Handler flags for sound_add_handler_ex(). */
+#define SOUND_HANDLER_SERIAL 0x00000001 /* touches shared guest state, always render on the emulation thread */
+
+typedef struct sound_handler_stats_t {
+    const char *name;  /* name of the device that registered the handler */
+    const char *chain; /* "sound", "music", "ym2151" or "wavetable" */
+    uint8_t     lane;  /* 0 = emulation thread, 1+ = mixer worker */
+    uint64_t    render_us;
+    uint64_t    render_calls;
+} sound_handler_stats_t;
+
 extern int  sound_gain;
 extern char sound_output_device[512]; /* selected audio output device name, empty = system default */
 
@@ -68,6 +81,7 @@ extern int speakon;
 
 extern int midi_freq;
 extern int midi_buf_size;
+extern int sound_mix_threads;
 
 extern int sound_pos_global;
 extern int music_pos_global;
@@ -80,10 +94,18 @@ extern void sound_add_handler(void (*get_buffer)(int32_t *buffer,
                                                  uint16_t len, void *priv),
                               void *priv);
 
+extern void sound_add_handler_ex(void (*get_buffer)(int32_t *buffer,
+                                                    uint16_t len, void *priv),
+                                 void *priv, uint32_t flags);
+
 extern void music_add_handler(void (*get_buffer)(int32_t *buffer,
                                                  uint16_t len, void *priv),
                               void *priv);
 
+extern void music_add_handler_ex(void (*get_buffer)(int32_t *buffer,
+                                                    uint16_t len, void *priv),
+                                 void *priv, uint32_t flags);
+
 extern void ym2151_add_handler(void (*get_buffer)(int32_t *buffer,
                                                   uint16_t len, void *priv),
                                void *priv);
@@ -128,6 +150,10 @@ extern void sound_card_reset(void);
 extern void sound_recalc_timers(void);
 extern void sound_close(void);
 
+extern int  sound_get_handler_stats(sound_handler_stats_t *stats, int max);
+
+extern void sound_mix_thread_end(void);
+
 extern void sound_cd_thread_end(void);
 extern void sound_cd_thread_reset(void);
 
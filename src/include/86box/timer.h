@@ -42,6 +42,8 @@ typedef struct pc_timer_t {
     void (*callback)(void *priv);
     void *priv;
 
+    int prof; /* Device slot for the host time accounting. */
+
     struct pc_timer_t *prev;
     struct pc_timer_t *next;
 } pc_timer_t;
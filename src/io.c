@@ -24,6 +24,7 @@
 #define HAVE_STDARG_H
 #include <86box/86box.h>
 #include <86box/io.h>
+#include <86box/device_prof.h>
 #include <86box/timer.h>
 #include "cpu.h"
 #include "x86.h"
@@ -41,8 +42,16 @@ typedef struct _io_ {
     void (*outw)(uint16_t port, uint16_t val, void *priv);
     void (*outl)(uint16_t port, uint32_t val, void *priv);
 
+    /* Optional, for REP INS/OUTS; return how many elements were moved. */
+    int (*inw_block)(uint16_t port, uint16_t *buf, int count, void *priv);
+    int (*inl_block)(uint16_t port, uint32_t *buf, int count, void *priv);
+    int (*outw_block)(uint16_t port, const uint16_t *buf, int count, void *priv);
+    int (*outl_block)(uint16_t port, const uint32_t *buf, int count, void *priv);
+
     void *priv;
 
+    int prof; /* Device slot for the host time accounting. */
+
     struct _io_ *prev, *next;
 } io_t;
 
@@ -54,10 +63,44 @@ typedef struct io_trap_s {
     void     *priv;
 } io_trap_t;
 
+/* Word/dword accesses a single handler can take in one call. */
+#define IO_DISP_INW  0x01
+#define IO_DISP_INL  0x02
+#define IO_DISP_OUTW 0x04
+#define IO_DISP_OUTL 0x08
+
+/*
+   Flat copy of the handler lists, rebuilt whenever a handler is added or
+   removed. list points at single when there is one handler, at an array
+   otherwise.
+ */
+typedef struct io_disp_t {
+    io_t   **list;
+    io_t    *single;
+    uint16_t count;
+    uint8_t  flags;
+} io_disp_t;
+
 uint8_t initialized = 0;
 io_t   *io[NPORTS];
 io_t   *io_last[NPORTS];
 
+static io_disp_t io_disp[NPORTS];
+
+/* Per-port access counters, only kept while turned on. */
+static int      io_stats_on = 0;
+static uint32_t io_stats[NPORTS][2];
+
+/* The list is looked up again on every step, handlers may change it. */
+#define IO_FOREACH(p, port)                                                                \
+    for (int io_i_ = 0; (io_i_ < io_disp[(port)].count) && ((p = io_disp[(port)].list[io_i_]) != NULL); io_i_++)
+
+#define IO_STATS_COUNT(port, write, n) \
+    if (io_stats_on)                   \
+        io_stats[(port)][(write)] += (n)
+
+#define IO_PROF_CALL(p, call) DEVICE_PROF_CALL((p)->prof, DEVICE_PROF_IO, call)
+
 #ifdef ENABLE_IO_LOG
 uint8_t io_do_log = ENABLE_IO_LOG;
 
@@ -76,6 +119,91 @@ io_log(const char *fmt, ...)
 #    define io_log(fmt, ...)
 #endif
 
+static void
+io_disp_update(uint16_t port)
+{
+    io_disp_t *d    = &io_disp[port];
+    io_t     **list = (d->list != &d->single) ? d->list : NULL;
+    int        n    = 0;
+
+    for (io_t *p = io[port]; p; p = p->next)
+        n++;
+
+    if (n > 1) {
+        list = (io_t **) realloc(list, n * sizeof(io_t *));
+        n    = 0;
+        for (io_t *p = io[port]; p; p = p->next)
+            list[n++] = p;
+        d->list   = list;
+        d->single = NULL;
+    } else {
+        free(list);
+        d->single = io[port];
+        d->list   = &d->single;
+    }
+    d->count = n;
+}
+
+/* Whether a word access at port - 1 would call a handler on port too. */
+static int
+io_disp_word_split(uint16_t port, int out)
+{
+    for (const io_t *p = io[port]; p; p = p->next) {
+        if (out ? (p->outb && !p->outw) : (p->inb && !p->inw))
+            return 1;
+    }
+
+    return 0;
+}
+
+/* Whether a dword access at port - (port & 3) would call a handler on port too. */
+static int
+io_disp_dword_split(uint16_t port, int word, int out)
+{
+    for (const io_t *p = io[port]; p; p = p->next) {
+        if (out) {
+            if ((p->outb && !p->outw && !p->outl) || (word && p->outw && !p->outl))
+                return 1;
+        } else if ((p->inb && !p->inw && !p->inl) || (word && p->inw && !p->inl))
+            return 1;
+    }
+
+    return 0;
+}
+
+static void
+io_disp_update_flags(uint16_t port)
+{
+    io_disp_t  *d = &io_disp[port];
+    const io_t *p = d->single;
+
+    d->flags = 0;
+    if (p == NULL)
+        return;
+
+    if (p->inw && !io_disp_word_split(port + 1, 0))
+        d->flags |= IO_DISP_INW;
+    if (p->outw && !io_disp_word_split(port + 1, 1))
+        d->flags |= IO_DISP_OUTW;
+    if (p->inl && !io_disp_dword_split(port + 1, 0, 0) && !io_disp_dword_split(port + 2, 1, 0) &&
+        !io_disp_dword_split(port + 3, 0, 0))
+        d->flags |= IO_DISP_INL;
+    if (p->outl && !io_disp_dword_split(port + 1, 0, 1) && !io_disp_dword_split(port + 2, 1, 1) &&
+        !io_disp_dword_split(port + 3, 0, 1))
+        d->flags |= IO_DISP_OUTL;
+}
+
+/* The flags of a port depend on the handlers up to three ports above it. */
+static void
+io_disp_rebuild(uint16_t base, uint32_t size)
+{
+    for (uint32_t c = 0; c < size; c++)
+        io_disp_update((base + c) & 0xffff);
+
+    for (uint32_t c = 0; c < (size + 3U); c++)
+        io_disp_update_flags((base + c - 3) & 0xffff);
+}
+
 void
 io_init(void)
 {
@@ -104,6 +232,8 @@ io_init(void)
         /* io[c] should be NULL. */
         io[c] = io_last[c] = NULL;
     }
+
+    io_disp_rebuild(0, NPORTS);
 }
 
 void
@@ -116,8 +246,9 @@ io_sethandler_common(uint16_t base, uint16_t size,
                      void (*outl)(uint16_t port, uint32_t val, void *priv),
                      void *priv, uint8_t step)
 {
-    io_t *p;
-    io_t *q = NULL;
+    io_t     *p;
+    io_t     *q    = NULL;
+    const int prof = device_prof_slot();
 
     for (uint32_t c = 0; c < size; c += step) {
         p = io_last[base + c];
@@ -139,12 +270,15 @@ io_sethandler_common(uint16_t base, uint16_t size,
         q->outl = outl;
 
         q->priv = priv;
+        q->prof = prof;
         q->next = NULL;
 
         io_last[base + c] = q;
 
         q = NULL;
     }
+
+    io_disp_rebuild(base, size);
 }
 
 void
@@ -182,6 +316,8 @@ io_removehandler_common(uint16_t base, uint16_t size,
             p = q;
         }
     }
+
+    io_disp_rebuild(base, size);
 }
 
 void
@@ -278,6 +414,30 @@ io_handler_interleaved(uint8_t set, uint16_t base, uint16_t size,
     io_handler_common(set, base, size, inb, inw, inl, outb, outw, outl, priv, 2);
 }
 
+/*
+   Attaches block handlers to the handlers priv already has on the ports;
+   they go away together with them on io_removehandler().
+ */
+void
+io_set_block_handler(uint16_t base, uint16_t size,
+                     int (*inw_block)(uint16_t port, uint16_t *buf, int count, void *priv),
+                     int (*inl_block)(uint16_t port, uint32_t *buf, int count, void *priv),
+                     int (*outw_block)(uint16_t port, const uint16_t *buf, int count, void *priv),
+                     int (*outl_block)(uint16_t port, const uint32_t *buf, int count, void *priv),
+                     void *priv)
+{
+    for (uint32_t c = 0; c < size; c++) {
+        for (io_t *p = io[(base + c) & 0xffff]; p; p = p->next) {
+            if (p->priv == priv) {
+                p->inw_block  = inw_block;
+                p->inl_block  = inl_block;
+                p->outw_block = outw_block;
+                p->outl_block = outl_block;
+            }
+        }
+    }
+}
+
 #ifdef USE_DEBUG_REGS_486
 extern int trap;
 /* Set trap for I/O address breakpoints. */
@@ -333,7 +493,6 @@ inb(uint16_t port)
 {
     uint8_t ret = 0xff;
     io_t   *p;
-    io_t   *q;
     uint8_t found  = 0;
 #ifdef ENABLE_IO_LOG
     uint8_t qfound = 0;
@@ -341,6 +500,8 @@ inb(uint16_t port)
 
     io_port = port;
 
+    IO_STATS_COUNT(port, 0, 1);
+
 #ifdef USE_DEBUG_REGS_486
     io_debug_check_addr(port);
 #endif
@@ -358,17 +519,14 @@ inb(uint16_t port)
         qfound = 1;
 #endif
     } else {
-        p = io[port];
-        while (p) {
-            q = p->next;
+        IO_FOREACH(p, port) {
             if (p->inb) {
-                ret &= p->inb(port, p->priv);
+                IO_PROF_CALL(p, ret &= p->inb(port, p->priv));
                 found |= 1;
 #ifdef ENABLE_IO_LOG
                 qfound++;
 #endif
             }
-            p = q;
         }
     }
 
@@ -399,7 +557,6 @@ void
 outb(uint16_t port, uint8_t val)
 {
     io_t   *p;
-    io_t   *q;
     uint8_t found  = 0;
 #ifdef ENABLE_IO_LOG
     uint8_t qfound = 0;
@@ -408,6 +565,8 @@ outb(uint16_t port, uint8_t val)
     io_port = port;
     io_val  = val;
 
+    IO_STATS_COUNT(port, 1, 1);
+
 #ifdef USE_DEBUG_REGS_486
     io_debug_check_addr(port);
 #endif
@@ -425,17 +584,14 @@ outb(uint16_t port, uint8_t val)
         qfound = 1;
 #endif
     } else {
-        p = io[port];
-        while (p) {
-            q = p->next;
+        IO_FOREACH(p, port) {
             if (p->outb) {
-                p->outb(port, val, p->priv);
+                IO_PROF_CALL(p, p->outb(port, val, p->priv));
                 found |= 1;
 #ifdef ENABLE_IO_LOG
                 qfound++;
 #endif
             }
-            p = q;
         }
     }
 
@@ -455,17 +611,19 @@ outb(uint16_t port, uint8_t val)
 uint16_t
 inw(uint16_t port)
 {
-    io_t    *p;
-    io_t    *q;
-    uint16_t ret    = 0xffff;
-    uint8_t  found  = 0;
+    io_t            *p;
+    const io_disp_t *d      = &io_disp[port];
+    uint16_t         ret    = 0xffff;
+    uint8_t          found  = 0;
 #ifdef ENABLE_IO_LOG
-    uint8_t  qfound = 0;
+    uint8_t          qfound = 0;
 #endif
-    uint8_t  ret8[2];
+    uint8_t          ret8[2];
 
     io_port = port;
 
+    IO_STATS_COUNT(port, 0, 1);
+
 #ifdef USE_DEBUG_REGS_486
     io_debug_check_addr(port);
 #endif
@@ -481,35 +639,35 @@ inw(uint16_t port)
         found = 2;
 #ifdef ENABLE_IO_LOG
         qfound = 1;
+#endif
+    } else if (d->flags & IO_DISP_INW) {
+        IO_PROF_CALL(d->single, ret = d->single->inw(port, d->single->priv));
+        found = 2;
+#ifdef ENABLE_IO_LOG
+        qfound = 1;
 #endif
     } else {
-        p = io[port];
-        while (p) {
-            q = p->next;
+        IO_FOREACH(p, port) {
             if (p->inw) {
-                ret &= p->inw(port, p->priv);
+                IO_PROF_CALL(p, ret &= p->inw(port, p->priv));
                 found |= 2;
 #ifdef ENABLE_IO_LOG
                 qfound++;
 #endif
             }
-            p = q;
         }
 
         ret8[0] = ret & 0xff;
         ret8[1] = (ret >> 8) & 0xff;
         for (uint8_t i = 0; i < 2; i++) {
-            p = io[(port + i) & 0xffff];
-            while (p) {
-                q = p->next;
+            IO_FOREACH(p, (port + i) & 0xffff) {
                 if (p->inb && !p->inw) {
-                    ret8[i] &= p->inb(port + i, p->priv);
+                    IO_PROF_CALL(p, ret8[i] &= p->inb(port + i, p->priv));
                     found |= 1;
 #ifdef ENABLE_IO_LOG
                     qfound++;
 #endif
                 }
-                p = q;
             }
         }
         ret = (ret8[1] << 8) | ret8[0];
@@ -535,16 +693,18 @@ inw(uint16_t port)
 void
 outw(uint16_t port, uint16_t val)
 {
-    io_t   *p;
-    io_t   *q;
-    uint8_t found  = 0;
+    io_t            *p;
+    const io_disp_t *d      = &io_disp[port];
+    uint8_t          found  = 0;
 #ifdef ENABLE_IO_LOG
-    uint8_t qfound = 0;
+    uint8_t          qfound = 0;
 #endif
 
     io_port = port;
     io_val  = val;
 
+    IO_STATS_COUNT(port, 1, 1);
+
 #ifdef USE_DEBUG_REGS_486
     io_debug_check_addr(port);
 #endif
@@ -560,33 +720,33 @@ outw(uint16_t port, uint16_t val)
         found = 2;
 #ifdef ENABLE_IO_LOG
         qfound = 1;
+#endif
+    } else if (d->flags & IO_DISP_OUTW) {
+        IO_PROF_CALL(d->single, d->single->outw(port, val, d->single->priv));
+        found = 2;
+#ifdef ENABLE_IO_LOG
+        qfound = 1;
 #endif
     } else {
-        p = io[port];
-        while (p) {
-            q = p->next;
+        IO_FOREACH(p, port) {
             if (p->outw) {
-                p->outw(port, val, p->priv);
+                IO_PROF_CALL(p, p->outw(port, val, p->priv));
                 found |= 2;
 #ifdef ENABLE_IO_LOG
                 qfound++;
 #endif
             }
-            p = q;
         }
 
         for (uint8_t i = 0; i < 2; i++) {
-            p = io[(port + i) & 0xffff];
-            while (p) {
-                q = p->next;
+            IO_FOREACH(p, (port + i) & 0xffff) {
                 if (p->outb && !p->outw) {
-                    p->outb(port + i, val >> (i << 3), p->priv);
+                    IO_PROF_CALL(p, p->outb(port + i, val >> (i << 3), p->priv));
                     found |= 1;
 #ifdef ENABLE_IO_LOG
                     qfound++;
 #endif
                 }
-                p = q;
             }
         }
     }
@@ -607,18 +767,20 @@ outw(uint16_t port, uint16_t val)
 uint32_t
 inl(uint16_t port)
 {
-    io_t    *p;
-    io_t    *q;
-    uint32_t ret = 0xffffffff;
-    uint16_t ret16[2];
-    uint8_t  ret8[4];
-    uint8_t  found  = 0;
+    io_t            *p;
+    const io_disp_t *d      = &io_disp[port];
+    uint32_t         ret    = 0xffffffff;
+    uint16_t         ret16[2];
+    uint8_t          ret8[4];
+    uint8_t          found  = 0;
 #ifdef ENABLE_IO_LOG
-    uint8_t  qfound = 0;
+    uint8_t          qfound = 0;
 #endif
 
     io_port = port;
 
+    IO_STATS_COUNT(port, 0, 1);
+
 #ifdef USE_DEBUG_REGS_486
     io_debug_check_addr(port);
 #endif
@@ -634,47 +796,44 @@ inl(uint16_t port)
         found = 4;
 #ifdef ENABLE_IO_LOG
         qfound = 1;
+#endif
+    } else if (d->flags & IO_DISP_INL) {
+        IO_PROF_CALL(d->single, ret = d->single->inl(port, d->single->priv));
+        found = 4;
+#ifdef ENABLE_IO_LOG
+        qfound = 1;
 #endif
     } else {
-        p = io[port];
-        while (p) {
-            q = p->next;
+        IO_FOREACH(p, port) {
             if (p->inl) {
-                ret &= p->inl(port, p->priv);
+                IO_PROF_CALL(p, ret &= p->inl(port, p->priv));
                 found |= 4;
 #ifdef ENABLE_IO_LOG
                 qfound++;
 #endif
             }
-            p = q;
         }
 
         ret16[0] = ret & 0xffff;
         ret16[1] = (ret >> 16) & 0xffff;
-        p        = io[port & 0xffff];
-        while (p) {
-            q = p->next;
+        IO_FOREACH(p, port) {
             if (p->inw && !p->inl) {
-                ret16[0] &= p->inw(port, p->priv);
+                IO_PROF_CALL(p, ret16[0] &= p->inw(port, p->priv));
                 found |= 2;
 #ifdef ENABLE_IO_LOG
                 qfound++;
 #endif
             }
-            p = q;
         }
 
-        p = io[(port + 2) & 0xffff];
-        while (p) {
-            q = p->next;
+        IO_FOREACH(p, (port + 2) & 0xffff) {
             if (p->inw && !p->inl) {
-                ret16[1] &= p->inw(port + 2, p->priv);
+                IO_PROF_CALL(p, ret16[1] &= p->inw(port + 2, p->priv));
                 found |= 2;
 #ifdef ENABLE_IO_LOG
                 qfound++;
 #endif
             }
-            p = q;
         }
         ret = (ret16[1] << 16) | ret16[0];
 
@@ -683,17 +842,14 @@ inl(uint16_t port)
         ret8[2] = (ret >> 16) & 0xff;
         ret8[3] = (ret >> 24) & 0xff;
         for (uint8_t i = 0; i < 4; i++) {
-            p = io[(port + i) & 0xffff];
-            while (p) {
-                q = p->next;
+            IO_FOREACH(p, (port + i) & 0xffff) {
                 if (p->inb && !p->inw && !p->inl) {
-                    ret8[i] &= p->inb(port + i, p->priv);
+                    IO_PROF_CALL(p, ret8[i] &= p->inb(port + i, p->priv));
                     found |= 1;
 #ifdef ENABLE_IO_LOG
                     qfound++;
 #endif
                 }
-                p = q;
             }
         }
         ret = (ret8[3] << 24) | (ret8[2] << 16) | (ret8[1] << 8) | ret8[0];
@@ -719,16 +875,18 @@ inl(uint16_t port)
 void
 outl(uint16_t port, uint32_t val)
 {
-    io_t   *p;
-    io_t   *q;
-    uint8_t found  = 0;
+    io_t            *p;
+    const io_disp_t *d      = &io_disp[port];
+    uint8_t          found  = 0;
 #ifdef ENABLE_IO_LOG
-    uint8_t qfound = 0;
+    uint8_t          qfound = 0;
 #endif
 
     io_port = port;
     io_val  = val;
 
+    IO_STATS_COUNT(port, 1, 1);
+
 #ifdef USE_DEBUG_REGS_486
     io_debug_check_addr(port);
 #endif
@@ -744,50 +902,45 @@ outl(uint16_t port, uint32_t val)
         found = 4;
 #ifdef ENABLE_IO_LOG
         qfound = 1;
+#endif
+    } else if (d->flags & IO_DISP_OUTL) {
+        IO_PROF_CALL(d->single, d->single->outl(port, val, d->single->priv));
+        found = 4;
+#ifdef ENABLE_IO_LOG
+        qfound = 1;
 #endif
     } else {
-        p = io[port];
-        if (p) {
-            while (p) {
-                q = p->next;
-                if (p->outl) {
-                    p->outl(port, val, p->priv);
-                    found |= 4;
+        IO_FOREACH(p, port) {
+            if (p->outl) {
+                IO_PROF_CALL(p, p->outl(port, val, p->priv));
+                found |= 4;
 #ifdef ENABLE_IO_LOG
-                    qfound++;
+                qfound++;
 #endif
-                }
-                p = q;
             }
         }
 
         for (uint8_t i = 0; i < 4; i += 2) {
-            p = io[(port + i) & 0xffff];
-            while (p) {
-                q = p->next;
+            IO_FOREACH(p, (port + i) & 0xffff) {
                 if (p->outw && !p->outl) {
-                    p->outw(port + i, val >> (i << 3), p->priv);
+                    IO_PROF_CALL(p, p->outw(port + i, val >> (i << 3), p->priv));
                     found |= 2;
 #ifdef ENABLE_IO_LOG
                     qfound++;
 #endif
                 }
-                p = q;
             }
         }
 
         for (uint8_t i = 0; i < 4; i++) {
-            p = io[(port + i) & 0xffff];
-            while (p) {
-                q = p->next;
+            IO_FOREACH(p, (port + i) & 0xffff) {
                 if (p->outb && !p->outw && !p->outl) {
-                    p->outb(port + i, val >> (i << 3), p->priv);
+                    IO_PROF_CALL(p, p->outb(port + i, val >> (i << 3), p->priv));
                     found |= 1;
 #ifdef ENABLE_IO_LOG
                     qfound++;
 #endif
                 }
-                p = q;
             }
         }
     }
@@ -850,6 +1003,172 @@ io_trap_writel(uint16_t port, uint32_t val, void *priv)
     trap->func(4, port, 1, val, trap->priv);
 }
 
+/*
+   A block transfer is only possible when a single device answers on all
+   the ports the word or dword access touches, so that no other handler
+   would have seen the elements.
+ */
+static io_t *
+io_block_handler(uint16_t port, int size)
+{
+    io_t *p = io[port];
+
+#ifdef USE_DEBUG_REGS_486
+    if (dr[7] & 0xff)
+        return NULL;
+#endif
+
+    if ((p == NULL) || (p->next != NULL) || (amstrad_latch & 0x80000000))
+        return NULL;
+
+    if ((pci_flags & FLAG_CONFIG_IO_ON) && ((port + size) > pci_base) && (port < (pci_base + pci_size)))
+        return NULL;
+    if ((pci_flags & FLAG_CONFIG_DEV0_IO_ON) && ((port + size) > 0xc000) && (port < 0xc100))
+        return NULL;
+
+    for (int i = 1; i < size; i++) {
+        for (io_t *q = io[(port + i) & 0xffff]; q; q = q->next) {
+            if (q->priv != p->priv)
+                return NULL;
+        }
+    }
+
+    return p;
+}
+
+int
+inw_block(uint16_t port, uint16_t *buf, int count)
+{
+    io_t *p   = io_block_handler(port, 2);
+    int   ret = 0;
+
+    if ((p != NULL) && (p->inw_block != NULL)) {
+        io_port = port;
+        IO_PROF_CALL(p, ret = p->inw_block(port, buf, count, p->priv));
+    }
+
+    IO_STATS_COUNT(port, 0, ret);
+
+    io_log("[%04X:%08X] inw_block(%04X, %i) = %i\n", CS, cpu_state.pc, port, count, ret);
+
+    return ret;
+}
+
+int
+inl_block(uint16_t port, uint32_t *buf, int count)
+{
+    io_t *p   = io_block_handler(port, 4);
+    int   ret = 0;
+
+    if ((p != NULL) && (p->inl_block != NULL)) {
+        io_port = port;
+        IO_PROF_CALL(p, ret = p->inl_block(port, buf, count, p->priv));
+    }
+
+    IO_STATS_COUNT(port, 0, ret);
+
+    io_log("[%04X:%08X] inl_block(%04X, %i) = %i\n", CS, cpu_state.pc, port, count, ret);
+
+    return ret;
+}
+
+int
+outw_block(uint16_t port, const uint16_t *buf, int count)
+{
+    io_t *p   = io_block_handler(port, 2);
+    int   ret = 0;
+
+    if ((p != NULL) && (p->outw_block != NULL)) {
+        io_port = port;
+        IO_PROF_CALL(p, ret = p->outw_block(port, buf, count, p->priv));
+        if (ret > 0)
+            io_val = buf[ret - 1];
+    }
+
+    IO_STATS_COUNT(port, 1, ret);
+
+    io_log("[%04X:%08X] outw_block(%04X, %i) = %i\n", CS, cpu_state.pc, port, count, ret);
+
+    return ret;
+}
+
+int
+outl_block(uint16_t port, const uint32_t *buf, int count)
+{
+    io_t *p   = io_block_handler(port, 4);
+    int   ret = 0;
+
+    if ((p != NULL) && (p->outl_block != NULL)) {
+        io_port = port;
+        IO_PROF_CALL(p, ret = p->outl_block(port, buf, count, p->priv));
+        if (ret > 0)
+            io_val = buf[ret - 1];
+    }
+
+    IO_STATS_COUNT(port, 1, ret);
+
+    io_log("[%04X:%08X] outl_block(%04X, %i) = %i\n", CS, cpu_state.pc, port, count, ret);
+
+    return ret;
+}
+
+void
+io_stats_enable(int enable)
+{
+    io_stats_on = !!enable;
+}
+
+int
+io_stats_enabled(void)
+{
+    return io_stats_on;
+}
+
+void
+io_stats_reset(void)
+{
+    memset(io_stats, 0, sizeof(io_stats));
+}
+
+/* Fills in the busiest ports, busiest first, and returns how many. */
+int
+io_stats_get_top(io_port_stats_t *stats, int max)
+{
+    int n = 0;
+
+    for (uint32_t c = 0; c < NPORTS; c++) {
+        const uint64_t total = (uint64_t) io_stats[c][0] + io_stats[c][1];
+        int            i;
+
+        if ((total == 0) || ((n == max) && (total <= ((uint64_t) stats[n - 1].reads + stats[n - 1].writes))))
+            continue;
+
+        if (n < max)
+            n++;
+        for (i = n - 1; (i > 0) && (total > ((uint64_t) stats[i - 1].reads + stats[i - 1].writes)); i--)
+            stats[i] = stats[i - 1];
+
+        stats[i].port     = c;
+        stats[i].handlers = io_disp[c].count;
+        stats[i].reads    = io_stats[c][0];
+        stats[i].writes   = io_stats[c][1];
+    }
+
+    return n;
+}
+
+void
+io_stats_dump(void)
+{
+    io_port_stats_t stats[IO_STATS_TOP];
+    const int       n = io_stats_get_top(stats, IO_STATS_TOP);
+
+    pclog("I/O port accesses, busiest first:\n");
+    for (int i = 0; i < n; i++)
+        pclog("  %04X: %10u reads %10u writes (%i handlers)\n",
+              stats[i].port, stats[i].reads, stats[i].writes, stats[i].handlers);
+}
+
 void *
 io_trap_add(void (*func)(uint16_t size, uint16_t port, uint8_t write, uint8_t val, void *priv),
             void *priv)
@@ -49,6 +49,14 @@ ioapic_log(const char *fmt, ...)
 #    define ioapic_log(fmt, ...)
 #endif
 
+/*
+   There is no local APIC or I/O APIC behind this, and the CPU core has
+   a single cpu_state, lookup set and dynarec block cache, so only one
+   processor can ever run. Hiding the MPS tables keeps multiprocessor
+   capable guests (NT, Linux, OS/2) on their uniprocessor kernels and
+   HALs instead of letting them wait for application processors that
+   never answer the startup IPI.
+ */
 static void
 ioapic_write(UNUSED(uint16_t port), uint8_t val, UNUSED(void *priv))
 {
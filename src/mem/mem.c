@@ -87,6 +87,22 @@ uint8_t    uncached = 0;
 int        writelnext;
 int        writelookup[256];
 
+/*
+   What each lookup slot may survive: a global page outlives a CR3 load
+   while PGE is on, and a page ring 3 can reach the same way outlives a
+   switch to ring 3. Filled from the last page walk, see mmu_note_walk().
+ */
+#define LOOKUP_KEEP_GLOBAL 1
+#define LOOKUP_KEEP_USER   2
+
+static uint8_t  readlookup_keep[256];
+static uint8_t  writelookup_keep[256];
+static uint32_t mmu_walk_page = 0xffffffff;
+static uint8_t  mmu_walk_global;
+static uint8_t  mmu_walk_prot;
+
+mmu_stats_t mmu_stats;
+
 /* The lookup tables. */
 page_t *page_lookup[1048576] = { 0 };
 uintptr_t readlookup2[1048576] = { 0 };
@@ -186,11 +202,16 @@ resetreadlookup(void)
     writelnext = 0;
     pccache    = 0xffffffff;
     high_page  = 0;
+
+    fetch_page_2386 = 0xffffffff;
+    mmu_walk_page   = 0xffffffff;
 }
 
 void
 flushmmucache(void)
 {
+    mmu_stats.flushes++;
+
     for (uint16_t c = 0; c < 256; c++) {
         if (readlookup[c] != (int) 0xffffffff) {
             readlookup2[readlookup[c]] = LOOKUP_INV;
@@ -207,6 +228,9 @@ flushmmucache(void)
     pccache  = (uint32_t) 0xffffffff;
     pccache2 = (uint8_t *) 0xffffffff;
 
+    fetch_page_2386 = 0xffffffff;
+    mmu_walk_page   = 0xffffffff;
+
 #ifdef USE_DYNAREC
     codegen_flush();
 #endif
@@ -223,6 +247,8 @@ flushmmucache_write(void)
         }
     }
     mmuflush++;
+
+    mmu_walk_page = 0xffffffff;
 }
 
 void
@@ -233,6 +259,8 @@ flushmmucache_pc(void)
     pccache  = (uint32_t) 0xffffffff;
     pccache2 = (uint8_t *) 0xffffffff;
 
+    fetch_page_2386 = 0xffffffff;
+
 #ifdef USE_DYNAREC
     codegen_flush();
 #endif
@@ -241,6 +269,8 @@ flushmmucache_pc(void)
 void
 flushmmucache_nopc(void)
 {
+    mmu_stats.flushes++;
+
     for (uint16_t c = 0; c < 256; c++) {
         if (readlookup[c] != (int) 0xffffffff) {
             readlookup2[readlookup[c]] = LOOKUP_INV;
@@ -252,6 +282,114 @@ flushmmucache_nopc(void)
             writelookup[c]               = 0xffffffff;
         }
     }
+
+    fetch_page_2386 = 0xffffffff;
+    mmu_walk_page   = 0xffffffff;
+}
+
+/* Drops the lookup slots that do not have all of the keep bits. */
+static void
+flushmmucache_except(uint8_t keep)
+{
+    for (uint16_t c = 0; c < 256; c++) {
+        if (readlookup[c] != (int) 0xffffffff) {
+            if ((readlookup_keep[c] & keep) == keep)
+                mmu_stats.kept++;
+            else {
+                readlookup2[readlookup[c]] = LOOKUP_INV;
+                readlookup[c]              = 0xffffffff;
+            }
+        }
+        if (writelookup[c] != (int) 0xffffffff) {
+            if ((writelookup_keep[c] & keep) == keep)
+                mmu_stats.kept++;
+            else {
+                page_lookup[writelookup[c]]  = NULL;
+                writelookup2[writelookup[c]] = LOOKUP_INV;
+                writelookup[c]               = 0xffffffff;
+            }
+        }
+    }
+
+    fetch_page_2386 = 0xffffffff;
+    mmu_walk_page   = 0xffffffff;
+}
+
+/* CR3 load: global pages stay mapped when PGE is enabled. */
+void
+flushmmucache_cr3(void)
+{
+    if (!(cr0 >> 31) || !(cr4 & CR4_PGE)) {
+        flushmmucache();
+        return;
+    }
+
+    mmu_stats.cr3_flushes++;
+
+    flushmmucache_except(LOOKUP_KEEP_GLOBAL);
+    mmuflush++;
+
+    pccache  = (uint32_t) 0xffffffff;
+    pccache2 = (uint8_t *) 0xffffffff;
+
+#ifdef USE_DYNAREC
+    codegen_flush();
+#endif
+}
+
+/*
+   Switch to ring 3: the slots filled at a more privileged level bypass the
+   U/S and R/W checks, so only those ring 3 could have filled are kept.
+ */
+void
+flushmmucache_user(void)
+{
+    if (!(cr0 >> 31)) {
+        flushmmucache_nopc();
+        return;
+    }
+
+    mmu_stats.user_flushes++;
+
+    flushmmucache_except(LOOKUP_KEEP_USER);
+}
+
+/* INVLPG: only the page addr is in, or the large page when PSE or PAE is on. */
+void
+flushmmucache_page(uint32_t addr)
+{
+    const uint32_t mask = (cr4 & (CR4_PSE | CR4_PAE)) ? ~0x3ffU : ~0U;
+    const uint32_t page = addr >> 12;
+
+    mmu_stats.page_flushes++;
+
+    for (uint16_t c = 0; c < 256; c++) {
+        if ((readlookup[c] != (int) 0xffffffff) && !(((uint32_t) readlookup[c] ^ page) & mask)) {
+            readlookup2[readlookup[c]] = LOOKUP_INV;
+            readlookup[c]              = 0xffffffff;
+        }
+        if ((writelookup[c] != (int) 0xffffffff) && !(((uint32_t) writelookup[c] ^ page) & mask)) {
+            page_lookup[writelookup[c]]  = NULL;
+            writelookup2[writelookup[c]] = LOOKUP_INV;
+            writelookup[c]               = 0xffffffff;
+        }
+    }
+
+    if (!((pccache ^ page) & mask)) {
+        pccache  = (uint32_t) 0xffffffff;
+        pccache2 = (uint8_t *) 0xffffffff;
+    }
+    if (!((fetch_page_2386 ^ page) & mask))
+        fetch_page_2386 = 0xffffffff;
+
+    /* The PTE may have changed since, do not let the next fill reuse its bits. */
+    mmu_walk_page = 0xffffffff;
+}
+
+void
+mem_get_mmu_stats(mmu_stats_t *stats)
+{
+    *stats = mmu_stats;
 }
 
 void
@@ -276,6 +414,14 @@ mem_flush_write_page(uint32_t addr, uint32_t virt)
 #define rammap(x)                ((uint32_t *) (_mem_exec[(x) >> MEM_GRANULARITY_BITS]))[((x) >> 2) & MEM_GRANULARITY_QMASK]
 #define rammap64(x)              ((uint64_t *) (_mem_exec[(x) >> MEM_GRANULARITY_BITS]))[((x) >> 3) & MEM_GRANULARITY_PMASK]
 
+static __inline void
+mmu_note_walk(uint32_t addr, uint64_t entry, uint64_t prot)
+{
+    mmu_walk_page   = addr >> 12;
+    mmu_walk_global = (entry & 0x100) && (cr4 & CR4_PGE);
+    mmu_walk_prot   = prot & 6;
+}
+
 static __inline uint64_t
 mmutranslatereal_normal(uint32_t addr, int rw)
 {
@@ -317,6 +463,7 @@ mmutranslatereal_normal(uint32_t addr, int rw)
         }
 
         rammap(addr2) |= (rw ? 0x60 : 0x20);
+        mmu_note_walk(addr, temp, temp);
 
         uint64_t page = temp & ~0x3fffff;
         if (cpu_features & CPU_FEATURE_PSE36)
@@ -340,6 +487,7 @@ mmutranslatereal_normal(uint32_t addr, int rw)
 
     rammap(addr2) |= 0x20;
     rammap((temp2 & ~0xfff) + ((addr >> 10) & 0xffc)) |= (rw ? 0x60 : 0x20);
+    mmu_note_walk(addr, temp, temp3);
 
     return (uint64_t) ((temp & ~0xfff) + (addr & 0xfff));
 }
@@ -402,6 +550,7 @@ mmutranslatereal_pae(uint32_t addr, int rw)
             return 0xffffffffffffffffULL;
         }
         rammap64(addr3) |= (rw ? 0x60 : 0x20);
+        mmu_note_walk(addr, temp, temp);
 
         return ((temp & ~0x1fffffULL) + (addr & 0x1fffffULL)) & 0x000000ffffffffffULL;
     }
@@ -423,6 +572,7 @@ mmutranslatereal_pae(uint32_t addr, int rw)
 
     rammap64(addr3) |= 0x20;
     rammap64(addr4) |= (rw ? 0x60 : 0x20);
+    mmu_note_walk(addr, temp, temp3);
 
     return ((temp & ~0xfffULL) + ((uint64_t) (addr & 0xfff))) & 0x000000ffffffffffULL;
 }
@@ -434,6 +584,8 @@ mmutranslatereal(uint32_t addr, int rw)
     if (cpu_state.abrt)
         return 0xffffffffffffffffULL;
 
+    mmu_stats.walks++;
+
     if (cr4 & CR4_PAE)
         return mmutranslatereal_pae(addr, rw);
     else
@@ -473,6 +625,9 @@ mmutranslate_noabrt_normal(uint32_t addr, int rw)
         if (((CPL == 3) && !(temp & 4) && !cpl_override) || (rw && !cpl_override && !(temp & 2) && ((CPL == 3) || (cr0 & WP_FLAG))))
             return 0xffffffffffffffffULL;
 
+        /* The dynarec fills lookups from these walks too, see get_phys_noabrt(). */
+        mmu_note_walk(addr, temp, temp);
+
         uint64_t page = temp & ~0x3fffff;
         if (cpu_features & CPU_FEATURE_PSE36)
             page |= (uint64_t) (temp & 0x1e000) << 19;
@@ -485,6 +640,8 @@ mmutranslate_noabrt_normal(uint32_t addr, int rw)
     if (!(temp & 1) || ((CPL == 3) && !(temp3 & 4) && !cpl_override) || (rw && !cpl_override && !(temp3 & 2) && ((CPL == 3) || (cr0 & WP_FLAG))))
         return 0xffffffffffffffffULL;
 
+    mmu_note_walk(addr, temp, temp3);
+
     return (uint64_t) ((temp & ~0xfff) + (addr & 0xfff));
 }
 
@@ -520,6 +677,8 @@ mmutranslate_noabrt_pae(uint32_t addr, int rw)
         if (((CPL == 3) && !(temp & 4) && !cpl_override) || (rw && !cpl_override && !(temp & 2) && ((CPL == 3) || (cr0 & WP_FLAG))))
             return 0xffffffffffffffffULL;
 
+        mmu_note_walk(addr, temp, temp);
+
         return ((temp & ~0x1fffffULL) + (addr & 0x1fffff)) & 0x000000ffffffffffULL;
     }
 
@@ -531,6 +690,8 @@ mmutranslate_noabrt_pae(uint32_t addr, int rw)
     if (!(temp & 1) || ((CPL == 3) && !(temp3 & 4) && !cpl_override) || (rw && !cpl_override && !(temp3 & 2) && ((CPL == 3) || (cr0 & WP_FLAG))))
         return 0xffffffffffffffffULL;
 
+    mmu_note_walk(addr, temp, temp3);
+
     return ((temp & ~0xfffULL) + ((uint64_t) (addr & 0xfff))) & 0x000000ffffffffffULL;
 }
 
@@ -541,6 +702,8 @@ mmutranslate_noabrt(uint32_t addr, int rw)
     if (cpu_state.abrt)
         return 0xffffffffffffffffULL;
 
+    mmu_stats.walks++;
+
     if (cr4 & CR4_PAE)
         return mmutranslate_noabrt_pae(addr, rw);
     else
@@ -584,6 +747,11 @@ addreadlookup(uint32_t virt, uint32_t phys)
 
     readlookup2[virt >> 12] = (uintptr_t) &ram[(uintptr_t) (phys & ~0xFFF) - (uintptr_t) (virt & ~0xfff)];
 
+    readlookup_keep[readlnext] = 0;
+    if ((virt >> 12) == mmu_walk_page)
+        readlookup_keep[readlnext] = (mmu_walk_global ? LOOKUP_KEEP_GLOBAL : 0) |
+                                     ((mmu_walk_prot & 4) ? LOOKUP_KEEP_USER : 0);
+
     readlookup[readlnext++] = virt >> 12;
     readlnext &= (cachesize - 1);
 #endif
@@ -629,6 +797,11 @@ addwritelookup(uint32_t virt, uint32_t phys)
         writelookup2[virt >> 12] = (uintptr_t) &ram[(uintptr_t) (phys & ~0xFFF) - (uintptr_t) (virt & ~0xfff)];
     }
 
+    writelookup_keep[writelnext] = 0;
+    if ((virt >> 12) == mmu_walk_page)
+        writelookup_keep[writelnext] = (mmu_walk_global ? LOOKUP_KEEP_GLOBAL : 0) |
+                                       ((mmu_walk_prot == 6) ? LOOKUP_KEEP_USER : 0);
+
     writelookup[writelnext++] = virt >> 12;
     writelnext &= (cachesize - 1);
 #endif
@@ -681,7 +854,7 @@ read_mem_b(uint32_t addr)
 
     map = read_mapping[addr >> MEM_GRANULARITY_BITS];
     if (map && map->read_b)
-        ret = map->read_b(addr, map->priv);
+        ret = mem_mapping_read_b(map, addr);
 
     return ret;
 }
@@ -701,9 +874,9 @@ read_mem_w(uint32_t addr)
         map = read_mapping[addr >> MEM_GRANULARITY_BITS];
 
         if (map && map->read_w)
-            ret = map->read_w(addr, map->priv);
+            ret = mem_mapping_read_w(map, addr);
         else if (map && map->read_b)
-            ret = map->read_b(addr, map->priv) | (map->read_b(addr + 1, map->priv) << 8);
+            ret = mem_mapping_read_b(map, addr) | (mem_mapping_read_b(map, addr + 1) << 8);
     }
 
     return ret;
@@ -719,7 +892,7 @@ write_mem_b(uint32_t addr, uint8_t val)
 
     map = write_mapping[addr >> MEM_GRANULARITY_BITS];
     if (map && map->write_b)
-        map->write_b(addr, val, map->priv);
+        mem_mapping_write_b(map, addr, val);
 }
 
 void
@@ -737,10 +910,10 @@ write_mem_w(uint32_t addr, uint16_t val)
         map = write_mapping[addr >> MEM_GRANULARITY_BITS];
         if (map) {
             if (map->write_w)
-                map->write_w(addr, val, map->priv);
+                mem_mapping_write_w(map, addr, val);
             else if (map->write_b) {
-                map->write_b(addr, val, map->priv);
-                map->write_b(addr + 1, val >> 8, map->priv);
+                mem_mapping_write_b(map, addr, val);
+                mem_mapping_write_b(map, addr + 1, val >> 8);
             }
         }
     }
@@ -773,7 +946,7 @@ readmembl(uint32_t addr)
 
     map = read_mapping[addr >> MEM_GRANULARITY_BITS];
     if (map && map->read_b)
-        return map->read_b(addr, map->priv);
+        return mem_mapping_read_b(map, addr);
 
     return 0xff;
 }
@@ -810,7 +983,7 @@ writemembl(uint32_t addr, uint8_t val)
 
     map = write_mapping[addr >> MEM_GRANULARITY_BITS];
     if (map && map->write_b)
-        map->write_b(addr, val, map->priv);
+        mem_mapping_write_b(map, addr, val);
 }
 
 /* Read a byte from memory without MMU translation - result of previous MMU translation passed as value. */
@@ -833,7 +1006,7 @@ readmembl_no_mmut(uint32_t addr, uint32_t a64)
 
     map = read_mapping[addr >> MEM_GRANULARITY_BITS];
     if (map && map->read_b)
-        return map->read_b(addr, map->priv);
+        return mem_mapping_read_b(map, addr);
 
     return 0xff;
 }
@@ -863,7 +1036,7 @@ writemembl_no_mmut(uint32_t addr, uint32_t a64, uint8_t val)
 
     map = write_mapping[addr >> MEM_GRANULARITY_BITS];
     if (map && map->write_b)
-        map->write_b(addr, val, map->priv);
+        mem_mapping_write_b(map, addr, val);
 }
 
 uint16_t
@@ -917,10 +1090,10 @@ readmemwl(uint32_t addr)
     map = read_mapping[addr >> MEM_GRANULARITY_BITS];
 
     if (map && map->read_w)
-        return map->read_w(addr, map->priv);
+        return mem_mapping_read_w(map, addr);
 
     if (map && map->read_b) {
-        return map->read_b(addr, map->priv) | ((uint16_t) (map->read_b(addr + 1, map->priv)) << 8);
+        return mem_mapping_read_b(map, addr) | ((uint16_t) (mem_mapping_read_b(map, addr + 1)) << 8);
     }
 
     return 0xffff;
@@ -991,13 +1164,13 @@ writememwl(uint32_t addr, uint16_t val)
     map = write_mapping[addr >> MEM_GRANULARITY_BITS];
 
     if (map && map->write_w) {
-        map->write_w(addr, val, map->priv);
+        mem_mapping_write_w(map, addr, val);
         return;
     }
 
     if (map && map->write_b) {
-        map->write_b(addr, val, map->priv);
-        map->write_b(addr + 1, val >> 8, map->priv);
+        mem_mapping_write_b(map, addr, val);
+        mem_mapping_write_b(map, addr + 1, val >> 8);
         return;
     }
 }
@@ -1037,10 +1210,10 @@ readmemwl_no_mmut(uint32_t addr, uint32_t *a64)
     map = read_mapping[addr >> MEM_GRANULARITY_BITS];
 
     if (map && map->read_w)
-        return map->read_w(addr, map->priv);
+        return mem_mapping_read_w(map, addr);
 
     if (map && map->read_b) {
-        return map->read_b(addr, map->priv) | ((uint16_t) (map->read_b(addr + 1, map->priv)) << 8);
+        return mem_mapping_read_b(map, addr) | ((uint16_t) (mem_mapping_read_b(map, addr + 1)) << 8);
     }
 
     return 0xffff;
@@ -1090,13 +1263,13 @@ writememwl_no_mmut(uint32_t addr, uint32_t *a64, uint16_t val)
     map = write_mapping[addr >> MEM_GRANULARITY_BITS];
 
     if (map && map->write_w) {
-        map->write_w(addr, val, map->priv);
+        mem_mapping_write_w(map, addr, val);
         return;
     }
 
     if (map && map->write_b) {
-        map->write_b(addr, val, map->priv);
-        map->write_b(addr + 1, val >> 8, map->priv);
+        mem_mapping_write_b(map, addr, val);
+        mem_mapping_write_b(map, addr + 1, val >> 8);
         return;
     }
 }
@@ -1166,13 +1339,13 @@ readmemll(uint32_t addr)
     map = read_mapping[addr >> MEM_GRANULARITY_BITS];
 
     if (map && map->read_l)
-        return map->read_l(addr, map->priv);
+        return mem_mapping_read_l(map, addr);
 
     if (map && map->read_w)
-        return map->read_w(addr, map->priv) | ((uint32_t) (map->read_w(addr + 2, map->priv)) << 16);
+        return mem_mapping_read_w(map, addr) | ((uint32_t) (mem_mapping_read_w(map, addr + 2)) << 16);
 
     if (map && map->read_b)
-        return map->read_b(addr, map->priv) | ((uint32_t) (map->read_b(addr + 1, map->priv)) << 8) | ((uint32_t) (map->read_b(addr + 2, map->priv)) << 16) | ((uint32_t) (map->read_b(addr + 3, map->priv)) << 24);
+        return mem_mapping_read_b(map, addr) | ((uint32_t) (mem_mapping_read_b(map, addr + 1)) << 8) | ((uint32_t) (mem_mapping_read_b(map, addr + 2)) << 16) | ((uint32_t) (mem_mapping_read_b(map, addr + 3)) << 24);
 
     return 0xffffffff;
 }
@@ -1255,19 +1428,19 @@ writememll(uint32_t addr, uint32_t val)
     map = write_mapping[addr >> MEM_GRANULARITY_BITS];
 
     if (map && map->write_l) {
-        map->write_l(addr, val, map->priv);
+        mem_mapping_write_l(map, addr, val);
         return;
     }
     if (map && map->write_w) {
-        map->write_w(addr, val, map->priv);
-        map->write_w(addr + 2, val >> 16, map->priv);
+        mem_mapping_write_w(map, addr, val);
+        mem_mapping_write_w(map, addr + 2, val >> 16);
         return;
     }
     if (map && map->write_b) {
-        map->write_b(addr, val, map->priv);
-        map->write_b(addr + 1, val >> 8, map->priv);
-        map->write_b(addr + 2, val >> 16, map->priv);
-        map->write_b(addr + 3, val >> 24, map->priv);
+        mem_mapping_write_b(map, addr, val);
+        mem_mapping_write_b(map, addr + 1, val >> 8);
+        mem_mapping_write_b(map, addr + 2, val >> 16);
+        mem_mapping_write_b(map, addr + 3, val >> 24);
         return;
     }
 }
@@ -1307,13 +1480,13 @@ readmemll_no_mmut(uint32_t addr, uint32_t *a64)
     map = read_mapping[addr >> MEM_GRANULARITY_BITS];
 
     if (map && map->read_l)
-        return map->read_l(addr, map->priv);
+        return mem_mapping_read_l(map, addr);
 
     if (map && map->read_w)
-        return map->read_w(addr, map->priv) | ((uint32_t) (map->read_w(addr + 2, map->priv)) << 16);
+        return mem_mapping_read_w(map, addr) | ((uint32_t) (mem_mapping_read_w(map, addr + 2)) << 16);
 
     if (map && map->read_b)
-        return map->read_b(addr, map->priv) | ((uint32_t) (map->read_b(addr + 1, map->priv)) << 8) | ((uint32_t) (map->read_b(addr + 2, map->priv)) << 16) | ((uint32_t) (map->read_b(addr + 3, map->priv)) << 24);
+        return mem_mapping_read_b(map, addr) | ((uint32_t) (mem_mapping_read_b(map, addr + 1)) << 8) | ((uint32_t) (mem_mapping_read_b(map, addr + 2)) << 16) | ((uint32_t) (mem_mapping_read_b(map, addr + 3)) << 24);
 
     return 0xffffffff;
 }
@@ -1362,19 +1535,19 @@ writememll_no_mmut(uint32_t addr, uint32_t *a64, uint32_t val)
     map = write_mapping[addr >> MEM_GRANULARITY_BITS];
 
     if (map && map->write_l) {
-        map->write_l(addr, val, map->priv);
+        mem_mapping_write_l(map, addr, val);
         return;
     }
     if (map && map->write_w) {
-        map->write_w(addr, val, map->priv);
-        map->write_w(addr + 2, val >> 16, map->priv);
+        mem_mapping_write_w(map, addr, val);
+        mem_mapping_write_w(map, addr + 2, val >> 16);
         return;
     }
     if (map && map->write_b) {
-        map->write_b(addr, val, map->priv);
-        map->write_b(addr + 1, val >> 8, map->priv);
-        map->write_b(addr + 2, val >> 16, map->priv);
-        map->write_b(addr + 3, val >> 24, map->priv);
+        mem_mapping_write_b(map, addr, val);
+        mem_mapping_write_b(map, addr + 1, val >> 8);
+        mem_mapping_write_b(map, addr + 2, val >> 16);
+        mem_mapping_write_b(map, addr + 3, val >> 24);
         return;
     }
 }
@@ -1443,24 +1616,24 @@ readmemql(uint32_t addr)
     map = read_mapping[addr >> MEM_GRANULARITY_BITS];
 
     if (map && map->read_l)
-        return map->read_l(addr, map->priv) |
-               ((uint64_t) map->read_l(addr + 4, map->priv) << 32);
+        return mem_mapping_read_l(map, addr) |
+               ((uint64_t) mem_mapping_read_l(map, addr + 4) << 32);
 
     if (map && map->read_w)
-        return map->read_w(addr, map->priv) |
-               ((uint64_t) map->read_w(addr + 2, map->priv) << 16) |
-               ((uint64_t) map->read_w(addr + 4, map->priv) << 32) |
-               ((uint64_t) map->read_w(addr + 6, map->priv) << 48);
+        return mem_mapping_read_w(map, addr) |
+               ((uint64_t) mem_mapping_read_w(map, addr + 2) << 16) |
+               ((uint64_t) mem_mapping_read_w(map, addr + 4) << 32) |
+               ((uint64_t) mem_mapping_read_w(map, addr + 6) << 48);
 
     if (map && map->read_b)
-        return map->read_b(addr, map->priv) |
-               ((uint64_t) map->read_b(addr + 1, map->priv) << 8) |
-               ((uint64_t) map->read_b(addr + 2, map->priv) << 16) |
-               ((uint64_t) map->read_b(addr + 3, map->priv) << 24) |
-               ((uint64_t) map->read_b(addr + 4, map->priv) << 32) |
-               ((uint64_t) map->read_b(addr + 5, map->priv) << 40) |
-               ((uint64_t) map->read_b(addr + 6, map->priv) << 48) |
-               ((uint64_t) map->read_b(addr + 7, map->priv) << 56);
+        return mem_mapping_read_b(map, addr) |
+               ((uint64_t) mem_mapping_read_b(map, addr + 1) << 8) |
+               ((uint64_t) mem_mapping_read_b(map, addr + 2) << 16) |
+               ((uint64_t) mem_mapping_read_b(map, addr + 3) << 24) |
+               ((uint64_t) mem_mapping_read_b(map, addr + 4) << 32) |
+               ((uint64_t) mem_mapping_read_b(map, addr + 5) << 40) |
+               ((uint64_t) mem_mapping_read_b(map, addr + 6) << 48) |
+               ((uint64_t) mem_mapping_read_b(map, addr + 7) << 56);
 
     return 0xffffffffffffffffULL;
 }
@@ -1541,26 +1714,26 @@ writememql(uint32_t addr, uint64_t val)
     map = write_mapping[addr >> MEM_GRANULARITY_BITS];
 
     if (map && map->write_l) {
-        map->write_l(addr, val, map->priv);
-        map->write_l(addr + 4, val >> 32, map->priv);
+        mem_mapping_write_l(map, addr, val);
+        mem_mapping_write_l(map, addr + 4, val >> 32);
         return;
     }
     if (map && map->write_w) {
-        map->write_w(addr, val, map->priv);
-        map->write_w(addr + 2, val >> 16, map->priv);
-        map->write_w(addr + 4, val >> 32, map->priv);
-        map->write_w(addr + 6, val >> 48, map->priv);
+        mem_mapping_write_w(map, addr, val);
+        mem_mapping_write_w(map, addr + 2, val >> 16);
+        mem_mapping_write_w(map, addr + 4, val >> 32);
+        mem_mapping_write_w(map, addr + 6, val >> 48);
         return;
     }
     if (map && map->write_b) {
-        map->write_b(addr, val, map->priv);
-        map->write_b(addr + 1, val >> 8, map->priv);
-        map->write_b(addr + 2, val >> 16, map->priv);
-        map->write_b(addr + 3, val >> 24, map->priv);
-        map->write_b(addr + 4, val >> 32, map->priv);
-        map->write_b(addr + 5, val >> 40, map->priv);
-        map->write_b(addr + 6, val >> 48, map->priv);
-        map->write_b(addr + 7, val >> 56, map->priv);
+        mem_mapping_write_b(map, addr, val);
+        mem_mapping_write_b(map, addr + 1, val >> 8);
+        mem_mapping_write_b(map, addr + 2, val >> 16);
+        mem_mapping_write_b(map, addr + 3, val >> 24);
+        mem_mapping_write_b(map, addr + 4, val >> 32);
+        mem_mapping_write_b(map, addr + 5, val >> 40);
+        mem_mapping_write_b(map, addr + 6, val >> 48);
+        mem_mapping_write_b(map, addr + 7, val >> 56);
         return;
     }
 }
@@ -1626,7 +1799,7 @@ mem_readb_phys(uint32_t addr)
         if (cpu_use_exec && map->exec)
             ret = map->exec[(addr - map->base) & map->mask];
         else if (map->read_b)
-            ret = map->read_b(addr, map->priv);
+            ret = mem_mapping_read_b(map, addr);
     }
 
     return ret;
@@ -1645,7 +1818,7 @@ mem_readw_phys(uint32_t addr)
         p   = (uint16_t *) &(map->exec[(addr - map->base) & map->mask]);
         ret = *p;
     } else if (((addr & MEM_GRANULARITY_MASK) <= MEM_GRANULARITY_HBOUND) && (map && map->read_w))
-        ret = map->read_w(addr, map->priv);
+        ret = mem_mapping_read_w(map, addr);
     else {
         ret = mem_readb_phys(addr + 1) << 8;
         ret |= mem_readb_phys(addr);
@@ -1667,7 +1840,7 @@ mem_readl_phys(uint32_t addr)
         p   = (uint32_t *) &(map->exec[(addr - map->base) & map->mask]);
         ret = *p;
     } else if (((addr & MEM_GRANULARITY_MASK) <= MEM_GRANULARITY_QBOUND) && (map && map->read_l))
-        ret = map->read_l(addr, map->priv);
+        ret = mem_mapping_read_l(map, addr);
     else {
         ret = mem_readw_phys(addr + 2) << 16;
         ret |= mem_readw_phys(addr);
@@ -1706,7 +1879,7 @@ mem_writeb_phys(uint32_t addr, uint8_t val)
         if (cpu_use_exec && map->exec)
             map->exec[(addr - map->base) & map->mask] = val;
         else if (map->write_b)
-            map->write_b(addr, val, map->priv);
+            mem_mapping_write_b(map, addr, val);
     }
 }
 
@@ -1722,7 +1895,7 @@ mem_writew_phys(uint32_t addr, uint16_t val)
         p  = (uint16_t *) &(map->exec[(addr - map->base) & map->mask]);
         *p = val;
     } else if (((addr & MEM_GRANULARITY_MASK) <= MEM_GRANULARITY_HBOUND) && (map && map->write_w))
-        map->write_w(addr, val, map->priv);
+        mem_mapping_write_w(map, addr, val);
     else {
         mem_writeb_phys(addr, val & 0xff);
         mem_writeb_phys(addr + 1, (val >> 8) & 0xff);
@@ -1741,7 +1914,7 @@ mem_writel_phys(uint32_t addr, uint32_t val)
         p  = (uint32_t *) &(map->exec[(addr - map->base) & map->mask]);
         *p = val;
     } else if (((addr & MEM_GRANULARITY_MASK) <= MEM_GRANULARITY_QBOUND) && (map && map->write_l))
-        map->write_l(addr, val, map->priv);
+        mem_mapping_write_l(map, addr, val);
     else {
         mem_writew_phys(addr, val & 0xffff);
         mem_writew_phys(addr + 2, (val >> 16) & 0xffff);
@@ -1992,6 +2165,59 @@ mem_write_raml_page(uint32_t addr, uint32_t val, page_t *page)
 }
 #endif
 
+/* Marks len bytes at addr, all within one page, as written after the CPU
+   stored them straight into page->mem, like mem_write_ram*_page() do for
+   single values. Used by the bulk REP string operations. */
+void
+mem_dirty_ram_range_page(uint32_t addr, uint32_t len, page_t *page)
+{
+    uint32_t a   = addr & 0xfff;
+    uint32_t end = a + len;
+
+    if ((page == NULL) || (page->mem == NULL) || (page->mem == page_ff))
+        return;
+
+#ifdef USE_NEW_DYNAREC
+    int evict = 0;
+
+    while (a < end) {
+        const int      offset    = (a >> PAGE_BYTE_MASK_SHIFT) & PAGE_BYTE_MASK_OFFSET_MASK;
+        const uint32_t next      = (a | PAGE_BYTE_MASK_MASK) + 1;
+        const uint32_t bytes     = ((next < end) ? next : end) - a;
+        const uint64_t mask      = (uint64_t) 1 << ((a >> PAGE_MASK_SHIFT) & PAGE_MASK_MASK);
+        const uint64_t byte_mask = ((bytes == 64) ? 0xffffffffffffffffULL : (((uint64_t) 1 << bytes) - 1)) <<
+                                   (a & PAGE_BYTE_MASK_MASK);
+
+        page->dirty_mask |= mask;
+        page->byte_dirty_mask[offset] |= byte_mask;
+        if ((page->code_present_mask & mask) || (page->byte_code_present_mask[offset] & byte_mask))
+            evict = 1;
+
+        a += bytes;
+    }
+
+    if (evict && !page_in_evict_list(page))
+        page_add_to_evict_list(page);
+#else
+    while (a < end) {
+        page->dirty_mask[(a >> PAGE_MASK_INDEX_SHIFT) & PAGE_MASK_INDEX_MASK] |=
+            (uint64_t) 1 << ((a >> PAGE_MASK_SHIFT) & PAGE_MASK_MASK);
+        a = (a | ((1 << PAGE_MASK_SHIFT) - 1)) + 1;
+    }
+#endif
+}
+
+/* Host pointer to addr in a RAM page reached through page_lookup[], or NULL
+   when the page is not plain RAM. */
+uint8_t *
+mem_ram_page_ptr(uint32_t addr, page_t *page)
+{
+    if ((page == NULL) || (page->write_b != mem_write_ramb_page) || (page->mem == NULL) || (page->mem == page_ff))
+        return NULL;
+
+    return &page->mem[addr & 0xfff];
+}
+
 void
 mem_write_ram(uint32_t addr, uint8_t val, UNUSED(void *priv))
 {
@@ -2235,8 +2461,210 @@ mem_mapping_access_allowed(uint32_t flags, uint16_t access)
     return ret;
 }
 
-void
-mem_mapping_recalc(uint64_t base, uint64_t size, uint32_t base_ignore)
+/*
+   Mappings sorted by base, so that a recalc only has to look at the ones
+   overlapping its range instead of walking the whole list. max_end is the
+   highest end of this and all preceding entries, which keeps the lower
+   bound of an overlap search a binary search as well.
+ */
+typedef struct mem_mapping_range_t {
+    mem_mapping_t *map;
+    uint64_t       base;
+    uint64_t       end;
+    uint64_t       max_end;
+    uint32_t       prio; /* Position in the mapping list, later entries win. */
+} mem_mapping_range_t;
+
+static mem_mapping_range_t *mapping_ranges;
+static mem_mapping_range_t *mapping_cands;
+static int                  mapping_ranges_num;
+static int                  mapping_ranges_size;
+static int                  mapping_ranges_dirty = 1;
+static int                  mapping_ranges_aliased;
+
+static int
+mem_mapping_range_cmp_base(const void *a, const void *b)
+{
+    const mem_mapping_range_t *ra = (const mem_mapping_range_t *) a;
+    const mem_mapping_range_t *rb = (const mem_mapping_range_t *) b;
+
+    if (ra->base != rb->base)
+        return (ra->base < rb->base) ? -1 : 1;
+
+    return (ra->prio < rb->prio) ? -1 : (ra->prio > rb->prio);
+}
+
+static int
+mem_mapping_range_cmp_prio(const void *a, const void *b)
+{
+    const mem_mapping_range_t *ra = (const mem_mapping_range_t *) a;
+    const mem_mapping_range_t *rb = (const mem_mapping_range_t *) b;
+
+    /* Highest priority first. */
+    return (ra->prio < rb->prio) ? 1 : -(ra->prio > rb->prio);
+}
+
+static void
+mem_mapping_ranges_rebuild(void)
+{
+    mem_mapping_t *map;
+    uint64_t       max_end = 0;
+    uint32_t       prio    = 0;
+
+    mapping_ranges_num     = 0;
+    mapping_ranges_aliased = 0;
+
+    for (map = base_mapping; map != NULL; map = map->next) {
+        if (mapping_ranges_num == mapping_ranges_size) {
+            mapping_ranges_size = mapping_ranges_size ? (mapping_ranges_size << 1) : 256;
+            mapping_ranges      = realloc(mapping_ranges, mapping_ranges_size * sizeof(mem_mapping_range_t));
+            mapping_cands       = realloc(mapping_cands, mapping_ranges_size * sizeof(mem_mapping_range_t));
+            if ((mapping_ranges == NULL) || (mapping_cands == NULL))
+                fatal("mem_mapping_ranges_rebuild(): Out of memory\n");
+        }
+
+        mapping_ranges[mapping_ranges_num].map  = map;
+        mapping_ranges[mapping_ranges_num].base = map->base;
+        mapping_ranges[mapping_ranges_num].end  = (uint64_t) map->base + (uint64_t) map->size;
+        mapping_ranges[mapping_ranges_num].prio = prio++;
+        mapping_ranges_num++;
+
+        if (map->base_ignore)
+            mapping_ranges_aliased = 1;
+    }
+
+    qsort(mapping_ranges, mapping_ranges_num, sizeof(mem_mapping_range_t), mem_mapping_range_cmp_base);
+
+    for (int i = 0; i < mapping_ranges_num; i++) {
+        if (mapping_ranges[i].end > max_end)
+            max_end = mapping_ranges[i].end;
+        mapping_ranges[i].max_end = max_end;
+    }
+
+    mapping_ranges_dirty = 0;
+}
+
+/* Enabled mappings overlapping [base, end), highest priority first. */
+static int
+mem_mapping_ranges_find(uint64_t base, uint64_t end)
+{
+    int lo = 0;
+    int hi = mapping_ranges_num;
+    int first;
+    int num = 0;
+
+    /* First entry that can reach into the range. */
+    while (lo < hi) {
+        int mid = (lo + hi) >> 1;
+        if (mapping_ranges[mid].max_end > base)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    first = lo;
+
+    /* First entry starting past the range. */
+    hi = mapping_ranges_num;
+    while (lo < hi) {
+        int mid = (lo + hi) >> 1;
+        if (mapping_ranges[mid].base < end)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    for (int i = first; i < lo; i++) {
+        if (mapping_ranges[i].map->enable && (mapping_ranges[i].end > base))
+            mapping_cands[num++] = mapping_ranges[i];
+    }
+
+    if (num > 1)
+        qsort(mapping_cands, num, sizeof(mem_mapping_range_t), mem_mapping_range_cmp_prio);
+
+    return num;
+}
+
+/*
+   Recalculates the granules in the range without aliasing. Each granule is
+   given to the highest priority mapping that allows the access, which is
+   what the list walk in mem_mapping_recalc_aliased() ends up with, but
+   without visiting the mappings that cannot win it. Only granules whose
+   executable memory changed are invalidated for the dynarec.
+ */
+static void
+mem_mapping_recalc_ranges(uint64_t base, uint64_t size)
+{
+    const mem_mapping_t *map;
+    const mem_state_t   *state;
+    uint64_t             c;
+    uint64_t             end = base + size;
+    int                  num;
+    int                  n = !!in_smm;
+
+    num = mem_mapping_ranges_find(base, end);
+
+    for (c = base & ~((uint64_t) MEM_GRANULARITY_MASK); c < end; c += MEM_GRANULARITY_SIZE) {
+        uint32_t       g        = c >> MEM_GRANULARITY_BITS;
+        uint64_t       g_start  = c;
+        uint8_t       *exec     = NULL;
+        mem_mapping_t *read     = NULL;
+        mem_mapping_t *write    = NULL;
+        mem_mapping_t *read_b   = NULL;
+        mem_mapping_t *write_b  = NULL;
+        int            write_ok = !_mem_wp[g];
+        int            bus_ok   = !_mem_wp_bus[g];
+
+        state = &_mem_state[g];
+
+        for (int i = 0; i < num; i++) {
+            uint64_t start = mapping_cands[i].base;
+            uint64_t m_end = (mapping_cands[i].end < end) ? mapping_cands[i].end : end;
+            uint64_t mc;
+
+            /* Same address the list walk would have used for this granule. */
+            if (g_start <= start)
+                mc = start;
+            else
+                mc = start + ((g_start - start + MEM_GRANULARITY_MASK) & ~((uint64_t) MEM_GRANULARITY_MASK));
+
+            if (((mc >> MEM_GRANULARITY_BITS) != g) || (mc >= m_end))
+                continue;
+
+            map = mapping_cands[i].map;
+
+            if (!exec && map->exec && mem_mapping_access_allowed(map->flags, state->states[n].x))
+                exec = map->exec + (mc - map->base);
+            if (map->write_b || map->write_w || map->write_l) {
+                if (write_ok && !write && mem_mapping_access_allowed(map->flags, state->states[n].w))
+                    write = (mem_mapping_t *) map;
+                if (bus_ok && !write_b && mem_mapping_access_allowed(map->flags, state->states[n | STATE_BUS].w))
+                    write_b = (mem_mapping_t *) map;
+            }
+            if (map->read_b || map->read_w || map->read_l) {
+                if (!read && mem_mapping_access_allowed(map->flags, state->states[n].r))
+                    read = (mem_mapping_t *) map;
+                if (!read_b && mem_mapping_access_allowed(map->flags, state->states[n | STATE_BUS].r))
+                    read_b = (mem_mapping_t *) map;
+            }
+
+            if (exec && read && read_b && (write || !write_ok) && (write_b || !bus_ok))
+                break;
+        }
+
+        /* Code translated from what was executable here before is stale now. */
+        if (_mem_exec[g] && (_mem_exec[g] != exec))
+            mem_invalidate_range(g_start, g_start + MEM_GRANULARITY_MASK);
+
+        _mem_exec[g]         = exec;
+        read_mapping[g]      = read;
+        write_mapping[g]     = write;
+        read_mapping_bus[g]  = read_b;
+        write_mapping_bus[g] = write_b;
+    }
+}
+
+static void
+mem_mapping_recalc_aliased(uint64_t base, uint64_t size, uint32_t base_ignore)
 {
     mem_mapping_t *map;
     int            n;
@@ -2246,9 +2674,6 @@ mem_mapping_recalc(uint64_t base, uint64_t size, uint32_t base_ignore)
                            (is6117 ? 0x03ffffffULL : 0x00ffffffULL) :
                            0xffffffffULL);
 
-    if (!size || (base_mapping == NULL))
-        return;
-
     map = base_mapping;
 
     /* Clear out old mappings. */
@@ -2357,6 +2782,25 @@ mem_mapping_recalc(uint64_t base, uint64_t size, uint32_t base_ignore)
         }
         map = map->next;
     }
+}
+
+void
+mem_mapping_recalc(uint64_t base, uint64_t size, uint32_t base_ignore)
+{
+#ifdef ENABLE_MEM_LOG
+    uint64_t c;
+#endif
+
+    if (!size || (base_mapping == NULL))
+        return;
+
+    if (mapping_ranges_dirty)
+        mem_mapping_ranges_rebuild();
+
+    if (base_ignore || mapping_ranges_aliased)
+        mem_mapping_recalc_aliased(base, size, base_ignore);
+    else
+        mem_mapping_recalc_ranges(base, size);
 
     flushmmucache_nopc();
 
@@ -2457,8 +2901,11 @@ mem_mapping_set(mem_mapping_t *map,
     map->exec    = exec;
     map->flags   = fl;
     map->priv    = priv;
+    map->prof    = device_prof_slot();
     map->next    = NULL;
 
+    mapping_ranges_dirty = 1;
+
     /*
        The ALi M6117 puts the RAM directly onto the internal 32-bit
        address bus but the external address bus is still 24-bit.
@@ -2569,6 +3016,8 @@ mem_mapping_set_addr(mem_mapping_t *map, uint32_t base, uint32_t size)
     map->base   = base;
     map->size   = size;
 
+    mapping_ranges_dirty = 1;
+
     mem_mapping_recalc(map->base, map->size, map->base_ignore);
 }
 
@@ -2583,6 +3032,8 @@ mem_mapping_set_base_ignore(mem_mapping_t *map, uint32_t base_ignore)
     map->enable      = 1;
     map->base_ignore = base_ignore;
 
+    mapping_ranges_dirty = 1;
+
     mem_mapping_recalc(map->base, map->size, map->base_ignore);
 }
 
@@ -2704,6 +3155,7 @@ mem_close(void)
     }
 
     base_mapping = last_mapping = 0;
+    mapping_ranges_dirty = 1;
 }
 
 static void
@@ -2839,6 +3291,7 @@ mem_reset(void)
     memset(read_mapping_bus, 0x00, sizeof(read_mapping_bus));
 
     base_mapping = last_mapping = NULL;
+    mapping_ranges_dirty = 1;
 
     /* Set the entire memory space as external. */
     memset(_mem_state, 0x00, sizeof(_mem_state));
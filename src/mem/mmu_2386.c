@@ -42,6 +42,16 @@
 /* As below, 1 = exec, 4 = read. */
 int    read_type = 4;
 
+/*
+   Last linear page instructions were fetched from, when it is plain RAM.
+   Only the translation is kept, the bytes are read from RAM each time, so
+   code writes need no invalidation; paging, mapping and A20 changes go
+   through the flushmmucache*() functions, which reset it.
+ */
+uint32_t fetch_page_2386 = 0xffffffff;
+int      fetch_user_2386;
+uint8_t *fetch_mem_2386;
+
 /* Set trap for data address breakpoints - 1 = exec, 2 = write, 4 = read. */
 void
 mem_debug_check_addr(uint32_t addr, int flags)
@@ -77,6 +87,32 @@ mem_debug_check_addr(uint32_t addr, int flags)
     }
 }
 
+/* Called after a successful readmemll_2386() instruction fetch at addr. */
+void
+fetch_fill_2386(uint32_t addr)
+{
+    const mem_mapping_t *map;
+    uint32_t             phys = addr64a[0] & rammask;
+
+    fetch_page_2386 = 0xffffffff;
+
+    if (!cpu_fetch_cache || cpu_state.abrt || cpu_old_paging || (dr[7] & 0x000000ff))
+        return;
+
+#ifdef USE_GDBSTUB
+    if (gdbstub_watch_pages[(addr >> MEM_GRANULARITY_BITS) >> 6] & (1ULL << ((addr >> MEM_GRANULARITY_BITS) & 63)))
+        return;
+#endif
+
+    map = read_mapping[phys >> MEM_GRANULARITY_BITS];
+    if ((map == NULL) || (map->read_l != mem_read_raml))
+        return;
+
+    fetch_page_2386 = addr >> 12;
+    fetch_user_2386 = (CPL == 3);
+    fetch_mem_2386  = &ram[phys & ~0xfff];
+}
+
 uint8_t
 mem_readb_map(uint32_t addr)
 {
@@ -86,7 +122,7 @@ mem_readb_map(uint32_t addr)
     mem_logical_addr = 0xffffffff;
 
     if (map && map->read_b)
-        ret = map->read_b(addr, map->priv);
+        ret = mem_mapping_read_b(map, addr);
 
     return ret;
 }
@@ -100,7 +136,7 @@ mem_readw_map(uint32_t addr)
     mem_logical_addr = 0xffffffff;
 
     if (((addr & MEM_GRANULARITY_MASK) <= MEM_GRANULARITY_HBOUND) && (map && map->read_w))
-        ret = map->read_w(addr, map->priv);
+        ret = mem_mapping_read_w(map, addr);
     else {
         ret = mem_readb_map(addr);
         ret |= ((uint16_t) mem_readb_map(addr + 1)) << 8;
@@ -118,7 +154,7 @@ mem_readl_map(uint32_t addr)
     mem_logical_addr = 0xffffffff;
 
     if (!cpu_16bitbus && ((addr & MEM_GRANULARITY_MASK) <= MEM_GRANULARITY_QBOUND) && (map && map->read_l))
-        ret = map->read_l(addr, map->priv);
+        ret = mem_mapping_read_l(map, addr);
     else {
         ret = mem_readw_map(addr);
         ret |= ((uint32_t) mem_readw_map(addr + 2)) << 16;
@@ -135,7 +171,7 @@ mem_writeb_map(uint32_t addr, uint8_t val)
     mem_logical_addr = 0xffffffff;
 
     if (map && map->write_b)
-        map->write_b(addr, val, map->priv);
+        mem_mapping_write_b(map, addr, val);
 }
 
 void
@@ -146,7 +182,7 @@ mem_writew_map(uint32_t addr, uint16_t val)
     mem_logical_addr = 0xffffffff;
 
     if (((addr & MEM_GRANULARITY_MASK) <= MEM_GRANULARITY_HBOUND) && (map && map->write_w))
-        map->write_w(addr, val, map->priv);
+        mem_mapping_write_w(map, addr, val);
     else {
         mem_writeb_map(addr, val & 0xff);
         mem_writeb_map(addr + 1, val >> 8);
@@ -161,7 +197,7 @@ mem_writel_map(uint32_t addr, uint32_t val)
     mem_logical_addr = 0xffffffff;
 
     if (!cpu_16bitbus && ((addr & MEM_GRANULARITY_MASK) <= MEM_GRANULARITY_QBOUND) && (map && map->write_l))
-        map->write_l(addr, val, map->priv);
+        mem_mapping_write_l(map, addr, val);
     else {
         mem_writew_map(addr, val & 0xffff);
         mem_writew_map(addr + 2, val >> 16);
@@ -182,6 +218,8 @@ mmutranslatereal_2386(uint32_t addr, int rw)
     if (cpu_state.abrt)
         return 0xffffffffffffffffULL;
 
+    mmu_stats.walks++;
+
     addr2 = ((cr3 & ~0xfff) + ((addr >> 20) & 0xffc));
     temp = temp2 = mem_readl_map(addr2);
     if (!(temp & 1)) {
@@ -297,7 +335,7 @@ readmembl_2386(uint32_t addr)
 
     map = read_mapping[addr >> MEM_GRANULARITY_BITS];
     if (map && map->read_b)
-        return map->read_b(addr, map->priv);
+        return mem_mapping_read_b(map, addr);
 
     return 0xff;
 }
@@ -328,7 +366,7 @@ writemembl_2386(uint32_t addr, uint8_t val)
 
     map = write_mapping[addr >> MEM_GRANULARITY_BITS];
     if (map && map->write_b)
-        map->write_b(addr, val, map->priv);
+        mem_mapping_write_b(map, addr, val);
 }
 
 /* Read a byte from memory without MMU translation - result of previous MMU translation passed as value. */
@@ -352,7 +390,7 @@ readmembl_no_mmut_2386(uint32_t addr, uint32_t a64)
 
     map = read_mapping[addr >> MEM_GRANULARITY_BITS];
     if (map && map->read_b)
-        return map->read_b(addr, map->priv);
+        return mem_mapping_read_b(map, addr);
 
     return 0xff;
 }
@@ -378,7 +416,7 @@ writemembl_no_mmut_2386(uint32_t addr, uint32_t a64, uint8_t val)
 
     map = write_mapping[addr >> MEM_GRANULARITY_BITS];
     if (map && map->write_b)
-        map->write_b(addr, val, map->priv);
+        mem_mapping_write_b(map, addr, val);
 }
 
 uint16_t
@@ -431,10 +469,10 @@ readmemwl_2386(uint32_t addr)
     map = read_mapping[addr >> MEM_GRANULARITY_BITS];
 
     if (map && map->read_w)
-        return map->read_w(addr, map->priv);
+        return mem_mapping_read_w(map, addr);
 
     if (map && map->read_b) {
-        return map->read_b(addr, map->priv) | ((uint16_t) (map->read_b(addr + 1, map->priv)) << 8);
+        return mem_mapping_read_b(map, addr) | ((uint16_t) (mem_mapping_read_b(map, addr + 1)) << 8);
     }
 
     return 0xffff;
@@ -496,13 +534,13 @@ writememwl_2386(uint32_t addr, uint16_t val)
     map = write_mapping[addr >> MEM_GRANULARITY_BITS];
 
     if (map && map->write_w) {
-        map->write_w(addr, val, map->priv);
+        mem_mapping_write_w(map, addr, val);
         return;
     }
 
     if (map && map->write_b) {
-        map->write_b(addr, val, map->priv);
-        map->write_b(addr + 1, val >> 8, map->priv);
+        mem_mapping_write_b(map, addr, val);
+        mem_mapping_write_b(map, addr + 1, val >> 8);
         return;
     }
 }
@@ -543,10 +581,10 @@ readmemwl_no_mmut_2386(uint32_t addr, uint32_t *a64)
     map = read_mapping[addr >> MEM_GRANULARITY_BITS];
 
     if (map && map->read_w)
-        return map->read_w(addr, map->priv);
+        return mem_mapping_read_w(map, addr);
 
     if (map && map->read_b) {
-        return map->read_b(addr, map->priv) | ((uint16_t) (map->read_b(addr + 1, map->priv)) << 8);
+        return mem_mapping_read_b(map, addr) | ((uint16_t) (mem_mapping_read_b(map, addr + 1)) << 8);
     }
 
     return 0xffff;
@@ -589,13 +627,13 @@ writememwl_no_mmut_2386(uint32_t addr, uint32_t *a64, uint16_t val)
     map = write_mapping[addr >> MEM_GRANULARITY_BITS];
 
     if (map && map->write_w) {
-        map->write_w(addr, val, map->priv);
+        mem_mapping_write_w(map, addr, val);
         return;
     }
 
     if (map && map->write_b) {
-        map->write_b(addr, val, map->priv);
-        map->write_b(addr + 1, val >> 8, map->priv);
+        mem_mapping_write_b(map, addr, val);
+        mem_mapping_write_b(map, addr + 1, val >> 8);
         return;
     }
 }
@@ -664,13 +702,13 @@ readmemll_2386(uint32_t addr)
     map = read_mapping[addr >> MEM_GRANULARITY_BITS];
 
     if (map && map->read_l)
-        return map->read_l(addr, map->priv);
+        return mem_mapping_read_l(map, addr);
 
     if (map && map->read_w)
-        return map->read_w(addr, map->priv) | ((uint32_t) (map->read_w(addr + 2, map->priv)) << 16);
+        return mem_mapping_read_w(map, addr) | ((uint32_t) (mem_mapping_read_w(map, addr + 2)) << 16);
 
     if (map && map->read_b)
-        return map->read_b(addr, map->priv) | ((uint32_t) (map->read_b(addr + 1, map->priv)) << 8) | ((uint32_t) (map->read_b(addr + 2, map->priv)) << 16) | ((uint32_t) (map->read_b(addr + 3, map->priv)) << 24);
+        return mem_mapping_read_b(map, addr) | ((uint32_t) (mem_mapping_read_b(map, addr + 1)) << 8) | ((uint32_t) (mem_mapping_read_b(map, addr + 2)) << 16) | ((uint32_t) (mem_mapping_read_b(map, addr + 3)) << 24);
 
     return 0xffffffff;
 }
@@ -744,19 +782,19 @@ writememll_2386(uint32_t addr, uint32_t val)
     map = write_mapping[addr >> MEM_GRANULARITY_BITS];
 
     if (map && map->write_l) {
-        map->write_l(addr, val, map->priv);
+        mem_mapping_write_l(map, addr, val);
         return;
     }
     if (map && map->write_w) {
-        map->write_w(addr, val, map->priv);
-        map->write_w(addr + 2, val >> 16, map->priv);
+        mem_mapping_write_w(map, addr, val);
+        mem_mapping_write_w(map, addr + 2, val >> 16);
         return;
     }
     if (map && map->write_b) {
-        map->write_b(addr, val, map->priv);
-        map->write_b(addr + 1, val >> 8, map->priv);
-        map->write_b(addr + 2, val >> 16, map->priv);
-        map->write_b(addr + 3, val >> 24, map->priv);
+        mem_mapping_write_b(map, addr, val);
+        mem_mapping_write_b(map, addr + 1, val >> 8);
+        mem_mapping_write_b(map, addr + 2, val >> 16);
+        mem_mapping_write_b(map, addr + 3, val >> 24);
         return;
     }
 }
@@ -797,13 +835,13 @@ readmemll_no_mmut_2386(uint32_t addr, uint32_t *a64)
     map = read_mapping[addr >> MEM_GRANULARITY_BITS];
 
     if (map && map->read_l)
-        return map->read_l(addr, map->priv);
+        return mem_mapping_read_l(map, addr);
 
     if (map && map->read_w)
-        return map->read_w(addr, map->priv) | ((uint32_t) (map->read_w(addr + 2, map->priv)) << 16);
+        return mem_mapping_read_w(map, addr) | ((uint32_t) (mem_mapping_read_w(map, addr + 2)) << 16);
 
     if (map && map->read_b)
-        return map->read_b(addr, map->priv) | ((uint32_t) (map->read_b(addr + 1, map->priv)) << 8) | ((uint32_t) (map->read_b(addr + 2, map->priv)) << 16) | ((uint32_t) (map->read_b(addr + 3, map->priv)) << 24);
+        return mem_mapping_read_b(map, addr) | ((uint32_t) (mem_mapping_read_b(map, addr + 1)) << 8) | ((uint32_t) (mem_mapping_read_b(map, addr + 2)) << 16) | ((uint32_t) (mem_mapping_read_b(map, addr + 3)) << 24);
 
     return 0xffffffff;
 }
@@ -845,19 +883,19 @@ writememll_no_mmut_2386(uint32_t addr, uint32_t *a64, uint32_t val)
     map = write_mapping[addr >> MEM_GRANULARITY_BITS];
 
     if (map && map->write_l) {
-        map->write_l(addr, val, map->priv);
+        mem_mapping_write_l(map, addr, val);
         return;
     }
     if (map && map->write_w) {
-        map->write_w(addr, val, map->priv);
-        map->write_w(addr + 2, val >> 16, map->priv);
+        mem_mapping_write_w(map, addr, val);
+        mem_mapping_write_w(map, addr + 2, val >> 16);
         return;
     }
     if (map && map->write_b) {
-        map->write_b(addr, val, map->priv);
-        map->write_b(addr + 1, val >> 8, map->priv);
-        map->write_b(addr + 2, val >> 16, map->priv);
-        map->write_b(addr + 3, val >> 24, map->priv);
+        mem_mapping_write_b(map, addr, val);
+        mem_mapping_write_b(map, addr + 1, val >> 8);
+        mem_mapping_write_b(map, addr + 2, val >> 16);
+        mem_mapping_write_b(map, addr + 3, val >> 24);
         return;
     }
 }
@@ -925,24 +963,24 @@ readmemql_2386(uint32_t addr)
     map = read_mapping[addr >> MEM_GRANULARITY_BITS];
 
     if (map && map->read_l)
-        return map->read_l(addr, map->priv) |
-               ((uint64_t) map->read_l(addr + 4, map->priv) << 32);
+        return mem_mapping_read_l(map, addr) |
+               ((uint64_t) mem_mapping_read_l(map, addr + 4) << 32);
 
     if (map && map->read_w)
-        return map->read_w(addr, map->priv) |
-               ((uint64_t) map->read_w(addr + 2, map->priv) << 16) |
-               ((uint64_t) map->read_w(addr + 4, map->priv) << 32) |
-               ((uint64_t) map->read_w(addr + 6, map->priv) << 48);
+        return mem_mapping_read_w(map, addr) |
+               ((uint64_t) mem_mapping_read_w(map, addr + 2) << 16) |
+               ((uint64_t) mem_mapping_read_w(map, addr + 4) << 32) |
+               ((uint64_t) mem_mapping_read_w(map, addr + 6) << 48);
 
     if (map && map->read_b)
-        return map->read_b(addr, map->priv) |
-               ((uint64_t) map->read_b(addr + 1, map->priv) << 8) |
-               ((uint64_t) map->read_b(addr + 2, map->priv) << 16) |
-               ((uint64_t) map->read_b(addr + 3, map->priv) << 24) |
-               ((uint64_t) map->read_b(addr + 4, map->priv) << 32) |
-               ((uint64_t) map->read_b(addr + 5, map->priv) << 40) |
-               ((uint64_t) map->read_b(addr + 6, map->priv) << 48) |
-               ((uint64_t) map->read_b(addr + 7, map->priv) << 56);
+        return mem_mapping_read_b(map, addr) |
+               ((uint64_t) mem_mapping_read_b(map, addr + 1) << 8) |
+               ((uint64_t) mem_mapping_read_b(map, addr + 2) << 16) |
+               ((uint64_t) mem_mapping_read_b(map, addr + 3) << 24) |
+               ((uint64_t) mem_mapping_read_b(map, addr + 4) << 32) |
+               ((uint64_t) mem_mapping_read_b(map, addr + 5) << 40) |
+               ((uint64_t) mem_mapping_read_b(map, addr + 6) << 48) |
+               ((uint64_t) mem_mapping_read_b(map, addr + 7) << 56);
 
     return 0xffffffffffffffffULL;
 }
@@ -1013,26 +1051,26 @@ writememql_2386(uint32_t addr, uint64_t val)
     map = write_mapping[addr >> MEM_GRANULARITY_BITS];
 
     if (map && map->write_l) {
-        map->write_l(addr, val, map->priv);
-        map->write_l(addr + 4, val >> 32, map->priv);
+        mem_mapping_write_l(map, addr, val);
+        mem_mapping_write_l(map, addr + 4, val >> 32);
         return;
     }
     if (map && map->write_w) {
-        map->write_w(addr, val, map->priv);
-        map->write_w(addr + 2, val >> 16, map->priv);
-        map->write_w(addr + 4, val >> 32, map->priv);
-        map->write_w(addr + 6, val >> 48, map->priv);
+        mem_mapping_write_w(map, addr, val);
+        mem_mapping_write_w(map, addr + 2, val >> 16);
+        mem_mapping_write_w(map, addr + 4, val >> 32);
+        mem_mapping_write_w(map, addr + 6, val >> 48);
         return;
     }
     if (map && map->write_b) {
-        map->write_b(addr, val, map->priv);
-        map->write_b(addr + 1, val >> 8, map->priv);
-        map->write_b(addr + 2, val >> 16, map->priv);
-        map->write_b(addr + 3, val >> 24, map->priv);
-        map->write_b(addr + 4, val >> 32, map->priv);
-        map->write_b(addr + 5, val >> 40, map->priv);
-        map->write_b(addr + 6, val >> 48, map->priv);
-        map->write_b(addr + 7, val >> 56, map->priv);
+        mem_mapping_write_b(map, addr, val);
+        mem_mapping_write_b(map, addr + 1, val >> 8);
+        mem_mapping_write_b(map, addr + 2, val >> 16);
+        mem_mapping_write_b(map, addr + 3, val >> 24);
+        mem_mapping_write_b(map, addr + 4, val >> 32);
+        mem_mapping_write_b(map, addr + 5, val >> 40);
+        mem_mapping_write_b(map, addr + 6, val >> 48);
+        mem_mapping_write_b(map, addr + 7, val >> 56);
         return;
     }
 }
@@ -0,0 +1,894 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Network capture tap.
+ *
+ *          While a card's tap is on, every frame it sends or receives
+ *          is checked against its filter, counted per flow and copied
+ *          into a byte ring, all on the emulation thread. A writer
+ *          thread turns the ring into one pcapng file per card, so the
+ *          guest never waits for the disk; if the writer falls behind,
+ *          frames are dropped from the capture and counted instead.
+ *
+ *          Filters are a list of keywords separated by spaces or commas:
+ *          arp, ip, ip6, tcp, udp, icmp and bcast select frame types,
+ *          port=N selects TCP and UDP ports. A frame is captured if it
+ *          matches any of the types (or none were given) and any of the
+ *          ports (or none were given).
+ *
+ * Authors: 86Box contributors.
+ *
+ *          Copyright 2026 86Box contributors.
+ */
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <wchar.h>
+#define HAVE_STDARG_H
+#include <86box/86box.h>
+#include <86box/device.h>
+#include <86box/plat.h>
+#include <86box/path.h>
+#include <86box/thread.h>
+#include <86box/timer.h>
+#include <86box/network.h>
+#include <86box/net_capture.h>
+#include <86box/version.h>
+#include <86box/plat_unused.h>
+
+#define CAPTURE_RING_MASK  (NET_CAPTURE_RING - 1)
+#define CAPTURE_FLOW_MASK  (NET_CAPTURE_FLOWS - 1)
+#define CAPTURE_FLOW_PROBE 8
+#define CAPTURE_PORTS      8
+
+/* Wake the writer early once the ring is this full. */
+#define CAPTURE_KICK       (NET_CAPTURE_RING / 2)
+#define CAPTURE_PERIOD_MS  100
+
+#define FILTER_ARP   0x01
+#define FILTER_IP    0x02
+#define FILTER_IP6   0x04
+#define FILTER_TCP   0x08
+#define FILTER_UDP   0x10
+#define FILTER_ICMP  0x20
+#define FILTER_BCAST 0x40
+
+#define ETHERTYPE_IP   0x0800
+#define ETHERTYPE_ARP  0x0806
+#define ETHERTYPE_VLAN 0x8100
+#define ETHERTYPE_IP6  0x86dd
+
+#define IPPROTO_ICMP_  1
+#define IPPROTO_TCP_   6
+#define IPPROTO_UDP_   17
+#define IPPROTO_ICMP6_ 58
+
+#define PCAPNG_SHB     0x0a0d0d0a
+#define PCAPNG_IDB     0x00000001
+#define PCAPNG_EPB     0x00000006
+#define PCAPNG_BOM     0x1a2b3c4d
+#define LINKTYPE_ETHER 1
+
+typedef struct capture_filter_t {
+    uint32_t types;
+    int      nports;
+    uint16_t ports[CAPTURE_PORTS];
+} capture_filter_t;
+
+/* What the tap needs to know about a frame, for filtering and flows. */
+typedef struct frame_info_t {
+    uint16_t ethertype;
+    uint8_t  proto;
+    uint8_t  addr_len;
+    uint32_t types;
+    uint16_t sport;
+    uint16_t dport;
+    const uint8_t *src;
+    const uint8_t *dst;
+} frame_info_t;
+
+/* Guest side first, so both directions of a conversation share a flow. */
+typedef struct flow_key_t {
+    uint16_t ethertype;
+    uint8_t  proto;
+    uint8_t  addr_len;
+    uint16_t lport;
+    uint16_t rport;
+    uint8_t  local[16];
+    uint8_t  remote[16];
+} flow_key_t;
+
+typedef struct flow_t {
+    flow_key_t key;
+    uint8_t    used;
+    uint32_t   last_seen;
+    uint64_t   packets[2];
+    uint64_t   bytes[2];
+    uint32_t   drops;
+} flow_t;
+
+typedef struct capture_card_t {
+    atomic_int       active;
+    /* Owned by the emulation thread. */
+    capture_filter_t filter;
+    uint32_t         snaplen;
+    uint64_t         packets;
+    uint64_t         bytes;
+    uint64_t         filtered;
+    uint32_t         ring_full;
+    uint32_t         clock;
+    /* Owned by whoever holds the capture mutex. */
+    FILE            *fp;
+    char             path[1024];
+    atomic_ullong    written;
+    /* Flows are shared with readers through their mutex. */
+    mutex_t         *flow_mutex;
+    flow_t           flows[NET_CAPTURE_FLOWS];
+} capture_card_t;
+
+/* Ring record, followed by the frame; 0 in size means wrap around. */
+typedef struct capture_rec_t {
+    uint32_t size;
+    uint16_t card_num;
+    uint8_t  dir;
+    uint8_t  pad;
+    uint32_t orig_len;
+    uint32_t cap_len;
+    uint64_t ts;
+} capture_rec_t;
+
+static struct {
+    uint8_t       *ring;
+    atomic_uint    head; /* Emulation thread only. */
+    atomic_uint    tail; /* Capture mutex holder only. */
+    atomic_int     kicked;
+    atomic_int     quit;
+    thread_t      *thread;
+    event_t       *wake;
+    mutex_t       *mutex;
+    capture_card_t cards[NET_CARD_MAX];
+} capture;
+
+#ifdef ENABLE_NET_CAPTURE_LOG
+int net_capture_do_log = ENABLE_NET_CAPTURE_LOG;
+
+static void
+net_capture_log(const char *fmt, ...)
+{
+    va_list ap;
+
+    if (net_capture_do_log) {
+        va_start(ap, fmt);
+        pclog_ex(fmt, ap);
+        va_end(ap);
+    }
+}
+#else
+#    define net_capture_log(fmt, ...)
+#endif
+
+static inline uint16_t
+get_be16(const uint8_t *p)
+{
+    return (p[0] << 8) | p[1];
+}
+
+static void
+network_capture_parse(const uint8_t *data, int len, frame_info_t *fi)
+{
+    int off = 14;
+
+    memset(fi, 0x00, sizeof(frame_info_t));
+    if (len < 14)
+        return;
+
+    fi->ethertype = get_be16(&data[12]);
+    if ((fi->ethertype == ETHERTYPE_VLAN) && (len >= 18)) {
+        fi->ethertype = get_be16(&data[16]);
+        off           = 18;
+    }
+
+    /* Fall back to the MAC addresses for anything that is not IP. */
+    fi->src      = &data[6];
+    fi->dst      = &data[0];
+    fi->addr_len = 6;
+    if (data[0] & 1)
+        fi->types |= FILTER_BCAST;
+
+    const uint8_t *l4  = NULL;
+    int            rem = 0;
+
+    switch (fi->ethertype) {
+        case ETHERTYPE_ARP:
+            fi->types |= FILTER_ARP;
+            break;
+
+        case ETHERTYPE_IP: {
+            const int ihl = (data[off] & 0x0f) << 2;
+
+            if ((len < (off + 20)) || (ihl < 20))
+                break;
+            fi->types |= FILTER_IP;
+            fi->proto    = data[off + 9];
+            fi->src      = &data[off + 12];
+            fi->dst      = &data[off + 16];
+            fi->addr_len = 4;
+            /* Only the first fragment carries the ports. */
+            if (!(get_be16(&data[off + 6]) & 0x1fff) && (len >= (off + ihl))) {
+                l4  = &data[off + ihl];
+                rem = len - off - ihl;
+            }
+            break;
+        }
+
+        case ETHERTYPE_IP6:
+            if (len < (off + 40))
+                break;
+            fi->types |= FILTER_IP6;
+            fi->proto    = data[off + 6];
+            fi->src      = &data[off + 8];
+            fi->dst      = &data[off + 24];
+            fi->addr_len = 16;
+            l4           = &data[off + 40];
+            rem          = len - off - 40;
+            break;
+
+        default:
+            break;
+    }
+
+    switch (fi->proto) {
+        case IPPROTO_TCP_:
+            fi->types |= FILTER_TCP;
+            break;
+        case IPPROTO_UDP_:
+            fi->types |= FILTER_UDP;
+            break;
+        case IPPROTO_ICMP_:
+            if (fi->addr_len == 4)
+                fi->types |= FILTER_ICMP;
+            return;
+        case IPPROTO_ICMP6_:
+            if (fi->addr_len == 16)
+                fi->types |= FILTER_ICMP;
+            return;
+        default:
+            return;
+    }
+
+    if (l4 && (rem >= 4)) {
+        fi->sport = get_be16(&l4[0]);
+        fi->dport = get_be16(&l4[2]);
+    }
+}
+
+static void
+network_capture_parse_filter(const char *str, capture_filter_t *filter)
+{
+    static const struct {
+        const char *name;
+        uint32_t    type;
+    } types[] = {
+        { "arp",   FILTER_ARP   },
+        { "ip",    FILTER_IP    },
+        { "ip6",   FILTER_IP6   },
+        { "tcp",   FILTER_TCP   },
+        { "udp",   FILTER_UDP   },
+        { "icmp",  FILTER_ICMP  },
+        { "bcast", FILTER_BCAST }
+    };
+    char  buf[64];
+    char *tok;
+
+    memset(filter, 0x00, sizeof(capture_filter_t));
+    snprintf(buf, sizeof(buf), "%s", str);
+
+    for (tok = strtok(buf, " ,"); tok; tok = strtok(NULL, " ,")) {
+        int i;
+
+        if (!strncmp(tok, "port=", 5)) {
+            if (filter->nports < CAPTURE_PORTS)
+                filter->ports[filter->nports++] = (uint16_t) atoi(&tok[5]);
+            continue;
+        }
+
+        for (i = 0; i < (int) (sizeof(types) / sizeof(types[0])); i++) {
+            if (!strcmp(tok, types[i].name)) {
+                filter->types |= types[i].type;
+                break;
+            }
+        }
+        if (i == (int) (sizeof(types) / sizeof(types[0])))
+            net_capture_log("Network capture: unknown filter keyword \"%s\"\n", tok);
+    }
+}
+
+static int
+network_capture_match(const capture_filter_t *filter, const frame_info_t *fi)
+{
+    if (filter->types && !(filter->types & fi->types))
+        return 0;
+
+    if (filter->nports) {
+        for (int i = 0; i < filter->nports; i++) {
+            if ((fi->types & (FILTER_TCP | FILTER_UDP)) &&
+                ((fi->sport == filter->ports[i]) || (fi->dport == filter->ports[i])))
+                return 1;
+        }
+        return 0;
+    }
+
+    return 1;
+}
+
+static void
+network_capture_flow(capture_card_t *c, const frame_info_t *fi, int dir, int len, int dropped)
+{
+    flow_key_t key;
+    flow_t    *flow   = NULL;
+    flow_t    *oldest = NULL;
+    uint32_t   hash   = 2166136261U;
+
+    memset(&key, 0x00, sizeof(flow_key_t));
+    key.ethertype = fi->ethertype;
+    key.proto     = fi->proto;
+    key.addr_len  = fi->addr_len;
+    if (dir == NET_CAPTURE_OUT) {
+        memcpy(key.local, fi->src, fi->addr_len);
+        memcpy(key.remote, fi->dst, fi->addr_len);
+        key.lport = fi->sport;
+        key.rport = fi->dport;
+    } else {
+        memcpy(key.local, fi->dst, fi->addr_len);
+        memcpy(key.remote, fi->src, fi->addr_len);
+        key.lport = fi->dport;
+        key.rport = fi->sport;
+    }
+
+    for (size_t i = 0; i < sizeof(flow_key_t); i++)
+        hash = (hash ^ ((const uint8_t *) &key)[i]) * 16777619U;
+
+    thread_wait_mutex(c->flow_mutex);
+
+    /* Short linear probe, evicting the least recently seen flow when full. */
+    for (int i = 0; i < CAPTURE_FLOW_PROBE; i++) {
+        flow_t *f = &c->flows[(hash + i) & CAPTURE_FLOW_MASK];
+
+        if (!f->used || !memcmp(&f->key, &key, sizeof(flow_key_t))) {
+            flow = f;
+            break;
+        }
+        if (!oldest || ((int32_t) (f->last_seen - oldest->last_seen) < 0))
+            oldest = f;
+    }
+
+    if (!flow)
+        flow = oldest;
+    if (!flow->used || memcmp(&flow->key, &key, sizeof(flow_key_t))) {
+        memset(flow, 0x00, sizeof(flow_t));
+        flow->key  = key;
+        flow->used = 1;
+    }
+
+    flow->last_seen = c->clock++;
+    if (dropped)
+        flow->drops++;
+    else {
+        flow->packets[dir]++;
+        flow->bytes[dir] += len;
+    }
+
+    thread_release_mutex(c->flow_mutex);
+}
+
+static uint64_t
+network_capture_now(void)
+{
+    struct timespec ts;
+
+    timespec_get(&ts, TIME_UTC);
+    return ((uint64_t) ts.tv_sec * 1000000ULL) + (ts.tv_nsec / 1000);
+}
+
+static void
+network_capture_push(capture_card_t *c, int card_num, int dir, const uint8_t *data, int len)
+{
+    const uint32_t cap_len = ((uint32_t) len > c->snaplen) ? c->snaplen : (uint32_t) len;
+    const uint32_t need    = (sizeof(capture_rec_t) + cap_len + 7) & ~7;
+    uint32_t       head    = atomic_load_explicit(&capture.head, memory_order_relaxed);
+    const uint32_t tail    = atomic_load_explicit(&capture.tail, memory_order_acquire);
+    uint32_t       off     = head & CAPTURE_RING_MASK;
+    uint32_t       skip    = 0;
+    capture_rec_t *rec;
+
+    /* Records never wrap, the rest of the ring is skipped instead. */
+    if ((NET_CAPTURE_RING - off) < need)
+        skip = NET_CAPTURE_RING - off;
+
+    if ((NET_CAPTURE_RING - (head - tail)) < (skip + need)) {
+        c->ring_full++;
+        return;
+    }
+
+    if (skip) {
+        ((capture_rec_t *) &capture.ring[off])->size = 0;
+        head += skip;
+        off = 0;
+    }
+
+    rec           = (capture_rec_t *) &capture.ring[off];
+    rec->size     = need;
+    rec->card_num = card_num;
+    rec->dir      = dir;
+    rec->pad      = 0;
+    rec->orig_len = len;
+    rec->cap_len  = cap_len;
+    rec->ts       = network_capture_now();
+    memcpy(&rec[1], data, cap_len);
+
+    head += need;
+    atomic_store_explicit(&capture.head, head, memory_order_release);
+
+    if (((head - tail) >= CAPTURE_KICK) && !atomic_exchange(&capture.kicked, 1))
+        thread_set_event(capture.wake);
+}
+
+void
+network_capture_frame(int card_num, int dir, const uint8_t *data, int len)
+{
+    capture_card_t *c = &capture.cards[card_num];
+    frame_info_t    fi;
+
+    if (!atomic_load_explicit(&c->active, memory_order_acquire))
+        return;
+
+    network_capture_parse(data, len, &fi);
+    if (!network_capture_match(&c->filter, &fi)) {
+        c->filtered++;
+        return;
+    }
+
+    c->packets++;
+    c->bytes += len;
+    network_capture_flow(c, &fi, dir, len, 0);
+    network_capture_push(c, card_num, dir, data, len);
+}
+
+void
+network_capture_drop(int card_num, int dir, const uint8_t *data, int len)
+{
+    capture_card_t *c = &capture.cards[card_num];
+    frame_info_t    fi;
+
+    if (!atomic_load_explicit(&c->active, memory_order_acquire))
+        return;
+
+    network_capture_parse(data, len, &fi);
+    if (network_capture_match(&c->filter, &fi))
+        network_capture_flow(c, &fi, dir, len, 1);
+}
+
+/* pcapng writing, see draft-ietf-opsawg-pcapng. */
+static uint32_t
+pcapng_opt(uint8_t *buf, uint32_t pos, uint16_t code, const void *val, uint16_t len)
+{
+    memcpy(&buf[pos], &code, 2);
+    memcpy(&buf[pos + 2], &len, 2);
+    memcpy(&buf[pos + 4], val, len);
+    pos += 4 + len;
+    while (pos & 3)
+        buf[pos++] = 0;
+
+    return pos;
+}
+
+static int
+pcapng_block(FILE *fp, uint32_t type, uint8_t *buf, uint32_t pos)
+{
+    /* buf starts with room for the type and length, the end option is added here. */
+    memset(&buf[pos], 0x00, 4);
+    pos += 8;
+    memcpy(&buf[0], &type, 4);
+    memcpy(&buf[4], &pos, 4);
+    memcpy(&buf[pos - 4], &pos, 4);
+
+    return fwrite(buf, 1, pos, fp) == pos;
+}
+
+static int
+network_capture_write_header(capture_card_t *c, int card_num)
+{
+    uint8_t        buf[512];
+    uint32_t       pos;
+    const uint32_t bom     = PCAPNG_BOM;
+    const uint16_t ver[2]  = { 1, 0 };
+    const int64_t  sec_len = -1;
+    const uint16_t link[2] = { LINKTYPE_ETHER, 0 };
+    const uint8_t  tsresol = 6; /* microseconds */
+    const char    *appl    = EMU_NAME " " EMU_VERSION_FULL;
+    char           name[128];
+
+    memset(buf, 0x00, sizeof(buf));
+    memcpy(&buf[8], &bom, 4);
+    memcpy(&buf[12], ver, 4);
+    memcpy(&buf[16], &sec_len, 8);
+    pos = pcapng_opt(buf, 24, 4 /* shb_userappl */, appl, strlen(appl));
+    if (!pcapng_block(c->fp, PCAPNG_SHB, buf, pos))
+        return 0;
+
+    snprintf(name, sizeof(name), "Network card %i (%s)", card_num + 1,
+             network_card_get_internal_name(net_cards_conf[card_num].device_num));
+    memset(buf, 0x00, sizeof(buf));
+    memcpy(&buf[8], link, 4);
+    memcpy(&buf[12], &c->snaplen, 4);
+    pos = pcapng_opt(buf, 16, 2 /* if_name */, name, strlen(name));
+    pos = pcapng_opt(buf, pos, 9 /* if_tsresol */, &tsresol, 1);
+
+    return pcapng_block(c->fp, PCAPNG_IDB, buf, pos);
+}
+
+static void
+network_capture_write_packet(capture_card_t *c, const capture_rec_t *rec)
+{
+    uint8_t        buf[64 + NET_MAX_FRAME];
+    uint32_t       pos;
+    const uint32_t iface = 0;
+    const uint32_t ts[2] = { (uint32_t) (rec->ts >> 32), (uint32_t) rec->ts };
+    /* Inbound or outbound, as seen from the guest. */
+    const uint32_t flags = (rec->dir == NET_CAPTURE_IN) ? 1 : 2;
+
+    memcpy(&buf[8], &iface, 4);
+    memcpy(&buf[12], ts, 8);
+    memcpy(&buf[20], &rec->cap_len, 4);
+    memcpy(&buf[24], &rec->orig_len, 4);
+    memcpy(&buf[28], &rec[1], rec->cap_len);
+    pos = 28 + rec->cap_len;
+    while (pos & 3)
+        buf[pos++] = 0;
+    pos = pcapng_opt(buf, pos, 2 /* epb_flags */, &flags, 4);
+
+    if (pcapng_block(c->fp, PCAPNG_EPB, buf, pos))
+        atomic_fetch_add_explicit(&c->written, 1, memory_order_relaxed);
+}
+
+/* Consumer side, with the capture mutex held. */
+static void
+network_capture_drain(void)
+{
+    uint32_t       tail = atomic_load_explicit(&capture.tail, memory_order_relaxed);
+    const uint32_t head = atomic_load_explicit(&capture.head, memory_order_acquire);
+
+    while (tail != head) {
+        const uint32_t       off = tail & CAPTURE_RING_MASK;
+        const capture_rec_t *rec = (const capture_rec_t *) &capture.ring[off];
+
+        if (!rec->size) {
+            tail += NET_CAPTURE_RING - off;
+            continue;
+        }
+
+        /* Frames of a card whose capture was stopped meanwhile are dropped. */
+        if ((rec->card_num < NET_CARD_MAX) && capture.cards[rec->card_num].fp)
+            network_capture_write_packet(&capture.cards[rec->card_num], rec);
+
+        tail += rec->size;
+    }
+
+    atomic_store_explicit(&capture.tail, tail, memory_order_release);
+}
+
+static void
+network_capture_thread(UNUSED(void *priv))
+{
+    net_capture_log("Network capture: writer started\n");
+
+    while (!atomic_load(&capture.quit)) {
+        thread_wait_event(capture.wake, CAPTURE_PERIOD_MS);
+        thread_reset_event(capture.wake);
+        atomic_store(&capture.kicked, 0);
+
+        thread_wait_mutex(capture.mutex);
+        network_capture_drain();
+        for (int i = 0; i < NET_CARD_MAX; i++) {
+            if (capture.cards[i].fp)
+                fflush(capture.cards[i].fp);
+        }
+        thread_release_mutex(capture.mutex);
+    }
+
+    net_capture_log("Network capture: writer stopped\n");
+}
+
+void
+network_capture_init(void)
+{
+    if (capture.mutex)
+        return;
+
+    capture.mutex = thread_create_mutex();
+    for (int i = 0; i < NET_CARD_MAX; i++) {
+        atomic_init(&capture.cards[i].active, 0);
+        atomic_init(&capture.cards[i].written, 0);
+        capture.cards[i].flow_mutex = thread_create_mutex();
+    }
+    atomic_init(&capture.head, 0);
+    atomic_init(&capture.tail, 0);
+    atomic_init(&capture.kicked, 0);
+    atomic_init(&capture.quit, 0);
+}
+
+void
+network_capture_close(void)
+{
+    if (!capture.mutex)
+        return;
+
+    for (int i = 0; i < NET_CARD_MAX; i++)
+        network_capture_stop(i);
+
+    if (capture.thread) {
+        atomic_store(&capture.quit, 1);
+        thread_set_event(capture.wake);
+        thread_wait(capture.thread);
+        thread_destroy_event(capture.wake);
+        capture.thread = NULL;
+        capture.wake   = NULL;
+    }
+
+    free(capture.ring);
+    capture.ring = NULL;
+
+    for (int i = 0; i < NET_CARD_MAX; i++) {
+        thread_close_mutex(capture.cards[i].flow_mutex);
+        capture.cards[i].flow_mutex = NULL;
+    }
+    thread_close_mutex(capture.mutex);
+    capture.mutex = NULL;
+}
+
+int
+network_capture_start(int card_num)
+{
+    netcard_stats_t stats;
+    capture_card_t *c;
+    char            fn[256];
+
+    if ((card_num < 0) || (card_num >= NET_CARD_MAX) || !capture.mutex ||
+        !network_card_get_stats(card_num, &stats))
+        return 0;
+
+    c = &capture.cards[card_num];
+    if (atomic_load(&c->active))
+        return 1;
+
+    thread_wait_mutex(capture.mutex);
+
+    if (!capture.ring) {
+        capture.ring = malloc(NET_CAPTURE_RING);
+        if (!capture.ring) {
+            thread_release_mutex(capture.mutex);
+            return 0;
+        }
+        atomic_store(&capture.quit, 0);
+        capture.wake   = thread_create_event();
+        capture.thread = thread_create(network_capture_thread, NULL);
+    }
+
+    memset(c->path, 0x00, sizeof(c->path));
+    path_append_filename(c->path, usr_path, NET_CAPTURE_PATH);
+    if (!plat_dir_check(c->path))
+        plat_dir_create(c->path);
+    path_slash(c->path);
+    snprintf(fn, sizeof(fn), "Network_%i", card_num + 1);
+    plat_tempfile(&c->path[strlen(c->path)], fn, ".pcapng");
+
+    c->snaplen = net_cards_conf[card_num].capture_snaplen;
+    if (!c->snaplen || (c->snaplen > NET_MAX_FRAME))
+        c->snaplen = NET_MAX_FRAME;
+    network_capture_parse_filter(net_cards_conf[card_num].capture_filter, &c->filter);
+
+    c->fp = plat_fopen(c->path, "wb");
+    if (!c->fp || !network_capture_write_header(c, card_num)) {
+        net_capture_log("Network capture: could not create %s\n", c->path);
+        if (c->fp)
+            fclose(c->fp);
+        c->fp = NULL;
+        thread_release_mutex(capture.mutex);
+        return 0;
+    }
+
+    c->packets   = 0;
+    c->bytes     = 0;
+    c->filtered  = 0;
+    c->ring_full = 0;
+    atomic_store(&c->written, 0);
+    thread_wait_mutex(c->flow_mutex);
+    memset(c->flows, 0x00, sizeof(c->flows));
+    thread_release_mutex(c->flow_mutex);
+
+    /* Publishes the settings above to the emulation thread. */
+    atomic_store_explicit(&c->active, 1, memory_order_release);
+
+    thread_release_mutex(capture.mutex);
+
+    net_capture_log("Network capture: card %i to %s\n", card_num + 1, c->path);
+
+    return 1;
+}
+
+void
+network_capture_stop(int card_num)
+{
+    capture_card_t *c;
+
+    if ((card_num < 0) || (card_num >= NET_CARD_MAX) || !capture.mutex)
+        return;
+
+    c = &capture.cards[card_num];
+    if (!atomic_exchange(&c->active, 0))
+        return;
+
+    /* Write out what is already buffered before closing the file. */
+    thread_wait_mutex(capture.mutex);
+    network_capture_drain();
+    if (c->fp) {
+        fclose(c->fp);
+        c->fp = NULL;
+    }
+    thread_release_mutex(capture.mutex);
+
+    net_capture_log("Network capture: card %i stopped\n", card_num + 1);
+}
+
+int
+network_capture_active(int card_num)
+{
+    if ((card_num < 0) || (card_num >= NET_CARD_MAX))
+        return 0;
+
+    return atomic_load(&capture.cards[card_num].active);
+}
+
+/*
+ * Counters are owned by the emulation thread, readers on other threads
+ * may see slightly stale values.
+ */
+int
+network_capture_get_stats(int card_num, net_capture_stats_t *stats)
+{
+    const capture_card_t *c;
+
+    if ((card_num < 0) || (card_num >= NET_CARD_MAX))
+        return 0;
+
+    c = &capture.cards[card_num];
+    memset(stats, 0x00, sizeof(net_capture_stats_t));
+    stats->active    = atomic_load(&c->active);
+    stats->packets   = c->packets;
+    stats->bytes     = c->bytes;
+    stats->filtered  = c->filtered;
+    stats->written   = atomic_load(&c->written);
+    stats->ring_full = c->ring_full;
+    if (stats->active)
+        snprintf(stats->path, sizeof(stats->path), "%s", c->path);
+
+    return 1;
+}
+
+static void
+network_capture_format_addr(char *buf, size_t size, const flow_key_t *key, const uint8_t *addr, uint16_t port)
+{
+    switch (key->addr_len) {
+        case 4:
+            if (port)
+                snprintf(buf, size, "%u.%u.%u.%u:%u", addr[0], addr[1], addr[2], addr[3], port);
+            else
+                snprintf(buf, size, "%u.%u.%u.%u", addr[0], addr[1], addr[2], addr[3]);
+            break;
+
+        case 16: {
+            int len = snprintf(buf, size, port ? "[" : "");
+            for (int i = 0; i < 16; i += 2)
+                len += snprintf(&buf[len], size - len, (i < 14) ? "%x:" : "%x", get_be16(&addr[i]));
+            if (port)
+                snprintf(&buf[len], size - len, "]:%u", port);
+            break;
+        }
+
+        default:
+            snprintf(buf, size, "%02x:%02x:%02x:%02x:%02x:%02x",
+                     addr[0], addr[1], addr[2], addr[3], addr[4], addr[5]);
+            break;
+    }
+}
+
+static void
+network_capture_describe(const flow_key_t *key, char *buf, size_t size)
+{
+    char local[48];
+    char remote[48];
+    char proto[16];
+
+    if (key->addr_len == 6) {
+        if (key->ethertype == ETHERTYPE_ARP)
+            snprintf(proto, sizeof(proto), "ARP");
+        else
+            snprintf(proto, sizeof(proto), "0x%04x", key->ethertype);
+    } else switch (key->proto) {
+        case IPPROTO_TCP_:
+            snprintf(proto, sizeof(proto), "TCP");
+            break;
+        case IPPROTO_UDP_:
+            snprintf(proto, sizeof(proto), "UDP");
+            break;
+        case IPPROTO_ICMP_:
+        case IPPROTO_ICMP6_:
+            snprintf(proto, sizeof(proto), (key->addr_len == 4) ? "ICMP" : "ICMPv6");
+            break;
+        default:
+            snprintf(proto, sizeof(proto), "IP %u", key->proto);
+            break;
+    }
+
+    network_capture_format_addr(local, sizeof(local), key, key->local, key->lport);
+    network_capture_format_addr(remote, sizeof(remote), key, key->remote, key->rport);
+    snprintf(buf, size, "%s %s <> %s", proto, local, remote);
+}
+
+static int
+network_capture_flow_cmp(const void *a, const void *b)
+{
+    const flow_t  *fa = (const flow_t *) a;
+    const flow_t  *fb = (const flow_t *) b;
+    const uint64_t ba = fa->bytes[0] + fa->bytes[1];
+    const uint64_t bb = fb->bytes[0] + fb->bytes[1];
+
+    return (ba < bb) ? 1 : ((ba > bb) ? -1 : 0);
+}
+
+int
+network_capture_get_flows(int card_num, net_flow_stats_t *flows, int max)
+{
+    capture_card_t *c;
+    flow_t         *copy;
+    int             count = 0;
+
+    if ((card_num < 0) || (card_num >= NET_CARD_MAX) || !capture.mutex)
+        return 0;
+
+    c    = &capture.cards[card_num];
+    copy = malloc(sizeof(c->flows));
+    if (!copy)
+        return 0;
+
+    thread_wait_mutex(c->flow_mutex);
+    for (int i = 0; i < NET_CAPTURE_FLOWS; i++) {
+        if (c->flows[i].used)
+            copy[count++] = c->flows[i];
+    }
+    thread_release_mutex(c->flow_mutex);
+
+    qsort(copy, count, sizeof(flow_t), network_capture_flow_cmp);
+    if (count > max)
+        count = max;
+
+    for (int i = 0; i < count; i++) {
+        network_capture_describe(&copy[i].key, flows[i].desc, sizeof(flows[i].desc));
+        memcpy(flows[i].packets, copy[i].packets, sizeof(flows[i].packets));
+        memcpy(flows[i].bytes, copy[i].bytes, sizeof(flows[i].bytes));
+        flows[i].drops = copy[i].drops;
+    }
+
+    free(copy);
+
+    return count;
+}
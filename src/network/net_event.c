@@ -4,6 +4,7 @@
 #else
 #    include <unistd.h>
 #    include <fcntl.h>
+#    include <time.h>
 #endif
 
 #include <86box/net_event.h>
@@ -21,6 +22,7 @@ setup_fd(int fd)
 void
 net_event_init(net_evt_t *event)
 {
+    atomic_init(&event->pending, 0);
 #ifdef _WIN32
     event->handle = CreateEvent(NULL, FALSE, FALSE, NULL);
 #else
@@ -30,9 +32,16 @@ net_event_init(net_evt_t *event)
 #endif
 }
 
+/*
+   Producers may call this once per packet or timer tick; only the first
+   call after the waiter has cleared the event costs a system call.
+ */
 void
 net_event_set(net_evt_t *event)
 {
+    if (atomic_exchange(&event->pending, 1))
+        return;
+
 #ifdef _WIN32
     SetEvent(event->handle);
 #else
@@ -41,14 +50,19 @@ net_event_set(net_evt_t *event)
 }
 
 void
-net_event_clear(UNUSED(net_evt_t *event))
+net_event_clear(net_evt_t *event)
 {
-#ifdef _WIN32
-    /* Do nothing on WIN32 since we use an auto-reset event */
-#else
-    char dummy[1];
-    (void) !read(event->fds[0], &dummy, sizeof(dummy));
+#ifndef _WIN32
+    /* Nothing to drain on WIN32 since we use an auto-reset event */
+    char dummy[16];
+    while (read(event->fds[0], &dummy, sizeof(dummy)) > 0)
+        ;
 #endif
+    /*
+       Only re-arm after draining; the caller looks at its queues after
+       this, so a set that was skipped in between is not lost.
+     */
+    atomic_store(&event->pending, 0);
 }
 
 void
@@ -74,4 +88,56 @@ net_event_get_fd(net_evt_t *event)
 {
     return event->fds[0];
 }
-#endif
\ No newline at end of file
+
+/* Shortest window spinning shrinks to, so that traffic can grow it again. */
+#    define NET_BUSY_POLL_FLOOR 8
+
+static uint64_t
+net_event_now_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t) ts.tv_sec * 1000000ULL) + (ts.tv_nsec / 1000);
+}
+
+void
+net_busy_poll_init(net_busy_poll_t *bp, uint32_t max_us)
+{
+    bp->max_us    = max_us;
+    bp->window_us = max_us;
+}
+
+/*
+   poll() that first spins for up to the busy-poll window, saving the
+   sleep and wakeup when frames follow each other closely. The window
+   doubles whenever spinning caught an event and halves when it did not,
+   so an idle link goes back to sleeping straight away.
+ */
+int
+net_event_poll(struct pollfd *pfd, int nfds, int timeout, net_busy_poll_t *bp)
+{
+    if (bp && bp->max_us && timeout) {
+        const uint64_t start = net_event_now_us();
+        int            ret;
+
+        do {
+            ret = poll(pfd, nfds, 0);
+            if (ret != 0) {
+                if (ret > 0) {
+                    bp->window_us <<= 1;
+                    if (bp->window_us > bp->max_us)
+                        bp->window_us = bp->max_us;
+                }
+                return ret;
+            }
+        } while ((net_event_now_us() - start) < bp->window_us);
+
+        bp->window_us >>= 1;
+        if (bp->window_us < NET_BUSY_POLL_FLOOR)
+            bp->window_us = (bp->max_us < NET_BUSY_POLL_FLOOR) ? bp->max_us : NET_BUSY_POLL_FLOOR;
+    }
+
+    return poll(pfd, nfds, timeout);
+}
+#endif
@@ -0,0 +1,1032 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Shared memory switch network driver, for emulators running
+ *          on the same Linux host.
+ *
+ *          All members of a switch map one memfd holding a receive ring
+ *          per port and a learned MAC address table. A sender looks up
+ *          the destination and copies the frame straight into the ring
+ *          of the receiving port, so a frame costs no system call unless
+ *          the receiver was asleep, in which case its eventfd is kicked.
+ *
+ *          The memfd and the eventfds are handed out over an abstract
+ *          Unix socket by whichever member currently listens on it. The
+ *          first instance creates the switch; when the listener goes
+ *          away, the next member to notice takes over, and the shared
+ *          memory lives on for as long as anyone has it mapped.
+ *
+ *          Every member stays connected to the listener, which hands
+ *          the port of a member back to the switch as soon as its end
+ *          of the connection is closed, however the member went away.
+ *
+ *          Instances with the same shared secret join the same switch.
+ *
+ * Authors: 86Box contributors.
+ *
+ *          Copyright 2026 86Box contributors.
+ */
+#include <errno.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <wchar.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#define HAVE_STDARG_H
+#include <86box/86box.h>
+#include <86box/device.h>
+#include <86box/plat.h>
+#include <86box/thread.h>
+#include <86box/timer.h>
+#include <86box/network.h>
+#include <86box/net_event.h>
+#include <86box/bswap.h>
+#include <shathree.h>
+
+#define SHMSWITCH_PKT_BATCH NET_QUEUE_LEN
+
+#define SHMSWITCH_MAGIC     0x53364238 /* "86BS" */
+#define SHMSWITCH_VERSION   2
+#define SHMSWITCH_PORTS     16
+#define SHMSWITCH_SLOTS     256 /* Per port, power of 2. */
+#define SHMSWITCH_MACS      256 /* Power of 2. */
+#define SHMSWITCH_CONNS     (2 * SHMSWITCH_PORTS)
+
+/* How often a member checks whether it has to take over the listener. */
+#define SHMSWITCH_ELECT_MS  1000
+/* How long a port may stay claimed by a member not connected to the listener. */
+#define SHMSWITCH_GRACE_MS  (10 * SHMSWITCH_ELECT_MS)
+
+#define SHMSWITCH_PORT_PROMISC 1
+
+/* Low half of a slot state, the high half is the ring position it is valid for. */
+#define SHMSWITCH_SLOT_FREE      0x00000000
+#define SHMSWITCH_SLOT_PUBLISHED 0xffffffff
+
+enum {
+    NET_EVENT_STOP = 0,
+    NET_EVENT_TX,
+    NET_EVENT_RX,
+    NET_EVENT_LISTEN,
+    NET_EVENT_LEADER,
+    NET_EVENT_MAX
+};
+
+/* Shared memory layout, identical in every member. */
+typedef struct shmswitch_slot_t {
+    atomic_ullong state; /* (pos << 32) | free, sender id or published. */
+    uint32_t      len;
+    uint8_t       data[NET_MAX_FRAME];
+} shmswitch_slot_t;
+
+typedef struct shmswitch_port_t {
+    atomic_uint      owner;   /* Nonzero while the port is in use. */
+    atomic_uint      gen;     /* Bumped whenever the port is handed back. */
+    atomic_uint      flags;
+    atomic_uint      waiting; /* The owner is about to sleep on its eventfd. */
+    atomic_uint      enq;     /* Claimed by the senders. */
+    atomic_uint      deq;     /* Advanced by the owner only. */
+    atomic_uint      drops;
+    shmswitch_slot_t slots[SHMSWITCH_SLOTS];
+} shmswitch_port_t;
+
+typedef struct shmswitch_shared_t {
+    uint32_t           magic;
+    uint32_t           version;
+    atomic_uint        leader; /* Id of the member handing out the switch, 0 if none. */
+    /* (MAC << 8) | (port + 1), 0 if unused. */
+    atomic_ullong      macs[SHMSWITCH_MACS];
+    shmswitch_port_t   ports[SHMSWITCH_PORTS];
+} shmswitch_shared_t;
+
+/* A member connected to us while we hand out the switch. */
+typedef struct shmswitch_conn_t {
+    int      fd;
+    uint32_t id; /* 0 until the member has registered its port. */
+} shmswitch_conn_t;
+
+typedef struct net_shmswitch_t {
+    shmswitch_shared_t *shm;
+    shmswitch_port_t   *port;
+    int                 port_num;
+    uint32_t            id; /* (generation << 8) | (port + 1) of our port. */
+    int                 mem_fd;
+    int                 event_fds[SHMSWITCH_PORTS];
+    int                 listen_fd;
+    int                 leader_fd; /* Our connection to the listener, if it is not us. */
+    uint32_t            elect_at;  /* plat_get_ticks() of the next listener check. */
+    struct sockaddr_un  addr;
+    socklen_t           addr_len;
+
+    /* Only used while we hand out the switch. */
+    shmswitch_conn_t    conns[SHMSWITCH_CONNS];
+    uint32_t            unseen[SHMSWITCH_PORTS]; /* Claimed without a connection since, 0 if not. */
+    uint32_t            sweep_at;
+
+    uint8_t             promisc;
+    union {
+        uint8_t  mac_addr[6];
+        uint64_t mac_addr_u64;
+    };
+    netcard_t          *card; /* netcard attached to us */
+    thread_t           *poll_tid;
+    net_evt_t           tx_event;
+    net_evt_t           stop_event;
+    netpkt_t            pkt;
+    netpkt_t            pkt_tx_v[SHMSWITCH_PKT_BATCH];
+} net_shmswitch_t;
+
+#ifdef ENABLE_SHMSWITCH_LOG
+int shmswitch_do_log = ENABLE_SHMSWITCH_LOG;
+
+static void
+shmswitch_log(const char *fmt, ...)
+{
+    va_list ap;
+
+    if (shmswitch_do_log) {
+        va_start(ap, fmt);
+        pclog_ex(fmt, ap);
+        va_end(ap);
+    }
+}
+#else
+#    define shmswitch_log(fmt, ...)
+#endif
+
+#define MAC_MASK 0xffffffffffffULL
+
+static inline uint64_t
+shmswitch_mac(const uint8_t *p)
+{
+    return ((uint64_t) p[0] << 40) | ((uint64_t) p[1] << 32) | ((uint64_t) p[2] << 24) |
+           ((uint64_t) p[3] << 16) | ((uint64_t) p[4] << 8) | (uint64_t) p[5];
+}
+
+static inline uint32_t
+shmswitch_mac_hash(uint64_t mac)
+{
+    mac ^= mac >> 23;
+    mac *= 0x2127599bf4325c37ULL;
+    mac ^= mac >> 47;
+    return (uint32_t) mac & (SHMSWITCH_MACS - 1);
+}
+
+/* Remember which port a source address lives behind. */
+static void
+shmswitch_learn(shmswitch_shared_t *shm, uint64_t mac, int port)
+{
+    const uint64_t entry = (mac << 8) | (uint64_t) (port + 1);
+    atomic_ullong *slot  = &shm->macs[shmswitch_mac_hash(mac)];
+
+    /* Collisions simply evict, the destination will be flooded. */
+    if (atomic_load_explicit(slot, memory_order_relaxed) != entry)
+        atomic_store_explicit(slot, entry, memory_order_relaxed);
+}
+
+static int
+shmswitch_lookup(shmswitch_shared_t *shm, uint64_t mac)
+{
+    const uint64_t entry = atomic_load_explicit(&shm->macs[shmswitch_mac_hash(mac)], memory_order_relaxed);
+
+    if (!entry || ((entry >> 8) != mac))
+        return -1;
+
+    return (int) (entry & 0xff) - 1;
+}
+
+static inline uint64_t
+shmswitch_slot_state(uint32_t pos, uint32_t tag)
+{
+    return ((uint64_t) pos << 32) | tag;
+}
+
+/* Never 0 or SHMSWITCH_SLOT_PUBLISHED, as the port number is stored plus one. */
+static inline uint32_t
+shmswitch_port_id(shmswitch_shared_t *shm, int port)
+{
+    return ((atomic_load(&shm->ports[port].gen) & 0xffffff) << 8) | (uint32_t) (port + 1);
+}
+
+/* Whether the port an id was handed out for has not been given back since. */
+static int
+shmswitch_id_alive(shmswitch_shared_t *shm, uint32_t id)
+{
+    const int port = (int) (id & 0xff) - 1;
+
+    if ((port < 0) || (port >= SHMSWITCH_PORTS))
+        return 0;
+
+    return atomic_load(&shm->ports[port].owner) && (shmswitch_port_id(shm, port) == id);
+}
+
+/*
+   Bounded multi-producer ring, one consumer per port. A sender claims a slot
+   by writing its id into it, and can only publish it if the slot still holds
+   that id afterwards. The receiver only takes a claimed slot back from a
+   sender whose port has been handed back, see shmswitch_port_reap(). A port
+   is only handed back once its member has gone away, or has been out of
+   touch with the listener for SHMSWITCH_GRACE_MS while everyone else found
+   it, so a sender does not write to a slot it no longer owns.
+ */
+static int
+shmswitch_port_put(net_shmswitch_t *sw, int dest, const uint8_t *data, int len)
+{
+    shmswitch_port_t *port = &sw->shm->ports[dest];
+    shmswitch_slot_t *slot;
+    uint32_t          pos;
+    uint32_t          next;
+    uint64_t          state;
+
+    for (;;) {
+        pos   = atomic_load_explicit(&port->enq, memory_order_acquire);
+        slot  = &port->slots[pos & (SHMSWITCH_SLOTS - 1)];
+        state = atomic_load_explicit(&slot->state, memory_order_acquire);
+
+        const int32_t dif = (int32_t) ((uint32_t) (state >> 32) - pos);
+
+        if (dif < 0) {
+            /* Still holds a frame from the previous lap, the ring is full. */
+            atomic_fetch_add_explicit(&port->drops, 1, memory_order_relaxed);
+            return 0;
+        }
+
+        if (dif == 0) {
+            next = pos + 1;
+            if ((uint32_t) state != SHMSWITCH_SLOT_FREE) {
+                /* Claimed by a sender that has yet to move enq on, help it along. */
+                atomic_compare_exchange_strong(&port->enq, &pos, next);
+            } else if (atomic_compare_exchange_weak_explicit(&slot->state, &state,
+                                                             shmswitch_slot_state(pos, sw->id),
+                                                             memory_order_acq_rel, memory_order_relaxed)) {
+                atomic_compare_exchange_strong(&port->enq, &pos, next);
+                break;
+            }
+        }
+    }
+
+    memcpy(slot->data, data, len);
+    slot->len = len;
+
+    /* Fails if our port was handed back and the receiver took the slot back. */
+    state = shmswitch_slot_state(pos, sw->id);
+    if (!atomic_compare_exchange_strong_explicit(&slot->state, &state,
+                                                 shmswitch_slot_state(pos, SHMSWITCH_SLOT_PUBLISHED),
+                                                 memory_order_release, memory_order_relaxed)) {
+        atomic_fetch_add_explicit(&port->drops, 1, memory_order_relaxed);
+        return 0;
+    }
+
+    /* Only kick the receiver if it has gone to sleep. */
+    if (atomic_exchange(&port->waiting, 0)) {
+        uint64_t one = 1;
+        (void) !write(sw->event_fds[dest], &one, sizeof(one));
+    }
+
+    return 1;
+}
+
+static shmswitch_slot_t *
+shmswitch_port_peek(shmswitch_port_t *port)
+{
+    const uint32_t    pos  = atomic_load_explicit(&port->deq, memory_order_relaxed);
+    shmswitch_slot_t *slot = &port->slots[pos & (SHMSWITCH_SLOTS - 1)];
+
+    if (atomic_load_explicit(&slot->state, memory_order_acquire) !=
+        shmswitch_slot_state(pos, SHMSWITCH_SLOT_PUBLISHED))
+        return NULL;
+
+    return slot;
+}
+
+static void
+shmswitch_port_pop(shmswitch_port_t *port, shmswitch_slot_t *slot)
+{
+    const uint32_t pos = atomic_load_explicit(&port->deq, memory_order_relaxed);
+
+    atomic_store_explicit(&port->deq, pos + 1, memory_order_relaxed);
+    atomic_store_explicit(&slot->state, shmswitch_slot_state(pos + SHMSWITCH_SLOTS, SHMSWITCH_SLOT_FREE),
+                          memory_order_release);
+}
+
+/*
+   A sender that dies between claiming a slot and publishing it would stall
+   the ring forever. Take such a slot back once the port of its sender has
+   been handed back; a sender that is merely slow is always waited for.
+   Returns -1 if nothing is pending, 0 if the head of the ring moved on and
+   1 if it is still being written by a live sender.
+ */
+static int
+shmswitch_port_reap(net_shmswitch_t *sw)
+{
+    shmswitch_port_t *port = sw->port;
+    const uint32_t    pos  = atomic_load_explicit(&port->deq, memory_order_relaxed);
+    shmswitch_slot_t *slot = &port->slots[pos & (SHMSWITCH_SLOTS - 1)];
+    uint64_t          state;
+    uint32_t          tag;
+
+    if (atomic_load_explicit(&port->enq, memory_order_relaxed) == pos)
+        return -1;
+
+    state = atomic_load_explicit(&slot->state, memory_order_acquire);
+    tag   = (uint32_t) state;
+    if (((uint32_t) (state >> 32) != pos) || (tag == SHMSWITCH_SLOT_FREE) || (tag == SHMSWITCH_SLOT_PUBLISHED))
+        return 0;
+
+    if (shmswitch_id_alive(sw->shm, tag))
+        return 1;
+
+    if (atomic_compare_exchange_strong_explicit(&slot->state, &state,
+                                                shmswitch_slot_state(pos + SHMSWITCH_SLOTS, SHMSWITCH_SLOT_FREE),
+                                                memory_order_acq_rel, memory_order_acquire)) {
+        atomic_store_explicit(&port->deq, pos + 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&port->drops, 1, memory_order_relaxed);
+        shmswitch_log("Shared Memory Switch: took back slot %u abandoned by port %u\n", pos, (tag & 0xff) - 1);
+    }
+
+    return 0;
+}
+
+static void
+shmswitch_forward(net_shmswitch_t *sw, const uint8_t *data, int len)
+{
+    shmswitch_shared_t *shm = sw->shm;
+    const uint64_t      dst = shmswitch_mac(data);
+    int                 dest;
+
+    shmswitch_learn(shm, shmswitch_mac(data + 6), sw->port_num);
+
+    dest = (data[0] & 1) ? -1 : shmswitch_lookup(shm, dst);
+
+    for (int i = 0; i < SHMSWITCH_PORTS; i++) {
+        if ((i == sw->port_num) || !atomic_load_explicit(&shm->ports[i].owner, memory_order_relaxed))
+            continue;
+
+        /* Unknown or group destinations are flooded, promiscuous ports see everything. */
+        if ((dest < 0) || (i == dest) ||
+            (atomic_load_explicit(&shm->ports[i].flags, memory_order_relaxed) & SHMSWITCH_PORT_PROMISC))
+            (void) shmswitch_port_put(sw, i, data, len);
+    }
+}
+
+static int
+shmswitch_receive(net_shmswitch_t *sw)
+{
+    shmswitch_slot_t *slot;
+    int               count = 0;
+
+    while ((count < SHMSWITCH_PKT_BATCH) && (slot = shmswitch_port_peek(sw->port))) {
+        const int len = slot->len;
+
+        if ((len >= 12) && (len <= NET_MAX_FRAME) &&
+            !(net_cards_conf[sw->card->card_num].link_state & NET_LINK_DOWN) &&
+            (sw->promisc ||        /* promiscuous mode? */
+             (slot->data[0] & 1) || /* broadcast packet? */
+             ((AS_U64(slot->data[0]) & le64_to_cpu(MAC_MASK)) == sw->mac_addr_u64))) { /* packet for me? */
+            /* One copy out of the ring, the queue then takes the buffer over. */
+            memcpy(sw->pkt.data, slot->data, len);
+            sw->pkt.len = len;
+            network_rx_put_pkt(sw->card, &sw->pkt);
+        }
+
+        shmswitch_port_pop(sw->port, slot);
+        count++;
+    }
+
+    return count;
+}
+
+static int
+shmswitch_send_fds(net_shmswitch_t *sw, int conn)
+{
+    int             fds[1 + SHMSWITCH_PORTS];
+    char            cbuf[CMSG_SPACE(sizeof(fds))];
+    uint32_t        magic = SHMSWITCH_MAGIC;
+    struct iovec    iov   = { .iov_base = &magic, .iov_len = sizeof(magic) };
+    struct msghdr   msg   = { 0 };
+    struct cmsghdr *cmsg;
+
+    fds[0] = sw->mem_fd;
+    memcpy(&fds[1], sw->event_fds, sizeof(sw->event_fds));
+
+    memset(cbuf, 0x00, sizeof(cbuf));
+    msg.msg_iov        = &iov;
+    msg.msg_iovlen     = 1;
+    msg.msg_control    = cbuf;
+    msg.msg_controllen = sizeof(cbuf);
+
+    cmsg             = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type  = SCM_RIGHTS;
+    cmsg->cmsg_len   = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+    return sendmsg(conn, &msg, MSG_NOSIGNAL) == sizeof(magic);
+}
+
+/* Fills in fds[1 + SHMSWITCH_PORTS], the memfd first. */
+static int
+shmswitch_recv_fds(int conn, int *fds)
+{
+    char            cbuf[CMSG_SPACE(sizeof(int) * (1 + SHMSWITCH_PORTS))];
+    uint32_t        magic = 0;
+    struct iovec    iov   = { .iov_base = &magic, .iov_len = sizeof(magic) };
+    struct msghdr   msg   = { 0 };
+    struct cmsghdr *cmsg;
+
+    msg.msg_iov        = &iov;
+    msg.msg_iovlen     = 1;
+    msg.msg_control    = cbuf;
+    msg.msg_controllen = sizeof(cbuf);
+
+    if (recvmsg(conn, &msg, MSG_CMSG_CLOEXEC) != sizeof(magic))
+        return 0;
+
+    cmsg = CMSG_FIRSTHDR(&msg);
+    if (!cmsg || (cmsg->cmsg_level != SOL_SOCKET) || (cmsg->cmsg_type != SCM_RIGHTS) ||
+        (cmsg->cmsg_len != CMSG_LEN(sizeof(int) * (1 + SHMSWITCH_PORTS))))
+        return 0;
+
+    memcpy(fds, CMSG_DATA(cmsg), sizeof(int) * (1 + SHMSWITCH_PORTS));
+    if (magic != SHMSWITCH_MAGIC) {
+        for (int i = 0; i < (1 + SHMSWITCH_PORTS); i++)
+            close(fds[i]);
+        return 0;
+    }
+
+    return 1;
+}
+
+/* Connect to the member handing out the switch, returns the connection or -1. */
+static int
+shmswitch_connect(net_shmswitch_t *sw, int *fds)
+{
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+    if (fd < 0)
+        return -1;
+
+    if ((connect(fd, (struct sockaddr *) &sw->addr, sw->addr_len) < 0) || !shmswitch_recv_fds(fd, fds)) {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+/* Tell the listener which port is ours, so it can hand it back once we are gone. */
+static void
+shmswitch_register(net_shmswitch_t *sw)
+{
+    if ((sw->leader_fd >= 0) && (send(sw->leader_fd, &sw->id, sizeof(sw->id), MSG_NOSIGNAL) != sizeof(sw->id))) {
+        close(sw->leader_fd);
+        sw->leader_fd = -1;
+    }
+}
+
+/* Become the member that hands out the switch, returns 0 if someone else is. */
+static int
+shmswitch_listen(net_shmswitch_t *sw)
+{
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+
+    if (fd < 0)
+        return 0;
+
+    if ((bind(fd, (struct sockaddr *) &sw->addr, sw->addr_len) < 0) || (listen(fd, SHMSWITCH_PORTS) < 0)) {
+        close(fd);
+        return 0;
+    }
+
+    sw->listen_fd = fd;
+    for (int i = 0; i < SHMSWITCH_CONNS; i++)
+        sw->conns[i].fd = -1;
+    memset(sw->unseen, 0x00, sizeof(sw->unseen));
+    sw->sweep_at = plat_get_ticks() + SHMSWITCH_ELECT_MS;
+    shmswitch_log("Shared Memory Switch: now handing out the switch\n");
+
+    return 1;
+}
+
+static int
+shmswitch_create(net_shmswitch_t *sw)
+{
+    sw->mem_fd = memfd_create("86Box-shmswitch", MFD_CLOEXEC);
+    if ((sw->mem_fd < 0) || (ftruncate(sw->mem_fd, sizeof(shmswitch_shared_t)) < 0))
+        return 0;
+
+    for (int i = 0; i < SHMSWITCH_PORTS; i++) {
+        sw->event_fds[i] = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        if (sw->event_fds[i] < 0)
+            return 0;
+    }
+
+    return 1;
+}
+
+static int
+shmswitch_join(net_shmswitch_t *sw, int *created)
+{
+    int fds[1 + SHMSWITCH_PORTS];
+
+    *created = 0;
+
+    /* Someone might be creating or leaving the switch at the same time. */
+    for (int tries = 0; tries < 10; tries++) {
+        sw->leader_fd = shmswitch_connect(sw, fds);
+        if (sw->leader_fd >= 0) {
+            sw->mem_fd = fds[0];
+            memcpy(sw->event_fds, &fds[1], sizeof(sw->event_fds));
+            return 1;
+        }
+
+        if (shmswitch_listen(sw)) {
+            *created = 1;
+            return shmswitch_create(sw);
+        }
+
+        usleep(10000);
+    }
+
+    return 0;
+}
+
+static int
+shmswitch_claim_port(net_shmswitch_t *sw)
+{
+    for (int i = 0; i < SHMSWITCH_PORTS; i++) {
+        shmswitch_port_t *port  = &sw->shm->ports[i];
+        uint32_t          owner = 0;
+
+        if (!atomic_compare_exchange_strong(&port->owner, &owner, 1))
+            continue;
+
+        sw->port     = port;
+        sw->port_num = i;
+        sw->id       = shmswitch_port_id(sw->shm, i);
+
+        atomic_store(&port->flags, sw->promisc ? SHMSWITCH_PORT_PROMISC : 0);
+        atomic_store(&port->waiting, 0);
+
+        /* Discard whatever the previous owner left in the ring. */
+        shmswitch_slot_t *slot;
+        while ((slot = shmswitch_port_peek(port)))
+            shmswitch_port_pop(port, slot);
+
+        return 1;
+    }
+
+    return 0;
+}
+
+/* Hand a port back to the switch, unless that has already happened since id was handed out. */
+static void
+shmswitch_release_port(net_shmswitch_t *sw, uint32_t id)
+{
+    shmswitch_shared_t *shm  = sw->shm;
+    const int           num  = (int) (id & 0xff) - 1;
+    shmswitch_port_t   *port = &shm->ports[num];
+    uint32_t            gen  = atomic_load(&port->gen);
+
+    if (((gen & 0xffffff) != (id >> 8)) || !atomic_compare_exchange_strong(&port->gen, &gen, gen + 1))
+        return;
+
+    /* Forget the addresses behind the port. */
+    for (int i = 0; i < SHMSWITCH_MACS; i++) {
+        uint64_t entry = atomic_load(&shm->macs[i]);
+        if (entry && ((int) (entry & 0xff) == (num + 1)))
+            atomic_compare_exchange_strong(&shm->macs[i], &entry, 0);
+    }
+    atomic_store(&port->owner, 0);
+
+    /* Receivers may be waiting for slots the port had claimed in their rings. */
+    for (int i = 0; i < SHMSWITCH_PORTS; i++) {
+        uint64_t one = 1;
+        if ((i != num) && atomic_load(&shm->ports[i].owner) && (sw->event_fds[i] >= 0))
+            (void) !write(sw->event_fds[i], &one, sizeof(one));
+    }
+
+    shmswitch_log("Shared Memory Switch: port %i handed back\n", num);
+}
+
+/* We just started handing out the switch, so whoever did before is gone. */
+static void
+shmswitch_take_over(net_shmswitch_t *sw)
+{
+    uint32_t leader = atomic_load(&sw->shm->leader);
+
+    if (leader && (leader != sw->id))
+        shmswitch_release_port(sw, leader);
+    atomic_store(&sw->shm->leader, sw->id);
+}
+
+static void
+shmswitch_drop_conn(net_shmswitch_t *sw, shmswitch_conn_t *conn)
+{
+    if (conn->id)
+        shmswitch_release_port(sw, conn->id);
+    close(conn->fd);
+    conn->fd = -1;
+    conn->id = 0;
+}
+
+static void
+shmswitch_accept(net_shmswitch_t *sw)
+{
+    int conn;
+
+    while ((conn = accept4(sw->listen_fd, NULL, NULL, SOCK_CLOEXEC | SOCK_NONBLOCK)) >= 0) {
+        int i;
+
+        for (i = 0; i < SHMSWITCH_CONNS; i++) {
+            if (sw->conns[i].fd < 0)
+                break;
+        }
+
+        if ((i == SHMSWITCH_CONNS) || !shmswitch_send_fds(sw, conn)) {
+            shmswitch_log("Shared Memory Switch: could not hand out the switch\n");
+            close(conn);
+            continue;
+        }
+
+        sw->conns[i].fd = conn;
+        sw->conns[i].id = 0;
+    }
+}
+
+/* A member registered its port, or went away. */
+static void
+shmswitch_conn_read(net_shmswitch_t *sw, shmswitch_conn_t *conn)
+{
+    uint32_t id;
+    ssize_t  ret;
+
+    while ((ret = recv(conn->fd, &id, sizeof(id), 0)) == sizeof(id)) {
+        if (conn->id && (conn->id != id))
+            shmswitch_release_port(sw, conn->id);
+        conn->id = id;
+    }
+
+    if ((ret == 0) || ((ret < 0) && (errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR)))
+        shmswitch_drop_conn(sw, conn);
+}
+
+/*
+   Hand back ports claimed by members that never connected to us, such as
+   ones that died while nobody was handing out the switch.
+ */
+static void
+shmswitch_sweep(net_shmswitch_t *sw, uint32_t now)
+{
+    for (int i = 0; i < SHMSWITCH_PORTS; i++) {
+        const uint32_t id   = shmswitch_port_id(sw->shm, i);
+        int            seen = (i == sw->port_num);
+
+        if (!atomic_load(&sw->shm->ports[i].owner)) {
+            sw->unseen[i] = 0;
+            continue;
+        }
+
+        for (int j = 0; !seen && (j < SHMSWITCH_CONNS); j++)
+            seen = (sw->conns[j].fd >= 0) && (sw->conns[j].id == id);
+
+        if (seen)
+            sw->unseen[i] = 0;
+        else if (!sw->unseen[i])
+            sw->unseen[i] = now | 1;
+        else if ((now - sw->unseen[i]) >= SHMSWITCH_GRACE_MS) {
+            shmswitch_release_port(sw, id);
+            sw->unseen[i] = 0;
+        }
+    }
+}
+
+/* Our connection to the listener was closed, see whether we have to take over. */
+static void
+shmswitch_elect(net_shmswitch_t *sw, uint32_t now)
+{
+    int fds[1 + SHMSWITCH_PORTS];
+
+    if (shmswitch_listen(sw)) {
+        shmswitch_take_over(sw);
+        return;
+    }
+
+    sw->leader_fd = shmswitch_connect(sw, fds);
+    if (sw->leader_fd < 0) {
+        sw->elect_at = now + SHMSWITCH_ELECT_MS;
+        return;
+    }
+
+    /* We already have the switch mapped. */
+    for (int i = 0; i < (1 + SHMSWITCH_PORTS); i++)
+        close(fds[i]);
+    shmswitch_register(sw);
+}
+
+static void
+net_shmswitch_in_available(void *priv)
+{
+    net_shmswitch_t *sw = (net_shmswitch_t *) priv;
+    net_event_set(&sw->tx_event);
+}
+
+static void
+net_shmswitch_thread(void *priv)
+{
+    net_shmswitch_t *sw = (net_shmswitch_t *) priv;
+    struct pollfd    pfd[NET_EVENT_MAX + SHMSWITCH_CONNS];
+
+    shmswitch_log("Shared Memory Switch: polling started on port %i\n", sw->port_num);
+
+    pfd[NET_EVENT_STOP].fd     = net_event_get_fd(&sw->stop_event);
+    pfd[NET_EVENT_STOP].events = POLLIN | POLLPRI;
+
+    pfd[NET_EVENT_TX].fd     = net_event_get_fd(&sw->tx_event);
+    pfd[NET_EVENT_TX].events = POLLIN | POLLPRI;
+
+    pfd[NET_EVENT_RX].fd     = sw->event_fds[sw->port_num];
+    pfd[NET_EVENT_RX].events = POLLIN;
+
+    pfd[NET_EVENT_LISTEN].events = POLLIN;
+    pfd[NET_EVENT_LEADER].events = POLLIN;
+    for (int i = 0; i < SHMSWITCH_CONNS; i++)
+        pfd[NET_EVENT_MAX + i].events = POLLIN;
+
+    sw->elect_at = plat_get_ticks() + SHMSWITCH_ELECT_MS;
+
+    while (1) {
+        uint32_t now = plat_get_ticks();
+        int      timeout;
+        int      nfds = NET_EVENT_MAX;
+
+        pfd[NET_EVENT_LISTEN].fd = sw->listen_fd;
+        pfd[NET_EVENT_LEADER].fd = sw->leader_fd;
+        if (sw->listen_fd >= 0) {
+            for (int i = 0; i < SHMSWITCH_CONNS; i++)
+                pfd[NET_EVENT_MAX + i].fd = sw->conns[i].fd;
+            nfds += SHMSWITCH_CONNS;
+        }
+
+        /* Announce the sleep before the last look at the ring, see shmswitch_port_put(). */
+        atomic_store(&sw->port->waiting, 1);
+        if (shmswitch_port_peek(sw->port))
+            timeout = 0;
+        else {
+            /* Handing back the port of a sender kicks us, the timeout is only a safety net. */
+            timeout = shmswitch_port_reap(sw);
+            if (timeout > 0)
+                timeout = SHMSWITCH_ELECT_MS;
+
+            const uint32_t at = (sw->listen_fd >= 0) ? sw->sweep_at : sw->elect_at;
+            if ((sw->listen_fd >= 0) || (sw->leader_fd < 0)) {
+                const int32_t wait = (int32_t) (at - now);
+                const int     left = (wait > 0) ? wait : 0;
+
+                if ((timeout < 0) || (left < timeout))
+                    timeout = left;
+            }
+        }
+
+        int ret = poll(pfd, nfds, timeout);
+        atomic_store(&sw->port->waiting, 0);
+
+        if (ret < 0) {
+            if (errno == EINTR)
+                continue;
+            shmswitch_log("Shared Memory Switch: poll error: %s\n", strerror(errno));
+            break;
+        }
+
+        if (pfd[NET_EVENT_STOP].revents & POLLIN) {
+            net_event_clear(&sw->stop_event);
+            break;
+        }
+
+        if (pfd[NET_EVENT_TX].revents & POLLIN) {
+            net_event_clear(&sw->tx_event);
+
+            int packets = network_tx_popv(sw->card, sw->pkt_tx_v, SHMSWITCH_PKT_BATCH);
+            if (!(net_cards_conf[sw->card->card_num].link_state & NET_LINK_DOWN)) {
+                for (int i = 0; i < packets; i++) {
+                    if (sw->pkt_tx_v[i].len >= 12)
+                        shmswitch_forward(sw, sw->pkt_tx_v[i].data, sw->pkt_tx_v[i].len);
+                }
+            }
+        }
+
+        if (pfd[NET_EVENT_RX].revents & POLLIN) {
+            uint64_t count;
+            (void) !read(sw->event_fds[sw->port_num], &count, sizeof(count));
+        }
+
+        shmswitch_receive(sw);
+
+        /* The listener never writes to us, so anything readable means it went away. */
+        if ((sw->leader_fd >= 0) && (pfd[NET_EVENT_LEADER].revents & (POLLIN | POLLHUP | POLLERR))) {
+            close(sw->leader_fd);
+            sw->leader_fd = -1;
+            sw->elect_at  = plat_get_ticks();
+        }
+
+        /* Our port was handed back while we were unreachable, get a new one. */
+        if (shmswitch_port_id(sw->shm, sw->port_num) != sw->id) {
+            shmswitch_log("Shared Memory Switch: lost port %i\n", sw->port_num);
+            if (!shmswitch_claim_port(sw)) {
+                shmswitch_log("Shared Memory Switch: all ports are in use\n");
+                break;
+            }
+            pfd[NET_EVENT_RX].fd = sw->event_fds[sw->port_num];
+            if (sw->listen_fd >= 0)
+                atomic_store(&sw->shm->leader, sw->id);
+            else
+                shmswitch_register(sw);
+        }
+
+        now = plat_get_ticks();
+        if (sw->listen_fd >= 0) {
+            if (pfd[NET_EVENT_LISTEN].revents & POLLIN)
+                shmswitch_accept(sw);
+            for (int i = 0; i < SHMSWITCH_CONNS; i++) {
+                if ((sw->conns[i].fd >= 0) && (pfd[NET_EVENT_MAX + i].fd == sw->conns[i].fd) &&
+                    (pfd[NET_EVENT_MAX + i].revents & (POLLIN | POLLHUP | POLLERR)))
+                    shmswitch_conn_read(sw, &sw->conns[i]);
+            }
+            if ((int32_t) (now - sw->sweep_at) >= 0) {
+                shmswitch_sweep(sw, now);
+                sw->sweep_at = now + SHMSWITCH_ELECT_MS;
+            }
+        } else if ((sw->leader_fd < 0) && ((int32_t) (now - sw->elect_at) >= 0)) {
+            /* Take over handing out the switch if its previous owner is gone,
+               however busy the ring is, and back off while someone else has it. */
+            shmswitch_elect(sw, now);
+        }
+    }
+
+    shmswitch_log("Shared Memory Switch: polling stopped\n");
+}
+
+static void net_shmswitch_close(void *priv);
+
+void *
+net_shmswitch_init(const netcard_t *card, const uint8_t *mac_addr, void *priv, char *netdrv_errbuf)
+{
+    netcard_conf_t  *netcard = (netcard_conf_t *) priv;
+    net_shmswitch_t *sw      = calloc(1, sizeof(net_shmswitch_t));
+    int              created;
+
+    memcpy(sw->mac_addr, mac_addr, sizeof(sw->mac_addr));
+    sw->card      = (netcard_t *) card;
+    sw->promisc   = !!netcard->promisc_mode;
+    sw->mem_fd    = -1;
+    sw->listen_fd = -1;
+    sw->leader_fd = -1;
+    sw->port_num  = -1;
+    for (int i = 0; i < SHMSWITCH_PORTS; i++)
+        sw->event_fds[i] = -1;
+
+    if (!atomic_is_lock_free(&((shmswitch_shared_t *) NULL)->macs[0])) {
+        strncpy(netdrv_errbuf, "Shared memory switch requires lock-free 64-bit atomics\n", NET_DRV_ERRBUF_SIZE);
+        goto fail;
+    }
+
+    /* The switch is named after a hash of the shared secret. */
+    SHA3Context cx;
+    SHA3Init(&cx, 256);
+    SHA3Update(&cx, (const uint8_t *) netcard->secret, strlen(netcard->secret));
+    const uint8_t *hash = SHA3Final(&cx);
+
+    sw->addr.sun_family = AF_UNIX;
+    int len = snprintf(&sw->addr.sun_path[1], sizeof(sw->addr.sun_path) - 1, "86Box-shmswitch-");
+    for (int i = 0; i < 8; i++)
+        len += snprintf(&sw->addr.sun_path[1 + len], sizeof(sw->addr.sun_path) - 1 - len, "%02x", hash[i]);
+    sw->addr_len = offsetof(struct sockaddr_un, sun_path) + 1 + len;
+
+    if (!shmswitch_join(sw, &created)) {
+        strncpy(netdrv_errbuf, "Could not create or join the shared memory switch\n", NET_DRV_ERRBUF_SIZE);
+        goto fail;
+    }
+
+    sw->shm = mmap(NULL, sizeof(shmswitch_shared_t), PROT_READ | PROT_WRITE, MAP_SHARED, sw->mem_fd, 0);
+    if (sw->shm == MAP_FAILED) {
+        sw->shm = NULL;
+        strncpy(netdrv_errbuf, "Could not map the shared memory switch\n", NET_DRV_ERRBUF_SIZE);
+        goto fail;
+    }
+
+    if (created) {
+        /* The memfd starts out zeroed, only the ring positions need setting up. */
+        for (int i = 0; i < SHMSWITCH_PORTS; i++)
+            for (uint32_t j = 0; j < SHMSWITCH_SLOTS; j++)
+                atomic_init(&sw->shm->ports[i].slots[j].state, shmswitch_slot_state(j, SHMSWITCH_SLOT_FREE));
+        sw->shm->version = SHMSWITCH_VERSION;
+        atomic_thread_fence(memory_order_release);
+        sw->shm->magic = SHMSWITCH_MAGIC;
+    } else if ((sw->shm->magic != SHMSWITCH_MAGIC) || (sw->shm->version != SHMSWITCH_VERSION)) {
+        strncpy(netdrv_errbuf, "Incompatible shared memory switch\n", NET_DRV_ERRBUF_SIZE);
+        goto fail;
+    }
+
+    if (!shmswitch_claim_port(sw)) {
+        strncpy(netdrv_errbuf, "All shared memory switch ports are in use\n", NET_DRV_ERRBUF_SIZE);
+        goto fail;
+    }
+
+    if (sw->listen_fd >= 0)
+        atomic_store(&sw->shm->leader, sw->id);
+    else
+        shmswitch_register(sw);
+
+    shmswitch_log("Shared Memory Switch: %s switch, port %i\n", created ? "created" : "joined", sw->port_num);
+
+    for (int i = 0; i < SHMSWITCH_PKT_BATCH; i++)
+        sw->pkt_tx_v[i].data = calloc(1, NET_MAX_FRAME);
+    sw->pkt.data = calloc(1, NET_MAX_FRAME);
+    net_event_init(&sw->tx_event);
+    net_event_init(&sw->stop_event);
+
+    shmswitch_log("Shared Memory Switch: creating thread...\n");
+    sw->poll_tid = thread_create(net_shmswitch_thread, sw);
+
+    return sw;
+
+fail:
+    net_shmswitch_close(sw);
+    return NULL;
+}
+
+void
+net_shmswitch_close(void *priv)
+{
+    if (!priv)
+        return;
+
+    net_shmswitch_t *sw = (net_shmswitch_t *) priv;
+
+    shmswitch_log("Shared Memory Switch: closing\n");
+
+    if (sw->poll_tid) {
+        /* Tell the polling thread to shut down. */
+        net_event_set(&sw->stop_event);
+
+        /* Wait for the thread to finish. */
+        shmswitch_log("Shared Memory Switch: waiting for thread to end...\n");
+        thread_wait(sw->poll_tid);
+
+        net_event_close(&sw->stop_event);
+        net_event_close(&sw->tx_event);
+    }
+
+    if (sw->port != NULL) {
+        if (sw->listen_fd >= 0) {
+            uint32_t leader = sw->id;
+            atomic_compare_exchange_strong(&sw->shm->leader, &leader, 0);
+        }
+        shmswitch_release_port(sw, sw->id);
+    }
+
+    if (sw->listen_fd >= 0) {
+        for (int i = 0; i < SHMSWITCH_CONNS; i++) {
+            if (sw->conns[i].fd >= 0)
+                close(sw->conns[i].fd);
+        }
+        close(sw->listen_fd);
+    }
+    if (sw->leader_fd >= 0)
+        close(sw->leader_fd);
+    if (sw->shm != NULL)
+        munmap(sw->shm, sizeof(shmswitch_shared_t));
+    if (sw->mem_fd >= 0)
+        close(sw->mem_fd);
+    for (int i = 0; i < SHMSWITCH_PORTS; i++) {
+        if (sw->event_fds[i] >= 0)
+            close(sw->event_fds[i]);
+    }
+    for (int i = 0; i < SHMSWITCH_PKT_BATCH; i++)
+        free(sw->pkt_tx_v[i].data);
+    free(sw->pkt.data);
+    free(sw);
+}
+
+const netdrv_t net_shmswitch_drv = {
+    .notify_in = &net_shmswitch_in_available,
+    .init      = &net_shmswitch_init,
+    .close     = &net_shmswitch_close,
+    .priv      = NULL
+};
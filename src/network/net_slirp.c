@@ -407,6 +407,7 @@ net_slirp_thread(void *priv)
 
             case NET_EVENT_TX:
                 {
+                    net_event_clear(&slirp->tx_event);
                     slirp->during_tx = 1;
                     int packets = network_tx_popv(slirp->card, slirp->pkt_tx_v, SLIRP_PKT_BATCH);
                     if (!(net_cards_conf[slirp->card->card_num].link_state & NET_LINK_DOWN)) {
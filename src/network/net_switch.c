@@ -28,6 +28,7 @@
 #    include <iphlpapi.h>
 #    define IFF_POINTOPOINT IFF_POINTTOPOINT
 #else
+#    include <errno.h>
 #    include <unistd.h>
 #    include <poll.h>
 #    include <sys/types.h>
@@ -51,11 +52,12 @@
 #include <86box/bswap.h>
 #include <shathree.h>
 
-#define SWITCH_PKT_BATCH NET_QUEUE_LEN
-
 #define SWITCH_MULTICAST_GROUP 0xefff5056 /* 239.255.80.86 */
 #define SWITCH_MULTICAST_PORT  8086
 
+#define MAC_FORMAT "(%02X:%02X:%02X:%02X:%02X:%02X -> %02X:%02X:%02X:%02X:%02X:%02X)"
+#define MAC_FORMAT_ARGS(p) (p)[6], (p)[7], (p)[8], (p)[9], (p)[10], (p)[11], (p)[0], (p)[1], (p)[2], (p)[3], (p)[4], (p)[5]
+
 enum {
     NET_EVENT_STOP = 0,
     NET_EVENT_TX,
@@ -93,11 +95,21 @@ typedef struct net_switch_t {
     net_evt_t      tx_event;
     net_evt_t      stop_event;
     netpkt_t       pkt;
-    netpkt_t       pkt_tx_v[SWITCH_PKT_BATCH];
+    netpkt_t      *pkt_tx_v;
+    int            batch;
     int            during_tx;
     int            recv_on_tx;
 #ifdef _WIN32
     HANDLE         sock_event;
+#else
+    net_busy_poll_t busy_poll;
+#endif
+#ifdef __linux__
+    /* Batched socket I/O, shared by both directions. */
+    netpkt_t       *pkt_rx_v;
+    struct mmsghdr *msgs;
+    struct iovec   *iovs;
+    uint8_t        *hash_rx;
 #endif
 } net_switch_t;
 
@@ -341,6 +353,118 @@ retry:
     }
 }
 
+static void
+net_switch_rx_frame(net_switch_t *netswitch, netpkt_t *pkt, int len)
+{
+    if ((AS_U64(pkt->data[6]) & le64_to_cpu(0xffffffffffffULL)) == netswitch->mac_addr_u64) {
+        /* A packet we've sent has looped back, drop it. */
+    } else if (!(net_cards_conf[netswitch->card->card_num].link_state & NET_LINK_DOWN) && (netswitch->promisc || /* promiscuous mode? */
+               (pkt->data[0] & 1) || /* broadcast packet? */
+               ((AS_U64(pkt->data[0]) & le64_to_cpu(0xffffffffffffULL)) == netswitch->mac_addr_u64))) { /* packet for me? */
+        netswitch_log("Network Switch: receiving %d-byte packet " MAC_FORMAT "\n",
+                      len, MAC_FORMAT_ARGS(pkt->data));
+        pkt->len = len;
+        if (netswitch->during_tx) {
+            network_rx_on_tx_put_pkt(netswitch->card, pkt);
+            netswitch->recv_on_tx = 1;
+        } else {
+            network_rx_put_pkt(netswitch->card, pkt);
+        }
+    } else {
+        netswitch_log("Network Switch: dropping %d-byte packet " MAC_FORMAT "\n",
+                      len, MAC_FORMAT_ARGS(pkt->data));
+    }
+}
+
+#ifdef __linux__
+/* The secret hash goes out as its own iovec, so frames are never copied. */
+static void
+net_switch_send_batch(net_switch_t *netswitch, int packets)
+{
+    struct mmsghdr *msgs     = netswitch->msgs;
+    struct iovec   *iov      = netswitch->iovs;
+    const int       hash_len = netswitch->secret_enabled ? sizeof(netswitch->secret_hash) : 0;
+
+    for (int i = 0; i < packets; i++, iov += 2) {
+        netswitch_log("Network Switch: sending %d-byte packet " MAC_FORMAT "\n",
+                      netswitch->pkt_tx_v[i].len,
+                      MAC_FORMAT_ARGS(netswitch->pkt_tx_v[i].data));
+
+        iov[0].iov_base = netswitch->secret_hash;
+        iov[0].iov_len  = hash_len;
+        iov[1].iov_base = netswitch->pkt_tx_v[i].data;
+        iov[1].iov_len  = netswitch->pkt_tx_v[i].len;
+
+        memset(&msgs[i].msg_hdr, 0x00, sizeof(msgs[i].msg_hdr));
+        msgs[i].msg_hdr.msg_iov    = hash_len ? iov : (iov + 1);
+        msgs[i].msg_hdr.msg_iovlen = hash_len ? 2 : 1;
+    }
+
+    /* Send through all known host interfaces, one system call per batch each. */
+    for (net_switch_hostaddr_t *hostaddr = netswitch->hostaddrs; hostaddr; hostaddr = hostaddr->next) {
+        for (int i = 0; i < packets; i++) {
+            msgs[i].msg_hdr.msg_name    = &hostaddr->addr_tx.sa;
+            msgs[i].msg_hdr.msg_namelen = sizeof(hostaddr->addr_tx.sa);
+        }
+
+        for (int sent = 0; sent < packets;) {
+            int ret = sendmmsg(hostaddr->socket_tx, &msgs[sent], packets - sent, 0);
+            if (ret > 0)
+                sent += ret;
+            else if ((ret < 0) && (errno == EINTR))
+                continue;
+            else
+                sent++; /* Skip the frame that failed, like a failed sendto(). */
+        }
+    }
+}
+
+static void
+net_switch_recv_batch(net_switch_t *netswitch)
+{
+    struct mmsghdr *msgs     = netswitch->msgs;
+    struct iovec   *iov      = netswitch->iovs;
+    const int       hash_len = netswitch->secret_enabled ? sizeof(netswitch->secret_hash) : 0;
+    int             received;
+
+    /* Refill every time, delivering a frame swaps its buffer out. */
+    for (int i = 0; i < netswitch->batch; i++, iov += 2) {
+        iov[0].iov_base = &netswitch->hash_rx[i * sizeof(netswitch->secret_hash)];
+        iov[0].iov_len  = hash_len;
+        iov[1].iov_base = netswitch->pkt_rx_v[i].data;
+        iov[1].iov_len  = NET_MAX_FRAME;
+
+        memset(&msgs[i].msg_hdr, 0x00, sizeof(msgs[i].msg_hdr));
+        msgs[i].msg_hdr.msg_iov    = hash_len ? iov : (iov + 1);
+        msgs[i].msg_hdr.msg_iovlen = hash_len ? 2 : 1;
+    }
+
+    received = recvmmsg(netswitch->socket_rx, msgs, netswitch->batch, MSG_DONTWAIT, NULL);
+    if (received < 0) {
+        netswitch_log("Network Switch: recvmmsg error (%d)\n", errno);
+        return;
+    }
+
+    for (int i = 0; i < received; i++) {
+        int len = msgs[i].msg_len;
+
+        if (len < (hash_len + 12)) {
+            netswitch_log("Network Switch: recv error (%d)\n", len);
+            continue;
+        }
+
+        if (hash_len) {
+            /* A packet with a different secret hash is ignored. */
+            if (memcmp(&netswitch->hash_rx[i * sizeof(netswitch->secret_hash)], netswitch->secret_hash, hash_len) != 0)
+                continue;
+            len -= hash_len;
+        }
+
+        net_switch_rx_frame(netswitch, &netswitch->pkt_rx_v[i], len);
+    }
+}
+#endif
+
 static void
 net_switch_thread(void *priv)
 {
@@ -369,7 +493,9 @@ net_switch_thread(void *priv)
 #endif
 
     int packets;
+#ifndef __linux__
     ssize_t len;
+#endif
 #ifdef _WIN32
     uint8_t run = 1;
     while (run) {
@@ -379,7 +505,7 @@ net_switch_thread(void *priv)
                 run = 0;
 #else
     while (1) {
-        poll(pfd, NET_EVENT_MAX, -1);
+        net_event_poll(pfd, NET_EVENT_MAX, -1, &netswitch->busy_poll);
         if (pfd[NET_EVENT_STOP].revents & POLLIN) {
 #endif
             net_event_clear(&netswitch->stop_event);
@@ -393,8 +519,11 @@ net_switch_thread(void *priv)
 #endif
             net_event_clear(&netswitch->tx_event);
             netswitch->during_tx = 1;
-            packets = network_tx_popv(netswitch->card, netswitch->pkt_tx_v, SWITCH_PKT_BATCH);
+            packets = network_tx_popv(netswitch->card, netswitch->pkt_tx_v, netswitch->batch);
             if (!(net_cards_conf[netswitch->card->card_num].link_state & NET_LINK_DOWN)) {
+#ifdef __linux__
+                net_switch_send_batch(netswitch, packets);
+#else
                 for (int i = 0; i < packets; i++) {
                     int orig_len = netswitch->pkt_tx_v[i].len;
                     int send_len = orig_len;
@@ -408,8 +537,6 @@ net_switch_thread(void *priv)
                                netswitch->pkt_tx_v[i].data, orig_len);
                     }
 
-#define MAC_FORMAT "(%02X:%02X:%02X:%02X:%02X:%02X -> %02X:%02X:%02X:%02X:%02X:%02X)"
-#define MAC_FORMAT_ARGS(p) (p)[6], (p)[7], (p)[8], (p)[9], (p)[10], (p)[11], (p)[0], (p)[1], (p)[2], (p)[3], (p)[4], (p)[5]
                     netswitch_log("Network Switch: sending %d-byte packet " MAC_FORMAT "\n",
                                   netswitch->pkt_tx_v[i].len,
                                   MAC_FORMAT_ARGS(netswitch->pkt_tx_v[i].data));
@@ -419,12 +546,13 @@ net_switch_thread(void *priv)
                         sendto(hostaddr->socket_tx, (char *) (netswitch->secret_enabled ? augmented : netswitch->pkt_tx_v[i].data),
                                send_len, 0, &hostaddr->addr_tx.sa, sizeof(hostaddr->addr_tx.sa));
                 }
+#endif
             }
             netswitch->during_tx = 0;
 
             if (netswitch->recv_on_tx) {
                 do {
-                    packets = network_rx_on_tx_popv(netswitch->card, netswitch->pkt_tx_v, SWITCH_PKT_BATCH);
+                    packets = network_rx_on_tx_popv(netswitch->card, netswitch->pkt_tx_v, netswitch->batch);
                     if (!(net_cards_conf[netswitch->card->card_num].link_state & NET_LINK_DOWN)) {
                         for (int i = 0; i < packets; i++)
                             network_rx_put_pkt(netswitch->card, &(netswitch->pkt_tx_v[i]));
@@ -440,6 +568,9 @@ net_switch_thread(void *priv)
         }
         if (pfd[NET_EVENT_RX].revents & POLLIN) {
 #endif
+#ifdef __linux__
+            net_switch_recv_batch(netswitch);
+#else
             if (netswitch->secret_enabled) {
                 len = recv(netswitch->socket_rx, (char *) netswitch->pkt.data, NET_MAX_FRAME + sizeof(netswitch->secret_hash), 0);
                 if (len < (sizeof(netswitch->secret_hash) + 12)) {
@@ -465,24 +596,8 @@ net_switch_thread(void *priv)
                 }
             }
 
-            if ((AS_U64(netswitch->pkt.data[6]) & le64_to_cpu(0xffffffffffffULL)) == netswitch->mac_addr_u64) {
-                /* A packet we've sent has looped back, drop it. */
-            } else if (!(net_cards_conf[netswitch->card->card_num].link_state & NET_LINK_DOWN) && (netswitch->promisc || /* promiscuous mode? */
-                       (netswitch->pkt.data[0] & 1) || /* broadcast packet? */
-                       ((AS_U64(netswitch->pkt.data[0]) & le64_to_cpu(0xffffffffffffULL)) == netswitch->mac_addr_u64))) { /* packet for me? */
-                netswitch_log("Network Switch: receiving %d-byte packet " MAC_FORMAT "\n",
-                              len, MAC_FORMAT_ARGS(netswitch->pkt.data));
-                netswitch->pkt.len = len;
-                if (netswitch->during_tx) {
-                    network_rx_on_tx_put_pkt(netswitch->card, &netswitch->pkt);
-                    netswitch->recv_on_tx = 1;
-                } else {
-                    network_rx_put_pkt(netswitch->card, &netswitch->pkt);
-                }
-            } else {
-                netswitch_log("Network Switch: dropping %d-byte packet " MAC_FORMAT "\n",
-                              len, MAC_FORMAT_ARGS(netswitch->pkt.data));
-            }
+            net_switch_rx_frame(netswitch, &netswitch->pkt, len);
+#endif
 #ifdef _WIN32
                 break;
 #endif
@@ -552,9 +667,22 @@ net_switch_init(const netcard_t *card, const uint8_t *mac_addr, void *priv, char
         goto fail;
     }
 
-    for (int i = 0; i < SWITCH_PKT_BATCH; i++)
+    netswitch->batch    = network_host_batch(card);
+    netswitch->pkt_tx_v = calloc(netswitch->batch, sizeof(netpkt_t));
+    for (int i = 0; i < netswitch->batch; i++)
         netswitch->pkt_tx_v[i].data = calloc(1, NET_MAX_FRAME);
     netswitch->pkt.data = calloc(1, NET_MAX_FRAME);
+#ifdef __linux__
+    netswitch->pkt_rx_v = calloc(netswitch->batch, sizeof(netpkt_t));
+    for (int i = 0; i < netswitch->batch; i++)
+        netswitch->pkt_rx_v[i].data = calloc(1, NET_MAX_FRAME);
+    netswitch->msgs    = calloc(netswitch->batch, sizeof(struct mmsghdr));
+    netswitch->iovs    = calloc(netswitch->batch * 2, sizeof(struct iovec));
+    netswitch->hash_rx = calloc(netswitch->batch, sizeof(netswitch->secret_hash));
+#endif
+#ifndef _WIN32
+    net_busy_poll_init(&netswitch->busy_poll, netcard->busy_poll);
+#endif
     net_event_init(&netswitch->tx_event);
     net_event_init(&netswitch->stop_event);
 #ifdef _WIN32
@@ -602,9 +730,22 @@ net_switch_close(void *priv)
         close(netswitch->socket_rx);
     net_event_close(&netswitch->stop_event);
     net_event_close(&netswitch->tx_event);
-    for (int i = 0; i < SWITCH_PKT_BATCH; i++)
-        free(netswitch->pkt_tx_v[i].data);
+    if (netswitch->pkt_tx_v) {
+        for (int i = 0; i < netswitch->batch; i++)
+            free(netswitch->pkt_tx_v[i].data);
+        free(netswitch->pkt_tx_v);
+    }
     free(netswitch->pkt.data);
+#ifdef __linux__
+    if (netswitch->pkt_rx_v) {
+        for (int i = 0; i < netswitch->batch; i++)
+            free(netswitch->pkt_rx_v[i].data);
+        free(netswitch->pkt_rx_v);
+    }
+    free(netswitch->msgs);
+    free(netswitch->iovs);
+    free(netswitch->hash_rx);
+#endif
     free(netswitch);
 }
 
@@ -84,7 +84,9 @@ typedef struct net_tap_t {
     net_evt_t  tx_event;
     net_evt_t  stop_event;
     netpkt_t   pkt_rx;
-    netpkt_t   pkts_tx[NET_QUEUE_LEN];
+    netpkt_t  *pkts_tx;
+    int        batch; // frames moved per wakeup
+    net_busy_poll_t busy_poll;
 } net_tap_t;
 
 #ifdef ENABLE_TAP_LOG
@@ -143,7 +145,7 @@ static void net_tap_thread(void *priv) {
     pfd[NET_EVENT_TAP].events = POLLERR | POLLHUP | POLLPRI;
     fcntl(tap->fd, F_SETFL, O_NONBLOCK);
     while(1) {
-        ssize_t ret = poll(pfd, NET_EVENT_MAX, -1);
+        ssize_t ret = net_event_poll(pfd, NET_EVENT_MAX, -1, &tap->busy_poll);
         if (ret < 0) {
             tap_log("TAP: poll error: %s\n", strerror(errno));
             net_event_set(&tap->stop_event);
@@ -155,8 +157,10 @@ static void net_tap_thread(void *priv) {
         }
         if (pfd[NET_EVENT_TX].revents & POLLIN) {
             net_event_clear(&tap->tx_event);
+            // The TAP device takes one frame per write, but popping a whole
+            // batch at once keeps us from going back to poll in between.
             int packets = network_tx_popv(tap->card, tap->pkts_tx,
-                                          NET_QUEUE_LEN);
+                                          tap->batch);
             for(int i = 0; i < packets; i++) {
                 netpkt_t *pkt = &tap->pkts_tx[i];
                 ssize_t ret = write(tap->fd, pkt->data, pkt->len);
@@ -166,13 +170,18 @@ static void net_tap_thread(void *priv) {
             }
         }
         if (pfd[NET_EVENT_RX].revents & POLLIN) {
-            ssize_t len = read(tap->fd, tap->pkt_rx.data, NET_MAX_FRAME);
-            if (len < 0) {
-                tap_log("TAP: read error: %s\n", strerror(errno));
-                continue;
+            // Likewise, drain up to a batch of frames per wakeup.
+            for (int i = 0; i < tap->batch; i++) {
+                ssize_t len = read(tap->fd, tap->pkt_rx.data, NET_MAX_FRAME);
+                if (len < 0) {
+                    if (errno != EAGAIN) {
+                        tap_log("TAP: read error: %s\n", strerror(errno));
+                    }
+                    break;
+                }
+                tap->pkt_rx.len = len;
+                network_rx_put_pkt(tap->card, &tap->pkt_rx);
             }
-            tap->pkt_rx.len = len;
-            network_rx_put_pkt(tap->card, &tap->pkt_rx);
         }
         if (pfd[NET_EVENT_STOP].revents & POLLIN) {
             net_event_clear(&tap->stop_event);
@@ -192,9 +201,10 @@ void net_tap_close(void *priv)
     tap_log("TAP: waiting for poll thread to exit.\n");
     thread_wait(tap->poll_tid);
     tap_log("TAP: poll thread exited.\n");
-    for(int i = 0; i < NET_QUEUE_LEN; i++) {
+    for(int i = 0; i < tap->batch; i++) {
         free(tap->pkts_tx[i].data);
     }
+    free(tap->pkts_tx);
     free(tap->pkt_rx.data);
     if (tap->fd >= 0) {
         close(tap->fd);
@@ -324,7 +334,12 @@ net_tap_init(
     if (!tap->pkt_rx.data) {
         goto alloc_fail;
     }
-    for(int i = 0; i < NET_QUEUE_LEN; i++) {
+    tap->batch   = network_host_batch(card);
+    tap->pkts_tx = calloc(tap->batch, sizeof(netpkt_t));
+    if (!tap->pkts_tx) {
+        goto alloc_fail;
+    }
+    for(int i = 0; i < tap->batch; i++) {
         tap->pkts_tx[i].data = calloc(1, NET_MAX_FRAME);
         if (!tap->pkts_tx[i].data) {
             goto alloc_fail;
@@ -332,6 +347,7 @@ net_tap_init(
     }
     tap->fd   = tap_fd;
     tap->card = (netcard_t *) card;
+    net_busy_poll_init(&tap->busy_poll, net_cards_conf[card->card_num].busy_poll);
     net_event_init(&tap->tx_event);
     net_event_init(&tap->stop_event);
     tap->poll_tid = thread_create(net_tap_thread, tap);
@@ -63,6 +63,7 @@
 #include <86box/ui.h>
 #include <86box/timer.h>
 #include <86box/network.h>
+#include <86box/net_capture.h>
 #include <86box/net_ne2000.h>
 #include <86box/net_pcnet.h>
 #include <86box/net_wd8003.h>
@@ -245,6 +246,8 @@ network_init(void)
     atexit(network_winsock_clean);
 #endif
 
+    network_capture_init();
+
     /* Create a first device entry that's always there, as needed by UI. */
     strcpy(network_devs[0].device, "none");
     strcpy(network_devs[0].description, "None");
@@ -299,26 +302,51 @@ network_init(void)
 #endif
 }
 
-void
-network_queue_init(netqueue_t *queue)
+/*
+ * Packet rings.
+ *
+ * Every ring has exactly one producer and one consumer thread: the host
+ * driver thread fills NET_QUEUE_RX and drains NET_QUEUE_TX_HOST, the
+ * emulation thread does the opposite and owns NET_QUEUE_TX_VM and
+ * NET_QUEUE_RX_LOOP, NET_QUEUE_RX_ON_TX never leaves the host thread.
+ * head and tail are free running, so a full ring uses every slot.
+ */
+struct netqueue_t {
+    netpkt_t   *packets;
+    uint32_t    size;
+    uint32_t    mask;
+    atomic_uint head; /* Written by the producer only. */
+    atomic_uint tail; /* Written by the consumer only. */
+    atomic_uint drops;
+};
+
+static netcard_t *net_cards_attached[NET_CARD_MAX];
+
+static netqueue_t *
+network_queue_init(uint32_t size)
 {
-    queue->head = queue->tail = 0;
-    for (int i = 0; i < NET_QUEUE_LEN; i++) {
+    netqueue_t *queue = calloc(1, sizeof(netqueue_t));
+
+    queue->size    = size;
+    queue->mask    = size - 1;
+    queue->packets = calloc(size, sizeof(netpkt_t));
+    for (uint32_t i = 0; i < size; i++) {
         queue->packets[i].data = calloc(1, NET_MAX_FRAME);
         queue->packets[i].len  = 0;
     }
-}
 
-static bool
-network_queue_full(netqueue_t *queue)
-{
-    return ((queue->head + 1) & NET_QUEUE_LEN_MASK) == queue->tail;
+    atomic_init(&queue->head, 0);
+    atomic_init(&queue->tail, 0);
+    atomic_init(&queue->drops, 0);
+
+    return queue;
 }
 
-static bool
-network_queue_empty(netqueue_t *queue)
+static uint32_t
+network_queue_count(netqueue_t *queue)
 {
-    return (queue->head == queue->tail);
+    return atomic_load_explicit(&queue->head, memory_order_acquire) -
+           atomic_load_explicit(&queue->tail, memory_order_acquire);
 }
 
 static inline void
@@ -329,24 +357,53 @@ network_swap_packet(netpkt_t *pkt1, netpkt_t *pkt2)
     *pkt1        = tmp;
 }
 
+/* Producer side, returns the slot to fill or NULL if the ring is full. */
+static netpkt_t *
+network_queue_slot(netqueue_t *queue)
+{
+    const uint32_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    const uint32_t tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+
+    if ((head - tail) >= queue->size)
+        return NULL;
+
+    return &queue->packets[head & queue->mask];
+}
+
+static inline void
+network_queue_push(netqueue_t *queue)
+{
+    atomic_fetch_add_explicit(&queue->head, 1, memory_order_release);
+}
+
 int
 network_queue_put(netqueue_t *queue, uint8_t *data, int len)
 {
-    if (len == 0 || len > NET_MAX_FRAME || network_queue_full(queue)) {
+    netpkt_t *pkt;
+
+    if (len == 0 || len > NET_MAX_FRAME) {
+        return 0;
+    }
+
+    if (!(pkt = network_queue_slot(queue))) {
+        atomic_fetch_add_explicit(&queue->drops, 1, memory_order_relaxed);
         return 0;
     }
 
-    netpkt_t *pkt = &queue->packets[queue->head];
     memcpy(pkt->data, data, len);
-    pkt->len    = len;
-    queue->head = (queue->head + 1) & NET_QUEUE_LEN_MASK;
+    pkt->len = len;
+    network_queue_push(queue);
     return 1;
 }
 
 int
 network_queue_put_swap(netqueue_t *queue, netpkt_t *src_pkt)
 {
-    if (src_pkt->len == 0 || src_pkt->len > NET_MAX_FRAME || network_queue_full(queue)) {
+    netpkt_t *dst_pkt = NULL;
+
+    if (src_pkt->len == 0 || src_pkt->len > NET_MAX_FRAME || !(dst_pkt = network_queue_slot(queue))) {
+        if ((src_pkt->len > 0) && (src_pkt->len <= NET_MAX_FRAME))
+            atomic_fetch_add_explicit(&queue->drops, 1, memory_order_relaxed);
 #ifdef DEBUG
         if (src_pkt->len == 0) {
             network_log("Discarded zero length packet.\n");
@@ -359,41 +416,42 @@ network_queue_put_swap(netqueue_t *queue, netpkt_t *src_pkt)
         return 0;
     }
 
-    netpkt_t *dst_pkt = &queue->packets[queue->head];
     network_swap_packet(src_pkt, dst_pkt);
-
-    queue->head = (queue->head + 1) & NET_QUEUE_LEN_MASK;
+    network_queue_push(queue);
     return 1;
 }
 
 static int
 network_queue_get_swap(netqueue_t *queue, netpkt_t *dst_pkt)
 {
-    if (network_queue_empty(queue))
+    const uint32_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    const uint32_t head = atomic_load_explicit(&queue->head, memory_order_acquire);
+
+    if (head == tail)
         return 0;
 
-    netpkt_t *src_pkt = &queue->packets[queue->tail];
+    netpkt_t *src_pkt = &queue->packets[tail & queue->mask];
     network_swap_packet(src_pkt, dst_pkt);
-    queue->tail = (queue->tail + 1) & NET_QUEUE_LEN_MASK;
+    atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
     return 1;
 }
 
 static int
 network_queue_move(netqueue_t *dst_q, netqueue_t *src_q)
 {
-    if (network_queue_empty(src_q))
-        return 0;
+    const uint32_t tail = atomic_load_explicit(&src_q->tail, memory_order_relaxed);
+    const uint32_t head = atomic_load_explicit(&src_q->head, memory_order_acquire);
+    netpkt_t      *dst_pkt;
 
-    if (network_queue_full(dst_q)) {
+    if (head == tail)
         return 0;
-    }
 
-    netpkt_t *src_pkt = &src_q->packets[src_q->tail];
-    netpkt_t *dst_pkt = &dst_q->packets[dst_q->head];
+    if (!(dst_pkt = network_queue_slot(dst_q)))
+        return 0;
 
-    network_swap_packet(src_pkt, dst_pkt);
-    dst_q->head = (dst_q->head + 1) & NET_QUEUE_LEN_MASK;
-    src_q->tail = (src_q->tail + 1) & NET_QUEUE_LEN_MASK;
+    network_swap_packet(&src_q->packets[tail & src_q->mask], dst_pkt);
+    network_queue_push(dst_q);
+    atomic_store_explicit(&src_q->tail, tail + 1, memory_order_release);
 
     return dst_pkt->len;
 }
@@ -401,11 +459,30 @@ network_queue_move(netqueue_t *dst_q, netqueue_t *src_q)
 void
 network_queue_clear(netqueue_t *queue)
 {
-    for (int i = 0; i < NET_QUEUE_LEN; i++) {
+    for (uint32_t i = 0; i < queue->size; i++)
         free(queue->packets[i].data);
-        queue->packets[i].len = 0;
-    }
-    queue->tail = queue->head = 0;
+    free(queue->packets);
+    free(queue);
+}
+
+static uint32_t
+network_queue_size(const netcard_conf_t *conf)
+{
+    uint32_t len  = conf->queue_len ? conf->queue_len : NET_QUEUE_LEN_DEFAULT;
+    uint32_t size = NET_QUEUE_LEN;
+
+    while ((size < len) && (size < NET_QUEUE_LEN_MAX))
+        size <<= 1;
+
+    return size;
+}
+
+static int
+network_rx_get(netcard_t *card)
+{
+    /* Frames the card looped back to itself go first. */
+    return network_queue_get_swap(card->queues[NET_QUEUE_RX_LOOP], &card->queued_pkt) ||
+           network_queue_get_swap(card->queues[NET_QUEUE_RX], &card->queued_pkt);
 }
 
 static void
@@ -420,42 +497,71 @@ network_rx_queue(void *priv)
         card->link_state = new_link_state;
     }
 
+    /*
+       In host speed mode the wire timing is ignored: everything queued is
+       handed over in one go, until the card runs out of receive buffers.
+       The guest then takes a single interrupt for the whole batch.
+     */
+    const bool host_speed = net_cards_conf[card->card_num].host_speed;
+    const int  batch      = host_speed ? (int) card->queues[NET_QUEUE_RX]->size : NET_QUEUE_LEN;
+
     uint32_t rx_bytes = 0;
-    for (int i = 0; i < NET_QUEUE_LEN; i++) {
-        if (card->queued_pkt.len == 0) {
-            thread_wait_mutex(card->rx_mutex);
-            int res = network_queue_get_swap(&card->queues[NET_QUEUE_RX], &card->queued_pkt);
-            thread_release_mutex(card->rx_mutex);
-            if (!res)
-                break;
-        }
+    bool     rx_full  = false;
+    for (int i = 0; i < batch; i++) {
+        if ((card->queued_pkt.len == 0) && !network_rx_get(card))
+            break;
 
         network_dump_packet(&card->queued_pkt);
         int res = card->rx(card->card_drv, card->queued_pkt.data, card->queued_pkt.len);
-        if (!res)
+        if (!res) {
+            card->rx_backpressure++;
+            rx_full = true;
             break;
+        }
+        network_capture_frame(card->card_num, NET_CAPTURE_IN, card->queued_pkt.data, card->queued_pkt.len);
         rx_bytes += card->queued_pkt.len;
+        card->rx_packets++;
         card->queued_pkt.len = 0;
     }
+    card->rx_bytes += rx_bytes;
 
     /* Transmission. */
     uint32_t tx_bytes = 0;
-    thread_wait_mutex(card->tx_mutex);
-    for (int i = 0; i < NET_QUEUE_LEN; i++) {
-        uint32_t bytes = network_queue_move(&card->queues[NET_QUEUE_TX_HOST], &card->queues[NET_QUEUE_TX_VM]);
+    for (int i = 0; i < batch; i++) {
+        uint32_t bytes = network_queue_move(card->queues[NET_QUEUE_TX_HOST], card->queues[NET_QUEUE_TX_VM]);
         if (!bytes)
             break;
         tx_bytes += bytes;
+        card->tx_packets++;
     }
-    thread_release_mutex(card->tx_mutex);
-    if (tx_bytes) {
-        /* Notify host that a packet is available in the TX queue */
+    card->tx_bytes += tx_bytes;
+
+    /*
+       Notify the host while anything is left in its queue, it may only
+       have taken a batch on the last wakeup; repeated notifications are
+       coalesced by net_event_set().
+     */
+    if (tx_bytes || network_queue_count(card->queues[NET_QUEUE_TX_HOST]))
         card->host_drv.notify_in(card->host_drv.priv);
+
+    /*
+       Poll faster while frames are backing up and the card keeps up with
+       them, relax back to the default interval once idle.
+     */
+    if (!rx_full && (network_queue_count(card->queues[NET_QUEUE_RX]) ||
+                     network_queue_count(card->queues[NET_QUEUE_TX_VM]))) {
+        card->poll_period /= 2;
+        if (card->poll_period < NET_POLL_MIN)
+            card->poll_period = NET_POLL_MIN;
+    } else if (!rx_bytes && !tx_bytes) {
+        card->poll_period *= 2;
+        if (card->poll_period > NET_POLL_MAX)
+            card->poll_period = NET_POLL_MAX;
     }
 
-    double timer_period = card->byte_period * (rx_bytes > tx_bytes ? rx_bytes : tx_bytes);
-    if (timer_period < 200)
-        timer_period = 200;
+    double timer_period = host_speed ? 0.0 : card->byte_period * (rx_bytes > tx_bytes ? rx_bytes : tx_bytes);
+    if (timer_period < card->poll_period)
+        timer_period = card->poll_period;
 
     timer_on_auto(&card->timer, timer_period);
 
@@ -486,16 +592,16 @@ network_attach(void *card_drv, uint8_t *mac, NETRXCB rx, NETSETLINKSTATE set_lin
     card->card_drv        = card_drv;
     card->rx              = rx;
     card->set_link_state  = set_link_state;
-    card->tx_mutex        = thread_create_mutex();
-    card->rx_mutex        = thread_create_mutex();
     card->card_num        = net_card_current;
     card->byte_period     = NET_PERIOD_10M;
+    card->poll_period     = NET_POLL_MAX;
 
     char net_drv_error[NET_DRV_ERRBUF_SIZE];
     char tempmsg[NET_DRV_ERRBUF_SIZE * 2];
 
+    uint32_t queue_size = network_queue_size(&net_cards_conf[net_card_current]);
     for (int i = 0; i < NET_QUEUE_COUNT; i++) {
-        network_queue_init(&card->queues[i]);
+        card->queues[i] = network_queue_init(queue_size);
     }
 
     const char *nic_name = network_card_get_internal_name(net_cards_conf[net_card_current].device_num);
@@ -531,6 +637,12 @@ network_attach(void *card_drv, uint8_t *mac, NETRXCB rx, NETSETLINKSTATE set_lin
             card->host_drv      = net_switch_drv;
             card->host_drv.priv = card->host_drv.init(card, mac, &net_cards_conf[net_card_current], net_drv_error);
             break;
+#ifdef HAS_SHMSWITCH
+        case NET_TYPE_SHMSWITCH:
+            card->host_drv      = net_shmswitch_drv;
+            card->host_drv.priv = card->host_drv.init(card, mac, &net_cards_conf[net_card_current], net_drv_error);
+            break;
+#endif
         default:
             card->host_drv.priv = NULL;
             break;
@@ -558,10 +670,8 @@ network_attach(void *card_drv, uint8_t *mac, NETRXCB rx, NETSETLINKSTATE set_lin
         // If null fails, something is very wrong
         // Clean up and fatal
         if(!card->host_drv.priv) {
-            thread_close_mutex(card->tx_mutex);
-            thread_close_mutex(card->rx_mutex);
             for (int i = 0; i < NET_QUEUE_COUNT; i++) {
-                network_queue_clear(&card->queues[i]);
+                network_queue_clear(card->queues[i]);
             }
 
             free(card->queued_pkt.data);
@@ -576,6 +686,8 @@ network_attach(void *card_drv, uint8_t *mac, NETRXCB rx, NETSETLINKSTATE set_lin
     timer_add(&card->timer, network_rx_queue, card, 0);
     timer_on_auto(&card->timer, 100);
 
+    net_cards_attached[card->card_num] = card;
+
     return card;
 }
 
@@ -585,10 +697,13 @@ netcard_close(netcard_t *card)
     timer_stop(&card->timer);
     card->host_drv.close(card->host_drv.priv);
 
-    thread_close_mutex(card->tx_mutex);
-    thread_close_mutex(card->rx_mutex);
+    if (net_cards_attached[card->card_num] == card) {
+        network_capture_stop(card->card_num);
+        net_cards_attached[card->card_num] = NULL;
+    }
+
     for (int i = 0; i < NET_QUEUE_COUNT; i++) {
-        network_queue_clear(&card->queues[i]);
+        network_queue_clear(card->queues[i]);
     }
 
     free(card->queued_pkt.data);
@@ -599,6 +714,8 @@ netcard_close(netcard_t *card)
 void
 network_close(void)
 {
+    network_capture_close();
+
 #ifdef ENABLE_NETWORK_LOG
     thread_close_mutex(network_dump_mutex);
     network_dump_mutex = NULL;
@@ -641,19 +758,16 @@ network_reset(void)
 void
 network_tx(netcard_t *card, uint8_t *bufp, int len)
 {
-    network_queue_put(&card->queues[NET_QUEUE_TX_VM], bufp, len);
+    if (network_queue_put(card->queues[NET_QUEUE_TX_VM], bufp, len))
+        network_capture_frame(card->card_num, NET_CAPTURE_OUT, bufp, len);
+    else
+        network_capture_drop(card->card_num, NET_CAPTURE_OUT, bufp, len);
 }
 
 int
 network_tx_pop(netcard_t *card, netpkt_t *out_pkt)
 {
-    int ret = 0;
-
-    thread_wait_mutex(card->tx_mutex);
-    ret = network_queue_get_swap(&card->queues[NET_QUEUE_TX_HOST], out_pkt);
-    thread_release_mutex(card->tx_mutex);
-
-    return ret;
+    return network_queue_get_swap(card->queues[NET_QUEUE_TX_HOST], out_pkt);
 }
 
 int
@@ -661,8 +775,7 @@ network_tx_popv(netcard_t *card, netpkt_t *pkt_vec, int vec_size)
 {
     int pkt_count = 0;
 
-    netqueue_t *queue = &card->queues[NET_QUEUE_TX_HOST];
-    thread_wait_mutex(card->tx_mutex);
+    netqueue_t *queue = card->queues[NET_QUEUE_TX_HOST];
     for (int i = 0; i < vec_size; i++) {
         if (!network_queue_get_swap(queue, pkt_vec))
             break;
@@ -670,21 +783,15 @@ network_tx_popv(netcard_t *card, netpkt_t *pkt_vec, int vec_size)
         pkt_count++;
         pkt_vec++;
     }
-    thread_release_mutex(card->tx_mutex);
 
     return pkt_count;
 }
 
+/* Loop a frame back into the card, emulation thread only. */
 int
 network_rx_put(netcard_t *card, uint8_t *bufp, int len)
 {
-    int ret = 0;
-
-    thread_wait_mutex(card->rx_mutex);
-    ret = network_queue_put(&card->queues[NET_QUEUE_RX], bufp, len);
-    thread_release_mutex(card->rx_mutex);
-
-    return ret;
+    return network_queue_put(card->queues[NET_QUEUE_RX_LOOP], bufp, len);
 }
 
 int
@@ -692,7 +799,7 @@ network_rx_on_tx_popv(netcard_t *card, netpkt_t *pkt_vec, int vec_size)
 {
     int pkt_count = 0;
 
-    netqueue_t *queue = &card->queues[NET_QUEUE_RX_ON_TX];
+    netqueue_t *queue = card->queues[NET_QUEUE_RX_ON_TX];
     for (int i = 0; i < vec_size; i++) {
         if (!network_queue_get_swap(queue, pkt_vec))
             break;
@@ -707,33 +814,56 @@ network_rx_on_tx_popv(netcard_t *card, netpkt_t *pkt_vec, int vec_size)
 int
 network_rx_on_tx_put(netcard_t *card, uint8_t *bufp, int len)
 {
-    int ret = 0;
-
-    ret = network_queue_put(&card->queues[NET_QUEUE_RX_ON_TX], bufp, len);
-
-    return ret;
+    return network_queue_put(card->queues[NET_QUEUE_RX_ON_TX], bufp, len);
 }
 
 int
 network_rx_on_tx_put_pkt(netcard_t *card, netpkt_t *pkt)
 {
-    int ret = 0;
+    return network_queue_put_swap(card->queues[NET_QUEUE_RX_ON_TX], pkt);
+}
 
-    ret = network_queue_put_swap(&card->queues[NET_QUEUE_RX_ON_TX], pkt);
+/* Frames a host driver should move at once, sized to the card's queues. */
+int
+network_host_batch(const netcard_t *card)
+{
+    const uint32_t size = network_queue_size(&net_cards_conf[card->card_num]);
 
-    return ret;
+    return (size < NET_HOST_BATCH_MAX) ? size : NET_HOST_BATCH_MAX;
 }
 
+/* Host driver thread only. */
 int
 network_rx_put_pkt(netcard_t *card, netpkt_t *pkt)
 {
-    int ret = 0;
+    return network_queue_put_swap(card->queues[NET_QUEUE_RX], pkt);
+}
 
-    thread_wait_mutex(card->rx_mutex);
-    ret = network_queue_put_swap(&card->queues[NET_QUEUE_RX], pkt);
-    thread_release_mutex(card->rx_mutex);
+/*
+ * Snapshot of a card's traffic counters. The emulation thread owns most
+ * of them, so readers on other threads may see slightly stale values.
+ */
+int
+network_card_get_stats(int card_num, netcard_stats_t *stats)
+{
+    const netcard_t *card;
 
-    return ret;
+    if ((card_num < 0) || (card_num >= NET_CARD_MAX) || !(card = net_cards_attached[card_num]))
+        return 0;
+
+    stats->rx_packets      = card->rx_packets;
+    stats->rx_bytes        = card->rx_bytes;
+    stats->tx_packets      = card->tx_packets;
+    stats->tx_bytes        = card->tx_bytes;
+    stats->rx_drops        = atomic_load(&card->queues[NET_QUEUE_RX]->drops) +
+                             atomic_load(&card->queues[NET_QUEUE_RX_LOOP]->drops);
+    stats->tx_drops        = atomic_load(&card->queues[NET_QUEUE_TX_VM]->drops);
+    stats->rx_backpressure = card->rx_backpressure;
+    stats->rx_queued       = network_queue_count(card->queues[NET_QUEUE_RX]);
+    stats->queue_len       = card->queues[NET_QUEUE_RX]->size;
+    stats->poll_period     = (uint32_t) card->poll_period;
+
+    return 1;
 }
 
 void
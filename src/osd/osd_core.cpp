@@ -28,10 +28,16 @@
 #include <86box/ui.h>
 #include <86box/version.h>
 #include <86box/cdrom.h>
-#include <86box/mem.h>
+#include <86box/timer.h>
+#include <86box/network.h>
+#include <86box/net_capture.h>
+#include <86box/device_prof.h>
 extern "C"
 {
+#include <86box/mem.h>
+#include <86box/io.h>
 #include <86box/rom.h>
+#include <86box/sound.h>
 }
 
 #include "osd_core.hpp"
@@ -46,7 +52,11 @@ enum {
     OSD_PATH_CAPACITY = 1024,
     OSD_LOG_LINES     = 64,
     OSD_LOG_LINE_LEN  = 256,
-    OSD_LIST_PAGE     = 12   /* rows moved per PageUp/PageDown */
+    OSD_LIST_PAGE     = 12,  /* rows moved per PageUp/PageDown */
+    OSD_NET_FLOWS     = 8,   /* busiest flows listed per card */
+    OSD_IO_PORTS      = 16,  /* busiest I/O ports listed */
+    OSD_DEVICES       = 16,  /* busiest devices listed */
+    OSD_SND_HANDLERS  = 32   /* sound handlers listed */
 };
 
 static constexpr float OSD_MIN_OUTPUT_SCALE = 1.0f;
@@ -61,6 +71,11 @@ static constexpr float OSD_REF_HEIGHT       = 576.0f;
 enum OsdView {
     VIEW_MENU,
     VIEW_LOG,
+    VIEW_NETWORK,
+    VIEW_IO_PORTS,
+    VIEW_PAGING,
+    VIEW_DEVICE_TIME,
+    VIEW_SOUND_TIME,
     VIEW_FILE_FLOPPY,
     VIEW_FILE_CD,
     VIEW_FILE_RDISK,
@@ -357,6 +372,11 @@ static const MenuItem menu_items[] = {
     { "Eject MO",                  ACT_EJECT_MO,     VIEW_MENU        },
     { nullptr, ACT_NONE, VIEW_MENU }, /* separator */
     { "Show Log",                  ACT_NONE,         VIEW_LOG         },
+    { "Network Statistics",        ACT_NONE,         VIEW_NETWORK     },
+    { "I/O Port Activity",         ACT_NONE,         VIEW_IO_PORTS    },
+    { "Paging Statistics",         ACT_NONE,         VIEW_PAGING      },
+    { "Device Host Time",          ACT_NONE,         VIEW_DEVICE_TIME },
+    { "Sound Handler Time",        ACT_NONE,         VIEW_SOUND_TIME  },
     { nullptr, ACT_NONE, VIEW_MENU }, /* separator */
     { "Hard Reset",                ACT_HARDRESET,    VIEW_MENU        },
     { "Toggle Fullscreen",         ACT_FULLSCREEN,   VIEW_MENU        },
@@ -463,10 +483,12 @@ static void activate_menu_item(int idx, bool *close_osd)
 
     if (mi.view == VIEW_LOG)
         log_scroll_pending = true;
-    else
+    else if ((mi.view != VIEW_NETWORK) && (mi.view != VIEW_IO_PORTS) && (mi.view != VIEW_PAGING) &&
+             (mi.view != VIEW_DEVICE_TIME) && (mi.view != VIEW_SOUND_TIME))
         open_browser(mi.view);
 
-    if (mi.view == VIEW_LOG)
+    if ((mi.view == VIEW_LOG) || (mi.view == VIEW_NETWORK) || (mi.view == VIEW_IO_PORTS) ||
+        (mi.view == VIEW_PAGING) || (mi.view == VIEW_DEVICE_TIME) || (mi.view == VIEW_SOUND_TIME))
         current_view = mi.view;
 }
 
@@ -621,6 +643,472 @@ static bool draw_log(void)
     return true;
 }
 
+/* ------------------------------------------------------------------ */
+/*  Draw: Network statistics                                           */
+/* ------------------------------------------------------------------ */
+static const char *format_bytes(char *buf, size_t size, uint64_t bytes)
+{
+    if (bytes >= (1ULL << 30))
+        snprintf(buf, size, "%.1f GB", bytes / (double) (1ULL << 30));
+    else if (bytes >= (1ULL << 20))
+        snprintf(buf, size, "%.1f MB", bytes / (double) (1ULL << 20));
+    else if (bytes >= (1ULL << 10))
+        snprintf(buf, size, "%.1f KB", bytes / (double) (1ULL << 10));
+    else
+        snprintf(buf, size, "%u B", (unsigned) bytes);
+    return buf;
+}
+
+static void draw_network_card(int card, bool focused, bool activate)
+{
+    netcard_stats_t     stats;
+    net_capture_stats_t cap;
+    net_flow_stats_t    flows[OSD_NET_FLOWS];
+    char                rx[32], tx[32], label[48];
+
+    network_card_get_stats(card, &stats);
+    network_capture_get_stats(card, &cap);
+
+    ImGui::TextDisabled("Card %d: %s", card + 1,
+                        network_card_get_internal_name(net_cards_conf[card].device_num));
+    ImGui::Text("RX %llu frames, %s   TX %llu frames, %s",
+                (unsigned long long) stats.rx_packets, format_bytes(rx, sizeof(rx), stats.rx_bytes),
+                (unsigned long long) stats.tx_packets, format_bytes(tx, sizeof(tx), stats.tx_bytes));
+    ImGui::Text("Drops RX %u TX %u   Card full %u   Queued %u/%u   Poll %u us",
+                stats.rx_drops, stats.tx_drops, stats.rx_backpressure,
+                stats.rx_queued, stats.queue_len, stats.poll_period);
+
+    snprintf(label, sizeof(label), "%s capture##net%d", cap.active ? "Stop" : "Start", card);
+    if (focused_button(label, focused) || activate) {
+        if (cap.active)
+            network_capture_stop(card);
+        else
+            network_capture_start(card);
+        network_capture_get_stats(card, &cap);
+    }
+
+    if (!cap.active && !cap.packets)
+        return;
+
+    ImGui::SameLine();
+    ImGui::Text("%llu frames, %llu written, %llu filtered, %u lost to a full ring",
+                (unsigned long long) cap.packets, (unsigned long long) cap.written,
+                (unsigned long long) cap.filtered, cap.ring_full);
+    if (cap.active)
+        ImGui::TextDisabled("%s", cap.path);
+
+    const int count = network_capture_get_flows(card, flows, OSD_NET_FLOWS);
+    if (!count)
+        return;
+
+    snprintf(label, sizeof(label), "##flows%d", card);
+    if (ImGui::BeginTable(label, 6, ImGuiTableFlags_Borders | ImGuiTableFlags_SizingFixedFit)) {
+        ImGui::TableSetupColumn("Flow", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupColumn("In");
+        ImGui::TableSetupColumn("In bytes");
+        ImGui::TableSetupColumn("Out");
+        ImGui::TableSetupColumn("Out bytes");
+        ImGui::TableSetupColumn("Drops");
+        ImGui::TableHeadersRow();
+
+        for (int i = 0; i < count; i++) {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn(); ImGui::TextUnformatted(flows[i].desc);
+            ImGui::TableNextColumn(); ImGui::Text("%llu", (unsigned long long) flows[i].packets[NET_CAPTURE_IN]);
+            ImGui::TableNextColumn(); ImGui::TextUnformatted(format_bytes(rx, sizeof(rx), flows[i].bytes[NET_CAPTURE_IN]));
+            ImGui::TableNextColumn(); ImGui::Text("%llu", (unsigned long long) flows[i].packets[NET_CAPTURE_OUT]);
+            ImGui::TableNextColumn(); ImGui::TextUnformatted(format_bytes(tx, sizeof(tx), flows[i].bytes[NET_CAPTURE_OUT]));
+            ImGui::TableNextColumn(); ImGui::Text("%u", flows[i].drops);
+        }
+        ImGui::EndTable();
+    }
+}
+
+static bool draw_network(void)
+{
+    /* Slots: one capture button per attached card, then Back. Tab cycles. */
+    static int net_focused_slot = 0;
+
+    int cards[NET_CARD_MAX];
+    int ncards = 0;
+    for (int i = 0; i < NET_CARD_MAX; i++) {
+        netcard_stats_t stats;
+        if (network_card_get_stats(i, &stats))
+            cards[ncards++] = i;
+    }
+
+    const bool tab   = ImGui::IsKeyPressed(ImGuiKey_Tab,         false);
+    const bool enter = ImGui::IsKeyPressed(ImGuiKey_Enter,       false)
+                    || ImGui::IsKeyPressed(ImGuiKey_KeypadEnter, false);
+
+    if (net_focused_slot > ncards)
+        net_focused_slot = ncards;
+    if (tab)
+        net_focused_slot = (net_focused_slot + 1) % (ncards + 1);
+    if (enter && (net_focused_slot == ncards)) {
+        show_main_menu();
+        return true;
+    }
+
+    ImGui::SetNextWindowPos(ImGui::GetMainViewport()->GetCenter(), ImGuiCond_Always, ImVec2(0.5f, 0.5f));
+    ImGui::SetNextWindowSize(ImVec2(osd_core_scaled(640.0f), osd_core_scaled(420.0f)), ImGuiCond_Always);
+    ImGui::Begin("Network Statistics", nullptr,
+                 ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoResize |
+                 ImGuiWindowFlags_NoMove     | ImGuiWindowFlags_NoNav);
+
+    ImGui::BeginChild("##netcards", ImVec2(0, -ImGui::GetFrameHeightWithSpacing()),
+                      true, ImGuiWindowFlags_NoNav);
+    if (!ncards)
+        ImGui::TextDisabled("No network cards attached.");
+    for (int i = 0; i < ncards; i++) {
+        if (i)
+            ImGui::Separator();
+        draw_network_card(cards[i], net_focused_slot == i, enter && (net_focused_slot == i));
+        if (ImGui::IsItemClicked()) net_focused_slot = i;
+    }
+    ImGui::EndChild();
+
+    if (focused_button("Back", net_focused_slot == ncards))
+        show_main_menu();
+    if (ImGui::IsItemClicked()) net_focused_slot = ncards;
+
+    ImGui::End();
+    return true;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Draw: I/O port activity                                            */
+/* ------------------------------------------------------------------ */
+static bool draw_io_ports(void)
+{
+    /* Slots: 0=Start/Stop, 1=Reset, 2=Dump to log, 3=Back. Tab cycles. */
+    static int io_focused_slot = 0;
+
+    io_port_stats_t stats[OSD_IO_PORTS];
+    const bool      on = io_stats_enabled();
+
+    const bool tab   = ImGui::IsKeyPressed(ImGuiKey_Tab,         false);
+    const bool enter = ImGui::IsKeyPressed(ImGuiKey_Enter,       false)
+                    || ImGui::IsKeyPressed(ImGuiKey_KeypadEnter, false);
+
+    if (tab)
+        io_focused_slot = (io_focused_slot + 1) % 4;
+    if (enter && (io_focused_slot == 3)) {
+        show_main_menu();
+        return true;
+    }
+
+    ImGui::SetNextWindowPos(ImGui::GetMainViewport()->GetCenter(), ImGuiCond_Always, ImVec2(0.5f, 0.5f));
+    ImGui::SetNextWindowSize(ImVec2(osd_core_scaled(480.0f), osd_core_scaled(420.0f)), ImGuiCond_Always);
+    ImGui::Begin("I/O Port Activity", nullptr,
+                 ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoResize |
+                 ImGuiWindowFlags_NoMove     | ImGuiWindowFlags_NoNav);
+
+    if (focused_button(on ? "Stop counting" : "Start counting", io_focused_slot == 0) ||
+        (enter && (io_focused_slot == 0)))
+        io_stats_enable(!on);
+    if (ImGui::IsItemClicked()) io_focused_slot = 0;
+    ImGui::SameLine();
+    if (focused_button("Reset", io_focused_slot == 1) || (enter && (io_focused_slot == 1)))
+        io_stats_reset();
+    if (ImGui::IsItemClicked()) io_focused_slot = 1;
+    ImGui::SameLine();
+    if (focused_button("Dump to log", io_focused_slot == 2) || (enter && (io_focused_slot == 2)))
+        io_stats_dump();
+    if (ImGui::IsItemClicked()) io_focused_slot = 2;
+
+    ImGui::BeginChild("##ioports", ImVec2(0, -ImGui::GetFrameHeightWithSpacing()),
+                      true, ImGuiWindowFlags_NoNav);
+    const int count = io_stats_get_top(stats, OSD_IO_PORTS);
+    if (!count)
+        ImGui::TextDisabled(io_stats_enabled() ? "No port accesses yet." : "Counting is off.");
+    else if (ImGui::BeginTable("##ioporttable", 4, ImGuiTableFlags_Borders | ImGuiTableFlags_SizingFixedFit)) {
+        ImGui::TableSetupColumn("Port", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupColumn("Reads");
+        ImGui::TableSetupColumn("Writes");
+        ImGui::TableSetupColumn("Handlers");
+        ImGui::TableHeadersRow();
+
+        for (int i = 0; i < count; i++) {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn(); ImGui::Text("%04X", stats[i].port);
+            ImGui::TableNextColumn(); ImGui::Text("%u", stats[i].reads);
+            ImGui::TableNextColumn(); ImGui::Text("%u", stats[i].writes);
+            ImGui::TableNextColumn(); ImGui::Text("%u", stats[i].handlers);
+        }
+        ImGui::EndTable();
+    }
+    ImGui::EndChild();
+
+    if (focused_button("Back", io_focused_slot == 3))
+        show_main_menu();
+    if (ImGui::IsItemClicked()) io_focused_slot = 3;
+
+    ImGui::End();
+    return true;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Draw: Paging statistics                                            */
+/* ------------------------------------------------------------------ */
+static bool draw_paging(void)
+{
+    /* Rates are taken over the last full second. */
+    static mmu_stats_t last;
+    static mmu_stats_t rate;
+    static double      last_time = -1.0;
+
+    mmu_stats_t  stats;
+    const double now = ImGui::GetTime();
+
+    mem_get_mmu_stats(&stats);
+    if ((last_time < 0.0) || (now < last_time)) {
+        last      = stats;
+        last_time = now;
+    } else if ((now - last_time) >= 1.0) {
+        const double secs = now - last_time;
+
+        rate.walks        = (uint64_t) ((stats.walks - last.walks) / secs);
+        rate.flushes      = (uint64_t) ((stats.flushes - last.flushes) / secs);
+        rate.cr3_flushes  = (uint64_t) ((stats.cr3_flushes - last.cr3_flushes) / secs);
+        rate.user_flushes = (uint64_t) ((stats.user_flushes - last.user_flushes) / secs);
+        rate.page_flushes = (uint64_t) ((stats.page_flushes - last.page_flushes) / secs);
+        rate.kept         = (uint64_t) ((stats.kept - last.kept) / secs);
+        last              = stats;
+        last_time         = now;
+    }
+
+    const bool enter = ImGui::IsKeyPressed(ImGuiKey_Enter,       false)
+                    || ImGui::IsKeyPressed(ImGuiKey_KeypadEnter, false);
+    if (enter) {
+        show_main_menu();
+        return true;
+    }
+
+    ImGui::SetNextWindowPos(ImGui::GetMainViewport()->GetCenter(), ImGuiCond_Always, ImVec2(0.5f, 0.5f));
+    ImGui::SetNextWindowSize(ImVec2(osd_core_scaled(420.0f), osd_core_scaled(260.0f)), ImGuiCond_Always);
+    ImGui::Begin("Paging Statistics", nullptr,
+                 ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoResize |
+                 ImGuiWindowFlags_NoMove     | ImGuiWindowFlags_NoNav);
+
+    ImGui::BeginChild("##paging", ImVec2(0, -ImGui::GetFrameHeightWithSpacing()),
+                      true, ImGuiWindowFlags_NoNav);
+    if (ImGui::BeginTable("##pagingtable", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_SizingFixedFit)) {
+        const struct {
+            const char *name;
+            uint64_t    total;
+            uint64_t    rate;
+        } rows[] = {
+            { "Page walks",             stats.walks,        rate.walks        },
+            { "Full flushes",           stats.flushes,      rate.flushes      },
+            { "CR3 loads (PGE)",        stats.cr3_flushes,  rate.cr3_flushes  },
+            { "Switches to ring 3",     stats.user_flushes, rate.user_flushes },
+            { "INVLPG",                 stats.page_flushes, rate.page_flushes },
+            { "Lookups kept",           stats.kept,         rate.kept         }
+        };
+
+        ImGui::TableSetupColumn("Event", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupColumn("Total");
+        ImGui::TableSetupColumn("Per second");
+        ImGui::TableHeadersRow();
+
+        for (const auto &row : rows) {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn(); ImGui::TextUnformatted(row.name);
+            ImGui::TableNextColumn(); ImGui::Text("%llu", (unsigned long long) row.total);
+            ImGui::TableNextColumn(); ImGui::Text("%llu", (unsigned long long) row.rate);
+        }
+        ImGui::EndTable();
+    }
+    ImGui::EndChild();
+
+    if (focused_button("Back", true))
+        show_main_menu();
+
+    ImGui::End();
+    return true;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Draw: Device host time                                             */
+/* ------------------------------------------------------------------ */
+static bool draw_device_time(void)
+{
+    /* Slots: 0=Start/Stop, 1=Reset, 2=Dump to file, 3=Back. Tab cycles. */
+    static int dev_focused_slot = 0;
+    static int dev_sort         = DEVICE_PROF_SORT_TOTAL;
+
+    device_prof_stats_t stats[OSD_DEVICES];
+    const bool          on = device_prof_on;
+
+    const bool tab   = ImGui::IsKeyPressed(ImGuiKey_Tab,         false);
+    const bool enter = ImGui::IsKeyPressed(ImGuiKey_Enter,       false)
+                    || ImGui::IsKeyPressed(ImGuiKey_KeypadEnter, false);
+
+    if (tab)
+        dev_focused_slot = (dev_focused_slot + 1) % 4;
+    if (enter && (dev_focused_slot == 3)) {
+        show_main_menu();
+        return true;
+    }
+
+    ImGui::SetNextWindowPos(ImGui::GetMainViewport()->GetCenter(), ImGuiCond_Always, ImVec2(0.5f, 0.5f));
+    ImGui::SetNextWindowSize(ImVec2(osd_core_scaled(600.0f), osd_core_scaled(440.0f)), ImGuiCond_Always);
+    ImGui::Begin("Device Host Time", nullptr,
+                 ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoResize |
+                 ImGuiWindowFlags_NoMove     | ImGuiWindowFlags_NoNav);
+
+    if (focused_button(on ? "Stop counting" : "Start counting", dev_focused_slot == 0) ||
+        (enter && (dev_focused_slot == 0)))
+        device_prof_enable(!on);
+    if (ImGui::IsItemClicked()) dev_focused_slot = 0;
+    ImGui::SameLine();
+    if (focused_button("Reset", dev_focused_slot == 1) || (enter && (dev_focused_slot == 1)))
+        device_prof_reset();
+    if (ImGui::IsItemClicked()) dev_focused_slot = 1;
+    ImGui::SameLine();
+    if (focused_button("Dump to file", dev_focused_slot == 2) || (enter && (dev_focused_slot == 2))) {
+        if (!device_prof_dump())
+            osd_log_push("Could not write the device host time dump.");
+    }
+    if (ImGui::IsItemClicked()) dev_focused_slot = 2;
+
+    ImGui::BeginChild("##devtime", ImVec2(0, -ImGui::GetFrameHeightWithSpacing()),
+                      true, ImGuiWindowFlags_NoNav);
+    const int    count   = device_prof_get_top(stats, OSD_DEVICES, dev_sort);
+    const double elapsed = (double) device_prof_elapsed();
+    if (!count)
+        ImGui::TextDisabled(on ? "No handler calls yet." : "Counting is off.");
+    else if (ImGui::BeginTable("##devtimetable", 6, ImGuiTableFlags_Borders | ImGuiTableFlags_SizingFixedFit |
+                                                    ImGuiTableFlags_Sortable)) {
+        /* Times are shares of the host time since counting started. */
+        const ImGuiTableColumnFlags desc = ImGuiTableColumnFlags_PreferSortDescending |
+                                           ImGuiTableColumnFlags_NoSortAscending;
+
+        ImGui::TableSetupColumn("Device",  ImGuiTableColumnFlags_WidthStretch | ImGuiTableColumnFlags_NoSortDescending,
+                                0.0f, DEVICE_PROF_SORT_NAME);
+        ImGui::TableSetupColumn("Timers",  desc, 0.0f, DEVICE_PROF_TIMER);
+        ImGui::TableSetupColumn("I/O",     desc, 0.0f, DEVICE_PROF_IO);
+        ImGui::TableSetupColumn("Memory",  desc, 0.0f, DEVICE_PROF_MEM);
+        ImGui::TableSetupColumn("Total",   desc | ImGuiTableColumnFlags_DefaultSort, 0.0f, DEVICE_PROF_SORT_TOTAL);
+        ImGui::TableSetupColumn("Calls",   desc, 0.0f, DEVICE_PROF_SORT_CALLS);
+        ImGui::TableHeadersRow();
+
+        ImGuiTableSortSpecs *specs = ImGui::TableGetSortSpecs();
+        if (specs && specs->SpecsDirty) {
+            if (specs->SpecsCount > 0)
+                dev_sort = (int) specs->Specs[0].ColumnUserID;
+            specs->SpecsDirty = false;
+        }
+
+        for (int i = 0; i < count; i++) {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn(); ImGui::TextUnformatted(stats[i].name);
+            for (int k = 0; k < DEVICE_PROF_KINDS; k++) {
+                ImGui::TableNextColumn();
+                ImGui::Text("%.2f%%", (elapsed > 0.0) ? ((stats[i].ticks[k] * 100.0) / elapsed) : 0.0);
+            }
+            ImGui::TableNextColumn();
+            ImGui::Text("%.2f%%", (elapsed > 0.0) ? ((stats[i].total * 100.0) / elapsed) : 0.0);
+            ImGui::TableNextColumn();
+            ImGui::Text("%llu", (unsigned long long) (stats[i].calls[DEVICE_PROF_TIMER] +
+                                                     stats[i].calls[DEVICE_PROF_IO] +
+                                                     stats[i].calls[DEVICE_PROF_MEM]));
+        }
+        ImGui::EndTable();
+    }
+    ImGui::EndChild();
+
+    if (focused_button("Back", dev_focused_slot == 3))
+        show_main_menu();
+    if (ImGui::IsItemClicked()) dev_focused_slot = 3;
+
+    ImGui::End();
+    return true;
+}
+
+/* ------------------------------------------------------------------ */
+/*  Draw: Sound handler time                                           */
+/* ------------------------------------------------------------------ */
+static bool draw_sound_time(void)
+{
+    /* Loads are taken over the last full second, as a share of one host core. */
+    static uint64_t last_us[OSD_SND_HANDLERS];
+    static double   load[OSD_SND_HANDLERS];
+    static int      last_count = -1;
+    static double   last_time  = -1.0;
+
+    sound_handler_stats_t stats[OSD_SND_HANDLERS];
+    const int             count = sound_get_handler_stats(stats, OSD_SND_HANDLERS);
+    const double          now   = ImGui::GetTime();
+
+    if ((last_time < 0.0) || (now < last_time) || (count != last_count)) {
+        for (int i = 0; i < count; i++) {
+            last_us[i] = stats[i].render_us;
+            load[i]    = 0.0;
+        }
+        last_count = count;
+        last_time  = now;
+    } else if ((now - last_time) >= 1.0) {
+        const double secs = now - last_time;
+
+        for (int i = 0; i < count; i++) {
+            load[i]    = ((stats[i].render_us - last_us[i]) / 10000.0) / secs;
+            last_us[i] = stats[i].render_us;
+        }
+        last_time = now;
+    }
+
+    const bool enter = ImGui::IsKeyPressed(ImGuiKey_Enter,       false)
+                    || ImGui::IsKeyPressed(ImGuiKey_KeypadEnter, false);
+    if (enter) {
+        show_main_menu();
+        return true;
+    }
+
+    ImGui::SetNextWindowPos(ImGui::GetMainViewport()->GetCenter(), ImGuiCond_Always, ImVec2(0.5f, 0.5f));
+    ImGui::SetNextWindowSize(ImVec2(osd_core_scaled(560.0f), osd_core_scaled(380.0f)), ImGuiCond_Always);
+    ImGui::Begin("Sound Handler Time", nullptr,
+                 ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoResize |
+                 ImGuiWindowFlags_NoMove     | ImGuiWindowFlags_NoNav);
+
+    ImGui::BeginChild("##soundtime", ImVec2(0, -ImGui::GetFrameHeightWithSpacing()),
+                      true, ImGuiWindowFlags_NoNav);
+    if (!count)
+        ImGui::TextDisabled("No sound handlers.");
+    else if (ImGui::BeginTable("##soundtimetable", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_SizingFixedFit)) {
+        ImGui::TableSetupColumn("Device", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupColumn("Chain");
+        ImGui::TableSetupColumn("Thread");
+        ImGui::TableSetupColumn("Per call");
+        ImGui::TableSetupColumn("Load");
+        ImGui::TableHeadersRow();
+
+        for (int i = 0; i < count; i++) {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn(); ImGui::TextUnformatted(stats[i].name);
+            ImGui::TableNextColumn(); ImGui::TextUnformatted(stats[i].chain);
+            ImGui::TableNextColumn();
+            if (stats[i].lane)
+                ImGui::Text("Mixer %u", stats[i].lane);
+            else
+                ImGui::TextUnformatted("Emulation");
+            ImGui::TableNextColumn();
+            ImGui::Text("%.1f us", stats[i].render_calls ?
+                                   ((double) stats[i].render_us / (double) stats[i].render_calls) : 0.0);
+            ImGui::TableNextColumn(); ImGui::Text("%.2f%%", load[i]);
+        }
+        ImGui::EndTable();
+    }
+    ImGui::EndChild();
+
+    if (focused_button("Back", true))
+        show_main_menu();
+
+    ImGui::End();
+    return true;
+}
+
 /* ------------------------------------------------------------------ */
 /*  Draw: File selector                                               */
 /* ------------------------------------------------------------------ */
@@ -673,6 +1161,11 @@ bool osd_core_build_ui(void)
     switch (current_view) {
         case VIEW_MENU:      return draw_menu();
         case VIEW_LOG:       return draw_log();
+        case VIEW_NETWORK:   return draw_network();
+        case VIEW_IO_PORTS:  return draw_io_ports();
+        case VIEW_PAGING:    return draw_paging();
+        case VIEW_DEVICE_TIME: return draw_device_time();
+        case VIEW_SOUND_TIME:  return draw_sound_time();
         default:             return draw_browser();
     }
 }
@@ -1422,6 +1422,9 @@ MediaMenu::nicUpdateMenu(int i)
         case NET_TYPE_NRSWITCH:
             netType = tr("Remote Switch");
             break;
+        case NET_TYPE_SHMSWITCH:
+            netType = tr("Shared Memory Switch");
+            break;
     }
 
     QString devName = DeviceConfig::DeviceName(network_card_getdevice(net_cards_conf[i].device_num), network_card_get_internal_name(net_cards_conf[i].device_num), 1);
@@ -234,6 +234,12 @@ plat_get_ticks(void)
     return elapsed_timer.elapsed();
 }
 
+uint64_t
+plat_get_micro_ticks(void)
+{
+    return (uint64_t) (elapsed_timer.nsecsElapsed() / 1000);
+}
+
 uint64_t
 plat_timer_read(void)
 {
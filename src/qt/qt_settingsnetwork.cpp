@@ -142,6 +142,7 @@ SettingsNetwork::enableElements(Ui::SettingsNetwork *ui)
 #endif
 
                 case NET_TYPE_NLSWITCH:
+                case NET_TYPE_SHMSWITCH:
                     // option_list_label->setText("Local Switch Options");
                     option_list_label->setVisible(true);
                     option_list_line->setVisible(true);
@@ -252,7 +253,7 @@ SettingsNetwork::changed()
             strncpy(temp_nrs_hostname, hostname_value->text().toUtf8().constData(), sizeof(temp_nrs_hostname) - 1);
             memset(temp_secret, '\0', sizeof(temp_secret));
             strncpy(temp_secret, secret_value->text().toUtf8().constData(), sizeof(temp_secret) - 1);
-        } else if (net_cards_conf[i].net_type == NET_TYPE_NLSWITCH) {
+        } else if ((net_cards_conf[i].net_type == NET_TYPE_NLSWITCH) || (net_cards_conf[i].net_type == NET_TYPE_SHMSWITCH)) {
             has_changed |= (net_cards_conf[i].promisc_mode != promisc_value->isChecked());
             memset(temp_secret, '\0', sizeof(temp_secret));
             strncpy(temp_secret, secret_value->text().toUtf8().constData(), sizeof(temp_secret) - 1);
@@ -310,7 +311,7 @@ SettingsNetwork::save(int soft)
             strncpy(net_cards_conf[i].nrs_hostname, hostname_value->text().toUtf8().constData(), sizeof(net_cards_conf[i].nrs_hostname) - 1);
             memset(net_cards_conf[i].secret, '\0', sizeof(net_cards_conf[i].secret));
             strncpy(net_cards_conf[i].secret, secret_value->text().toUtf8().constData(), sizeof(net_cards_conf[i].secret) - 1);
-        } else if (net_cards_conf[i].net_type == NET_TYPE_NLSWITCH) {
+        } else if ((net_cards_conf[i].net_type == NET_TYPE_NLSWITCH) || (net_cards_conf[i].net_type == NET_TYPE_SHMSWITCH)) {
             net_cards_conf[i].promisc_mode = promisc_value->isChecked();
             memset(net_cards_conf[i].secret, '\0', sizeof(net_cards_conf[i].secret));
             strncpy(net_cards_conf[i].secret, secret_value->text().toUtf8().constData(), sizeof(net_cards_conf[i].secret) - 1);
@@ -402,6 +403,9 @@ SettingsNetwork::onCurrentMachineChanged(int machineId)
 #ifdef ENABLE_NET_NRSWITCH
         Models::AddEntry(model, tr("Remote Switch"), NET_TYPE_NRSWITCH);
 #endif /* ENABLE_NET_NRSWITCH */
+#ifdef HAS_SHMSWITCH
+        Models::AddEntry(model, tr("Shared Memory Switch"), NET_TYPE_SHMSWITCH);
+#endif
 
         model->removeRows(0, removeRows);
         cbox->setCurrentIndex(cbox->findData(net_cards_conf[i].net_type));
@@ -438,7 +442,7 @@ SettingsNetwork::onCurrentMachineChanged(int machineId)
             auto    editline         = findChild<QLineEdit *>(QString("bridgeTAPNIC%1").arg(i + 1));
             editline->setText(currentTapDevice);
 #endif
-        } else if (net_cards_conf[i].net_type == NET_TYPE_NLSWITCH) {
+        } else if ((net_cards_conf[i].net_type == NET_TYPE_NLSWITCH) || (net_cards_conf[i].net_type == NET_TYPE_SHMSWITCH)) {
             auto *promisc_value = findChild<QCheckBox *>(QString("boxPromisc%1").arg(i + 1));
             promisc_value->setCheckState(net_cards_conf[i].promisc_mode == 1 ? Qt::CheckState::Checked : Qt::CheckState::Unchecked);
             auto *secret_value = findChild<QLineEdit *>(QString("secretSwitch%1").arg(i + 1));
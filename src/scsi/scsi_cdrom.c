@@ -670,7 +670,8 @@ scsi_cdrom_set_period(scsi_cdrom_t *dev)
         double  bytes_per_second;
         double  period;
 
-        if ((dev->drv->speed > 72) || (dev->was_cached == -1)) {
+        if ((dev->drv->speed > 72) || (dev->was_cached == -1) ||
+            (ide_fast_completion && (dev->drv->bus_type == CDROM_BUS_ATAPI))) {
             if (dev->drv->bus_type == CDROM_BUS_SCSI)
                 dev->callback = -1.0; /* Speed depends on SCSI controller */
             else if (dev->was_cached == -1)
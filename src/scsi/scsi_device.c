@@ -98,6 +98,9 @@ scsi_device_request_sense(scsi_device_t *dev, uint8_t *buffer, uint8_t alloc_len
 void
 scsi_device_reset(scsi_device_t *dev)
 {
+    dev->tag_type = SCSI_TAG_NONE;
+    dev->queued   = 0;
+
     if (dev->reset)
         dev->reset(dev->sc);
 }
@@ -136,6 +139,14 @@ scsi_device_command_phase0(scsi_device_t *dev, uint8_t *cdb)
         return;
     }
 
+    if (dev->tag_type != SCSI_TAG_NONE) {
+        scsi_device_log("SCSI: Command %02X with %s queue tag %02X\n", cdb[0],
+                        (dev->tag_type == SCSI_TAG_HEAD) ? "HEAD OF" :
+                        ((dev->tag_type == SCSI_TAG_ORDERED) ? "ORDERED" : "SIMPLE"),
+                        dev->tag);
+        dev->tag_type = SCSI_TAG_NONE;
+    }
+
     /* Finally, execute the SCSI command immediately and get the transfer length. */
     dev->phase  = SCSI_PHASE_COMMAND;
     dev->status = scsi_device_target_command(dev, cdb);
@@ -183,6 +194,43 @@ scsi_device_identify(scsi_device_t *dev, uint8_t lun)
              a LUN not supported by the target. */
 }
 
+/*
+   Tagged commands are executed in the order the target receives them and a
+   controller never hands a target a new command while one it has let go of
+   is still outstanding (see scsi_device_queue_busy()), so ORDERED and HEAD OF
+   QUEUE tags are honoured simply by recording them.
+ */
+void
+scsi_device_set_tag(scsi_device_t *dev, uint8_t tag_type, uint8_t tag)
+{
+    if (dev == NULL)
+        return;
+
+    dev->tag_type = tag_type;
+    dev->tag      = tag;
+}
+
+/* The command has been started and its completion is deferred, letting the
+   controller go on to serve other targets in the meantime. */
+void
+scsi_device_queue_begin(scsi_device_t *dev)
+{
+    dev->queued++;
+}
+
+void
+scsi_device_queue_end(scsi_device_t *dev)
+{
+    if (dev->queued > 0)
+        dev->queued--;
+}
+
+int
+scsi_device_queue_busy(scsi_device_t *dev)
+{
+    return !!dev->queued;
+}
+
 void
 scsi_device_close_all(void)
 {
@@ -938,16 +938,13 @@ ncr53c8xx_do_msgout(ncr53c8xx_t *dev, uint8_t id)
                 }
                 break;
             case 0x20: /* SIMPLE queue */
-                id |= ncr53c8xx_get_msgbyte(dev) | NCR_TAG_VALID;
-                ncr53c8xx_log("SIMPLE queue tag=0x%x\n", id & 0xff);
-                break;
             case 0x21: /* HEAD of queue */
-                ncr53c8xx_log("HEAD queue not implemented\n");
-                id |= ncr53c8xx_get_msgbyte(dev) | NCR_TAG_VALID;
-                break;
             case 0x22: /* ORDERED queue */
-                ncr53c8xx_log("ORDERED queue not implemented\n");
-                id |= ncr53c8xx_get_msgbyte(dev) | NCR_TAG_VALID;
+                /* Commands never disconnect, so the target always sees
+                   them in order and the tag only needs to be recorded. */
+                arg = ncr53c8xx_get_msgbyte(dev);
+                ncr53c8xx_log("Queue tag message %02X, tag=0x%x\n", msg, arg);
+                scsi_device_set_tag(sd, msg, arg);
                 break;
             case 0x0d:
                 /* The ABORT TAG message clears the current I/O process only. */
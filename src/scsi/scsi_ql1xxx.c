@@ -2772,6 +2772,13 @@ ql_sxp_state_machine(ql_t *dev)
                 ql_log("QL: SCSI CDB[%2lu]=%02X\n", i, pkt->cdb[i]);
             }
 
+            if (pkt->flags & REQFLAG_HTAG)
+                scsi_device_set_tag(sd, SCSI_TAG_HEAD, pkt->handle & 0xff);
+            else if (pkt->flags & REQFLAG_OTAG)
+                scsi_device_set_tag(sd, SCSI_TAG_ORDERED, pkt->handle & 0xff);
+            else if (pkt->flags & REQFLAG_STAG)
+                scsi_device_set_tag(sd, SCSI_TAG_SIMPLE, pkt->handle & 0xff);
+
             sd->buffer_length = -1;
             scsi_device_command_phase0(sd, pkt->cdb);
 
@@ -940,11 +940,114 @@ x54x_scsi_cmd(x54x_t *dev)
     x54x_log("scsi_devices[%02i][%02i].Status = %02X\n", dev->bus, req->TargetID, sd->status);
 }
 
+/*
+   Instead of holding the adapter for the target's media time, which is what
+   dominates a disk command, park the command in its target's slot and go on
+   to serve the mailboxes of other targets. The slot's timer marks it ready
+   and the lookup phase then finishes it off like any other command.
+ */
+static void
+x54x_slot_callback(void *priv)
+{
+    x54x_slot_t *slot = (x54x_slot_t *) priv;
+
+    slot->ready = 1;
+}
+
+static void
+x54x_park(x54x_t *dev, double period)
+{
+    const Req_t *req  = &dev->Req;
+    x54x_slot_t *slot = &dev->slots[req->TargetID];
+
+    x54x_log("%s: Parking command for ID %i for %lf us\n", dev->name, req->TargetID, period);
+
+    slot->req             = *req;
+    slot->scsi_cmd_phase  = dev->scsi_cmd_phase;
+    slot->target_data_len = dev->target_data_len;
+    slot->Outgoing        = dev->Outgoing;
+    memcpy(slot->temp_cdb, dev->temp_cdb, sizeof(slot->temp_cdb));
+    slot->busy  = 1;
+    slot->ready = 0;
+
+    scsi_device_queue_begin(&scsi_devices[dev->bus][req->TargetID]);
+    dev->pending_cmds++;
+
+    timer_on_auto(&slot->timer, period);
+
+    dev->callback_sub_phase = 0;
+    if (dev->ven_callback)
+        dev->callback_phase ^= 1;
+}
+
+static int
+x54x_unpark(x54x_t *dev)
+{
+    x54x_slot_t *slot;
+
+    for (uint8_t i = 0; i <= dev->max_id; i++) {
+        slot = &dev->slots[i];
+        if (!slot->busy || !slot->ready)
+            continue;
+
+        x54x_log("%s: Completing parked command for ID %i\n", dev->name, i);
+
+        dev->Req             = slot->req;
+        dev->scsi_cmd_phase  = slot->scsi_cmd_phase;
+        dev->target_data_len = slot->target_data_len;
+        dev->Outgoing        = slot->Outgoing;
+        memcpy(dev->temp_cdb, slot->temp_cdb, sizeof(dev->temp_cdb));
+        dev->MailboxIsBIOS = 0;
+        slot->busy         = 0;
+        slot->ready        = 0;
+
+        /* The adapter stays on this command until its mailbox is freed, so
+           the target can take a new one from here on. */
+        scsi_device_queue_end(&scsi_devices[dev->bus][i]);
+        dev->pending_cmds--;
+
+        dev->callback_sub_phase = 3;
+        return 1;
+    }
+
+    return 0;
+}
+
+static void
+x54x_slots_reset(x54x_t *dev)
+{
+    for (uint8_t i = 0; i < 16; i++) {
+        timer_stop(&dev->slots[i].timer);
+        dev->slots[i].busy  = 0;
+        dev->slots[i].ready = 0;
+    }
+
+    dev->pending_cmds = 0;
+}
+
+/* Peek at the target of a CCB without accepting it. */
+static int
+x54x_target_busy(x54x_t *dev, uint32_t CCBPointer)
+{
+    CCBU    CmdBlock;
+    uint8_t id;
+
+    dma_bm_read(CCBPointer, (uint8_t *) &CmdBlock, sizeof(CCB32), dev->transfer_size);
+    x54x_add_to_period(dev, sizeof(CCB32));
+
+    id = (dev->flags & X54X_MBX_24BIT) ? CmdBlock.old.Id : CmdBlock.new.Id;
+    if (id > dev->max_id)
+        return 0;
+
+    return scsi_device_queue_busy(&scsi_devices[dev->bus][id]);
+}
+
 static void
 x54x_scsi_cmd_phase1(x54x_t *dev)
 {
     Req_t         *req = &dev->Req;
     double         p;
+    double         park  = 0.0;
     uint8_t        bit24 = !!req->Is24bit;
     scsi_device_t *sd;
 
@@ -955,6 +1058,8 @@ x54x_scsi_cmd_phase1(x54x_t *dev)
             p = scsi_device_get_callback(sd);
             if (p <= 0.0)
                 x54x_add_to_period(dev, sd->buffer_length);
+            else if (!dev->MailboxIsBIOS)
+                park = p;
             else
                 dev->media_period += p;
             x54x_buf_dma_transfer(dev, req, bit24, dev->target_data_len, (dev->scsi_cmd_phase == SCSI_PHASE_DATA_OUT));
@@ -962,6 +1067,11 @@ x54x_scsi_cmd_phase1(x54x_t *dev)
         }
     }
 
+    if (park > 0.0) {
+        x54x_park(dev, park);
+        return;
+    }
+
     dev->callback_sub_phase = 3;
     x54x_log("scsi_devices[%02xi][%02i].Status = %02X\n", dev->bus, req->TargetID, sd->status);
 }
@@ -1089,6 +1199,13 @@ x54x_req_setup(x54x_t *dev, uint32_t CCBPointer, UNUSED(Mailbox32_t *Mailbox32))
             dev->callback_sub_phase = 4;
             return;
         }
+        if (!req->Is24bit && (req->CmdBlock.new.TagQueued || req->CmdBlock.new.LegacyTagEnable)) {
+            /* Queue tag 0 is SIMPLE, 1 is HEAD OF QUEUE and 2 is ORDERED. */
+            if (req->CmdBlock.new.TagQueued)
+                scsi_device_set_tag(sd, SCSI_TAG_SIMPLE + req->CmdBlock.new.QueueTag, dev->MailboxOutPosCur);
+            else
+                scsi_device_set_tag(sd, SCSI_TAG_SIMPLE + req->CmdBlock.new.LegacyQueueTag, dev->MailboxOutPosCur);
+        }
         if (req->CmdBlock.common.Opcode == 0x81) {
             x54x_log("Bus reset opcode\n");
             scsi_device_reset(sd);
@@ -1159,6 +1276,12 @@ x54x_mbo_process(x54x_t *dev)
     dev->ToRaise  = 0;
     dev->Outgoing = x54x_mbo(dev, &mb32);
 
+    if ((mb32.u.out.ActionCode == MBO_START) && dev->pending_cmds && x54x_target_busy(dev, mb32.CCBPointer)) {
+        /* The target still has a command outstanding, take this one later. */
+        x54x_log("Start Mailbox Command for a busy target, deferred\n");
+        return 0;
+    }
+
     if (mb32.u.out.ActionCode == MBO_START) {
         x54x_log("Start Mailbox Command\n");
         x54x_req_setup(dev, mb32.CCBPointer, &mb32);
@@ -1239,6 +1362,9 @@ x54x_cmd_callback(void *priv)
     switch (dev->callback_sub_phase) {
         case 0:
             /* Sub-phase 0 - Look for mailbox. */
+            if (dev->pending_cmds && x54x_unpark(dev))
+                break;
+
             if ((dev->callback_phase == 0) && mailboxes_present) {
                 x54x_log("%s: Callback: Look for mailbox\n", dev->name);
                 x54x_do_mail(dev);
@@ -1428,6 +1554,7 @@ x54x_reset(x54x_t *dev)
     dev->callback_sub_phase = 0;
     timer_stop(&dev->timer);
     timer_set_delay_u64(&dev->timer, (uint64_t) (dev->timer.period * ((double) TIMER_USEC)));
+    x54x_slots_reset(dev);
     dev->Command      = 0xFF;
     dev->CmdParam     = 0;
     dev->CmdParamLeft = 0;
@@ -1907,6 +2034,8 @@ x54x_init(const device_t *info)
 
     timer_add(&dev->ResetCB, x54x_reset_poll, dev, 0);
     timer_add(&dev->timer, x54x_cmd_callback, dev, 1);
+    for (uint8_t i = 0; i < 16; i++)
+        timer_add(&dev->slots[i].timer, x54x_slot_callback, &dev->slots[i], 0);
     dev->timer.period = 10.0;
     timer_set_delay_u64(&dev->timer, (uint64_t) (dev->timer.period * ((double) TIMER_USEC)));
 
@@ -1926,6 +2055,7 @@ x54x_close(void *priv)
     if (dev) {
         /* Tell the timer to terminate. */
         timer_stop(&dev->timer);
+        x54x_slots_reset(dev);
 
         /* Also terminate the reset callback timer. */
         timer_disable(&dev->ResetCB);
@@ -25,8 +25,6 @@
 #define CM32LN_CTRL_ROM   "roms/sound/cm32ln/CM32LN_CONTROL.ROM"
 #define CM32LN_PCM_ROM    "roms/sound/cm32ln/CM32LN_PCM.ROM"
 
-extern void al_set_midi(int freq, int buf_size);
-
 static mt32emu_report_handler_version get_mt32_report_handler_version(mt32emu_report_handler_i i);
 static void                           display_mt32_message(void *instance_data, const char *message);
 
@@ -150,18 +148,8 @@ cm32ln_available(void)
     return roms_present[1];
 }
 
-static thread_t *thread_h    = NULL;
-static event_t  *event       = NULL;
-static event_t  *start_event = NULL;
-static int       mt32_on     = 0;
-
-#define RENDER_RATE     100
-#define BUFFER_SEGMENTS 10
-
-static uint32_t samplerate   = 44100;
-static int      buf_size     = 0;
-static float   *buffer       = NULL;
-static int16_t *buffer_int16 = NULL;
+static midi_synth_t *synth      = NULL;
+static uint32_t      samplerate = 44100;
 
 static mt32emu_report_handler_version
 get_mt32_report_handler_version(UNUSED(mt32emu_report_handler_i i))
@@ -183,102 +171,58 @@ display_mt32_message(UNUSED(void *instance_data), const char *message)
     }
 }
 
-void
-mt32_stream(float *stream, int len)
+static void
+mt32_render(UNUSED(void *priv), float *buf, int frames)
 {
     if (context)
-        mt32emu_render_float(context, stream, len);
+        mt32emu_render_float(context, buf, frames);
 }
 
-void
-mt32_stream_int16(int16_t *stream, int len)
+static void
+mt32_render_int16(UNUSED(void *priv), int16_t *buf, int frames)
 {
     if (context)
-        mt32emu_render_bit16s(context, stream, len);
+        mt32emu_render_bit16s(context, buf, frames);
 }
 
-void
-mt32_poll(void)
+/* Called on the synth host render thread. */
+static void
+mt32_play_msg(UNUSED(void *priv), uint8_t *val)
 {
-    thread_set_event(event);
+    if (context)
+        mt32_check("mt32emu_play_msg", mt32emu_play_msg(context, *(uint32_t *) val), MT32EMU_RC_OK);
 }
 
 static void
-mt32_thread(UNUSED(void *param))
+mt32_play_sysex(UNUSED(void *priv), uint8_t *data, unsigned int len)
 {
-    int      buf_pos = 0;
-    int      bsize   = buf_size / BUFFER_SEGMENTS;
-    float   *buf;
-    int16_t *buf16;
-
-    thread_set_event(start_event);
-
-    while (mt32_on) {
-        thread_wait_event(event, -1);
-        thread_reset_event(event);
-
-        if (sound_is_float) {
-            buf = (float *) ((uint8_t *) buffer + buf_pos);
-            memset(buf, 0, bsize);
-            mt32_stream(buf, bsize / (2 * sizeof(float)));
-
-            /* Apply sound card MIDI volume and filters */
-            if (filter_midi != NULL) {
-                for (int i = 0; i < (bsize / sizeof(float)); i += 2) {
-                    double dl = (double) buf[i];
-                    double dr = (double) buf[i + 1];
-                    filter_midi(0, &dl, filter_midi_p);
-                    filter_midi(1, &dr, filter_midi_p);
-                    buf[i] = (float) dl;
-                    buf[i + 1] = (float) dr;
-                }
-            }
-
-            buf_pos += bsize;
-
-            if (buf_pos >= buf_size) {
-                givealbuffer_midi(buffer, buf_size / sizeof(float));
-                buf_pos = 0;
-            }
-        } else {
-            buf16 = (int16_t *) ((uint8_t *) buffer_int16 + buf_pos);
-            memset(buf16, 0, bsize);
-            mt32_stream_int16(buf16, bsize / (2 * sizeof(int16_t)));
-
-            /* Apply sound card MIDI volume and filters */
-            if (filter_midi != NULL) {
-                for (int i = 0; i < (bsize / sizeof(int16_t)); i += 2) {
-                    double dl = (double) buf16[i];
-                    double dr = (double) buf16[i + 1];
-                    filter_midi(0, &dl, filter_midi_p);
-                    filter_midi(1, &dr, filter_midi_p);
-                    buf16[i] = (int16_t) round(dl);
-                    buf16[i + 1] = (int16_t) round(dr);
-                }
-            }
-
-            buf_pos += bsize;
-
-            if (buf_pos >= buf_size) {
-                givealbuffer_midi(buffer_int16, buf_size / sizeof(int16_t));
-                buf_pos = 0;
-            }
-        }
-    }
+    if (context)
+        mt32_check("mt32emu_play_sysex", mt32emu_play_sysex(context, data, len), MT32EMU_RC_OK);
+}
+
+static const midi_synth_ops_t mt32_synth_ops = {
+    .play_msg     = mt32_play_msg,
+    .play_sysex   = mt32_play_sysex,
+    .render       = mt32_render,
+    .render_int16 = mt32_render_int16
+};
+
+void
+mt32_poll(void)
+{
+    midi_synth_poll(synth);
 }
 
 void
 mt32_msg(uint8_t *val)
 {
-    if (context)
-        mt32_check("mt32emu_play_msg", mt32emu_play_msg(context, *(uint32_t *) val), MT32EMU_RC_OK);
+    midi_synth_msg(synth, val);
 }
 
 void
 mt32_sysex(uint8_t *data, unsigned int len)
 {
-    if (context)
-        mt32_check("mt32emu_play_sysex", mt32emu_play_sysex(context, data, len), MT32EMU_RC_OK);
+    midi_synth_sysex(synth, data, len);
 }
 
 void *
@@ -302,16 +246,6 @@ mt32emu_init(char *control_rom, char *pcm_rom)
         return 0;
 
     samplerate = mt32emu_get_actual_stereo_output_samplerate(context);
-    /* buf_size = samplerate/RENDER_RATE*2; */
-    if (sound_is_float) {
-        buf_size     = (samplerate / RENDER_RATE) * 2 * BUFFER_SEGMENTS * sizeof(float);
-        buffer       = calloc(1, buf_size);
-        buffer_int16 = NULL;
-    } else {
-        buf_size     = (samplerate / RENDER_RATE) * 2 * BUFFER_SEGMENTS * sizeof(int16_t);
-        buffer       = NULL;
-        buffer_int16 = calloc(1, buf_size);
-    }
 
     mt32emu_set_output_gain(context, device_get_config_int("output_gain") / 100.0f);
     mt32emu_set_reverb_enabled(context, device_get_config_int("reverb"));
@@ -319,8 +253,6 @@ mt32emu_init(char *control_rom, char *pcm_rom)
     mt32emu_set_reversed_stereo_enabled(context, device_get_config_int("reversed_stereo"));
     mt32emu_set_nice_amp_ramp_enabled(context, device_get_config_int("nice_ramp"));
 
-    al_set_midi(samplerate, buf_size);
-
     dev = calloc(1, sizeof(midi_device_t));
 
     dev->play_msg   = mt32_msg;
@@ -329,15 +261,7 @@ mt32emu_init(char *control_rom, char *pcm_rom)
 
     midi_out_init(dev);
 
-    mt32_on = 1;
-
-    start_event = thread_create_event();
-
-    event    = thread_create_event();
-    thread_h = thread_create(mt32_thread, 0);
-
-    thread_wait_event(start_event, -1);
-    thread_reset_event(start_event);
+    synth = midi_synth_init(&mt32_synth_ops, NULL, samplerate);
 
     return dev;
 }
@@ -372,13 +296,8 @@ mt32_close(void *priv)
     if (!priv)
         return;
 
-    mt32_on = 0;
-    thread_set_event(event);
-    thread_wait(thread_h);
-
-    event       = NULL;
-    start_event = NULL;
-    thread_h    = NULL;
+    midi_synth_close(synth);
+    synth = NULL;
 
     if (context) {
         mt32emu_close_synth(context);
@@ -387,14 +306,6 @@ mt32_close(void *priv)
     context = NULL;
 
     ui_sb_mt32lcd("");
-
-    if (buffer)
-        free(buffer);
-    buffer = NULL;
-
-    if (buffer_int16)
-        free(buffer_int16);
-    buffer_int16 = NULL;
 }
 
 static const device_config_t mt32_config[] = {
@@ -43,11 +43,6 @@
 #include "clap/clap_host.h"
 #include "clap/clap_event_list.h"
 
-#define RENDER_RATE      100
-#define BUFFER_SEGMENTS  10
-
-extern void al_set_midi(int freq, int buf_size);
-
 /* ------------------------------------------------------------------ */
 /*  Model definitions (matching DOSBox Staging)                       */
 /* ------------------------------------------------------------------ */
@@ -81,17 +76,11 @@ typedef struct soundcanvas {
     /* audio buffers */
     float    *buf_left;
     float    *buf_right;
-    float    *out_buffer;        /* interleaved float stereo */
-    int16_t  *out_buffer_int16;  /* interleaved int16 stereo */
-    int       buf_size;          /* total buffer size in bytes */
+    int       buf_frames;        /* size of the planar buffers in frames */
     float     vol_ctrl;          /* Output gain */
 
-    /* threading */
-    thread_t *thread_h;
-    event_t  *event;
-    event_t  *start_event;
-    mutex_t  *midi_mutex;
-    int       on;
+    /* rendering */
+    midi_synth_t *synth;
 
     /* logging */
     void *    log;
@@ -221,120 +210,39 @@ find_sc_plugin(UNUSED(const char *rom_path), int model_index,
 }
 
 /* ------------------------------------------------------------------ */
-/*  Poll callback (called from sound system at SOUND_FREQ)            */
-/* ------------------------------------------------------------------ */
-void
-soundcanvas_poll(void)
-{
-    soundcanvas_t *data = &scdev;
-
-    thread_set_event(data->event);
-}
-
-/* ------------------------------------------------------------------ */
-/*  Render thread                                                     */
+/*  Synth host callbacks (render thread)                              */
 /* ------------------------------------------------------------------ */
 static void
-soundcanvas_thread(void *param)
+soundcanvas_render(void *priv, float *buf, int frames)
 {
-    soundcanvas_t *data      = (soundcanvas_t *)param;
-    int            buf_pos   = 0;
-    int            frames_per_seg;
-    int            seg_bytes;
-
-    if (sound_is_float) {
-        seg_bytes      = data->buf_size / BUFFER_SEGMENTS;
-        frames_per_seg = seg_bytes / (2 * (int)sizeof(float));
-    } else {
-        seg_bytes      = data->buf_size / BUFFER_SEGMENTS;
-        frames_per_seg = seg_bytes / (2 * (int)sizeof(int16_t));
-    }
+    soundcanvas_t *data = (soundcanvas_t *) priv;
 
-    thread_set_event(data->start_event);
-
-    while (data->on) {
-        thread_wait_event(data->event, -1);
-        thread_reset_event(data->event);
-
-        /* Grab pending MIDI events under lock */
-        thread_wait_mutex(data->midi_mutex);
+    while (frames > 0) {
+        int count = (frames > data->buf_frames) ? data->buf_frames : frames;
 
         /* Render through CLAP plugin */
-        memset(data->buf_left,  0, (size_t)frames_per_seg * sizeof(float));
-        memset(data->buf_right, 0, (size_t)frames_per_seg * sizeof(float));
+        memset(data->buf_left,  0, (size_t)count * sizeof(float));
+        memset(data->buf_right, 0, (size_t)count * sizeof(float));
 
         clap_host_process(data->clap_inst,
                           data->buf_left, data->buf_right,
-                          frames_per_seg, &data->events);
-
-        thread_release_mutex(data->midi_mutex);
+                          count, &data->events);
 
         /* Interleave into output buffer */
-        if (sound_is_float) {
-            float *buf = (float *)((uint8_t *)data->out_buffer + buf_pos);
-
-            for (int i = 0; i < frames_per_seg; i++) {
-                /* Apply sound card MIDI volume and filters */
-                if (filter_midi != NULL) {
-                    double dl = (double) (data->buf_left[i] * data->vol_ctrl);
-                    double dr = (double) (data->buf_right[i] * data->vol_ctrl);
-                    filter_midi(0, &dl, filter_midi_p);
-                    filter_midi(1, &dr, filter_midi_p);
-                    buf[i * 2 + 0] = (float) dl;
-                    buf[i * 2 + 1] = (float) dr;
-                } else {
-                    buf[i * 2 + 0] = data->buf_left[i] * data->vol_ctrl;
-                    buf[i * 2 + 1] = data->buf_right[i] * data->vol_ctrl;
-                }
-            }
-            buf_pos += seg_bytes;
-            if (buf_pos >= data->buf_size) {
-                givealbuffer_midi(data->out_buffer,
-                                  data->buf_size / (int)sizeof(float));
-                buf_pos = 0;
-            }
-        } else {
-            int16_t *buf = (int16_t *)((uint8_t *)data->out_buffer_int16 + buf_pos);
-
-            for (int i = 0; i < frames_per_seg; i++) {
-                float l = data->buf_left[i]  * 32767.0f * data->vol_ctrl;
-                float r = data->buf_right[i] * 32767.0f * data->vol_ctrl;
-
-                /* Apply sound card MIDI volume and filters */
-                if (filter_midi != NULL) {
-                    double dl = (double) l;
-                    double dr = (double) r;
-                    filter_midi(0, &dl, filter_midi_p);
-                    filter_midi(1, &dr, filter_midi_p);
-                    l = (float) l;
-                    r = (float) r;
-                }
-
-                if (l >  32767.0f) l =  32767.0f;
-                if (l < -32768.0f) l = -32768.0f;
-                if (r >  32767.0f) r =  32767.0f;
-                if (r < -32768.0f) r = -32768.0f;
-
-                buf[i * 2 + 0] = (int16_t)l;
-                buf[i * 2 + 1] = (int16_t)r;
-            }
-            buf_pos += seg_bytes;
-            if (buf_pos >= data->buf_size) {
-                givealbuffer_midi(data->out_buffer_int16,
-                                  data->buf_size / (int)sizeof(int16_t));
-                buf_pos = 0;
-            }
+        for (int i = 0; i < count; i++) {
+            buf[i * 2 + 0] = data->buf_left[i]  * data->vol_ctrl;
+            buf[i * 2 + 1] = data->buf_right[i] * data->vol_ctrl;
         }
+
+        buf    += count * 2;
+        frames -= count;
     }
 }
 
-/* ------------------------------------------------------------------ */
-/*  MIDI message callbacks                                            */
-/* ------------------------------------------------------------------ */
-void
-soundcanvas_msg(uint8_t *msg)
+static void
+soundcanvas_play_msg(void *priv, uint8_t *msg)
 {
-    soundcanvas_t *data = &scdev;
+    soundcanvas_t *data = (soundcanvas_t *) priv;
     uint32_t val  = *((uint32_t *)msg);
     uint8_t  midi[3];
     int      len;
@@ -352,19 +260,44 @@ soundcanvas_msg(uint8_t *msg)
             len = 3; break;
     }
 
-    thread_wait_mutex(data->midi_mutex);
+    /* The host splits rendering at event boundaries, so offset 0 is exact */
     clap_event_list_add_midi(&data->events, midi, len, 0);
-    thread_release_mutex(data->midi_mutex);
 }
 
-void
-soundcanvas_sysex(uint8_t *buf, unsigned int len)
+static void
+soundcanvas_play_sysex(void *priv, uint8_t *buf, unsigned int len)
 {
-    soundcanvas_t *data = &scdev;
+    soundcanvas_t *data = (soundcanvas_t *) priv;
 
-    thread_wait_mutex(data->midi_mutex);
     clap_event_list_add_sysex(&data->events, buf, len, 0);
-    thread_release_mutex(data->midi_mutex);
+}
+
+static const midi_synth_ops_t soundcanvas_synth_ops = {
+    .play_msg     = soundcanvas_play_msg,
+    .play_sysex   = soundcanvas_play_sysex,
+    .render       = soundcanvas_render,
+    .render_int16 = NULL
+};
+
+/* ------------------------------------------------------------------ */
+/*  MIDI device callbacks (emulation thread)                          */
+/* ------------------------------------------------------------------ */
+void
+soundcanvas_poll(void)
+{
+    midi_synth_poll(scdev.synth);
+}
+
+void
+soundcanvas_msg(uint8_t *msg)
+{
+    midi_synth_msg(scdev.synth, msg);
+}
+
+void
+soundcanvas_sysex(uint8_t *buf, unsigned int len)
+{
+    midi_synth_sysex(scdev.synth, buf, len);
 }
 
 /* ------------------------------------------------------------------ */
@@ -458,22 +391,9 @@ soundcanvas_init(UNUSED(const device_t *info))
     clap_event_list_init(&data->events);
 
     /* Allocate render buffers (separate L/R for CLAP) */
-    int frames_per_seg = data->sample_rate / RENDER_RATE;
-    data->buf_left  = (float *)calloc((size_t)frames_per_seg, sizeof(float));
-    data->buf_right = (float *)calloc((size_t)frames_per_seg, sizeof(float));
-
-    /* Allocate interleaved output buffer */
-    if (sound_is_float) {
-        data->buf_size         = frames_per_seg * 2 * (int)sizeof(float) * BUFFER_SEGMENTS;
-        data->out_buffer       = (float *)calloc(1, (size_t)data->buf_size);
-        data->out_buffer_int16 = NULL;
-    } else {
-        data->buf_size         = frames_per_seg * 2 * (int)sizeof(int16_t) * BUFFER_SEGMENTS;
-        data->out_buffer       = NULL;
-        data->out_buffer_int16 = (int16_t *)calloc(1, (size_t)data->buf_size);
-    }
-
-    al_set_midi(data->sample_rate, data->buf_size);
+    data->buf_frames = data->sample_rate / RENDER_RATE;
+    data->buf_left   = (float *)calloc((size_t)data->buf_frames, sizeof(float));
+    data->buf_right  = (float *)calloc((size_t)data->buf_frames, sizeof(float));
 
     /* Set up MIDI device */
     dev = (midi_device_t *)calloc(1, sizeof(midi_device_t));
@@ -484,14 +404,7 @@ soundcanvas_init(UNUSED(const device_t *info))
     midi_out_init(dev);
 
     /* Start render thread */
-    data->on          = 1;
-    data->midi_mutex  = thread_create_mutex();
-    data->start_event = thread_create_event();
-    data->event       = thread_create_event();
-    data->thread_h    = thread_create(soundcanvas_thread, data);
-
-    thread_wait_event(data->start_event, -1);
-    thread_reset_event(data->start_event);
+    data->synth = midi_synth_init(&soundcanvas_synth_ops, data, data->sample_rate);
 
     scanvas_log(data->log, "Sound Canvas: Initialized (model=%s, rate=%d Hz)\n",
           model_idx >= 0 ? sc_models[model_idx].label : "auto",
@@ -509,9 +422,8 @@ soundcanvas_close(void *priv)
     soundcanvas_t *data = &scdev;
 
     /* Stop render thread */
-    data->on = 0;
-    thread_set_event(data->event);
-    thread_wait(data->thread_h);
+    midi_synth_close(data->synth);
+    data->synth = NULL;
 
     /* Destroy CLAP instance */
     if (data->clap_inst) {
@@ -521,17 +433,11 @@ soundcanvas_close(void *priv)
 
     clap_event_list_free(&data->events);
 
-    thread_close_mutex(data->midi_mutex);
-
     free(data->buf_left);
     free(data->buf_right);
-    free(data->out_buffer);
-    free(data->out_buffer_int16);
 
-    data->buf_left         = NULL;
-    data->buf_right        = NULL;
-    data->out_buffer       = NULL;
-    data->out_buffer_int16 = NULL;
+    data->buf_left  = NULL;
+    data->buf_right = NULL;
 
     if (data->log != NULL) {
         log_close(data->log);
@@ -0,0 +1,519 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Shared host for software MIDI synthesizers.
+ *
+ *          The emulation thread only time-stamps incoming MIDI
+ *          messages and SysEx dumps and pushes them into lock-free
+ *          single-producer/single-consumer rings. A dedicated render
+ *          thread drains the rings, applies every event at its sample
+ *          position, renders the synthesizer in blocks, and feeds the
+ *          result to the MIDI audio source. The render thread is
+ *          allowed to stay up to midi_render_ahead milliseconds ahead
+ *          of emulated time, so that a slow block (for example the
+ *          synth digesting a large SysEx burst) is absorbed instead of
+ *          causing a dropout.
+ *
+ *          Copyright 2026 86Box contributors.
+ */
+#include <math.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+#define HAVE_STDARG_H
+#include <86box/86box.h>
+#include <86box/midi.h>
+#include <86box/sound.h>
+#include <86box/thread.h>
+
+/* Number of MIDI poll periods rendered per block; divides BUFFER_SEGMENTS. */
+#define MIDI_SYNTH_BLOCK_POLLS 2
+#define MIDI_SYNTH_EVENTS      4096    /* must be a power of 2 */
+#define MIDI_SYNTH_SYSEX_RING  131072  /* must be a power of 2 */
+#define BUFFER_SEGMENTS        10
+
+extern void al_set_midi(int freq, int buf_size);
+
+typedef struct midi_synth_event_t {
+    uint32_t ts;   /* emulated sample position */
+    uint32_t msg;  /* short message, or 0 for SysEx */
+    uint32_t len;  /* SysEx length in bytes */
+    uint32_t pos;  /* SysEx position in the data ring */
+} midi_synth_event_t;
+
+/* Producer-side overflow queue entry, SysEx data follows. */
+typedef struct midi_synth_spill_t {
+    struct midi_synth_spill_t *next;
+    uint32_t                   ts;
+    uint32_t                   msg;
+    uint32_t                   len;
+    uint8_t                    data[];
+} midi_synth_spill_t;
+
+struct midi_synth_t {
+    const midi_synth_ops_t *ops;
+    void                   *priv;
+
+    int      freq;
+    uint32_t poll_frames;
+    uint32_t block_frames;
+    uint32_t ahead_frames;
+
+    /* Producer (emulation thread) side. */
+    atomic_uint emu_frames;
+    atomic_uint ev_head;
+    atomic_uint data_head;
+
+    /* Consumer (render thread) side. */
+    atomic_uint rendered;
+    atomic_uint ev_tail;
+    atomic_uint data_tail;
+
+    midi_synth_event_t events[MIDI_SYNTH_EVENTS];
+    uint8_t            data[MIDI_SYNTH_SYSEX_RING];
+    uint8_t            sysex[SYSEX_SIZE];
+
+    float   *render_buf;
+    float   *out_buffer;
+    int16_t *out_buffer_int16;
+    int      out_frames;
+    int      out_pos;
+
+    /* Events that did not fit in the rings, emulation thread only. */
+    midi_synth_spill_t *spill_head;
+    midi_synth_spill_t *spill_tail;
+    uint32_t            spills;
+
+    thread_t  *thread_h;
+    event_t   *wake_event;
+    event_t   *start_event;
+    atomic_int on;
+};
+
+int midi_render_ahead = MIDI_RENDER_AHEAD_DEFAULT;
+
+#ifdef ENABLE_MIDI_SYNTH_LOG
+int midi_synth_do_log = ENABLE_MIDI_SYNTH_LOG;
+
+static void
+midi_synth_log(const char *fmt, ...)
+{
+    va_list ap;
+
+    if (midi_synth_do_log) {
+        va_start(ap, fmt);
+        pclog_ex(fmt, ap);
+        va_end(ap);
+    }
+}
+#else
+#    define midi_synth_log(fmt, ...)
+#endif
+
+static void
+midi_synth_dispatch(midi_synth_t *synth, const midi_synth_event_t *ev)
+{
+    uint32_t mask = MIDI_SYNTH_SYSEX_RING - 1;
+    uint32_t pos  = ev->pos & mask;
+    uint32_t first;
+
+    if (ev->len == 0) {
+        uint32_t msg = ev->msg;
+
+        if (synth->ops->play_msg)
+            synth->ops->play_msg(synth->priv, (uint8_t *) &msg);
+        return;
+    }
+
+    /* Unwrap the SysEx data into a linear buffer before handing it over. */
+    first = MIDI_SYNTH_SYSEX_RING - pos;
+    if (first >= ev->len)
+        memcpy(synth->sysex, &synth->data[pos], ev->len);
+    else {
+        memcpy(synth->sysex, &synth->data[pos], first);
+        memcpy(synth->sysex + first, synth->data, ev->len - first);
+    }
+
+    if (synth->ops->play_sysex)
+        synth->ops->play_sysex(synth->priv, synth->sysex, ev->len);
+
+    atomic_store_explicit(&synth->data_tail, ev->pos + ev->len, memory_order_release);
+}
+
+static void
+midi_synth_render(midi_synth_t *synth, float *buf, int16_t *buf16, int frames)
+{
+    if (buf16 != NULL) {
+        if (synth->ops->render_int16) {
+            synth->ops->render_int16(synth->priv, buf16, frames);
+            return;
+        }
+
+        /* The synth only renders float, convert it to saturated 16-bit. */
+        synth->ops->render(synth->priv, synth->render_buf, frames);
+        for (int i = 0; i < (frames << 1); i++) {
+            float s = synth->render_buf[i] * 32767.0f;
+
+            if (s > 32767.0f)
+                s = 32767.0f;
+            else if (s < -32768.0f)
+                s = -32768.0f;
+            buf16[i] = (int16_t) s;
+        }
+    } else
+        synth->ops->render(synth->priv, buf, frames);
+}
+
+/* Apply sound card MIDI volume and filters to a freshly rendered block. */
+static void
+midi_synth_filter(float *buf, int16_t *buf16, int frames)
+{
+    if (filter_midi == NULL)
+        return;
+
+    if (buf16 != NULL) {
+        for (int i = 0; i < (frames << 1); i += 2) {
+            double dl = (double) buf16[i];
+            double dr = (double) buf16[i + 1];
+
+            filter_midi(0, &dl, filter_midi_p);
+            filter_midi(1, &dr, filter_midi_p);
+            buf16[i]     = (int16_t) round(dl);
+            buf16[i + 1] = (int16_t) round(dr);
+        }
+    } else {
+        for (int i = 0; i < (frames << 1); i += 2) {
+            double dl = (double) buf[i];
+            double dr = (double) buf[i + 1];
+
+            filter_midi(0, &dl, filter_midi_p);
+            filter_midi(1, &dr, filter_midi_p);
+            buf[i]     = (float) dl;
+            buf[i + 1] = (float) dr;
+        }
+    }
+}
+
+static void
+midi_synth_render_block(midi_synth_t *synth)
+{
+    uint32_t start  = atomic_load_explicit(&synth->rendered, memory_order_relaxed);
+    uint32_t frames = synth->block_frames;
+    uint32_t pos    = 0;
+    uint32_t next;
+    uint32_t head;
+    uint32_t tail;
+    float   *buf    = NULL;
+    int16_t *buf16  = NULL;
+
+    if (sound_is_float)
+        buf = synth->out_buffer + (synth->out_pos << 1);
+    else
+        buf16 = synth->out_buffer_int16 + (synth->out_pos << 1);
+
+    head = atomic_load_explicit(&synth->ev_head, memory_order_acquire);
+    tail = atomic_load_explicit(&synth->ev_tail, memory_order_relaxed);
+
+    while (pos < frames) {
+        /* Play everything that is due at the current position; late events land here too. */
+        while (tail != head) {
+            const midi_synth_event_t *ev = &synth->events[tail & (MIDI_SYNTH_EVENTS - 1)];
+
+            if ((int32_t) (ev->ts - (start + pos)) > 0)
+                break;
+
+            midi_synth_dispatch(synth, ev);
+            tail++;
+            atomic_store_explicit(&synth->ev_tail, tail, memory_order_release);
+        }
+
+        next = frames;
+        if (tail != head) {
+            uint32_t ev_pos = synth->events[tail & (MIDI_SYNTH_EVENTS - 1)].ts - start;
+
+            if (ev_pos < frames)
+                next = ev_pos;
+        }
+
+        midi_synth_render(synth, buf ? (buf + (pos << 1)) : NULL,
+                          buf16 ? (buf16 + (pos << 1)) : NULL, (int) (next - pos));
+        pos = next;
+    }
+
+    midi_synth_filter(buf, buf16, (int) frames);
+
+    atomic_store_explicit(&synth->rendered, start + frames, memory_order_release);
+
+    synth->out_pos += (int) frames;
+    if (synth->out_pos >= synth->out_frames) {
+        if (sound_is_float)
+            givealbuffer_midi(synth->out_buffer, synth->out_frames << 1);
+        else
+            givealbuffer_midi(synth->out_buffer_int16, synth->out_frames << 1);
+        synth->out_pos = 0;
+    }
+}
+
+static int
+midi_synth_behind(midi_synth_t *synth)
+{
+    uint32_t target = atomic_load_explicit(&synth->emu_frames, memory_order_acquire) + synth->ahead_frames;
+    uint32_t done   = atomic_load_explicit(&synth->rendered, memory_order_relaxed);
+
+    return (int32_t) (target - done) >= (int32_t) synth->block_frames;
+}
+
+static void
+midi_synth_thread(void *param)
+{
+    midi_synth_t *synth = (midi_synth_t *) param;
+
+    thread_set_event(synth->start_event);
+
+    while (atomic_load(&synth->on)) {
+        thread_wait_event(synth->wake_event, -1);
+        thread_reset_event(synth->wake_event);
+
+        while (atomic_load(&synth->on) && midi_synth_behind(synth))
+            midi_synth_render_block(synth);
+    }
+}
+
+static int
+midi_synth_has_space(midi_synth_t *synth, uint32_t bytes)
+{
+    const uint32_t ev_used   = atomic_load_explicit(&synth->ev_head, memory_order_relaxed) -
+                               atomic_load_explicit(&synth->ev_tail, memory_order_acquire);
+    const uint32_t data_used = atomic_load_explicit(&synth->data_head, memory_order_relaxed) -
+                               atomic_load_explicit(&synth->data_tail, memory_order_acquire);
+
+    return (ev_used < MIDI_SYNTH_EVENTS) && ((data_used + bytes) <= MIDI_SYNTH_SYSEX_RING);
+}
+
+static void
+midi_synth_put(midi_synth_t *synth, uint32_t ts, uint32_t msg, const uint8_t *sysex, uint32_t len)
+{
+    const uint32_t      head = atomic_load_explicit(&synth->ev_head, memory_order_relaxed);
+    midi_synth_event_t *ev   = &synth->events[head & (MIDI_SYNTH_EVENTS - 1)];
+
+    ev->ts  = ts;
+    ev->msg = msg;
+    ev->len = len;
+    ev->pos = 0;
+
+    if (len) {
+        const uint32_t data_head = atomic_load_explicit(&synth->data_head, memory_order_relaxed);
+        const uint32_t pos       = data_head & (MIDI_SYNTH_SYSEX_RING - 1);
+        const uint32_t first     = MIDI_SYNTH_SYSEX_RING - pos;
+
+        if (first >= len)
+            memcpy(&synth->data[pos], sysex, len);
+        else {
+            memcpy(&synth->data[pos], sysex, first);
+            memcpy(synth->data, sysex + first, len - first);
+        }
+
+        ev->pos = data_head;
+        atomic_store_explicit(&synth->data_head, data_head + len, memory_order_release);
+    }
+
+    atomic_store_explicit(&synth->ev_head, head + 1, memory_order_release);
+}
+
+/* Move spilled events into the rings, oldest first, as far as they fit. */
+static void
+midi_synth_unspill(midi_synth_t *synth)
+{
+    midi_synth_spill_t *sp;
+
+    while ((sp = synth->spill_head) && midi_synth_has_space(synth, sp->len)) {
+        midi_synth_put(synth, sp->ts, sp->msg, sp->data, sp->len);
+
+        synth->spill_head = sp->next;
+        if (synth->spill_head == NULL)
+            synth->spill_tail = NULL;
+        free(sp);
+    }
+}
+
+void
+midi_synth_poll(midi_synth_t *synth)
+{
+    if (synth == NULL)
+        return;
+
+    if (synth->spill_head != NULL)
+        midi_synth_unspill(synth);
+
+    atomic_fetch_add_explicit(&synth->emu_frames, synth->poll_frames, memory_order_release);
+
+    /* Only wake the render thread once a whole block is due. */
+    if (midi_synth_behind(synth))
+        thread_set_event(synth->wake_event);
+}
+
+/*
+   Events are placed on the render clock, which runs ahead_frames in front of
+   emulated time, so they keep their spacing within a block. One that would
+   land in a block already rendered plays at the start of the next one.
+ */
+static uint32_t
+midi_synth_stamp(midi_synth_t *synth)
+{
+    const uint32_t ts   = atomic_load_explicit(&synth->emu_frames, memory_order_relaxed) + synth->ahead_frames;
+    const uint32_t done = atomic_load_explicit(&synth->rendered, memory_order_acquire);
+
+    return ((int32_t) (ts - done) < 0) ? done : ts;
+}
+
+/*
+   Never blocks the emulation thread: when a burst (typically a large SysEx
+   dump) fills the rings, the rest is queued on the heap with its timestamp
+   and moved over by later pushes and polls as the render thread consumes
+   the rings.
+ */
+static void
+midi_synth_push(midi_synth_t *synth, uint32_t msg, const uint8_t *sysex, uint32_t len)
+{
+    const uint32_t      ts = midi_synth_stamp(synth);
+    midi_synth_spill_t *sp;
+
+    if (synth->spill_head != NULL)
+        midi_synth_unspill(synth);
+
+    if ((synth->spill_head == NULL) && midi_synth_has_space(synth, len)) {
+        midi_synth_put(synth, ts, msg, sysex, len);
+        return;
+    }
+
+    sp = malloc(sizeof(midi_synth_spill_t) + len);
+    if (sp == NULL)
+        return;
+
+    sp->next = NULL;
+    sp->ts   = ts;
+    sp->msg  = msg;
+    sp->len  = len;
+    if (len)
+        memcpy(sp->data, sysex, len);
+
+    if (synth->spill_tail != NULL)
+        synth->spill_tail->next = sp;
+    else
+        synth->spill_head = sp;
+    synth->spill_tail = sp;
+
+    if (!synth->spills++)
+        midi_synth_log("MIDI synth: rings full, queueing events on the heap\n");
+}
+
+void
+midi_synth_msg(midi_synth_t *synth, uint8_t *msg)
+{
+    if (synth != NULL)
+        midi_synth_push(synth, *(uint32_t *) msg, NULL, 0);
+}
+
+void
+midi_synth_sysex(midi_synth_t *synth, uint8_t *sysex, unsigned int len)
+{
+    if ((synth == NULL) || (len == 0))
+        return;
+
+    if (len > SYSEX_SIZE)
+        len = SYSEX_SIZE;
+
+    midi_synth_push(synth, 0, sysex, len);
+}
+
+midi_synth_t *
+midi_synth_init(const midi_synth_ops_t *ops, void *priv, int freq)
+{
+    midi_synth_t *synth;
+    int           ahead = midi_render_ahead;
+
+    if (ahead < 0)
+        ahead = 0;
+    else if (ahead > MIDI_RENDER_AHEAD_MAX)
+        ahead = MIDI_RENDER_AHEAD_MAX;
+
+    synth = calloc(1, sizeof(midi_synth_t));
+
+    synth->ops          = ops;
+    synth->priv         = priv;
+    synth->freq         = freq;
+    synth->poll_frames  = freq / RENDER_RATE;
+    synth->block_frames = synth->poll_frames * MIDI_SYNTH_BLOCK_POLLS;
+    synth->ahead_frames = (uint32_t) (((uint64_t) freq * ahead) / 1000);
+    synth->out_frames   = synth->poll_frames * BUFFER_SEGMENTS;
+
+    synth->render_buf = calloc(synth->block_frames << 1, sizeof(float));
+    if (sound_is_float) {
+        synth->out_buffer = calloc(synth->out_frames << 1, sizeof(float));
+        al_set_midi(freq, (synth->out_frames << 1) * sizeof(float));
+    } else {
+        synth->out_buffer_int16 = calloc(synth->out_frames << 1, sizeof(int16_t));
+        al_set_midi(freq, (synth->out_frames << 1) * sizeof(int16_t));
+    }
+
+    atomic_init(&synth->emu_frames, 0);
+    atomic_init(&synth->ev_head, 0);
+    atomic_init(&synth->data_head, 0);
+    atomic_init(&synth->rendered, 0);
+    atomic_init(&synth->ev_tail, 0);
+    atomic_init(&synth->data_tail, 0);
+    atomic_init(&synth->on, 1);
+
+    synth->wake_event  = thread_create_event();
+    synth->start_event = thread_create_event();
+    synth->thread_h    = thread_create(midi_synth_thread, synth);
+
+    thread_wait_event(synth->start_event, -1);
+    thread_reset_event(synth->start_event);
+
+    /* Prime the render-ahead window. */
+    thread_set_event(synth->wake_event);
+
+    midi_synth_log("MIDI synth: %i Hz, %u-frame blocks, %u frames ahead\n",
+                   freq, synth->block_frames, synth->ahead_frames);
+
+    return synth;
+}
+
+void
+midi_synth_close(midi_synth_t *synth)
+{
+    if (synth == NULL)
+        return;
+
+    atomic_store(&synth->on, 0);
+    thread_set_event(synth->wake_event);
+    thread_wait(synth->thread_h);
+
+    thread_destroy_event(synth->wake_event);
+    thread_destroy_event(synth->start_event);
+
+    while (synth->spill_head != NULL) {
+        midi_synth_spill_t *sp = synth->spill_head;
+
+        synth->spill_head = sp->next;
+        free(sp);
+    }
+
+    if (synth->spills)
+        midi_synth_log("MIDI synth: %u events queued on the heap\n", synth->spills);
+
+    free(synth->render_buf);
+    free(synth->out_buffer);
+    free(synth->out_buffer_int16);
+    free(synth);
+}
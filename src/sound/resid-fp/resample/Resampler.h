@@ -97,6 +97,30 @@ public:
         return softClip(out);
     }
 
+    /**
+     * Input a block of samples, storing every output sample that becomes ready.
+     *
+     * @param samples input samples
+     * @param count number of input samples
+     * @param buf audio output buffer
+     * @param scaleFactor output scale factor
+     * @return number of samples produced
+     */
+    virtual int inputBlock(const int* samples, int count, short* buf, int scaleFactor)
+    {
+        int s = 0;
+
+        for (int i = 0; i < count; i++)
+        {
+            if (input(samples[i]))
+            {
+                buf[s++] = getOutput(scaleFactor);
+            }
+        }
+
+        return s;
+    }
+
     virtual void reset() = 0;
 };
 
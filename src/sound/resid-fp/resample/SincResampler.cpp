@@ -39,9 +39,11 @@
 #  include "config.h"
 #endif
 
-#ifdef HAVE_SMMINTRIN_H
-#  include <smmintrin.h>
-#elif defined(HAVE_ARM_NEON_H)
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#  define RESID_CONVOLVE_SSE2
+#  include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__aarch64__) || defined(_M_ARM64)
+#  define RESID_CONVOLVE_NEON
 #  include <arm_neon.h>
 #endif
 
@@ -81,158 +83,112 @@ double I0(double x)
 }
 
 /**
- * Calculate convolution with sample and sinc.
+ * Calculate two convolutions of the same sample window with two sinc tables.
  *
- * @param a sample buffer input
- * @param b sinc buffer
- * @param bLength length of the sinc buffer
- * @return convolved result
+ * The input samples are stored split in two 16 bit halves (see input()),
+ * so that both can be multiplied with the 16 bit sinc coefficients using
+ * 16x16->32 multiply-accumulate instructions. The result is the exact
+ * 32 bit sum of products of the original samples, identical to the scalar
+ * int * short convolution.
+ *
+ * @param hi high halves of the samples
+ * @param lo biased low halves of the samples
+ * @param b1 first sinc buffer
+ * @param b2 second sinc buffer
+ * @param bLength length of the sinc buffers
+ * @param out1 sums of products for b1 (high, low)
+ * @param out2 sums of products for b2 (high, low)
  */
-int convolve(const int* a, const short* b, int bLength)
+static inline void convolve2(const short* hi, const short* lo, const short* b1, const short* b2, int bLength,
+                             unsigned int out1[2], unsigned int out2[2])
 {
-#ifdef HAVE_EMMINTRIN_H
-    int out = 0;
-
-    const uintptr_t offset = (uintptr_t)(a) & 0x0f;
-
-    // check for aligned accesses
-    if (offset == ((uintptr_t)(b) & 0x0f))
-    {
-        if (offset)
-        {
-            const int l = (0x10 - offset) / 2;
-
-            for (int i = 0; i < l; i++)
-            {
-                out += *a++ * *b++;
-            }
-
-            bLength -= offset;
-        }
-
-        __m128i acc = _mm_setzero_si128();
-
-        const int n = bLength / 8;
-
-        for (int i = 0; i < n; i++)
-        {
-            const __m128i tmp = _mm_madd_epi16(*(__m128i*)a, *(__m128i*)b);
-            acc = _mm_add_epi16(acc, tmp);
-            a += 8;
-            b += 8;
-        }
-
-        __m128i vsum = _mm_add_epi32(acc, _mm_srli_si128(acc, 8));
-        vsum = _mm_add_epi32(vsum, _mm_srli_si128(vsum, 4));
-        out += _mm_cvtsi128_si32(vsum);
-
-        bLength &= 7;
-    }
-#elif defined HAVE_MMINTRIN_H
-    __m64 acc = _mm_setzero_si64();
-
-    const int n = bLength / 4;
-
-    for (int i = 0; i < n; i++)
+    unsigned int hi1 = 0;
+    unsigned int lo1 = 0;
+    unsigned int hi2 = 0;
+    unsigned int lo2 = 0;
+    int i = 0;
+
+#if defined(RESID_CONVOLVE_SSE2)
+    __m128i accHi1 = _mm_setzero_si128();
+    __m128i accLo1 = _mm_setzero_si128();
+    __m128i accHi2 = _mm_setzero_si128();
+    __m128i accLo2 = _mm_setzero_si128();
+
+    for (; i <= bLength - 8; i += 8)
     {
-        const __m64 tmp = _mm_madd_pi16(*(__m64*)a, *(__m64*)b);
-        acc = _mm_add_pi16(acc, tmp);
-        a += 4;
-        b += 4;
+        const __m128i h  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hi + i));
+        const __m128i l  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lo + i));
+        const __m128i c1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b1 + i));
+        const __m128i c2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b2 + i));
+
+        accHi1 = _mm_add_epi32(accHi1, _mm_madd_epi16(h, c1));
+        accLo1 = _mm_add_epi32(accLo1, _mm_madd_epi16(l, c1));
+        accHi2 = _mm_add_epi32(accHi2, _mm_madd_epi16(h, c2));
+        accLo2 = _mm_add_epi32(accLo2, _mm_madd_epi16(l, c2));
     }
 
-    int out = _mm_cvtsi64_si32(acc) + _mm_cvtsi64_si32(_mm_srli_si64(acc, 32));
-    _mm_empty();
-
-    bLength &= 3;
-#elif defined(HAVE_ARM_NEON_H)
-#if (defined(__arm64__) && defined(__APPLE__)) || defined(__aarch64__)
-    int32x4_t acc1Low = vdupq_n_s32(0);
-    int32x4_t acc1High = vdupq_n_s32(0);
-    int32x4_t acc2Low = vdupq_n_s32(0);
-    int32x4_t acc2High = vdupq_n_s32(0);
-
-    const int n = bLength / 16;
-
-    for (int i = 0; i < n; i++)
+    // Horizontal sums of the four accumulators
+    __m128i t0 = _mm_unpacklo_epi32(accHi1, accLo1);
+    __m128i t1 = _mm_unpackhi_epi32(accHi1, accLo1);
+    __m128i t2 = _mm_unpacklo_epi32(accHi2, accLo2);
+    __m128i t3 = _mm_unpackhi_epi32(accHi2, accLo2);
+    t0 = _mm_add_epi32(t0, t1);
+    t2 = _mm_add_epi32(t2, t3);
+    const __m128i s = _mm_add_epi32(_mm_unpacklo_epi64(t0, t2), _mm_unpackhi_epi64(t0, t2));
+
+    hi1 = static_cast<unsigned int>(_mm_cvtsi128_si32(s));
+    lo1 = static_cast<unsigned int>(_mm_cvtsi128_si32(_mm_srli_si128(s, 4)));
+    hi2 = static_cast<unsigned int>(_mm_cvtsi128_si32(_mm_srli_si128(s, 8)));
+    lo2 = static_cast<unsigned int>(_mm_cvtsi128_si32(_mm_srli_si128(s, 12)));
+#elif defined(RESID_CONVOLVE_NEON)
+    int32x4_t accHi1 = vdupq_n_s32(0);
+    int32x4_t accLo1 = vdupq_n_s32(0);
+    int32x4_t accHi2 = vdupq_n_s32(0);
+    int32x4_t accLo2 = vdupq_n_s32(0);
+
+    for (; i <= bLength - 4; i += 4)
     {
-        int16x8_t v11 = vld1q_s16(a);
-        int16x8_t v12 = vld1q_s16(a + 8);
-        int16x8_t v21 = vld1q_s16(b);
-        int16x8_t v22 = vld1q_s16(b + 8);
-
-        acc1Low  = vmlal_s16(acc1Low, vget_low_s16(v11), vget_low_s16(v21));
-        acc1High = vmlal_high_s16(acc1High, v11, v21);
-        acc2Low  = vmlal_s16(acc2Low, vget_low_s16(v12), vget_low_s16(v22));
-        acc2High = vmlal_high_s16(acc2High, v12, v22);
-
-        a += 16;
-        b += 16;
-    }
-
-    bLength &= 15;
-
-    if (bLength >= 8)
-    {
-        int16x8_t v1 = vld1q_s16(a);
-        int16x8_t v2 = vld1q_s16(b);
-
-        acc1Low  = vmlal_s16(acc1Low, vget_low_s16(v1), vget_low_s16(v2));
-        acc1High = vmlal_high_s16(acc1High, v1, v2);
-
-        a += 8;
-        b += 8;
+        const int16x4_t h  = vld1_s16(hi + i);
+        const int16x4_t l  = vld1_s16(lo + i);
+        const int16x4_t c1 = vld1_s16(b1 + i);
+        const int16x4_t c2 = vld1_s16(b2 + i);
+
+        accHi1 = vmlal_s16(accHi1, h, c1);
+        accLo1 = vmlal_s16(accLo1, l, c1);
+        accHi2 = vmlal_s16(accHi2, h, c2);
+        accLo2 = vmlal_s16(accLo2, l, c2);
     }
 
-    bLength &= 7;
-
-    if (bLength >= 4)
-    {
-        int16x4_t v1 = vld1_s16(a);
-        int16x4_t v2 = vld1_s16(b);
-
-        acc1Low  = vmlal_s16(acc1Low, v1, v2);
-
-        a += 4;
-        b += 4;
-    }
-
-    int32x4_t accSumsNeon = vaddq_s32(acc1Low, acc1High);
-    accSumsNeon = vaddq_s32(accSumsNeon, acc2Low);
-    accSumsNeon = vaddq_s32(accSumsNeon, acc2High);
-
-    int out = vaddvq_s32(accSumsNeon);
-
-    bLength &= 3;
-#else
-    int32x4_t acc = vdupq_n_s32(0);
-
-    const int n = bLength / 4;
+    hi1 = static_cast<unsigned int>(vgetq_lane_s32(accHi1, 0) + vgetq_lane_s32(accHi1, 1) + vgetq_lane_s32(accHi1, 2) + vgetq_lane_s32(accHi1, 3));
+    lo1 = static_cast<unsigned int>(vgetq_lane_s32(accLo1, 0) + vgetq_lane_s32(accLo1, 1) + vgetq_lane_s32(accLo1, 2) + vgetq_lane_s32(accLo1, 3));
+    hi2 = static_cast<unsigned int>(vgetq_lane_s32(accHi2, 0) + vgetq_lane_s32(accHi2, 1) + vgetq_lane_s32(accHi2, 2) + vgetq_lane_s32(accHi2, 3));
+    lo2 = static_cast<unsigned int>(vgetq_lane_s32(accLo2, 0) + vgetq_lane_s32(accLo2, 1) + vgetq_lane_s32(accLo2, 2) + vgetq_lane_s32(accLo2, 3));
+#endif
 
-    for (int i = 0; i < n; i++)
+    for (; i < bLength; i++)
     {
-        const int16x4_t h_vec = vld1_s16(a);
-        const int16x4_t x_vec = vld1_s16(b);
-        acc = vmlal_s16(acc, h_vec, x_vec);
-        a += 4;
-        b += 4;
+        hi1 += static_cast<unsigned int>(hi[i] * b1[i]);
+        lo1 += static_cast<unsigned int>(lo[i] * b1[i]);
+        hi2 += static_cast<unsigned int>(hi[i] * b2[i]);
+        lo2 += static_cast<unsigned int>(lo[i] * b2[i]);
     }
 
-    int out = vgetq_lane_s32(acc, 0) +
-              vgetq_lane_s32(acc, 1) +
-              vgetq_lane_s32(acc, 2) +
-              vgetq_lane_s32(acc, 3);
-
-    bLength &= 3;
-#endif
-#else
-    int out = 0;
-#endif
+    out1[0] = hi1;
+    out1[1] = lo1;
+    out2[0] = hi2;
+    out2[1] = lo2;
+}
 
-    for (int i = 0; i < bLength; i++)
-    {
-        out += a[i] * static_cast<int>(b[i]);
-    }
+/**
+ * Reassemble a convolution result from its split sums.
+ *
+ * @param sums sums of products with the high and low halves
+ * @param bSum sum of the sinc coefficients, for the low half bias
+ * @return convolved result
+ */
+static inline int combine(const unsigned int sums[2], int bSum)
+{
+    const int out = static_cast<int>((sums[0] << 16) + sums[1] + (static_cast<unsigned int>(bSum) << 15));
 
     return (out + (1 << 14)) >> 15;
 }
@@ -244,19 +200,32 @@ int SincResampler::fir(int subcycle)
     const int firTableOffset = (subcycle * firRES) & 0x3ff;
 
     // Find firN most recent samples, plus one extra in case the FIR wraps.
-    int sampleStart = sampleIndex - firN + RINGSIZE - 1;
+    // The tables are front padded with zeros to a multiple of 8 taps.
+    const int sampleStart = sampleIndex - firLength + RINGSIZE - 1;
 
-    const int v1 = convolve(sample + sampleStart, (*firTable)[firTableFirst], firN);
+    unsigned int sums1[2];
+    unsigned int sums2[2];
 
     // Use next FIR table, wrap around to first FIR table using
     // previous sample.
-    if (unlikely(++firTableFirst == firRES))
+    if (likely(firTableFirst + 1 < firRES))
+    {
+        // Both tables share the sample window, convolve them in one pass
+        convolve2(sampleHi + sampleStart, sampleLo + sampleStart,
+                  (*firTable)[firTableFirst], (*firTable)[firTableFirst + 1], firLength, sums1, sums2);
+    }
+    else
     {
-        firTableFirst = 0;
-        ++sampleStart;
+        unsigned int dummy[2];
+
+        convolve2(sampleHi + sampleStart, sampleLo + sampleStart,
+                  (*firTable)[firTableFirst], (*firTable)[firTableFirst], firLength, sums1, dummy);
+        convolve2(sampleHi + sampleStart + 1, sampleLo + sampleStart + 1,
+                  (*firTable)[0], (*firTable)[0], firLength, sums2, dummy);
     }
 
-    const int v2 = convolve(sample + sampleStart, (*firTable)[firTableFirst], firN);
+    const int v1 = combine(sums1, firSum[firTableFirst]);
+    const int v2 = combine(sums2, firSum[(firTableFirst + 1 < firRES) ? (firTableFirst + 1) : 0]);
 
     // Linear interpolation between the sinc tables yields good
     // approximation for the exact value.
@@ -320,7 +289,9 @@ SincResampler::SincResampler(
 
     {
         // Allocate memory for FIR tables.
-        firTable = new matrix_t(firRES, firN);
+        firLength = (firN + 7) & ~7;
+        firTable = new matrix_t(firRES, firLength);
+        firSum.assign(firRES, 0);
 
         // The cutoff frequency is midway through the transition band, in effect the same as nyquist.
         const double wc = PI;
@@ -336,6 +307,9 @@ SincResampler::SincResampler(
         for (int i = 0; i < firRES; i++)
         {
             const double jPhase = (double) i / firRES + firN_2;
+            short* const coeff = (*firTable)[i] + (firLength - firN);
+
+            std::fill((*firTable)[i], coeff, static_cast<short>(0));
 
             for (int j = 0; j < firN; j++)
             {
@@ -347,10 +321,14 @@ SincResampler::SincResampler(
                 const double wt = wc * x * inv_cyclesPerSampleD;
                 const double sincWt = std::fabs(wt) >= 1e-8 ? std::sin(wt) / wt : 1.;
 
-                (*firTable)[i][j] = static_cast<short>(scale * sincWt * kaiserXt);
+                coeff[j] = static_cast<short>(scale * sincWt * kaiserXt);
+                firSum[i] += coeff[j];
             }
         }
     }
+
+    std::fill(std::begin(sampleHi), std::end(sampleHi), 0);
+    std::fill(std::begin(sampleLo), std::end(sampleLo), static_cast<short>(0x8000));
 }
 
 SincResampler::~SincResampler()
@@ -362,7 +340,12 @@ bool SincResampler::input(int input)
 {
     bool ready = false;
 
-    sample[sampleIndex] = sample[sampleIndex + RINGSIZE] = input;
+    // Split the sample into hi * 65536 + lo + 32768, see convolve2()
+    const short hi = static_cast<short>(input >> 16);
+    const short lo = static_cast<short>((input & 0xffff) ^ 0x8000);
+
+    sampleHi[sampleIndex] = sampleHi[sampleIndex + RINGSIZE] = hi;
+    sampleLo[sampleIndex] = sampleLo[sampleIndex + RINGSIZE] = lo;
     sampleIndex = (sampleIndex + 1) & (RINGSIZE - 1);
 
     if (sampleOffset < 1024)
@@ -379,7 +362,8 @@ bool SincResampler::input(int input)
 
 void SincResampler::reset()
 {
-    std::fill(std::begin(sample), std::end(sample), 0);
+    std::fill(std::begin(sampleHi), std::end(sampleHi), 0);
+    std::fill(std::begin(sampleLo), std::end(sampleLo), static_cast<short>(0x8000));
     sampleOffset = 0;
 }
 
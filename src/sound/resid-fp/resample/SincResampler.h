@@ -27,6 +27,8 @@
 
 #include "../array.h"
 
+#include <vector>
+
 namespace reSIDfp
 {
 
@@ -55,6 +57,9 @@ private:
     /// Table of the fir filter coefficients
     matrix_t* firTable;
 
+    /// Sum of the coefficients of each fir table
+    std::vector<int> firSum;
+
     int sampleIndex = 0;
 
     /// Filter resolution
@@ -63,13 +68,18 @@ private:
     /// Filter length
     int firN;
 
+    /// Filter table row length, firN rounded up to a multiple of 8
+    int firLength;
+
     const int cyclesPerSample;
 
     int sampleOffset = 0;
 
     int outputValue = 0;
 
-    int sample[RINGSIZE * 2];
+    /// Input samples, split in 16 bit halves for the vectorized convolution
+    short sampleHi[RINGSIZE * 2];
+    short sampleLo[RINGSIZE * 2];
 
 private:
     int fir(int subcycle);
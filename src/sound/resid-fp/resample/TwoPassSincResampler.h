@@ -82,6 +82,21 @@ public:
         return s2->output();
     }
 
+    int inputBlock(const int* samples, int count, short* buf, int scaleFactor) override
+    {
+        int s = 0;
+
+        for (int i = 0; i < count; i++)
+        {
+            if (s1->input(samples[i]) && s2->input(s1->output()))
+            {
+                buf[s++] = getOutput(scaleFactor);
+            }
+        }
+
+        return s;
+    }
+
     void reset() override
     {
         s1->reset();
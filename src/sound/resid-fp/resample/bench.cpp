@@ -0,0 +1,240 @@
+/*
+ * This file is part of libsidplayfp, a SID player engine.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/*
+ * Benchmark and quality check of the vectorized SincResampler against the
+ * scalar int * short convolution it replaces. Not part of the build:
+ *
+ *   g++ -O3 -msse2 bench.cpp SincResampler.cpp -o bench && ./bench
+ *
+ * Both resamplers are fed the same 18 bit wide input, which is wider than
+ * the 16 bit halves the vectorized path works on, and their outputs must
+ * match exactly.
+ */
+
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "../siddefs-fp.h"
+
+#include "SincResampler.h"
+
+#ifndef M_PI
+#  define M_PI    3.14159265358979323846
+#endif
+
+namespace
+{
+
+double I0(double x)
+{
+    double sum = 1.;
+    double u = 1.;
+    double n = 1.;
+    const double halfx = x / 2.;
+
+    do
+    {
+        const double temp = halfx / n;
+        u *= temp * temp;
+        sum += u;
+        n += 1.;
+    }
+    while (u >= 1e-6 * sum);
+
+    return sum;
+}
+
+/// Scalar reference, same tables and phase logic as SincResampler.
+class RefSincResampler
+{
+private:
+    static constexpr int RINGSIZE = 2048;
+
+    std::vector<std::vector<short>> firTable;
+    int firRES;
+    int firN;
+    const int cyclesPerSample;
+    int sampleIndex = 0;
+    int sampleOffset = 0;
+    int outputValue = 0;
+    int sample[RINGSIZE * 2] = {};
+
+    static int convolve(const int* a, const short* b, int bLength)
+    {
+        int out = 0;
+
+        for (int i = 0; i < bLength; i++)
+        {
+            out += a[i] * static_cast<int>(b[i]);
+        }
+
+        return (out + (1 << 14)) >> 15;
+    }
+
+    int fir(int subcycle)
+    {
+        int firTableFirst = (subcycle * firRES >> 10);
+        const int firTableOffset = (subcycle * firRES) & 0x3ff;
+        int sampleStart = sampleIndex - firN + RINGSIZE - 1;
+
+        const int v1 = convolve(sample + sampleStart, firTable[firTableFirst].data(), firN);
+
+        if (++firTableFirst == firRES)
+        {
+            firTableFirst = 0;
+            ++sampleStart;
+        }
+
+        const int v2 = convolve(sample + sampleStart, firTable[firTableFirst].data(), firN);
+
+        return v1 + (firTableOffset * (v2 - v1) >> 10);
+    }
+
+public:
+    RefSincResampler(double clockFrequency, double samplingFrequency, double highestAccurateFrequency) :
+        cyclesPerSample(static_cast<int>(clockFrequency / samplingFrequency * 1024.))
+    {
+        const double A = -20. * std::log10(1.0 / (1 << 16));
+        const double dw = (1. - 2.*highestAccurateFrequency / samplingFrequency) * M_PI * 2.;
+        const double beta = 0.1102 * (A - 8.7);
+        const double I0beta = I0(beta);
+        const double cyclesPerSampleD = clockFrequency / samplingFrequency;
+        const double inv_cyclesPerSampleD = samplingFrequency / clockFrequency;
+
+        int N = static_cast<int>((A - 7.95) / (2.285 * dw) + 0.5);
+        N += N & 1;
+        firN = static_cast<int>(N * cyclesPerSampleD) + 1;
+        firN |= 1;
+        firRES = static_cast<int>(std::ceil(std::sqrt(1.234 * (1 << 16)) * inv_cyclesPerSampleD));
+
+        firTable.assign(firRES, std::vector<short>(firN));
+
+        const double wc = M_PI;
+        const double scale = 32768.0 * wc * inv_cyclesPerSampleD / M_PI;
+        const int tmp = firN / 2;
+        const double firN_2 = static_cast<double>(tmp);
+
+        for (int i = 0; i < firRES; i++)
+        {
+            const double jPhase = (double) i / firRES + firN_2;
+
+            for (int j = 0; j < firN; j++)
+            {
+                const double x = j - jPhase;
+                const double xt = x / firN_2;
+                const double kaiserXt = std::fabs(xt) < 1. ? I0(beta * std::sqrt(1. - xt * xt)) / I0beta : 0.;
+                const double wt = wc * x * inv_cyclesPerSampleD;
+                const double sincWt = std::fabs(wt) >= 1e-8 ? std::sin(wt) / wt : 1.;
+
+                firTable[i][j] = static_cast<short>(scale * sincWt * kaiserXt);
+            }
+        }
+    }
+
+    bool input(int input)
+    {
+        bool ready = false;
+
+        sample[sampleIndex] = sample[sampleIndex + RINGSIZE] = input;
+        sampleIndex = (sampleIndex + 1) & (RINGSIZE - 1);
+
+        if (sampleOffset < 1024)
+        {
+            outputValue = fir(sampleOffset);
+            ready = true;
+            sampleOffset += cyclesPerSample;
+        }
+
+        sampleOffset -= 1024;
+
+        return ready;
+    }
+
+    int output() const { return outputValue; }
+};
+
+int signal(long k)
+{
+    // Two tones plus noise, slightly over the 17 bit range the filters produce
+    const double s = 70000. * std::sin(k * 0.0031) + 40000. * std::sin(k * 0.173);
+    return static_cast<int>(s) + (std::rand() & 0x3fff) - 0x2000;
+}
+
+}
+
+int main(int, const char*[])
+{
+    // SID clock on the SSI-2001 and the first stage of the two pass resampler
+    const double RATE = 14318180.0 / 16.0;
+    const double INTERMEDIATE = 121634.;
+    const long CYCLES = static_cast<long>(RATE) * 20;
+
+    std::vector<int> in(CYCLES);
+
+    for (long k = 0; k < CYCLES; k++)
+    {
+        in[k] = signal(k);
+    }
+
+    std::unique_ptr<reSIDfp::SincResampler> r(new reSIDfp::SincResampler(RATE, INTERMEDIATE, 20000.));
+    std::unique_ptr<RefSincResampler> ref(new RefSincResampler(RATE, INTERMEDIATE, 20000.));
+
+    std::vector<int> out;
+    std::vector<int> refOut;
+    out.reserve(CYCLES / 7 + 1);
+    refOut.reserve(CYCLES / 7 + 1);
+
+    clock_t start = clock();
+    for (long k = 0; k < CYCLES; k++)
+    {
+        if (ref->input(in[k]))
+            refOut.push_back(ref->output());
+    }
+    const double refTime = (clock() - start) * 1000. / CLOCKS_PER_SEC;
+
+    start = clock();
+    for (long k = 0; k < CYCLES; k++)
+    {
+        if (r->input(in[k]))
+            out.push_back(r->output());
+    }
+    const double simdTime = (clock() - start) * 1000. / CLOCKS_PER_SEC;
+
+    long mismatches = out.size() == refOut.size() ? 0 : 1;
+    int maxError = 0;
+
+    for (size_t i = 0; i < out.size() && i < refOut.size(); i++)
+    {
+        const int error = std::abs(out[i] - refOut[i]);
+
+        if (error)
+            mismatches++;
+        if (error > maxError)
+            maxError = error;
+    }
+
+    std::cout << "Samples " << out.size() << ", mismatches " << mismatches << ", max error " << maxError << std::endl;
+    std::cout << "Scalar " << refTime << " ms, vectorized " << simdTime << " ms" << std::endl;
+
+    return mismatches ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -99,6 +99,12 @@ private:
     /// Time until #voiceSync must be run.
     unsigned int nextVoiceSync;
 
+    /// Number of cycles synthesized before handing them to the resampler.
+    static constexpr unsigned int CLOCK_BLOCK = 256;
+
+    /// Per-cycle output of the current block.
+    int block[CLOCK_BLOCK];
+
     /// Currently active chip model.
     ChipModel model;
 
@@ -357,6 +363,10 @@ int SID::clock(unsigned int cycles, short* buf)
 
         if (likely(delta_t > 0))
         {
+            // Synthesize a block of cycles, then resample it in one go
+            if (delta_t > CLOCK_BLOCK)
+                delta_t = CLOCK_BLOCK;
+
             for (unsigned int i = 0; i < delta_t; i++)
             {
                 // clock waveform generators
@@ -369,12 +379,11 @@ int SID::clock(unsigned int cycles, short* buf)
                 voice[1].envelope()->clock();
                 voice[2].envelope()->clock();
 
-                if (unlikely(resampler->input(output())))
-                {
-                    buf[s++] = resampler->getOutput(scaleFactor);
-                }
+                block[i] = output();
             }
 
+            s += resampler->inputBlock(block, static_cast<int>(delta_t), buf + s, scaleFactor);
+
             cycles -= delta_t;
             nextVoiceSync -= delta_t;
         }
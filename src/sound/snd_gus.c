@@ -53,6 +53,11 @@
 #include <86box/hdc_ide.h>
 #include <86box/log.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || defined(__amd64__)
+#    include <emmintrin.h>
+#    define GUS_WAVE_SSE2
+#endif
+
 #ifdef ENABLE_GUS_LOG
 int gus_do_log = ENABLE_GUS_LOG;
 
@@ -70,6 +75,8 @@ gus_log(void *priv, const char *fmt, ...)
 #    define gus_log(fmt, ...)
 #endif
 
+#define GUS_WAVE_BLOCK 256 /* maximum number of wave ticks rendered in one go */
+
 enum {
     MIDI_INT_RECEIVE  = 0x01,
     MIDI_INT_TRANSMIT = 0x02,
@@ -165,6 +172,11 @@ typedef struct gus_t {
     int16_t buffer[2][SOUNDBUFLEN];
     int     pos;
 
+    /* Wave ticks not rendered yet, and the sound position at each of them. */
+    int      wave_pending;
+    uint32_t wave_horizon;
+    int      wave_pos[GUS_WAVE_BLOCK];
+
     pc_timer_t samp_timer;
     uint64_t   samp_latch;
 
@@ -247,6 +259,9 @@ typedef struct gus_t {
     void *   log; /* New logging system */
 } gus_t;
 
+static void gus_wave_flush(gus_t *gus);
+static void gus_wave_update_horizon(gus_t *gus);
+
 static int gus_gf1_irqs[8]  = { -1, 2, 5, 3, 7, 11, 12, 15 };
 static int gus_midi_irqs[8] = { -1, 2, 5, 3, 7, 11, 12, 15 };
 static int gus_dmas[8]      = { -1, 1, 3, 5, 6, 7, -1, -1 };
@@ -410,6 +425,10 @@ gus_write(uint16_t addr, uint8_t val, void *priv)
     else
         port = addr & 0xf0f;
 
+    /* Voice registers, DRAM and DMA all change what the wave engine renders. */
+    if ((port >= 0x302) && (port <= 0x307))
+        gus_wave_flush(gus);
+
     switch (port) {
         case 0x300: /*MIDI control*/
             old            = gus->midi_ctrl;
@@ -962,6 +981,10 @@ gus_write(uint16_t addr, uint8_t val, void *priv)
         default:
             break;
     }
+
+    /* The write may have started a voice, enabled an IRQ or moved its boundary. */
+    if ((port >= 0x302) && (port <= 0x307))
+        gus_wave_update_horizon(gus);
 }
 
 uint8_t
@@ -976,6 +999,9 @@ gus_read(uint16_t addr, void *priv)
     else
         port = addr & 0xf0f;
 
+    if (((port >= 0x302) && (port <= 0x307)) || (port == 0x206))
+        gus_wave_flush(gus);
+
     switch (port) {
         case 0x300: /*MIDI status*/
             val = gus->midi_status;
@@ -1312,9 +1338,9 @@ gus_poll_timer_2(void *priv)
 }
 
 static void
-gus_update(gus_t *gus)
+gus_update_to(gus_t *gus, int pos)
 {
-    for (; gus->pos < sound_pos_global; gus->pos++) {
+    for (; gus->pos < pos; gus->pos++) {
         if (gus->out_l < -32768)
             gus->buffer[0][gus->pos] = -32768;
         else if (gus->out_l > 32767)
@@ -1330,157 +1356,317 @@ gus_update(gus_t *gus)
     }
 }
 
-void
-gus_poll_wave(void *priv)
+static void
+gus_update(gus_t *gus)
 {
-    gus_t   *gus = (gus_t *) priv;
-    uint32_t addr;
-    int16_t  v;
-    int32_t  vl;
-    int      update_irqs = 0;
+    gus_update_to(gus, sound_pos_global);
+}
 
-    gus_update(gus);
+/* Number of wave ticks until the first voice with its wave or ramp IRQ enabled
+   reaches its boundary. Rendering can be deferred for that many ticks without
+   moving any IRQ, as long as nothing touches the GF1 in between. */
+static void
+gus_wave_update_horizon(gus_t *gus)
+{
+    uint32_t horizon = GUS_WAVE_BLOCK;
+    uint32_t dist;
+    uint32_t ticks;
+
+    if ((gus->reset & 3) == 3) {
+        for (uint8_t d = 0; d < 32; d++) {
+            if (!(gus->ctrl[d] & 3) && (gus->ctrl[d] & 0x20)) {
+                if (gus->ctrl[d] & 0x40)
+                    dist = (gus->cur[d] > gus->start[d]) ? (gus->cur[d] - gus->start[d]) : 0;
+                else
+                    dist = (gus->end[d] > gus->cur[d]) ? (gus->end[d] - gus->cur[d]) : 0;
+
+                /* A voice sitting on its boundary fires on the next tick, even with a zero step. */
+                if (dist == 0)
+                    horizon = 1;
+                else if (gus->freq[d] >> 1) {
+                    ticks = (dist + (gus->freq[d] >> 1) - 1) / (gus->freq[d] >> 1);
+                    if (ticks < horizon)
+                        horizon = ticks;
+                }
+            }
 
-    timer_advance_u64(&gus->samp_timer, gus->samp_latch);
+            if (!(gus->rctrl[d] & 3) && (gus->rctrl[d] & 0x20)) {
+                if (gus->rctrl[d] & 0x40)
+                    dist = (gus->rcur[d] > gus->rstart[d]) ? (gus->rcur[d] - gus->rstart[d]) : 0;
+                else
+                    dist = (gus->rend[d] > gus->rcur[d]) ? (gus->rend[d] - gus->rcur[d]) : 0;
+
+                if (dist == 0)
+                    horizon = 1;
+                else if (gus->rfreq[d]) {
+                    ticks = (dist + gus->rfreq[d] - 1) / gus->rfreq[d];
+                    if (ticks < horizon)
+                        horizon = ticks;
+                }
+            }
+        }
+    }
 
-    gus->out_l = gus->out_r = 0;
+    gus->wave_horizon = horizon;
+}
 
-    if ((gus->reset & 3) != 3)
-        return;
-    for (uint8_t d = 0; d < 32; d++) {
-        if (!(gus->ctrl[d] & 3)) {
-            if (gus->ctrl[d] & 4) {
-                addr = gus->cur[d] >> 9;
-                addr = (addr & 0xC0000) | ((addr << 1) & 0x3FFFE);
-                if (!(gus->freq[d] >> 10)) {
-                    /* Interpolate */
-                    if (((addr + 1) & 0xfffff) < gus->gus_end_ram)
-                        vl = (int16_t) (int8_t) ((gus->ram[(addr + 1) & 0xfffff] ^ 0x80) - 0x80) *
-                             (511 - (gus->cur[d] & 511));
-                    else
-                        vl = 0;
+/* Interpolate count samples between the s[] pairs using the w[] weight pairs. */
+static void
+gus_wave_interpolate(const int16_t *s, const int16_t *w, int32_t *v, int count)
+{
+    int i = 0;
 
-                    if (((addr + 3) & 0xfffff) < gus->gus_end_ram)
-                        vl += (int16_t) (int8_t) ((gus->ram[(addr + 3) & 0xfffff] ^ 0x80) - 0x80) *
-                              (gus->cur[d] & 511);
+#ifdef GUS_WAVE_SSE2
+    for (; (i + 4) <= count; i += 4) {
+        const __m128i sv = _mm_loadu_si128((const __m128i *) &s[i << 1]);
+        const __m128i wv = _mm_loadu_si128((const __m128i *) &w[i << 1]);
 
-                    v = vl >> 9;
-                } else if (((addr + 1) & 0xfffff) < gus->gus_end_ram)
-                    v = (int16_t) (int8_t) ((gus->ram[(addr + 1) & 0xfffff] ^ 0x80) - 0x80);
-                else
-                    v = 0x0000;
-            } else {
-                if (!(gus->freq[d] >> 10)) {
-                    /* Interpolate */
-                    if (((gus->cur[d] >> 9) & 0xfffff) < gus->gus_end_ram)
-                        vl = ((int8_t) ((gus->ram[(gus->cur[d] >> 9) & 0xfffff] ^ 0x80) - 0x80)) *
-                                       (511 - (gus->cur[d] & 511));
-                    else
-                        vl = 0;
+        _mm_storeu_si128((__m128i *) &v[i], _mm_srai_epi32(_mm_madd_epi16(sv, wv), 9));
+    }
+#endif
 
-                    if ((((gus->cur[d] >> 9) + 1) & 0xfffff) < gus->gus_end_ram)
-                        vl += ((int8_t) ((gus->ram[((gus->cur[d] >> 9) + 1) & 0xfffff] ^ 0x80) - 0x80)) *
-                              (gus->cur[d] & 511);
+    for (; i < count; i++)
+        v[i] = ((s[i << 1] * w[i << 1]) + (s[(i << 1) + 1] * w[(i << 1) + 1])) >> 9;
+}
 
-                    v = vl >> 9;
-                } else if (((gus->cur[d] >> 9) & 0xfffff) < gus->gus_end_ram)
-                    v = (int16_t) (int8_t) ((gus->ram[(gus->cur[d] >> 9) & 0xfffff] ^ 0x80) - 0x80);
-                else
-                    v = 0x0000;
-            }
+/* Apply the volume ramp to count samples in place. */
+static void
+gus_wave_apply_volume(int32_t *v, const uint16_t *vol, int count)
+{
+    int i = 0;
+
+#ifdef GUS_WAVE_SSE2
+    const __m128d scale = _mm_set1_pd(24.0);
+
+    for (; (i + 2) <= count; i += 2) {
+        const __m128d sv = _mm_cvtepi32_pd(_mm_loadl_epi64((const __m128i *) &v[i]));
+        const __m128d vv = _mm_set_pd(vol16bit[vol[i + 1]], vol16bit[vol[i]]);
+
+        _mm_storel_epi64((__m128i *) &v[i], _mm_cvttpd_epi32(_mm_mul_pd(_mm_mul_pd(sv, scale), vv)));
+    }
+#endif
+
+    for (; i < count; i++)
+        v[i] = (int16_t) ((double) v[i] * 24.0 * vol16bit[vol[i]]);
+}
 
-            if ((gus->rcur[d] >> 14) > 4095)
-                v = (int16_t) (float) (v) *24.0 * vol16bit[4095];
+/* Advance voice d by count wave ticks, adding its output to out_l/out_r.
+   Returns 1 if a wave or ramp IRQ became pending. */
+static int
+gus_wave_render_voice(gus_t *gus, uint8_t d, int32_t *out_l, int32_t *out_r, int count)
+{
+    uint32_t       pos[GUS_WAVE_BLOCK];
+    uint16_t       vol[GUS_WAVE_BLOCK];
+    int16_t        s[GUS_WAVE_BLOCK * 2];
+    int16_t        w[GUS_WAVE_BLOCK * 2];
+    int32_t        v[GUS_WAVE_BLOCK];
+    uint32_t       cur      = gus->cur[d];
+    int            rcur     = gus->rcur[d];
+    uint8_t        ctrl     = gus->ctrl[d];
+    uint8_t        rctrl    = gus->rctrl[d];
+    const uint32_t start    = gus->start[d];
+    const uint32_t end      = gus->end[d];
+    const uint32_t step     = gus->freq[d] >> 1;
+    const int      rstart   = gus->rstart[d];
+    const int      rend     = gus->rend[d];
+    const int      rstep    = gus->rfreq[d];
+    int            wave_irq = 0;
+    int            ramp_irq = 0;
+    int            played   = 0;
+
+    if ((ctrl & 3) && (rctrl & 3))
+        return 0;
+
+    /* Pass 1: step the address and volume ramp generators, which have to stay serial.
+       A voice can only stop within the block, so the samples played are a prefix. */
+    for (int i = 0; i < count; i++) {
+        if (!(ctrl & 3)) {
+            pos[played] = cur;
+            if ((rcur >> 14) > 4095)
+                vol[played] = 4095;
             else
-                v = (int16_t) (float) (v) *24.0 * vol16bit[(gus->rcur[d] >> 10) & 4095];
-
-            gus->out_l += (v * gus->pan_l[d]) / 7;
-            gus->out_r += (v * gus->pan_r[d]) / 7;
-
-            if (gus->ctrl[d] & 0x40) {
-                gus->cur[d] -= (gus->freq[d] >> 1);
-                if (gus->cur[d] <= gus->start[d]) {
-                    int diff = gus->start[d] - gus->cur[d];
-
-                    if (gus->ctrl[d] & 8) {
-                        if (gus->ctrl[d] & 0x10)
-                            gus->ctrl[d] ^= 0x40;
-                        gus->cur[d] = (gus->ctrl[d] & 0x40) ? (gus->end[d] - diff) : (gus->start[d] + diff);
-                    } else if (!(gus->rctrl[d] & 4)) {
-                        gus->ctrl[d] |= 1;
-                        gus->cur[d] = (gus->ctrl[d] & 0x40) ? gus->end[d] : gus->start[d];
+                vol[played] = (rcur >> 10) & 4095;
+            played++;
+
+            if (ctrl & 0x40) {
+                cur -= step;
+                if (cur <= start) {
+                    int diff = start - cur;
+
+                    if (ctrl & 8) {
+                        if (ctrl & 0x10)
+                            ctrl ^= 0x40;
+                        cur = (ctrl & 0x40) ? (end - diff) : (start + diff);
+                    } else if (!(rctrl & 4)) {
+                        ctrl |= 1;
+                        cur = (ctrl & 0x40) ? end : start;
                     }
 
-                    if ((gus->ctrl[d] & 0x20) && !gus->waveirqs[d]) {
-                        gus->waveirqs[d] = 1;
-                        update_irqs      = 1;
-                    }
+                    if (ctrl & 0x20)
+                        wave_irq = 1;
                 }
             } else {
-                gus->cur[d] += (gus->freq[d] >> 1);
-
-                if (gus->cur[d] >= gus->end[d]) {
-                    int diff = gus->cur[d] - gus->end[d];
-
-                    if (gus->ctrl[d] & 8) {
-                        if (gus->ctrl[d] & 0x10)
-                            gus->ctrl[d] ^= 0x40;
-                        gus->cur[d] = (gus->ctrl[d] & 0x40) ? (gus->end[d] - diff) : (gus->start[d] + diff);
-                    } else if (!(gus->rctrl[d] & 4)) {
-                        gus->ctrl[d] |= 1;
-                        gus->cur[d] = (gus->ctrl[d] & 0x40) ? gus->end[d] : gus->start[d];
+                cur += step;
+
+                if (cur >= end) {
+                    int diff = cur - end;
+
+                    if (ctrl & 8) {
+                        if (ctrl & 0x10)
+                            ctrl ^= 0x40;
+                        cur = (ctrl & 0x40) ? (end - diff) : (start + diff);
+                    } else if (!(rctrl & 4)) {
+                        ctrl |= 1;
+                        cur = (ctrl & 0x40) ? end : start;
                     }
 
-                    if ((gus->ctrl[d] & 0x20) && !gus->waveirqs[d]) {
-                        gus->waveirqs[d] = 1;
-                        update_irqs      = 1;
-                    }
+                    if (ctrl & 0x20)
+                        wave_irq = 1;
                 }
             }
         }
-        if (!(gus->rctrl[d] & 3)) {
-            if (gus->rctrl[d] & 0x40) {
-                gus->rcur[d] -= gus->rfreq[d];
-                if (gus->rcur[d] <= gus->rstart[d]) {
-                    int diff = gus->rstart[d] - gus->rcur[d];
-                    if (!(gus->rctrl[d] & 8)) {
-                        gus->rctrl[d] |= 1;
-                        gus->rcur[d] = (gus->rctrl[d] & 0x40) ? gus->rstart[d] : gus->rend[d];
+
+        if (!(rctrl & 3)) {
+            if (rctrl & 0x40) {
+                rcur -= rstep;
+                if (rcur <= rstart) {
+                    int diff = rstart - rcur;
+                    if (!(rctrl & 8)) {
+                        rctrl |= 1;
+                        rcur = (rctrl & 0x40) ? rstart : rend;
                     } else {
-                        if (gus->rctrl[d] & 0x10)
-                            gus->rctrl[d] ^= 0x40;
-                        gus->rcur[d] = (gus->rctrl[d] & 0x40) ? (gus->rend[d] - diff) : (gus->rstart[d] + diff);
+                        if (rctrl & 0x10)
+                            rctrl ^= 0x40;
+                        rcur = (rctrl & 0x40) ? (rend - diff) : (rstart + diff);
                     }
 
-                    if ((gus->rctrl[d] & 0x20) && !gus->rampirqs[d]) {
-                        gus->rampirqs[d] = 1;
-                        update_irqs      = 1;
-                    }
+                    if (rctrl & 0x20)
+                        ramp_irq = 1;
                 }
             } else {
-                gus->rcur[d] += gus->rfreq[d];
-                if (gus->rcur[d] >= gus->rend[d]) {
-                    int diff = gus->rcur[d] - gus->rend[d];
-                    if (!(gus->rctrl[d] & 8)) {
-                        gus->rctrl[d] |= 1;
-                        gus->rcur[d] = (gus->rctrl[d] & 0x40) ? gus->rstart[d] : gus->rend[d];
+                rcur += rstep;
+                if (rcur >= rend) {
+                    int diff = rcur - rend;
+                    if (!(rctrl & 8)) {
+                        rctrl |= 1;
+                        rcur = (rctrl & 0x40) ? rstart : rend;
                     } else {
-                        if (gus->rctrl[d] & 0x10)
-                            gus->rctrl[d] ^= 0x40;
-                        gus->rcur[d] = (gus->rctrl[d] & 0x40) ? (gus->rend[d] - diff) : (gus->rstart[d] + diff);
+                        if (rctrl & 0x10)
+                            rctrl ^= 0x40;
+                        rcur = (rctrl & 0x40) ? (rend - diff) : (rstart + diff);
                     }
 
-                    if ((gus->rctrl[d] & 0x20) && !gus->rampirqs[d]) {
-                        gus->rampirqs[d] = 1;
-                        update_irqs      = 1;
-                    }
+                    if (rctrl & 0x20)
+                        ramp_irq = 1;
                 }
             }
         }
     }
 
+    gus->cur[d]   = cur;
+    gus->rcur[d]  = rcur;
+    gus->ctrl[d]  = ctrl;
+    gus->rctrl[d] = rctrl;
+
+    wave_irq = wave_irq && !gus->waveirqs[d];
+    ramp_irq = ramp_irq && !gus->rampirqs[d];
+    if (wave_irq)
+        gus->waveirqs[d] = 1;
+    if (ramp_irq)
+        gus->rampirqs[d] = 1;
+
+    if (played == 0)
+        return wave_irq || ramp_irq;
+
+    /* Pass 2: fetch the sample pairs. The 16-bit mode and interpolation flag
+       cannot change without a register write, so they hold for the whole block. */
+    if (gus->ctrl[d] & 4) {
+        for (int i = 0; i < played; i++) {
+            const uint32_t addr  = ((pos[i] >> 9) & 0xC0000) | (((pos[i] >> 9) << 1) & 0x3FFFE);
+            const uint32_t addr0 = (addr + 1) & 0xfffff;
+            const uint32_t addr1 = (addr + 3) & 0xfffff;
+
+            s[i << 1]       = (addr0 < gus->gus_end_ram) ? (int8_t) gus->ram[addr0] : 0;
+            s[(i << 1) + 1] = (addr1 < gus->gus_end_ram) ? (int8_t) gus->ram[addr1] : 0;
+        }
+    } else {
+        for (int i = 0; i < played; i++) {
+            const uint32_t addr0 = (pos[i] >> 9) & 0xfffff;
+            const uint32_t addr1 = ((pos[i] >> 9) + 1) & 0xfffff;
+
+            s[i << 1]       = (addr0 < gus->gus_end_ram) ? (int8_t) gus->ram[addr0] : 0;
+            s[(i << 1) + 1] = (addr1 < gus->gus_end_ram) ? (int8_t) gus->ram[addr1] : 0;
+        }
+    }
+
+    /* Pass 3: interpolate, apply the volume ramp and pan. */
+    if (!(gus->freq[d] >> 10)) {
+        for (int i = 0; i < played; i++) {
+            w[i << 1]       = 511 - (pos[i] & 511);
+            w[(i << 1) + 1] = pos[i] & 511;
+        }
+        gus_wave_interpolate(s, w, v, played);
+    } else {
+        for (int i = 0; i < played; i++)
+            v[i] = s[i << 1];
+    }
+
+    gus_wave_apply_volume(v, vol, played);
+
+    for (int i = 0; i < played; i++) {
+        out_l[i] += (v[i] * gus->pan_l[d]) / 7;
+        out_r[i] += (v[i] * gus->pan_r[d]) / 7;
+    }
+
+    return wave_irq || ramp_irq;
+}
+
+/* Render all wave ticks that are still pending. */
+static void
+gus_wave_flush(gus_t *gus)
+{
+    int32_t out_l[GUS_WAVE_BLOCK];
+    int32_t out_r[GUS_WAVE_BLOCK];
+    int     update_irqs = 0;
+    int     count       = gus->wave_pending;
+
+    if (count == 0)
+        return;
+
+    memset(out_l, 0x00, count * sizeof(int32_t));
+    memset(out_r, 0x00, count * sizeof(int32_t));
+
+    if ((gus->reset & 3) == 3) {
+        for (uint8_t d = 0; d < 32; d++)
+            update_irqs |= gus_wave_render_voice(gus, d, out_l, out_r, count);
+    }
+
+    for (int i = 0; i < count; i++) {
+        gus_update_to(gus, gus->wave_pos[i]);
+
+        gus->out_l = out_l[i];
+        gus->out_r = out_r[i];
+    }
+
+    gus->wave_pending = 0;
+
     if (update_irqs)
         gus_update_int_status(gus);
+
+    gus_wave_update_horizon(gus);
+}
+
+void
+gus_poll_wave(void *priv)
+{
+    gus_t *gus = (gus_t *) priv;
+
+    timer_advance_u64(&gus->samp_timer, gus->samp_latch);
+
+    gus->wave_pos[gus->wave_pending++] = sound_pos_global;
+
+    if (gus->wave_pending >= gus->wave_horizon)
+        gus_wave_flush(gus);
 }
 
 void
@@ -1543,6 +1729,7 @@ gus_get_buffer(int32_t *buffer, uint16_t len, void *priv)
     if ((gus->type == GUS_MAX) && (gus->max_ctrl))
         ad1848_update(&gus->ad1848);
 
+    gus_wave_flush(gus);
     gus_update(gus);
     for (uint16_t c = 0; c < len * 2; c += 2) {
         double temp_l = 0.0;
@@ -1577,6 +1764,7 @@ gus_extreme_get_buffer(int32_t *buffer, uint16_t len, void *priv)
 {
     gus_t *gus = (gus_t *) priv;
 
+    gus_wave_flush(gus);
     gus_update(gus);
 
     for (uint16_t c = 0; c < len * 2; c += 2) {
@@ -1708,6 +1896,8 @@ gus_reset(void *priv)
     if (gus == NULL)
         return;
 
+    gus_wave_flush(gus);
+
     memset(gus->ram, 0x00, (gus->gus_end_ram));
 
     for (c = 0; c < 32; c++) {
@@ -1801,6 +1991,7 @@ gus_reset(void *priv)
     }
 
     gus_update_int_status(gus);
+    gus_wave_update_horizon(gus);
 }
 
 void *
@@ -1893,7 +2084,8 @@ gus_init(UNUSED(const device_t *info))
     timer_add(&gus->timer_2, gus_poll_timer_2, gus, 1);
     timer_add(&gus->sample_timer, gus_input_poll, gus, 0);
 
-    sound_add_handler(gus_get_buffer, gus);
+    /* Flushing the wave engine can raise or clear the IRQ. */
+    sound_add_handler_ex(gus_get_buffer, gus, SOUND_HANDLER_SERIAL);
 
     if ((gus->type != GUS_ACE) && (device_get_config_int("receive_input")))
         midi_in_handler(1, gus_input_msg, gus_input_sysex, gus);
@@ -1987,7 +2179,7 @@ gus_extreme_init(UNUSED(const device_t *info))
     timer_add(&gus->timer_1, gus_poll_timer_1, gus, 1);
     timer_add(&gus->timer_2, gus_poll_timer_2, gus, 1);
 
-    sound_add_handler(gus_extreme_get_buffer, gus);
+    sound_add_handler_ex(gus_extreme_get_buffer, gus, SOUND_HANDLER_SERIAL);
 
     gus->gameport = gameport_add(&gameport_pnp_1io_device);
     gameport_remap(gus->gameport, 0x201);
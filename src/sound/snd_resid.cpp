@@ -2,6 +2,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <vector>
 
 #include "resid-fp/sid.h"
 #include <86box/plat.h>
@@ -9,12 +10,23 @@
 
 #define RESID_FREQ 48000
 
+/* SID clocks per output sample. */
+#define RESID_CYCLES_PER_SAMPLE ((14318180.0 / 16.0) / (double) RESID_FREQ)
+
+/* Most samples carried between blocks; absorbs the resampler's rate rounding. */
+#define RESID_HOLD_MAX 16
+
 using reSIDfp::SID;
 
 typedef struct psid_t {
     /* resid sid implementation */
     SID    *sid;
     int16_t last_sample;
+
+    /* Block rendering state */
+    double               cycles_due;  /* fractional SID clocks carried over */
+    int                  held;        /* samples carried over (< 0: owed) */
+    std::vector<int16_t> block;
 } psid_t;
 
 psid_t *psid;
@@ -25,8 +37,11 @@ sid_init(uint8_t type, double range)
     reSIDfp::SamplingMethod method         = reSIDfp::RESAMPLE;
     float                   cycles_per_sec = 14318180.0 / 16.0;
 
-    psid      = new psid_t;
-    psid->sid = new SID;
+    psid              = new psid_t;
+    psid->sid         = new SID;
+    psid->last_sample = 0;
+    psid->cycles_due  = 0.0;
+    psid->held        = 0;
 	psid->sid->setFilter6581Range(range);
 	psid->sid->reset();
     switch (type) {
@@ -63,15 +78,16 @@ void
 sid_close(UNUSED(void *priv))
 {
     delete psid->sid;
-#if 0
-    free(psid);
-#endif
+    delete psid;
+    psid = nullptr;
 }
 
 void
 sid_reset(UNUSED(void *priv))
 {
     psid->sid->reset();
+    psid->cycles_due = 0.0;
+    psid->held       = 0;
 
     for (uint8_t c = 0; c < 32; c++)
         psid->sid->write(c, 0);
@@ -89,21 +105,69 @@ sid_write(uint16_t addr, uint8_t val, UNUSED(void *priv))
     psid->sid->write(addr & 0x1f, val);
 }
 
-#define CLOCK_DELTA(n) (int) (((14318180.0 * n) / 16.0) / (float) RESID_FREQ)
-
-static void
-fillbuf2(int &count, int16_t *buf, UNUSED(int len))
-{
-    int c = psid->sid->clock(count, buf);
-
-    if (!c)
-        *buf = psid->last_sample;
-    psid->last_sample = *buf;
-}
+/*
+ * Render exactly len samples. The SID is clocked for the emulated time the
+ * block covers, with the fractional clock carried over, and the whole chunk
+ * between two register accesses is synthesized in one call. The resampler
+ * phase can make a chunk yield one sample more or less than asked for; the
+ * surplus is held for the next block and a shortfall repeats the last sample
+ * and is made up for by dropping the next surplus sample. The resampler's
+ * rate is rounded, so the carry is bounded by RESID_HOLD_MAX.
+ */
 void
 sid_fillbuf(int16_t *buf, int len, UNUSED(void *priv))
 {
-    int x = CLOCK_DELTA(len);
+    std::vector<int16_t> &block = psid->block;
+    int                   cycles;
+    int                   produced;
+    int                   start;
+    int                   avail;
+    int                   pos;
+    int                   owed = 0;
+
+    if (len <= 0)
+        return;
+
+    psid->cycles_due += (double) len * RESID_CYCLES_PER_SAMPLE;
+    cycles = (int) psid->cycles_due;
+    psid->cycles_due -= (double) cycles;
+
+    /* Room for held samples plus the resampler rounding slack. */
+    start = (psid->held > 0) ? psid->held : 0;
+    if (block.size() < (size_t) (start + len + 16))
+        block.resize(start + len + 16);
+
+    produced = psid->sid->clock(cycles, block.data() + start);
+
+    if (psid->held < 0) {
+        /* Drop the samples owed from the previous block. */
+        int skip = -psid->held;
+
+        if (skip > produced)
+            skip = produced;
+        memmove(block.data(), block.data() + skip, (produced - skip) * sizeof(int16_t));
+        owed = psid->held + skip;
+        produced -= skip;
+    }
 
-    fillbuf2(x, buf, len);
+    avail = start + produced;
+    pos   = (avail < len) ? avail : len;
+    memcpy(buf, block.data(), pos * sizeof(int16_t));
+
+    if (pos)
+        psid->last_sample = buf[pos - 1];
+
+    for (int c = pos; c < len; c++)
+        buf[c] = psid->last_sample;
+
+    if (avail > len) {
+        psid->held = avail - len;
+        if (psid->held > RESID_HOLD_MAX)
+            psid->held = RESID_HOLD_MAX;
+        memmove(block.data(), block.data() + len, psid->held * sizeof(int16_t));
+    } else {
+        psid->held = owed - (len - avail);
+        if (psid->held < -RESID_HOLD_MAX)
+            psid->held = -RESID_HOLD_MAX;
+    }
 }
\ No newline at end of file
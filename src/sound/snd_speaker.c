@@ -123,7 +123,8 @@ speaker_init(const device_t *info)
 {
     speaker_t *dev     = (speaker_t *) calloc(1, sizeof(speaker_t));
 
-    music_add_handler(speaker_get_buffer, dev);
+    /* The PC speaker filter lives in whichever sound card installed it. */
+    music_add_handler_ex(speaker_get_buffer, dev, SOUND_HANDLER_SERIAL);
 
     speaker_mute       = 0;
     speaker_gated      = 0;
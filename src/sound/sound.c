@@ -37,6 +37,14 @@
 #include <86box/fdd_audio.h>
 #include <86box/hdd_audio.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || defined(__amd64__)
+#    include <emmintrin.h>
+#    define SOUND_MIX_SSE2
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+#    include <arm_neon.h>
+#    define SOUND_MIX_NEON
+#endif
+
 typedef struct {
     const device_t *device;
 } SOUND_CARD;
@@ -44,8 +52,30 @@ typedef struct {
 typedef struct {
     void (*get_buffer)(int32_t *buffer, uint16_t len, void *priv);
     void *priv;
+
+    uint32_t        flags;
+    const device_t *device;      /* device context at registration time */
+    uint8_t         lane;        /* 0 = emulation thread, 1+ = mixer worker */
+    int32_t        *mix_buffer;  /* private render target for worker lanes */
+
+    uint64_t        render_us;   /* host time spent in get_buffer() */
+    uint64_t        render_calls;
 } sound_handler_t;
 
+typedef struct {
+    thread_t        *thread;
+    event_t         *start_event;
+    event_t         *done_event;
+    uint8_t          lane;
+} sound_mix_worker_t;
+
+/* The job the mixer workers are currently rendering. */
+typedef struct {
+    sound_handler_t *handlers;
+    uint8_t          count;
+    uint16_t         len;
+} sound_mix_job_t;
+
 int  sound_card_current[SOUND_CARD_MAX] = { 0, 0, 0, 0 };
 int  sound_pos_global                   = 0;
 static int sound_buf_len                = SOUNDBUFLEN;
@@ -57,6 +87,7 @@ char sound_output_device[512]           = { 0 };
 
 int  midi_freq                          = 44100;
 int  midi_buf_size                      = 4410;
+int  sound_mix_threads                  = 0;
 
 unsigned long long src_freqs[I_MAX] = {
     0, MUSIC_FREQ, WT_FREQ, CD_FREQ, 0, 0, YM2151_FREQ, 0
@@ -74,6 +105,11 @@ static sound_handler_t wavetable_handlers[NUM_WAVETABLE_HANDLERS];
 
 static double     cd_audio_volume_lut[256];
 
+static sound_mix_worker_t sound_mix_workers[SOUND_MIX_MAX_THREADS];
+static sound_mix_job_t    sound_mix_job;
+static int                sound_mix_workers_num = 0;
+static volatile int       sound_mix_running     = 0;
+
 static thread_t  *sound_cd_thread_h;
 static event_t   *sound_cd_event;
 static event_t   *sound_cd_start_event;
@@ -451,6 +487,210 @@ sound_cd_thread(UNUSED(void *param))
     }
 }
 
+static inline int
+sound_handler_offloaded(const sound_handler_t *h)
+{
+    return (h->get_buffer != NULL) && (h->mix_buffer != NULL) &&
+           (h->lane > 0) && (h->lane <= sound_mix_workers_num);
+}
+
+static void
+sound_handler_render(sound_handler_t *h, int32_t *buffer, uint16_t len)
+{
+    const uint64_t start = plat_get_micro_ticks();
+
+    h->get_buffer(buffer, len, h->priv);
+
+    h->render_us += plat_get_micro_ticks() - start;
+    h->render_calls++;
+}
+
+static void
+sound_mix_thread(void *param)
+{
+    const sound_mix_worker_t *worker = (sound_mix_worker_t *) param;
+
+    thread_set_event(worker->done_event);
+
+    while (1) {
+        thread_wait_event(worker->start_event, -1);
+        thread_reset_event(worker->start_event);
+
+        if (!sound_mix_running)
+            break;
+
+        for (uint8_t c = 0; c < sound_mix_job.count; c++) {
+            sound_handler_t *h = &sound_mix_job.handlers[c];
+
+            if (!sound_handler_offloaded(h) || (h->lane != worker->lane))
+                continue;
+
+            memset(h->mix_buffer, 0x00, sound_mix_job.len * 2 * sizeof(int32_t));
+            sound_handler_render(h, h->mix_buffer, sound_mix_job.len);
+        }
+
+        thread_set_event(worker->done_event);
+    }
+}
+
+static void
+sound_mix_thread_init(void)
+{
+    int threads = sound_mix_threads;
+
+    if (sound_mix_running || (threads <= 0))
+        return;
+
+    if (threads > SOUND_MIX_MAX_THREADS)
+        threads = SOUND_MIX_MAX_THREADS;
+
+    sound_mix_running = 1;
+
+    for (int i = 0; i < threads; i++) {
+        sound_mix_worker_t *worker = &sound_mix_workers[i];
+
+        worker->lane        = i + 1;
+        worker->start_event = thread_create_event();
+        worker->done_event  = thread_create_event();
+        worker->thread      = thread_create(sound_mix_thread, worker);
+
+        thread_wait_event(worker->done_event, -1);
+        thread_reset_event(worker->done_event);
+    }
+
+    sound_mix_workers_num = threads;
+    sound_log("Started %i sound mixer worker(s)\n", threads);
+}
+
+void
+sound_mix_thread_end(void)
+{
+    if (!sound_mix_running)
+        return;
+
+    sound_mix_running = 0;
+
+    for (int i = 0; i < sound_mix_workers_num; i++) {
+        sound_mix_worker_t *worker = &sound_mix_workers[i];
+
+        thread_set_event(worker->start_event);
+        thread_wait(worker->thread);
+
+        thread_destroy_event(worker->start_event);
+        thread_destroy_event(worker->done_event);
+        memset(worker, 0x00, sizeof(sound_mix_worker_t));
+    }
+
+    sound_mix_workers_num = 0;
+}
+
+static void
+sound_mix_accumulate(int32_t *dst, const int32_t *src, uint32_t samples)
+{
+    uint32_t c = 0;
+
+#if defined(SOUND_MIX_SSE2)
+    for (; (c + 4) <= samples; c += 4) {
+        const __m128i d = _mm_loadu_si128((const __m128i *) &dst[c]);
+        const __m128i s = _mm_loadu_si128((const __m128i *) &src[c]);
+
+        _mm_storeu_si128((__m128i *) &dst[c], _mm_add_epi32(d, s));
+    }
+#elif defined(SOUND_MIX_NEON)
+    for (; (c + 4) <= samples; c += 4)
+        vst1q_s32(&dst[c], vaddq_s32(vld1q_s32(&dst[c]), vld1q_s32(&src[c])));
+#endif
+
+    for (; c < samples; c++)
+        dst[c] += src[c];
+}
+
+/* Convert the 32-bit mix to the output format, saturating to 16 bits for int16 output. */
+static void
+sound_mix_convert(const int32_t *in, float *out_float, int16_t *out_int16, uint32_t samples)
+{
+    uint32_t c = 0;
+
+    if (sound_is_float) {
+#if defined(SOUND_MIX_SSE2)
+        const __m128 scale = _mm_set1_ps(1.0f / 32768.0f);
+
+        for (; (c + 4) <= samples; c += 4) {
+            const __m128i v = _mm_loadu_si128((const __m128i *) &in[c]);
+
+            _mm_storeu_ps(&out_float[c], _mm_mul_ps(_mm_cvtepi32_ps(v), scale));
+        }
+#elif defined(SOUND_MIX_NEON)
+        for (; (c + 4) <= samples; c += 4)
+            vst1q_f32(&out_float[c], vmulq_n_f32(vcvtq_f32_s32(vld1q_s32(&in[c])), 1.0f / 32768.0f));
+#endif
+        for (; c < samples; c++)
+            out_float[c] = ((float) in[c]) / (float) 32768.0;
+    } else {
+#if defined(SOUND_MIX_SSE2)
+        for (; (c + 8) <= samples; c += 8) {
+            const __m128i lo = _mm_loadu_si128((const __m128i *) &in[c]);
+            const __m128i hi = _mm_loadu_si128((const __m128i *) &in[c + 4]);
+
+            _mm_storeu_si128((__m128i *) &out_int16[c], _mm_packs_epi32(lo, hi));
+        }
+#elif defined(SOUND_MIX_NEON)
+        for (; (c + 8) <= samples; c += 8)
+            vst1q_s16(&out_int16[c], vcombine_s16(vqmovn_s32(vld1q_s32(&in[c])), vqmovn_s32(vld1q_s32(&in[c + 4]))));
+#endif
+        for (; c < samples; c++) {
+            if (in[c] > 32767)
+                out_int16[c] = 32767;
+            else if (in[c] < -32768)
+                out_int16[c] = -32768;
+            else
+                out_int16[c] = (int16_t) in[c];
+        }
+    }
+}
+
+/* Render a handler chain into buffer. Handlers on worker lanes render into their own
+   buffers in parallel with the emulation thread lane and are summed in afterwards. */
+static void
+sound_mix_handlers(sound_handler_t *handlers, uint8_t count, int32_t *buffer, uint16_t len)
+{
+    uint32_t lanes = 0;
+
+    for (uint8_t c = 0; c < count; c++) {
+        if (sound_handler_offloaded(&handlers[c]))
+            lanes |= (1 << handlers[c].lane);
+    }
+
+    if (lanes) {
+        sound_mix_job.handlers = handlers;
+        sound_mix_job.count    = count;
+        sound_mix_job.len      = len;
+
+        for (int i = 0; i < sound_mix_workers_num; i++)
+            if (lanes & (1 << sound_mix_workers[i].lane))
+                thread_set_event(sound_mix_workers[i].start_event);
+    }
+
+    for (uint8_t c = 0; c < count; c++) {
+        if ((handlers[c].get_buffer != NULL) && !sound_handler_offloaded(&handlers[c]))
+            sound_handler_render(&handlers[c], buffer, len);
+    }
+
+    if (lanes) {
+        for (int i = 0; i < sound_mix_workers_num; i++) {
+            if (lanes & (1 << sound_mix_workers[i].lane)) {
+                thread_wait_event(sound_mix_workers[i].done_event, -1);
+                thread_reset_event(sound_mix_workers[i].done_event);
+            }
+        }
+
+        for (uint8_t c = 0; c < count; c++) {
+            if (sound_handler_offloaded(&handlers[c]))
+                sound_mix_accumulate(buffer, handlers[c].mix_buffer, len * 2);
+        }
+    }
+}
+
 static void
 sound_realloc_buffers(void)
 {
@@ -610,58 +850,172 @@ sound_init(void)
         cdaudioon = 0;
 
     cd_thread_enable = available_cdrom_drives ? 1 : 0;
+
+    sound_mix_thread_init();
 }
 
-void
-sound_add_handler(void (*get_buffer)(int32_t *buffer, uint16_t len, void *priv), void *priv)
+static int
+sound_handlers_share_state(const sound_handler_t *a, const sound_handler_t *b)
 {
-    if (sound_handlers_num >= NUM_SOUND_HANDLERS) {
-        sound_log("sound_add_handler: handler table full, dropping registration\n");
-        return;
+    /* Handlers of the same card instance share its state, and handlers with the same
+       callback may share file-scope filter state, so keep either on the same lane. */
+    return (a->priv == b->priv) || (a->get_buffer == b->get_buffer);
+}
+
+static void
+sound_handler_move_lane(sound_handler_t *handlers, uint8_t num, uint8_t from, uint8_t to)
+{
+    for (uint8_t i = 0; i < num; i++)
+        if (handlers[i].lane == from)
+            handlers[i].lane = to;
+}
+
+static void
+sound_handler_assign_lane(sound_handler_t *handlers, uint8_t num)
+{
+    sound_handler_t *h                                 = &handlers[num];
+    int              lane_load[SOUND_MIX_MAX_THREADS + 1] = { 0 };
+    int              threads                           = sound_mix_threads;
+    int              lane                              = -1;
+
+    if (threads > SOUND_MIX_MAX_THREADS)
+        threads = SOUND_MIX_MAX_THREADS;
+
+    for (uint8_t i = 0; i < num; i++) {
+        if (sound_handlers_share_state(&handlers[i], h) && ((lane == -1) || (handlers[i].lane == 0)))
+            lane = handlers[i].lane;
+        lane_load[handlers[i].lane]++;
     }
 
-    sound_handlers[sound_handlers_num].get_buffer = get_buffer;
-    sound_handlers[sound_handlers_num].priv       = priv;
-    sound_handlers_num++;
+    if ((threads <= 0) || (h->flags & SOUND_HANDLER_SERIAL))
+        lane = 0;
+    else if (lane == -1) {
+        /* New independent producer, put it on the least loaded worker. */
+        lane = 1;
+        for (int l = 2; l <= threads; l++)
+            if (lane_load[l] < lane_load[lane])
+                lane = l;
+    }
+
+    /* Anything this handler shares state with has to end up on the same lane. */
+    for (uint8_t i = 0; i < num; i++)
+        if (sound_handlers_share_state(&handlers[i], h) && (handlers[i].lane != lane))
+            sound_handler_move_lane(handlers, num, handlers[i].lane, lane);
+
+    h->lane = lane;
 }
 
-void
-music_add_handler(void (*get_buffer)(int32_t *buffer, uint16_t len, void *priv), void *priv)
+static void
+sound_handler_add(sound_handler_t *handlers, uint8_t *num, uint8_t max, uint16_t buf_len,
+                  void (*get_buffer)(int32_t *buffer, uint16_t len, void *priv), void *priv,
+                  uint32_t flags, const char *func)
 {
-    if (music_handlers_num >= NUM_MUSIC_HANDLERS) {
-        sound_log("music_add_handler: handler table full, dropping registration\n");
+    sound_handler_t *h;
+
+    if (*num >= max) {
+        sound_log("%s: handler table full, dropping registration\n", func);
         return;
     }
 
-    music_handlers[music_handlers_num].get_buffer = get_buffer;
-    music_handlers[music_handlers_num].priv       = priv;
-    music_handlers_num++;
+    h             = &handlers[*num];
+    h->get_buffer = get_buffer;
+    h->priv       = priv;
+    h->flags      = flags;
+    h->device     = device_context_get_device();
+    h->mix_buffer = NULL;
+
+    sound_handler_assign_lane(handlers, *num);
+
+    if (sound_mix_threads > 0)
+        h->mix_buffer = calloc(buf_len * 2, sizeof(int32_t));
+
+    (*num)++;
 }
 
-void
-ym2151_add_handler(void (*get_buffer)(int32_t *buffer, uint16_t len, void *priv), void *priv)
+static void
+sound_handlers_clear(sound_handler_t *handlers, uint8_t *num, uint8_t max)
 {
-    if (ym2151_handlers_num >= NUM_YM2151_HANDLERS) {
-        sound_log("ym2151_add_handler: handler table full, dropping registration\n");
-        return;
+    for (uint8_t i = 0; i < max; i++) {
+        if (handlers[i].mix_buffer != NULL)
+            free(handlers[i].mix_buffer);
     }
 
-    ym2151_handlers[ym2151_handlers_num].get_buffer = get_buffer;
-    ym2151_handlers[ym2151_handlers_num].priv       = priv;
-    ym2151_handlers_num++;
+    *num = 0;
+    memset(handlers, 0x00, max * sizeof(sound_handler_t));
+}
+
+void
+sound_add_handler_ex(void (*get_buffer)(int32_t *buffer, uint16_t len, void *priv), void *priv, uint32_t flags)
+{
+    sound_handler_add(sound_handlers, &sound_handlers_num, NUM_SOUND_HANDLERS, SOUNDBUFLEN,
+                      get_buffer, priv, flags, "sound_add_handler");
+}
+
+void
+sound_add_handler(void (*get_buffer)(int32_t *buffer, uint16_t len, void *priv), void *priv)
+{
+    sound_add_handler_ex(get_buffer, priv, 0);
+}
+
+void
+music_add_handler_ex(void (*get_buffer)(int32_t *buffer, uint16_t len, void *priv), void *priv, uint32_t flags)
+{
+    sound_handler_add(music_handlers, &music_handlers_num, NUM_MUSIC_HANDLERS, MUSICBUFLEN,
+                      get_buffer, priv, flags, "music_add_handler");
+}
+
+void
+music_add_handler(void (*get_buffer)(int32_t *buffer, uint16_t len, void *priv), void *priv)
+{
+    music_add_handler_ex(get_buffer, priv, 0);
+}
+
+void
+ym2151_add_handler(void (*get_buffer)(int32_t *buffer, uint16_t len, void *priv), void *priv)
+{
+    sound_handler_add(ym2151_handlers, &ym2151_handlers_num, NUM_YM2151_HANDLERS, YM2151BUFLEN,
+                      get_buffer, priv, 0, "ym2151_add_handler");
 }
 
 void
 wavetable_add_handler(void (*get_buffer)(int32_t *buffer, uint16_t len, void *priv), void *priv)
 {
-    if (wavetable_handlers_num >= NUM_WAVETABLE_HANDLERS) {
-        sound_log("wavetable_add_handler: handler table full, dropping registration\n");
-        return;
+    sound_handler_add(wavetable_handlers, &wavetable_handlers_num, NUM_WAVETABLE_HANDLERS, WTBUFLEN,
+                      get_buffer, priv, 0, "wavetable_add_handler");
+}
+
+int
+sound_get_handler_stats(sound_handler_stats_t *stats, int max)
+{
+    static const struct {
+        const char      *chain;
+        sound_handler_t *handlers;
+        const uint8_t   *num;
+    } chains[] = {
+        { "sound",     sound_handlers,     &sound_handlers_num     },
+        { "music",     music_handlers,     &music_handlers_num     },
+        { "ym2151",    ym2151_handlers,    &ym2151_handlers_num    },
+        { "wavetable", wavetable_handlers, &wavetable_handlers_num }
+    };
+    int count = 0;
+
+    for (uint8_t i = 0; i < (sizeof(chains) / sizeof(chains[0])); i++) {
+        for (uint8_t c = 0; (c < *chains[i].num) && (count < max); c++) {
+            const sound_handler_t *h = &chains[i].handlers[c];
+
+            if (h->get_buffer == NULL)
+                continue;
+
+            stats[count].name         = (h->device != NULL) ? h->device->name : "Unknown";
+            stats[count].chain        = chains[i].chain;
+            stats[count].lane         = h->lane;
+            stats[count].render_us    = h->render_us;
+            stats[count].render_calls = h->render_calls;
+            count++;
+        }
     }
 
-    wavetable_handlers[wavetable_handlers_num].get_buffer = get_buffer;
-    wavetable_handlers[wavetable_handlers_num].priv       = priv;
-    wavetable_handlers_num++;
+    return count;
 }
 
 void
@@ -718,22 +1072,9 @@ sound_poll(UNUSED(void *priv))
     if (sound_pos_global == sound_buf_len) {
         memset(outbuffer, 0x00, sound_buf_len * 2 * sizeof(int32_t));
 
-        for (uint8_t c = 0; c < handler_count; c++)
-            if (sound_handlers[c].get_buffer != NULL)
-                sound_handlers[c].get_buffer(outbuffer, sound_buf_len, sound_handlers[c].priv);
+        sound_mix_handlers(sound_handlers, handler_count, outbuffer, sound_buf_len);
 
-        for (uint32_t c = 0; c < (uint32_t) (sound_buf_len * 2); c++) {
-            if (sound_is_float)
-                outbuffer_ex[c] = ((float) outbuffer[c]) / (float) 32768.0;
-            else {
-                if (outbuffer[c] > 32767)
-                    outbuffer[c] = 32767;
-                if (outbuffer[c] < -32768)
-                    outbuffer[c] = -32768;
-
-                outbuffer_ex_int16[c] = (int16_t) outbuffer[c];
-            }
-        }
+        sound_mix_convert(outbuffer, outbuffer_ex, outbuffer_ex_int16, (uint32_t) (sound_buf_len * 2));
 
         if (sound_is_float)
             givealbuffer(outbuffer_ex);
@@ -762,22 +1103,9 @@ music_poll(UNUSED(void *priv))
     if (music_pos_global == MUSICBUFLEN) {
         memset(outbuffer_m, 0x00, MUSICBUFLEN * 2 * sizeof(int32_t));
 
-        for (uint8_t c = 0; c < handler_count; c++)
-            if (music_handlers[c].get_buffer != NULL)
-                music_handlers[c].get_buffer(outbuffer_m, MUSICBUFLEN, music_handlers[c].priv);
+        sound_mix_handlers(music_handlers, handler_count, outbuffer_m, MUSICBUFLEN);
 
-        for (uint32_t c = 0; c < MUSICBUFLEN * 2; c++) {
-            if (sound_is_float)
-                outbuffer_m_ex[c] = ((float) outbuffer_m[c]) / (float) 32768.0;
-            else {
-                if (outbuffer_m[c] > 32767)
-                    outbuffer_m[c] = 32767;
-                if (outbuffer_m[c] < -32768)
-                    outbuffer_m[c] = -32768;
-
-                outbuffer_m_ex_int16[c] = (int16_t) outbuffer_m[c];
-            }
-        }
+        sound_mix_convert(outbuffer_m, outbuffer_m_ex, outbuffer_m_ex_int16, MUSICBUFLEN * 2);
 
         if (sound_is_float)
             givealbuffer_music(outbuffer_m_ex);
@@ -799,22 +1127,9 @@ ym2151_poll(UNUSED(void *priv))
     if (ym2151_pos_global == YM2151BUFLEN) {
         memset(outbuffer_y, 0x00, YM2151BUFLEN * 2 * sizeof(int32_t));
 
-        for (uint8_t c = 0; c < handler_count; c++)
-            if (ym2151_handlers[c].get_buffer != NULL)
-                ym2151_handlers[c].get_buffer(outbuffer_y, YM2151BUFLEN, ym2151_handlers[c].priv);
-
-        for (uint32_t c = 0; c < YM2151BUFLEN * 2; c++) {
-            if (sound_is_float)
-                outbuffer_y_ex[c] = ((float) outbuffer_y[c]) / (float) 32768.0;
-            else {
-                if (outbuffer_y[c] > 32767)
-                    outbuffer_y[c] = 32767;
-                if (outbuffer_y[c] < -32768)
-                    outbuffer_y[c] = -32768;
+        sound_mix_handlers(ym2151_handlers, handler_count, outbuffer_y, YM2151BUFLEN);
 
-                outbuffer_y_ex_int16[c] = (int16_t) outbuffer_y[c];
-            }
-        }
+        sound_mix_convert(outbuffer_y, outbuffer_y_ex, outbuffer_y_ex_int16, YM2151BUFLEN * 2);
 
         if (sound_is_float)
             givealbuffer_ym2151(outbuffer_y_ex);
@@ -836,22 +1151,9 @@ wavetable_poll(UNUSED(void *priv))
     if (wavetable_pos_global == WTBUFLEN) {
         memset(outbuffer_w, 0x00, WTBUFLEN * 2 * sizeof(int32_t));
 
-        for (uint8_t c = 0; c < handler_count; c++)
-            if (wavetable_handlers[c].get_buffer != NULL)
-                wavetable_handlers[c].get_buffer(outbuffer_w, WTBUFLEN, wavetable_handlers[c].priv);
-
-        for (uint32_t c = 0; c < WTBUFLEN * 2; c++) {
-            if (sound_is_float)
-                outbuffer_w_ex[c] = ((float) outbuffer_w[c]) / (float) 32768.0;
-            else {
-                if (outbuffer_w[c] > 32767)
-                    outbuffer_w[c] = 32767;
-                if (outbuffer_w[c] < -32768)
-                    outbuffer_w[c] = -32768;
+        sound_mix_handlers(wavetable_handlers, handler_count, outbuffer_w, WTBUFLEN);
 
-                outbuffer_w_ex_int16[c] = (int16_t) outbuffer_w[c];
-            }
-        }
+        sound_mix_convert(outbuffer_w, outbuffer_w_ex, outbuffer_w_ex_int16, WTBUFLEN * 2);
 
         if (sound_is_float)
             givealbuffer_wt(outbuffer_w_ex);
@@ -901,23 +1203,19 @@ sound_reset(void)
 
     memset(&sound_poll_timer, 0x00, sizeof(pc_timer_t));
     timer_add(&sound_poll_timer, sound_poll, NULL, 1);
-    sound_handlers_num = 0;
-    memset(sound_handlers, 0x00, NUM_SOUND_HANDLERS * sizeof(sound_handler_t));
+    sound_handlers_clear(sound_handlers, &sound_handlers_num, NUM_SOUND_HANDLERS);
 
     memset(&music_poll_timer, 0x00, sizeof(pc_timer_t));
     timer_add(&music_poll_timer, music_poll, NULL, 1);
-    music_handlers_num = 0;
-    memset(music_handlers, 0x00, NUM_MUSIC_HANDLERS * sizeof(sound_handler_t));
+    sound_handlers_clear(music_handlers, &music_handlers_num, NUM_MUSIC_HANDLERS);
 
     memset(&ym2151_poll_timer, 0x00, sizeof(pc_timer_t));
     timer_add(&ym2151_poll_timer, ym2151_poll, NULL, 1);
-    ym2151_handlers_num = 0;
-    memset(ym2151_handlers, 0x00, NUM_YM2151_HANDLERS * sizeof(sound_handler_t));
+    sound_handlers_clear(ym2151_handlers, &ym2151_handlers_num, NUM_YM2151_HANDLERS);
 
     memset(&wavetable_poll_timer, 0x00, sizeof(pc_timer_t));
     timer_add(&wavetable_poll_timer, wavetable_poll, NULL, 1);
-    wavetable_handlers_num = 0;
-    memset(wavetable_handlers, 0x00, NUM_WAVETABLE_HANDLERS * sizeof(sound_handler_t));
+    sound_handlers_clear(wavetable_handlers, &wavetable_handlers_num, NUM_WAVETABLE_HANDLERS);
 
     filter_cd_audio   = NULL;
     filter_cd_audio_p = NULL;
@@ -1137,20 +1435,16 @@ sound_close(void)
     timer_disable(&midi_poll_timer);
 
     timer_disable(&sound_poll_timer);
-    sound_handlers_num = 0;
-    memset(sound_handlers, 0x00, NUM_SOUND_HANDLERS * sizeof(sound_handler_t));
+    sound_handlers_clear(sound_handlers, &sound_handlers_num, NUM_SOUND_HANDLERS);
 
     timer_disable(&music_poll_timer);
-    music_handlers_num = 0;
-    memset(music_handlers, 0x00, NUM_MUSIC_HANDLERS * sizeof(sound_handler_t));
+    sound_handlers_clear(music_handlers, &music_handlers_num, NUM_MUSIC_HANDLERS);
 
     timer_disable(&ym2151_poll_timer);
-    ym2151_handlers_num = 0;
-    memset(ym2151_handlers, 0x00, NUM_YM2151_HANDLERS * sizeof(sound_handler_t));
+    sound_handlers_clear(ym2151_handlers, &ym2151_handlers_num, NUM_YM2151_HANDLERS);
 
     timer_disable(&wavetable_poll_timer);
-    wavetable_handlers_num = 0;
-    memset(wavetable_handlers, 0x00, NUM_WAVETABLE_HANDLERS * sizeof(sound_handler_t));
+    sound_handlers_clear(wavetable_handlers, &wavetable_handlers_num, NUM_WAVETABLE_HANDLERS);
 
     filter_cd_audio   = NULL;
     filter_cd_audio_p = NULL;
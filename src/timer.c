@@ -3,6 +3,7 @@
 #include <string.h>
 #include <wchar.h>
 #include <86box/86box.h>
+#include <86box/device_prof.h>
 #include "cpu.h"
 #include <86box/timer.h>
 #include <86box/nv/vid_nv_rivatimer.h>
@@ -135,7 +136,7 @@ timer_process(void)
                is needed.
              */
             timer->in_callback = 1;
-            timer->callback(timer->priv);
+            DEVICE_PROF_CALL(timer->prof, DEVICE_PROF_TIMER, timer->callback(timer->priv));
             timer->in_callback = 0;
         }
     }
@@ -185,6 +186,7 @@ timer_add(pc_timer_t *timer, void (*callback)(void *priv), void *priv, int start
     timer->priv        = priv;
     timer->flags       = 0;
     timer->prev        = timer->next = NULL;
+    timer->prof        = device_prof_slot();
     if (start_timer)
         timer_set_delay_u64(timer, 0);
 }
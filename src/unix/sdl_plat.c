@@ -326,6 +326,12 @@ plat_get_ticks(void)
     return (uint32_t) (plat_get_ticks_common() / 1000);
 }
 
+uint64_t
+plat_get_micro_ticks(void)
+{
+    return plat_get_ticks_common();
+}
+
 void
 plat_delay_ms(uint32_t count)
 {